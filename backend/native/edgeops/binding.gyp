@@ -0,0 +1,18 @@
+{
+  "variables": {
+    # Directory holding libedgeops, override with: node-gyp rebuild --edgeops_lib_dir=/path
+    "edgeops_lib_dir%": "<(module_root_dir)/../../operators/build"
+  },
+  "targets": [
+    {
+      "target_name": "edgeops",
+      "sources": ["src/addon.c"],
+      "include_dirs": ["<(module_root_dir)/../../operators/include"],
+      "libraries": [
+        "-L<(edgeops_lib_dir)",
+        "-ledgeops",
+        "-Wl,-rpath,<(edgeops_lib_dir)"
+      ]
+    }
+  ]
+}
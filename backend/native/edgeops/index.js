@@ -0,0 +1,29 @@
+const path = require("path");
+
+const addon = require(path.join(__dirname, "build", "Release", "edgeops.node"));
+
+// Runs an operator in-process on an encoded image and resolves with the encoded edges.
+// `flags` are the executable's flags, e.g. ["--threads=2", "--deadline-ms=5000"]; aborting
+// `signal` stops the operator at its next check. Rejects with an Error whose `code` is
+// CANCELLED, TOO_LARGE, UNKNOWN_OPERATOR or ERROR and whose `status` is the matching exit code.
+const processImage = (operator, input, { extension = ".png", flags = [], signal } = {}) => {
+  const token = addon.createToken();
+  const onAbort = () => addon.cancelToken(token);
+  if (signal) {
+    if (signal.aborted) {
+      onAbort();
+    } else {
+      signal.addEventListener("abort", onAbort, { once: true });
+    }
+  }
+
+  return addon
+    .process(operator, input, extension, flags.join(" "), token)
+    .finally(() => {
+      if (signal) {
+        signal.removeEventListener("abort", onAbort);
+      }
+    });
+};
+
+module.exports = { processImage };
@@ -0,0 +1,224 @@
+#include <node_api.h>
+#include <stdlib.h>
+#include <string.h>
+#include "capi/edgeops.h"
+
+// Node-API bindings to libedgeops. A job runs on the libuv thread pool so the event loop keeps
+// serving requests, reads its input straight from the caller's Buffer and hands the encoded
+// output back as a Buffer that owns the library's allocation, so no byte is copied on the way.
+
+#define CHECK(env, call)                                              \
+  do {                                                                \
+    if ((call) != napi_ok) {                                          \
+      napi_throw_error((env), NULL, "edgeops: " #call " failed");     \
+      return NULL;                                                    \
+    }                                                                 \
+  } while (0)
+
+typedef struct {
+  napi_async_work work;
+  napi_deferred deferred;
+  napi_ref input_ref; // keeps the input Buffer alive while the pool thread reads it
+  napi_ref token_ref; // keeps the token alive while the pool thread checks it, or NULL
+  char* operator_name;
+  char* extension;
+  char* flags;
+  const uint8_t* input;
+  size_t input_size;
+  edgeops_token* token;
+  uint8_t* output;
+  size_t output_size;
+  edgeops_status status;
+  char error[512];
+} process_job;
+
+static const char* status_code(edgeops_status status) {
+  switch (status) {
+    case EDGEOPS_CANCELLED:
+      return "CANCELLED";
+    case EDGEOPS_TOO_LARGE:
+      return "TOO_LARGE";
+    case EDGEOPS_UNKNOWN_OPERATOR:
+      return "UNKNOWN_OPERATOR";
+    default:
+      return "ERROR";
+  }
+}
+
+// Copies a JS string argument into a NUL-terminated heap string, NULL if it is not a string.
+static char* get_string(napi_env env, napi_value value) {
+  size_t length = 0;
+  if (napi_get_value_string_utf8(env, value, NULL, 0, &length) != napi_ok) {
+    return NULL;
+  }
+  char* string = malloc(length + 1);
+  if (string != NULL) {
+    napi_get_value_string_utf8(env, value, string, length + 1, &length);
+  }
+  return string;
+}
+
+static void free_job(napi_env env, process_job* job) {
+  if (job->input_ref != NULL) {
+    napi_delete_reference(env, job->input_ref);
+  }
+  if (job->token_ref != NULL) {
+    napi_delete_reference(env, job->token_ref);
+  }
+  if (job->work != NULL) {
+    napi_delete_async_work(env, job->work);
+  }
+  free(job->operator_name);
+  free(job->extension);
+  free(job->flags);
+  free(job);
+}
+
+static void finalize_output(napi_env env, void* data, void* hint) {
+  edgeops_free(data);
+}
+
+static void finalize_token(napi_env env, void* data, void* hint) {
+  edgeops_token_destroy(data);
+}
+
+// Runs on a thread pool thread: no JS values may be touched here.
+static void execute_process(napi_env env, void* data) {
+  process_job* job = data;
+  job->status = edgeops_process(job->operator_name, job->input, job->input_size, job->extension,
+                                job->flags, job->token, &job->output, &job->output_size,
+                                job->error, sizeof(job->error));
+}
+
+static void complete_process(napi_env env, napi_status status, void* data) {
+  process_job* job = data;
+  napi_value result;
+
+  if (status == napi_ok && job->status == EDGEOPS_OK) {
+    napi_status created = napi_create_external_buffer(env, job->output_size, job->output,
+                                                      finalize_output, NULL, &result);
+    if (created == napi_ok) {
+      job->output = NULL;
+    } else {
+      // runtimes that forbid external buffers get a copy instead
+      void* copy;
+      napi_create_buffer_copy(env, job->output_size, job->output, &copy, &result);
+    }
+    napi_resolve_deferred(env, job->deferred, result);
+  } else {
+    napi_value message, code, code_number;
+    napi_create_string_utf8(env, status == napi_ok ? job->error : "Job was not run",
+                            NAPI_AUTO_LENGTH, &message);
+    napi_create_string_utf8(env, status_code(job->status), NAPI_AUTO_LENGTH, &code);
+    napi_create_error(env, code, message, &result);
+    napi_create_int32(env, status == napi_ok ? job->status : EDGEOPS_ERROR, &code_number);
+    napi_set_named_property(env, result, "status", code_number);
+    napi_reject_deferred(env, job->deferred, result);
+  }
+
+  edgeops_free(job->output);
+  free_job(env, job);
+}
+
+// process(operator, input, extension, flags, token?) -> Promise<Buffer>
+static napi_value Process(napi_env env, napi_callback_info info) {
+  size_t argc = 5;
+  napi_value argv[5];
+  CHECK(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+
+  bool is_buffer = false;
+  if (argc < 4 || napi_is_buffer(env, argv[1], &is_buffer) != napi_ok || !is_buffer) {
+    napi_throw_type_error(env, NULL, "Expected (operator, buffer, extension, flags[, token])");
+    return NULL;
+  }
+
+  process_job* job = calloc(1, sizeof(process_job));
+  if (job == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+  job->operator_name = get_string(env, argv[0]);
+  job->extension = get_string(env, argv[2]);
+  job->flags = get_string(env, argv[3]);
+  if (job->operator_name == NULL || job->extension == NULL || job->flags == NULL) {
+    free_job(env, job);
+    napi_throw_type_error(env, NULL, "Expected operator, extension and flags to be strings");
+    return NULL;
+  }
+
+  void* input;
+  napi_get_buffer_info(env, argv[1], &input, &job->input_size);
+  job->input = input;
+  napi_create_reference(env, argv[1], 1, &job->input_ref);
+
+  napi_valuetype token_type = napi_undefined;
+  if (argc >= 5) {
+    napi_typeof(env, argv[4], &token_type);
+  }
+  if (token_type == napi_external) {
+    void* token;
+    napi_get_value_external(env, argv[4], &token);
+    job->token = token;
+    napi_create_reference(env, argv[4], 1, &job->token_ref);
+  }
+
+  napi_value promise, resource_name;
+  napi_create_string_utf8(env, "edgeops.process", NAPI_AUTO_LENGTH, &resource_name);
+  if (napi_create_promise(env, &job->deferred, &promise) != napi_ok
+      || napi_create_async_work(env, NULL, resource_name, execute_process, complete_process, job,
+                                &job->work) != napi_ok
+      || napi_queue_async_work(env, job->work) != napi_ok) {
+    free_job(env, job);
+    napi_throw_error(env, NULL, "Failed to queue the job");
+    return NULL;
+  }
+  return promise;
+}
+
+// createToken() -> token, released when garbage collected
+static napi_value CreateToken(napi_env env, napi_callback_info info) {
+  edgeops_token* token = edgeops_token_create();
+  if (token == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+  napi_value result;
+  if (napi_create_external(env, token, finalize_token, NULL, &result) != napi_ok) {
+    edgeops_token_destroy(token);
+    napi_throw_error(env, NULL, "Failed to create token");
+    return NULL;
+  }
+  return result;
+}
+
+// cancelToken(token): the job using it stops at its next check
+static napi_value CancelToken(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value argv[1];
+  void* token = NULL;
+  CHECK(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  if (argc < 1 || napi_get_value_external(env, argv[0], &token) != napi_ok) {
+    napi_throw_type_error(env, NULL, "Expected a token");
+    return NULL;
+  }
+  edgeops_token_cancel(token);
+  return NULL;
+}
+
+static napi_value Init(napi_env env, napi_value exports) {
+  // a library built from another version of the header must not be called through this one
+  if (edgeops_abi_version() != EDGEOPS_ABI_VERSION) {
+    napi_throw_error(env, NULL, "libedgeops ABI version does not match the addon");
+    return NULL;
+  }
+
+  napi_property_descriptor properties[] = {
+    {"process", NULL, Process, NULL, NULL, NULL, napi_default, NULL},
+    {"createToken", NULL, CreateToken, NULL, NULL, NULL, napi_default, NULL},
+    {"cancelToken", NULL, CancelToken, NULL, NULL, NULL, napi_default, NULL},
+  };
+  CHECK(env, napi_define_properties(env, exports, sizeof(properties) / sizeof(properties[0]), properties));
+  return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
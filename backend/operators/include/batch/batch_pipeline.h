@@ -0,0 +1,162 @@
+#ifndef OPERATORS_BATCH_PIPELINE_H
+#define OPERATORS_BATCH_PIPELINE_H
+
+#include "gradient/gradient_operator.h"
+#include "utils/image_utils.h"
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @file batch_pipeline.h
+ * @brief This file contains the declaration of the BatchPipeline that runs an operator over many
+ * images with decoding, edge detection and encoding overlapped on three threads.
+ *
+ * The stages hand slots to each other through SpscQueues: decode to compute, compute to encode,
+ * and encode back to decode once the output is written. The slots form the buffer pool: each
+ * keeps the capacity of its file buffer and its decoded image from one image to the next, and
+ * their number bounds the images in flight. While the operator computes image i, image i + 1 is
+ * decoded and image i - 1 encoded, so the throughput approaches that of the slowest stage.
+ *
+ * Small images do not fill the threads of one operator run: the fork and join of each parallel
+ * pass cost more than the work. Images up to the crossover size instead run one per thread, each
+ * worker decoding, detecting and encoding whole images with its own single-threaded operator.
+ */
+
+/**
+ * @brief One image of a batch.
+ */
+struct BatchJob {
+    std::string inputPath;
+    std::string outputPath; // its extension selects the output format as for getEdges
+};
+
+/**
+ * @brief Whether images are processed with all threads on one image or one image per thread.
+ */
+enum class BatchParallelism {
+    Auto,  // one image per thread up to the crossover size, all threads on one image above it
+    Intra, // always all threads on one image, through the overlapped stages
+    Inter  // always one image per thread
+};
+
+/**
+ * @brief How a batch runs.
+ */
+struct BatchOptions {
+    static constexpr double defaultCrossoverPixels = 512 * 512; // used until --tune measures it
+
+    size_t depth = 4;                        // images in flight across the overlapped stages
+    BatchParallelism parallelism = BatchParallelism::Auto;
+    double crossoverPixels = defaultCrossoverPixels; // largest image that runs one per thread
+    int workers = 0;                         // threads for one image per thread, 0 for the OpenMP default
+
+    /**
+     * @brief Applies one command line flag: --depth=N sets the images in flight and
+     * --parallelism=auto|intra|inter how images are spread over the threads.
+     * @param arg The command line argument.
+     * @throws std::runtime_error if the flag is known but its value is invalid.
+     * @return true if the flag was recognized, false otherwise.
+     */
+    bool parseFlag(const std::string& arg);
+};
+
+/**
+ * @brief Creates an operator for one worker thread, configured like the batch operator but
+ * single-threaded.
+ */
+using OperatorFactory = std::function<std::unique_ptr<GradientOperator>()>;
+
+/**
+ * @brief The outcome of a batch.
+ */
+struct BatchStats {
+    size_t images = 0;         // images written
+    size_t failed = 0;         // images that could not be read, processed or written
+    size_t interImages = 0;    // images that ran one per thread
+    double seconds = 0;        // wall time of the batch
+    double decodeSeconds = 0;  // time each stage was busy summed over threads
+    double computeSeconds = 0;
+    double encodeSeconds = 0;
+};
+
+class BatchPipeline {
+public:
+    /**
+     * @brief Constructs a BatchPipeline.
+     * @param gradientOperator The operator, with its options, limits and token already set.
+     * Only the compute stage runs its detection. Not owned.
+     * @param options The depth of the overlapped stages and the choice of parallelism.
+     * @param factory Creates the operators of the workers that run one image per thread, or
+     * nullptr to run every image through gradientOperator.
+     * @throws std::runtime_error if the depth is 0.
+     */
+    explicit BatchPipeline(GradientOperator& gradientOperator, const BatchOptions& options = BatchOptions(),
+                           OperatorFactory factory = nullptr);
+
+    /**
+     * @brief Sets the token the decode stage checks before reading the next image.
+     * @param token The token, or nullptr to always run every job. Not owned.
+     */
+    void setCancellationToken(const CancellationToken* token) {
+        cancellation = token;
+    }
+
+    /**
+     * @brief Processes the jobs in order. A job that fails is reported on stderr and counted,
+     * the others still run.
+     * @param jobs The jobs.
+     * @throws OperationCancelled if the token was cancelled before every job ran.
+     * @return The counts and stage times.
+     */
+    BatchStats run(const std::vector<BatchJob>& jobs);
+
+    /**
+     * @brief Checks whether an image runs one per thread.
+     * @param info The header of the input, or nothing if it was not recognized.
+     * @return true if the image runs on a worker with its own single-threaded operator.
+     */
+    [[nodiscard]] bool runsPerThread(const std::optional<ImageInfo>& info) const;
+
+    /**
+     * @brief Reads a batch manifest: one job per line, the input and output paths separated by a
+     * tab, or by the first whitespace if the line has no tab. Blank lines and lines starting with
+     * # are skipped.
+     * @param path The manifest path, or "-" for stdin.
+     * @throws std::runtime_error if the manifest cannot be read or a line has no output path.
+     * @return The jobs.
+     */
+    static std::vector<BatchJob> readManifest(const std::string& path);
+
+private:
+    /**
+     * @brief The buffers of one image in flight, recycled from image to image.
+     */
+    struct Slot {
+        size_t job = 0;
+        std::vector<uint8_t> input; // the encoded input, its capacity kept between images
+        cv::Mat image;              // the decoded input, its buffer reused for images of the same size
+        EdgeResult result;
+        std::string error;          // why the job failed, empty while it has not
+    };
+
+    /**
+     * @brief Runs jobs through the overlapped decode, compute and encode stages.
+     */
+    void runOverlapped(const std::vector<BatchJob>& jobs, const std::vector<size_t>& indices, BatchStats& stats);
+
+    /**
+     * @brief Runs jobs one per worker thread, each worker doing all three stages.
+     */
+    void runPerThread(const std::vector<BatchJob>& jobs, const std::vector<size_t>& indices, BatchStats& stats);
+
+    GradientOperator& gradientOperator;
+    BatchOptions options;
+    OperatorFactory factory;
+    const CancellationToken* cancellation = nullptr;
+};
+
+#endif //OPERATORS_BATCH_PIPELINE_H
@@ -0,0 +1,97 @@
+#ifndef OPERATORS_EDGEOPS_H
+#define OPERATORS_EDGEOPS_H
+
+/**
+ * @file edgeops.h
+ * @brief This file contains the stable C ABI of the operator library, used to run the operators
+ * in-process from other languages. Only plain C types cross the boundary, so the library can be
+ * rebuilt with another compiler or C++ standard library without rebuilding its callers.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define EDGEOPS_API __declspec(dllexport)
+#else
+#define EDGEOPS_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Incremented whenever a declaration in this file changes incompatibly. */
+#define EDGEOPS_ABI_VERSION 1
+
+/* Result of edgeops_process; the values match the exit codes of the operators executable. */
+typedef enum edgeops_status {
+    EDGEOPS_OK = 0,
+    EDGEOPS_ERROR = 1,
+    EDGEOPS_CANCELLED = 2,
+    EDGEOPS_TOO_LARGE = 3,
+    EDGEOPS_UNKNOWN_OPERATOR = 4
+} edgeops_status;
+
+/* Cancellation token shared between the thread running a job and the thread cancelling it. */
+typedef struct edgeops_token edgeops_token;
+
+/**
+ * @brief Get the ABI version the library was built with.
+ * @return EDGEOPS_ABI_VERSION of the library.
+ */
+EDGEOPS_API int edgeops_abi_version(void);
+
+/**
+ * @brief Creates a cancellation token.
+ * @return The token, to be released with edgeops_token_destroy.
+ */
+EDGEOPS_API edgeops_token* edgeops_token_create(void);
+
+/**
+ * @brief Cancels a token. Safe to call from any thread while a job uses it.
+ * @param token The token.
+ */
+EDGEOPS_API void edgeops_token_cancel(edgeops_token* token);
+
+/**
+ * @brief Releases a token once no job uses it.
+ * @param token The token, or NULL.
+ */
+EDGEOPS_API void edgeops_token_destroy(edgeops_token* token);
+
+/**
+ * @brief Decodes an image, runs an operator on it and encodes the edges.
+ * @param operator_name The operator name as used by the backend routes, e.g. "opencv%20sobel".
+ * @param input The encoded input image.
+ * @param input_size The size of the input in bytes.
+ * @param output_extension The output format as a file extension, e.g. ".png" or ".jpg". Tile
+ * pyramids (.dzi or {z}/{x}/{y} templates) are written to files by the executable only and fail
+ * with EDGEOPS_ERROR.
+ * @param flags Space-separated flags as accepted by the executable, e.g. "--threads=2
+ * --max-memory=256 --deadline-ms=5000", or NULL.
+ * @param token The cancellation token, or NULL. A --deadline-ms flag sets its deadline.
+ * @param output Receives the encoded output, to be released with edgeops_free.
+ * @param output_size Receives the size of the output in bytes.
+ * @param error Receives a NUL-terminated message on failure, or NULL.
+ * @param error_size The capacity of error in bytes.
+ * @return EDGEOPS_OK, or the reason the job failed.
+ */
+EDGEOPS_API edgeops_status edgeops_process(const char* operator_name,
+                                           const uint8_t* input, size_t input_size,
+                                           const char* output_extension, const char* flags,
+                                           edgeops_token* token,
+                                           uint8_t** output, size_t* output_size,
+                                           char* error, size_t error_size);
+
+/**
+ * @brief Releases an output buffer returned by edgeops_process.
+ * @param buffer The buffer, or NULL.
+ */
+EDGEOPS_API void edgeops_free(uint8_t* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //OPERATORS_EDGEOPS_H
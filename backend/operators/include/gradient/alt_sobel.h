@@ -33,6 +33,22 @@ public:
      */
     Mat getEdges(const string& inputPath, const string& outputName) override;
 
+    /**
+     * @brief Detects edges in an image that is already in memory.
+     * @param image The BGR or grayscale input image.
+     * @throws runtime_error if the input image is empty.
+     * @return The image with the edges detected.
+     */
+    Mat detectEdges(const Mat& image) override;
+
+    /**
+     * @brief Detects edges and also returns the gradients they were combined from.
+     * @param image The input image.
+     * @param planes Receives the CV_32S gradients.
+     * @return The image with the edges detected.
+     */
+    Mat detectEdgesWithGradients(const Mat& image, GradientPlanes& planes) override;
+
     /**
      * @brief Get the name of the operator.
      *
@@ -40,8 +56,29 @@ public:
      */
     [[nodiscard]] virtual string getOperatorName() const override;
 
+    /**
+     * @brief Estimates the peak memory and time of the operator on an image of the given size.
+     * @param imageSize The decoded image size.
+     * @return The estimate.
+     */
+    [[nodiscard]] ResourceEstimate estimateResources(Size imageSize) const override;
+
+    /**
+     * @brief Get how far detectEdges reaches: one pixel, plus the Gaussian when smoothing.
+     * @return The radius.
+     */
+    [[nodiscard]] int haloRadius() const override;
+
 private:
 
+    /**
+     * @brief Runs the operator, copying the gradients out only when they are asked for.
+     * @param image The input image.
+     * @param planes Receives the CV_32S gradients, or nullptr.
+     * @return The image with the edges detected.
+     */
+    Mat detect(const Mat& image, GradientPlanes* planes);
+
     /**
      * @brief Converts the input image to RGB.
      * @param input The input image.
@@ -58,6 +95,13 @@ private:
      */
     [[nodiscard]] vector<vector<uint8_t>> convertToGrayscale(const vector<vector<vector<uint8_t>>>& rgbMatrix) const;
 
+    /**
+     * @brief Smooths the grayscale image with a separable Gaussian, rows then columns, replicating
+     * the edge pixels. AltSobel is the handwritten reference, so the smoothing runs as its own pass.
+     * @param grayImage The grayscale image, smoothed in place.
+     */
+    void smoothGrayscale(vector<vector<uint8_t>>& grayImage) const;
+
     /**
      * @brief Computes the gradient in the x-direction.
      * @param input The input image.
@@ -0,0 +1,86 @@
+#ifndef OPERATORS_AUTO_SOBEL_H
+#define OPERATORS_AUTO_SOBEL_H
+
+#include "gradient_operator.h"
+#include "sobel_tuner.h"
+#include "utils/execution_config.h"
+using namespace std;
+using namespace cv;
+
+/**
+ * @file auto_sobel.h
+ * @brief This file contains the declaration of the AutoSobel operator that dispatches each image
+ * to the Sobel backend, tile size and thread count a SobelAutoTuner measured fastest for its size.
+ */
+class AutoSobel : public GradientOperator {
+private:
+    TuningTable table; // measured fastest variant per image size
+    ExecutionConfig limits; // caps the thread count of the selected variant
+
+public:
+    /**
+     * @brief Constructs an AutoSobel object.
+     * @param table The tuning table. Default is TuningTable::hostTable().
+     * @param limits The execution configuration whose thread count caps the selected variant.
+     */
+    explicit AutoSobel(TuningTable table = TuningTable::hostTable(),
+                       const ExecutionConfig& limits = ExecutionConfig());
+
+    /**
+     * @brief Detects edges in the input image.
+     * @param inputPath The path to the input image.
+     * @param outputName The path to the output image.
+     * @throws runtime_error if the input image is empty.
+     * @return The image with the edges detected.
+     */
+    Mat getEdges(const string& inputPath, const string& outputName) override;
+
+    /**
+     * @brief Detects edges in an image that is already in memory.
+     * @param image The BGR or grayscale input image.
+     * @throws runtime_error if the input image is empty.
+     * @return The image with the edges detected.
+     */
+    Mat detectEdges(const Mat& image) override;
+
+    /**
+     * @brief Detects edges with the selected backend and also returns its gradients.
+     * @param image The input image.
+     * @param planes Receives the gradients, in the depth of the selected backend.
+     * @return The image with the edges detected.
+     */
+    Mat detectEdgesWithGradients(const Mat& image, GradientPlanes& planes) override;
+
+    /**
+     * @brief Get the name of the operator.
+     *
+     * @return The name of the operator.
+     */
+    [[nodiscard]] string getOperatorName() const override;
+
+    /**
+     * @brief Estimates the peak memory and time of the operator on an image of the given size.
+     * @param imageSize The decoded image size.
+     * @return The estimate.
+     */
+    [[nodiscard]] ResourceEstimate estimateResources(Size imageSize) const override;
+
+    /**
+     * @brief Selects the variant to run for an image size. Without a tuning table this is
+     * OcvSobel with the OpenCV default thread count. The thread count never exceeds the limit.
+     * @param imageSize The size of the image.
+     * @return The variant.
+     */
+    [[nodiscard]] TuningEntry selectVariant(Size imageSize) const;
+
+private:
+    /**
+     * @brief Runs the selected backend, asking it for its gradients only when they are wanted.
+     * @param image The input image.
+     * @param planes Receives the gradients, or nullptr.
+     * @return The image with the edges detected.
+     */
+    Mat detect(const Mat& image, GradientPlanes* planes);
+};
+
+#endif //OPERATORS_AUTO_SOBEL_H
@@ -2,7 +2,46 @@
 #define GRADIENT_OPERATOR_H
 
 #include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <optional>
 #include <string>
+#include <vector>
+#include "utils/cancellation.h"
+#include "utils/edge_options.h"
+#include "utils/encode_options.h"
+#include "utils/resource_limits.h"
+
+struct ImageInfo;
+
+/**
+ * @brief The signed derivatives an operator combines into its magnitude.
+ */
+struct GradientPlanes {
+    cv::Mat gradX; // derivative along the operator's first axis, single channel in its working depth
+    cv::Mat gradY; // derivative along the second axis, same size and depth
+};
+
+/**
+ * @brief What an operator computed for one output, before it is encoded.
+ */
+struct EdgeResult {
+    cv::Mat edges;         // the edge map, thresholded if the options ask for it
+    cv::Mat magnitude;     // the 8-bit magnitude before thresholding, for .pts point lists
+    GradientPlanes planes; // the gradients, for .npy tensors and point directions
+    int level = 0;         // the threshold level of the point list
+};
+
+/**
+ * @brief How an input is decoded, planned from its header before any pixel is read.
+ */
+struct DecodePlan {
+    bool probed = false;       // false if the header was not recognized, nothing else is set then
+    cv::Size imageSize;        // the size of the whole input
+    cv::Rect region;           // the part that is decoded, the whole input without a region of interest
+    ResourceEstimate estimate; // peak memory and time for the decoded part
+    int reduction = 1;         // the decode downscale, always 1 with a region of interest
+    bool partial = false;      // only the region is read from the file, see ImageUtils::canDecodeRegion
+};
 
 /**
  * @file Operator.cpp
@@ -24,12 +63,274 @@ public:
      */
     virtual cv::Mat getEdges(const std::string& inputPath, const std::string& outputName) = 0;
 
+    /**
+     * @brief Detects edges in an image that is already in memory.
+     * @param image The input image, either BGR or grayscale.
+     * @throws std::runtime_error if the input image is empty.
+     * @return The image with the edges detected.
+     */
+    virtual cv::Mat detectEdges(const cv::Mat& image) = 0;
+
+    /**
+     * @brief Detects edges like detectEdges and also returns the gradients they were combined from.
+     * @param image The input image, either BGR or grayscale.
+     * @param planes Receives the gradients, the size of the image.
+     * @throws std::runtime_error if the operator does not compute separate gradients.
+     * @return The image with the edges detected.
+     */
+    virtual cv::Mat detectEdgesWithGradients(const cv::Mat& image, GradientPlanes& planes);
+
+    /**
+     * @brief Detects edges in a decoded image, applies the edge options and encodes the result in
+     * the format the extension selects: an image format, a .pbm or .rle mask, a .pts point list or
+     * an .npy tensor of the gradients.
+     * @param image The input image.
+     * @param extension The extension, e.g. ".png".
+     * @param edges Receives the edge map, thresholded if the options ask for it.
+     * @throws std::runtime_error if the result cannot be encoded in that format.
+     * @return The encoded result.
+     */
+    std::vector<uint8_t> encodeEdges(const cv::Mat& image, const std::string& extension, cv::Mat& edges);
+
+    /**
+     * @brief The detection half of encodeEdges: computes what the format the extension selects needs.
+     * With a region of interest only the region and its halo are detected, and the result is the
+     * size of the region.
+     * @param image The input image.
+     * @param extension The extension, e.g. ".png".
+     * @throws OperationCancelled if the operator is cancelled.
+     * @throws std::runtime_error if the region of interest lies outside the image.
+     * @return The result to pass to encodeResult.
+     */
+    EdgeResult computeEdges(const cv::Mat& image, const std::string& extension);
+
+    /**
+     * @brief The encoding half of encodeEdges. Uses no detection state, so it may run on another
+     * thread while the operator computes the next image.
+     * @param result The result of computeEdges for the same extension.
+     * @param extension The extension, e.g. ".png".
+     * @throws std::runtime_error if the result cannot be encoded in that format.
+     * @return The encoded result.
+     */
+    std::vector<uint8_t> encodeResult(const EdgeResult& result, const std::string& extension);
+
     /**
      * @brief Get the name of the operator.
      *
      * @return The name of the operator.
      */
     [[nodiscard]] virtual std::string getOperatorName() const = 0;
+
+    /**
+     * @brief Estimates the peak memory and time of detectEdges on an image of the given size,
+     * counting the decoded input the operator's getEdges reads.
+     * @param imageSize The decoded image size.
+     * @return The estimate.
+     */
+    [[nodiscard]] virtual ResourceEstimate estimateResources(cv::Size imageSize) const = 0;
+
+    /**
+     * @brief Get the mode the operator decodes its input with.
+     * @return cv::IMREAD_GRAYSCALE for operators that only use intensity, cv::IMREAD_COLOR otherwise.
+     */
+    [[nodiscard]] virtual cv::ImreadModes inputMode() const {
+        return cv::IMREAD_COLOR;
+    }
+
+    /**
+     * @brief Get how far detectEdges reaches: an output pixel depends only on the input pixels
+     * within this many rows and columns, so detecting edges in a region with that halo around it
+     * gives the edges of the whole image inside the region.
+     * @return The radius, or -1 if output pixels depend on the whole image, e.g. through a
+     * normalization by the global maximum.
+     */
+    [[nodiscard]] virtual int haloRadius() const {
+        return -1;
+    }
+
+    /**
+     * @brief Get the part of an image detection reads for the region of interest: the region with
+     * the halo around it, within the image. Operators without a halo read the region alone, so
+     * their normalization covers the region rather than the whole image.
+     * @param imageSize The size of the image.
+     * @throws std::runtime_error if the region lies outside the image.
+     * @return The rectangle, the whole image if no region is set.
+     */
+    [[nodiscard]] cv::Rect inputRegion(cv::Size imageSize) const;
+
+    /**
+     * @brief Get the region of interest within an image.
+     * @param imageSize The size of the image.
+     * @throws std::runtime_error if the region lies outside the image.
+     * @return The rectangle, the whole image if no region is set.
+     */
+    [[nodiscard]] cv::Rect outputRegion(cv::Size imageSize) const;
+
+    /**
+     * @brief Sets the budget getEdges checks against the header of the input before decoding it.
+     * @param resourceLimits The budget.
+     */
+    void setResourceLimits(const ResourceLimits& limits) {
+        resourceLimits = limits;
+    }
+
+    /**
+     * @brief Sets what the operator computes beyond the plain gradient, e.g. Gaussian pre-smoothing.
+     * @param options The options.
+     */
+    void setEdgeOptions(const EdgeOptions& options) {
+        edgeOptions = options;
+    }
+
+    /**
+     * @brief Sets the codec settings of the image formats encodeEdges writes.
+     * @param options The options.
+     */
+    void setEncodeOptions(const EncodeOptions& options) {
+        encodeOptions = options;
+    }
+
+    /**
+     * @brief Get the time the last encodeEdges spent encoding its result, after detection.
+     * @return The time in seconds, 0 before the first call.
+     */
+    [[nodiscard]] double lastEncodeSeconds() const {
+        return encodeSeconds;
+    }
+
+    /**
+     * @brief Applies the threshold of the edge options to the output of detectEdges.
+     * @param edges The 8-bit magnitude.
+     * @return A 0 / 255 edge map, or edges itself if no threshold is set.
+     */
+    [[nodiscard]] cv::Mat thresholdEdges(const cv::Mat& edges) const;
+
+    /**
+     * @brief Chooses the decode reduction for an input: 1 if it fits the budget, otherwise the
+     * smallest of 2, 4 and 8 that fits when the policy allows downscaling.
+     * @param info The header of the input.
+     * @param mode The mode the input is decoded with.
+     * @throws ImageTooLarge if no allowed reduction fits.
+     * @return The reduction.
+     */
+    [[nodiscard]] int planReduction(const ImageInfo& info, cv::ImreadModes mode) const;
+
+    /**
+     * @brief Probes the header of an input file and plans its decode as getEdges does: the
+     * reduction that fits the budget, or with a region of interest the part of the file to read.
+     * Nothing is printed, so callers report the plan as they see fit.
+     * @param inputPath The path to the input image.
+     * @param mode The mode the input is decoded with.
+     * @throws ImageTooLarge if the input does not fit the budget.
+     * @return The plan, not probed if the format is not recognized.
+     */
+    [[nodiscard]] DecodePlan planDecode(const std::string& inputPath, cv::ImreadModes mode) const;
+
+    /**
+     * @brief Plans the decode of a whole probed input, as decodeImage does for encoded images.
+     * @param info The probed header, or nothing if the format was not recognized.
+     * @param mode The mode the input is decoded with.
+     * @throws ImageTooLarge if the input does not fit the budget.
+     * @return The plan, not probed if the header is unknown.
+     */
+    [[nodiscard]] DecodePlan planDecode(const std::optional<ImageInfo>& info, cv::ImreadModes mode) const;
+
+    /**
+     * @brief Decodes an encoded image in memory under the same budget getEdges applies to files.
+     * @param data The encoded image.
+     * @param size The size of the encoded image in bytes.
+     * @throws ImageTooLarge if the image does not fit the budget.
+     * @throws std::runtime_error if the image cannot be decoded.
+     * @return The image, decoded with inputMode().
+     */
+    cv::Mat decodeImage(const uint8_t* data, size_t size) const;
+
+    /**
+     * @brief Decodes like decodeImage into an existing image, reusing its buffer when the size and
+     * type match.
+     * @param data The encoded image.
+     * @param size The size of the encoded image in bytes.
+     * @param image Receives the image.
+     * @throws ImageTooLarge if the image does not fit the budget.
+     * @throws std::runtime_error if the image cannot be decoded.
+     */
+    void decodeImage(const uint8_t* data, size_t size, cv::Mat& image) const;
+
+    /**
+     * @brief Sets the token the operator checks between stages and inside long loops.
+     * @param token The token, or nullptr to always run to completion. Not owned.
+     */
+    void setCancellationToken(const CancellationToken* token) {
+        cancellation = token;
+    }
+
+protected:
+    /**
+     * @brief Stops the operator if its token was cancelled or its deadline has passed.
+     * @throws OperationCancelled if the operator should stop.
+     */
+    void checkCancelled() const {
+        if (cancellation) {
+            cancellation->throwIfCancelled();
+        }
+    }
+
+    /**
+     * @brief Encodes the edges of a decoded input and writes them to the output path, in the format
+     * its extension selects as for encodeEdges, or as a tile pyramid for a .dzi path or an XYZ
+     * template, see TilePyramid.
+     * @param image The input image as loadImage returns it, only the region of interest and its
+     * halo if a region is set.
+     * @param outputName The output path.
+     * @throws OperationCancelled if the operator is cancelled before the output is written.
+     * @throws std::runtime_error if the result cannot be encoded or written.
+     * @return The edge map, or an empty map for a pyramid, which is never held whole.
+     */
+    cv::Mat writeEdges(const cv::Mat& image, const std::string& outputName);
+
+    /**
+     * @brief Probes the input header, checks the estimate against the budget and decodes the
+     * input at the planned reduction. Inputs in formats the probe does not know are decoded as is.
+     * With a region of interest only inputRegion() is decoded, at full resolution, and the budget
+     * is checked for it.
+     * @param inputPath The path to the input image.
+     * @param mode The decode mode.
+     * @throws ImageTooLarge if the input does not fit the budget.
+     * @throws std::runtime_error if the image cannot be read.
+     * @return The image.
+     */
+    cv::Mat loadImage(const std::string& inputPath, cv::ImreadModes mode = cv::IMREAD_COLOR) const;
+
+    /**
+     * @brief Detects the edges of a region of an image, and computes the result for the extension
+     * from them as computeEdges does.
+     * @param image The image.
+     * @param input The part of the image the detection reads.
+     * @param output The part of the image the result covers, within input.
+     * @param extension The extension, e.g. ".png".
+     * @return The result, the size of output.
+     */
+    EdgeResult computeRegion(const cv::Mat& image, const cv::Rect& input, const cv::Rect& output,
+                             const std::string& extension);
+
+    /**
+     * @brief Writes the edges of a region as a tile pyramid. Operators with a halo detect the
+     * region one tile row at a time, so the tiles of a band are written while the next one is
+     * detected and the full map is never held; the others detect the region at once.
+     * @param image The image.
+     * @param input The part of the image the detection reads.
+     * @param output The part of the image the pyramid covers, within input.
+     * @param outputName The .dzi path or XYZ template.
+     * @throws std::runtime_error if a tile cannot be encoded or written.
+     */
+    void writePyramid(const cv::Mat& image, const cv::Rect& input, const cv::Rect& output,
+                      const std::string& outputName);
+
+    const CancellationToken* cancellation = nullptr; // checked between stages, not owned
+    ResourceLimits resourceLimits;                   // budget checked before decoding
+    EdgeOptions edgeOptions;                         // smoothing folded into the derivative
+    EncodeOptions encodeOptions;                     // codec settings of the output
+    double encodeSeconds = 0;                        // time spent in the last encode
 };
 
 #endif // GRADIENT_OPERATOR_H
@@ -19,8 +19,31 @@ public:
 
     Mat getEdges(const string &inputPath, const string &outputName) override;
 
+    Mat detectEdges(const Mat& image) override;
+
+    /**
+     * @brief Detects edges and also returns the gradients they were combined from.
+     * @param image The input image.
+     * @param planes Receives the CV_64F gradients.
+     * @return The image with the edges detected.
+     */
+    Mat detectEdgesWithGradients(const Mat& image, GradientPlanes& planes) override;
+
     string getOperatorName() const override;
 
+    /**
+     * @brief Estimates the peak memory and time of the operator on an image of the given size.
+     * @param imageSize The decoded image size.
+     * @return The estimate.
+     */
+    [[nodiscard]] ResourceEstimate estimateResources(Size imageSize) const override;
+
+    /**
+     * @brief The operator only uses intensity, so its input is decoded as grayscale.
+     * @return cv::IMREAD_GRAYSCALE.
+     */
+    [[nodiscard]] ImreadModes inputMode() const override;
+
 private:
     /**
      * @brief Converts the input image to RGB.
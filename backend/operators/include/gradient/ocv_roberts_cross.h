@@ -27,12 +27,40 @@ public:
      */
     Mat getEdges(const string &inputPath, const string &outputName) override;
 
+    /**
+     * @brief Gets the edges of an image that is already in memory.
+     * @param image The BGR or grayscale input image.
+     * @return The edges of the input image.
+     */
+    Mat detectEdges(const Mat& image) override;
+
+    /**
+     * @brief Detects edges and also returns the gradients they were combined from.
+     * @param image The input image.
+     * @param planes Receives the CV_64F diagonal gradients.
+     * @return The image with the edges detected.
+     */
+    Mat detectEdgesWithGradients(const Mat& image, GradientPlanes& planes) override;
+
     /**
      * @brief Gets the operator name.
      * @return The operator name.
      */
     string getOperatorName() const override;
 
+    /**
+     * @brief Estimates the peak memory and time of the operator on an image of the given size.
+     * @param imageSize The decoded image size.
+     * @return The estimate.
+     */
+    [[nodiscard]] ResourceEstimate estimateResources(Size imageSize) const override;
+
+    /**
+     * @brief The operator only uses intensity, so its input is decoded as grayscale.
+     * @return cv::IMREAD_GRAYSCALE.
+     */
+    [[nodiscard]] ImreadModes inputMode() const override;
+
 private:
 
     /**
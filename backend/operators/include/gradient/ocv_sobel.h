@@ -15,17 +15,35 @@ private:
     int ksize;  // kernel size for the OcvSobel operator
     double scale; // scaling factor for the gradient values
     double delta; // offset added to the gradient values
+    int threads;  // stripes detectEdges runs in parallel, 0 for the process-wide OpenCV pool as it is
 
 public:
     /**
      * @brief Constructs a OcvSobel object.
      * @param kernelSize The size of the kernel for the OcvSobel operator. Default is 3.
+     * @param threads The number of row stripes each call runs in parallel, which bounds its
+     * threads without cv::setNumThreads. Default is 0, which leaves the split to OpenCV.
      */
-    explicit OcvSobel(int kernelSize = 3);
+    explicit OcvSobel(int kernelSize = 3, int threads = 0);
 
     Mat getEdges(const string& inputPath, const string& outputName) override;
+    Mat detectEdges(const Mat& image) override;
+    Mat detectEdgesWithGradients(const Mat& image, GradientPlanes& planes) override;
     [[nodiscard]] string getOperatorName() const override;
 
+    /**
+     * @brief Estimates the peak memory and time of the operator on an image of the given size.
+     * @param imageSize The decoded image size.
+     * @return The estimate.
+     */
+    [[nodiscard]] ResourceEstimate estimateResources(Size imageSize) const override;
+
+    /**
+     * @brief The operator only uses intensity, so its input is decoded as grayscale.
+     * @return cv::IMREAD_GRAYSCALE.
+     */
+    [[nodiscard]] ImreadModes inputMode() const override;
+
 private:
 
     /**
@@ -56,6 +74,16 @@ private:
      */
     [[nodiscard]] Mat computeGradientY(const Mat& image) const;
 
+    /**
+     * @brief Detects edges like detectEdgesWithGradients in row stripes, at most threads of them
+     * running at once. The filters read the rows around a stripe from the whole image, so the
+     * result equals that of a single pass.
+     * @param image The input image.
+     * @param planes Receives the gradients.
+     * @return The image with the edges detected.
+     */
+    Mat detectInStripes(const Mat& image, GradientPlanes& planes) const;
+
     /**
      * @brief Combines the gradients in the x and y directions.
      * @param gradX The gradient in the x-direction.
@@ -3,6 +3,8 @@
 
 #include <omp.h>
 #include "gradient_operator.h"
+#include "utils/tile_scheduler.h"
+#include "utils/smoothed_kernels.h"
 using namespace std;
 using namespace cv;
 
@@ -10,6 +12,8 @@ using namespace cv;
  * @file ocv_sobel.h
  * @brief This file contains the declaration of the OcvSobel operator based on 
  * the Alt OcvSobel operator with OpenMP parallelization.
+ * The whole pipeline runs per tile on a work-stealing TileScheduler, so the image is
+ * processed in a single parallel region and intermediates never leave the L2 cache.
  */
 class OmpSobel : public GradientOperator {
 private:
@@ -18,13 +22,17 @@ private:
     double delta; // offset added to the gradient values
     int height; // height of the image
     int width; // width of the image
+    TileScheduler scheduler; // splits the image into cache-sized tiles and runs them in parallel
+    SeparableKernel smoothedX; // Sobel x kernel with the Gaussian folded in, when smoothing
+    SeparableKernel smoothedY; // Sobel y kernel with the Gaussian folded in, when smoothing
 
 public:
     /**
      * Constructs an OmpSobel object.
      * @param kernelSize The size of the kernel for the OcvSobel operator. Default is 3.
+     * @param config The thread count, schedule, chunk or tile size and pinning policy.
      */
-    explicit OmpSobel(int kernelSize = 3);
+    explicit OmpSobel(int kernelSize = 3, const ExecutionConfig& config = ExecutionConfig());
 
     /**
      * @brief Detects edges in the input image.
@@ -34,6 +42,22 @@ public:
      */
     Mat getEdges(const string& inputPath, const string& outputName) override;
 
+    /**
+     * @brief Detects edges in an image that is already in memory.
+     * @param image The BGR or grayscale input image.
+     * @throws runtime_error if the input image is empty.
+     * @return The image with the edges detected.
+     */
+    Mat detectEdges(const Mat& image) override;
+
+    /**
+     * @brief Detects edges and also returns the gradients they were combined from.
+     * @param image The input image.
+     * @param planes Receives the CV_32S, or CV_32F when smoothing, gradients.
+     * @return The image with the edges detected.
+     */
+    Mat detectEdgesWithGradients(const Mat& image, GradientPlanes& planes) override;
+
     /**
      * @brief Get the name of the operator.
      *
@@ -41,46 +65,91 @@ public:
      */
     [[nodiscard]] virtual string getOperatorName() const override;
 
+    /**
+     * @brief Estimates the peak memory and time of the operator on an image of the given size.
+     * @param imageSize The decoded image size.
+     * @return The estimate.
+     */
+    [[nodiscard]] ResourceEstimate estimateResources(Size imageSize) const override;
+
+    /**
+     * @brief Get how far detectEdges reaches: one pixel, plus the Gaussian when smoothing.
+     * @return The radius.
+     */
+    [[nodiscard]] int haloRadius() const override;
+
+    /**
+     * @brief Get the execution configuration, with the tile size resolved.
+     * @return The execution configuration.
+     */
+    [[nodiscard]] const ExecutionConfig& getExecutionConfig() const;
+
 private:
 
     /**
-     * @brief Converts the input image to RGB.
+     * @brief Runs the operator, copying the gradient tiles out only when they are asked for.
+     * @param image The input image.
+     * @param planes Receives the gradients, or nullptr.
+     * @return The image with the edges detected.
+     */
+    Mat detect(const Mat& image, GradientPlanes* planes);
+
+    /**
+     * @brief Runs the whole pipeline on one tile and writes the tile of the output image.
      * @param input The input image.
-     * @return The image in RGB format represented in a 3D vector.
+     * @param tile The tile of the image to process.
+     * @param edges The output image.
+     * @param planes The full-size gradients to copy the tile's gradients into, or nullptr.
      */
-    Mat convertToRGB(const Mat& input) const;
+    void processTile(const Mat& input, const Rect& tile, Mat& edges, GradientPlanes* planes) const;
 
     /**
-     * @brief Converts the input image to grayscale.
+     * @brief Runs the smoothed pipeline on one tile: the halo grows to the radius of the smoothed
+     * kernels, sides on the image border are reflected as cv::BORDER_DEFAULT does, and both
+     * gradients come from one separable pass each, so the result does not depend on the tiling.
+     * @param input The input image.
+     * @param tile The tile of the image to process.
+     * @param edges The output image.
+     * @param planes The full-size gradients to copy the tile's gradients into, or nullptr.
+     */
+    void processSmoothedTile(const Mat& input, const Rect& tile, Mat& edges, GradientPlanes* planes) const;
+
+    /**
+     * @brief Converts a region of the input image to grayscale.
      * The RGB values are converted to grayscale using the National Television System Committee formula:
      * 0.299 ∙ Red + 0.587 ∙ Green + 0.114 ∙ Blue.
-     * @param rgbMatrix The input image in RGB format.
-     * @return The image in grayscale format represented in a 2D vector.
+     * @param input The input image.
+     * @param region The region of the input image to convert.
+     * @param grayImage The region in grayscale format.
      */
-    Mat convertToGrayscale(const Mat& rgbImage) const;
+    void convertToGrayscale(const Mat& input, const Rect& region, Mat& grayImage) const;
 
     /**
-     * @brief Computes the gradient in the x-direction.
-     * @param input The input image.
-     * @return The gradient in the x-direction.
+     * @brief Computes the gradient in the x-direction for a tile.
+     * @param grayImage The grayscale region covering the tile and its halo.
+     * @param region The position of the grayscale region in the image.
+     * @param tile The tile of the image.
+     * @param gradX The gradient in the x-direction for the tile.
      */
-    [[nodiscard]] Mat computeGradientX(const Mat& grayImage) const;
+    void computeGradientX(const Mat& grayImage, const Rect& region, const Rect& tile, Mat& gradX) const;
 
-        /**
-         * @brief Computes the gradient in the y-direction.
-         * @param input The input image.
-         * @return The gradient in the y-direction.
-         */
-    [[nodiscard]] Mat computeGradientY(const Mat& grayImage) const;
+    /**
+     * @brief Computes the gradient in the y-direction for a tile.
+     * @param grayImage The grayscale region covering the tile and its halo.
+     * @param region The position of the grayscale region in the image.
+     * @param tile The tile of the image.
+     * @param gradY The gradient in the y-direction for the tile.
+     */
+    void computeGradientY(const Mat& grayImage, const Rect& region, const Rect& tile, Mat& gradY) const;
 
     /**
      * @brief Combines the gradients in the x and y directions.
      * @param gradX The gradient in the x-direction.
      * @param gradY The gradient in the y-direction.
-     * @return The combined gradients.
+     * @param combined The combined gradients.
      */
-    Mat combineGradients(const Mat& gradX, const Mat& gradY) const;
-    };
+    static void combineGradients(const Mat& gradX, const Mat& gradY, Mat& combined);
+};
 
 
 #endif //OPERATORS_OMP_SOBEL_H
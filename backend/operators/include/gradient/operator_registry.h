@@ -0,0 +1,145 @@
+#ifndef OPERATORS_OPERATOR_REGISTRY_H
+#define OPERATORS_OPERATOR_REGISTRY_H
+
+#include "gradient_operator.h"
+#include "utils/execution_config.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @file operator_registry.h
+ * @brief This file contains the declaration of the OperatorRegistry, where each operator registers
+ * its name, parameters, cost model and capabilities. The CLI, the C API and the batch modes look
+ * operators up here instead of dispatching on names themselves.
+ */
+
+/**
+ * @brief Thrown when no operator is registered under a name.
+ */
+class UnknownOperator : public std::runtime_error {
+public:
+    explicit UnknownOperator(const std::string& name) : std::runtime_error("Unknown operator: " + name) {}
+};
+
+/**
+ * @brief A flag that changes what an operator does.
+ */
+struct OperatorParameter {
+    std::string flag;        // e.g. --threads
+    std::string description;
+};
+
+/**
+ * @brief What callers may assume about an operator.
+ */
+struct OperatorCapabilities {
+    bool inPlace = false;    // detectEdges may write its result into the input image
+    bool streaming = false;  // output pixels depend on a bounded neighbourhood, so bands or tiles with a halo give the same result
+    bool simd = false;       // the inner loops are vectorized
+    bool threadSafe = false; // detectEdges may run concurrently on one instance
+};
+
+/**
+ * @brief A registered operator.
+ */
+struct OperatorDescriptor {
+    using Factory = std::function<std::unique_ptr<GradientOperator>(const ExecutionConfig& config,
+                                                                    const std::string& argument)>;
+
+    std::string name;        // canonical name, e.g. "opencv sobel"
+    std::string description;
+    std::vector<OperatorParameter> parameters; // operator-specific flags, besides the budget and deadline every operator takes
+    OperatorCapabilities capabilities;
+    Factory create;          // receives the text after "name:" if the operator takes an argument
+    bool takesArgument = false; // looked up as "name:argument", e.g. "pipeline:blur=5,sobel"
+};
+
+/**
+ * @brief An operator leased from a registry for one job; it goes back to the registry's idle
+ * instances when the lease is released.
+ */
+using OperatorLease = std::unique_ptr<GradientOperator, std::function<void(GradientOperator*)>>;
+
+class OperatorRegistry {
+public:
+    /**
+     * @brief Gets the registry holding the built-in operators.
+     * @return The registry.
+     */
+    static OperatorRegistry& builtin();
+
+    /**
+     * @brief Registers an operator.
+     * @param descriptor The operator; its name must not be registered yet.
+     * @throws std::runtime_error if the name is empty or taken, or the factory is missing.
+     */
+    void add(OperatorDescriptor descriptor);
+
+    /**
+     * @brief Looks up an operator by name. URL-encoded names as sent by the backend routes,
+     * e.g. "opencv%20sobel", are decoded first. A name without an exact match is looked up by
+     * the part before its first ':' among the operators that take an argument.
+     * @param name The operator name.
+     * @return The operator, or nullptr if none is registered under the name.
+     */
+    [[nodiscard]] const OperatorDescriptor* find(const std::string& name) const;
+
+    /**
+     * @brief Creates a new instance of an operator, owned by the caller.
+     * @param name The operator name.
+     * @param config The execution configuration for the parallel operators.
+     * @throws UnknownOperator if no operator is registered under the name.
+     * @throws std::runtime_error if the operator rejects its argument.
+     * @return The operator.
+     */
+    [[nodiscard]] std::unique_ptr<GradientOperator> create(const std::string& name,
+                                                           const ExecutionConfig& config = ExecutionConfig()) const;
+
+    /**
+     * @brief Leases an instance of an operator for one job, reusing an idle instance of the same
+     * name and configuration when one was released, and creating one otherwise. A lease is never
+     * shared, so the job sets its own cancellation token, limits and options on it; they are
+     * reset when the lease is released. Concurrent jobs get distinct instances. Leases must be
+     * released before the registry is destroyed.
+     * @param name The operator name.
+     * @param config The execution configuration for the parallel operators.
+     * @throws UnknownOperator if no operator is registered under the name.
+     * @throws std::runtime_error if the operator rejects its argument.
+     * @return The operator.
+     */
+    OperatorLease acquire(const std::string& name, const ExecutionConfig& config = ExecutionConfig());
+
+    /**
+     * @brief Estimates the peak memory and time of an operator on an image of the given size.
+     * @param name The operator name.
+     * @param imageSize The decoded image size.
+     * @throws UnknownOperator if no operator is registered under the name.
+     * @return The estimate.
+     */
+    ResourceEstimate estimate(const std::string& name, cv::Size imageSize);
+
+    /**
+     * @brief Gets the registered operators.
+     * @return The operators in name order.
+     */
+    [[nodiscard]] std::vector<const OperatorDescriptor*> list() const;
+
+    /**
+     * @brief Decodes %XX escapes, e.g. "sobel%3Aauto" to "sobel:auto".
+     * @param name The possibly URL-encoded name.
+     * @return The decoded name.
+     */
+    static std::string decodeName(const std::string& name);
+
+private:
+    std::map<std::string, OperatorDescriptor> operators;
+    std::map<std::string, std::vector<std::unique_ptr<GradientOperator>>> idle; // by name and configuration
+    std::mutex idleMutex;
+};
+
+#endif //OPERATORS_OPERATOR_REGISTRY_H
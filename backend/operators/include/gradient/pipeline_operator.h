@@ -0,0 +1,55 @@
+#ifndef OPERATORS_PIPELINE_OPERATOR_H
+#define OPERATORS_PIPELINE_OPERATOR_H
+
+#include "gradient_operator.h"
+#include "pipeline/pipeline.h"
+#include "utils/tile_scheduler.h"
+using namespace std;
+using namespace cv;
+
+/**
+ * @file pipeline_operator.h
+ * @brief This file contains the declaration of the PipelineOperator that runs a Pipeline of stages
+ * as one operator, registered as "pipeline:<description>", e.g. "pipeline:blur=5,sobel,threshold=40".
+ */
+class PipelineOperator : public GradientOperator {
+private:
+    Pipeline pipeline;
+    TileScheduler scheduler; // runs the fused passes of the pipeline
+
+public:
+    /**
+     * @brief Constructs a PipelineOperator.
+     * @param pipeline The stages to run.
+     * @param config The thread count, schedule, chunk or tile size and pinning policy of the fused passes.
+     */
+    explicit PipelineOperator(Pipeline pipeline, const ExecutionConfig& config = ExecutionConfig());
+
+    Mat getEdges(const string& inputPath, const string& outputName) override;
+
+    Mat detectEdges(const Mat& image) override;
+
+    [[nodiscard]] string getOperatorName() const override;
+
+    /**
+     * @brief Estimates the peak memory and time of the pipeline on an image of the given size:
+     * the input and output, a full image between passes, and the per-thread tile buffers.
+     * @param imageSize The decoded image size.
+     * @return The estimate.
+     */
+    [[nodiscard]] ResourceEstimate estimateResources(Size imageSize) const override;
+
+    /**
+     * @brief Get how far the pipeline reaches: the radii of its stages added up.
+     * @return The radius, or -1 if a stage such as normalize needs the whole image.
+     */
+    [[nodiscard]] int haloRadius() const override;
+
+    /**
+     * @brief Get the pipeline.
+     * @return The pipeline.
+     */
+    [[nodiscard]] const Pipeline& getPipeline() const;
+};
+
+#endif //OPERATORS_PIPELINE_OPERATOR_H
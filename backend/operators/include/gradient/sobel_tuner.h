@@ -0,0 +1,190 @@
+#ifndef OPERATORS_SOBEL_TUNER_H
+#define OPERATORS_SOBEL_TUNER_H
+
+#include "gradient_operator.h"
+#include <opencv2/core.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @file sobel_tuner.h
+ * @brief This file contains the declaration of the Sobel tuning table and the auto-tuner that
+ * benchmarks the Sobel backends, tile sizes and thread counts on the host to fill it.
+ */
+
+/**
+ * @brief The fastest Sobel variant measured for one image size.
+ */
+struct TuningEntry {
+    cv::Size imageSize;          // size of the benchmarked image
+    std::string backend;         // "opencv", "alternative" or "openmp"
+    cv::Size tileSize;           // tile size for the openmp backend, empty for the default
+    int threads = 0;             // thread count, 0 for the library default
+    double seconds = 0;          // best measured time
+};
+
+class TuningTable {
+public:
+    /**
+     * @brief Adds an entry, replacing any entry for the same image size.
+     * @param entry The entry to add.
+     */
+    void add(const TuningEntry& entry);
+
+    /**
+     * @brief Finds the entry whose benchmarked size is closest to the image size on a log scale.
+     * @param imageSize The size of the incoming image.
+     * @return The entry, or nullptr if the table is empty.
+     */
+    [[nodiscard]] const TuningEntry* lookup(cv::Size imageSize) const;
+
+    /**
+     * @brief Get the entries sorted by image area.
+     * @return The entries.
+     */
+    [[nodiscard]] const std::vector<TuningEntry>& getEntries() const;
+
+    /**
+     * @brief Get the largest image a batch processes faster one image per thread than with all
+     * threads on each image in turn.
+     * @return The size in pixels, 0 if one image per thread was never faster, negative if it was
+     * not measured.
+     */
+    [[nodiscard]] double getBatchCrossoverPixels() const {
+        return batchCrossoverPixels;
+    }
+
+    /**
+     * @brief Sets the batch crossover measured by SobelAutoTuner::measureBatchCrossover.
+     * @param pixels The size in pixels.
+     */
+    void setBatchCrossoverPixels(double pixels) {
+        batchCrossoverPixels = pixels;
+    }
+
+    /**
+     * @brief Get the CPU count of the host the table was measured on.
+     * @return The count, 0 for a table that was neither measured nor loaded.
+     */
+    [[nodiscard]] int getMeasuredCpus() const {
+        return measuredCpus;
+    }
+
+    /**
+     * @brief Sets the CPU count of the host the table was measured on.
+     * @param cpus The count.
+     */
+    void setMeasuredCpus(int cpus) {
+        measuredCpus = cpus;
+    }
+
+    /**
+     * @brief Checks whether the table was measured on a host with this host's CPU count. Callers
+     * report a mismatch, the table does not print from library code.
+     * @return true if it was, or if the CPU count is unknown.
+     */
+    [[nodiscard]] bool fitsHost() const;
+
+    /**
+     * @brief Writes the table with cv::FileStorage. The format follows the file extension.
+     * @param path The path to the table file.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Reads a table written by save.
+     * @param path The path to the table file.
+     * @return The table, empty if the file does not exist.
+     */
+    static TuningTable load(const std::string& path);
+
+    /**
+     * @brief Get the table at defaultPath(), read once per process on first use, so operators
+     * created per job or per batch worker do not parse the file again.
+     * @return The table, empty if the file does not exist.
+     */
+    static const TuningTable& hostTable();
+
+    /**
+     * @brief Get the default table path, OPERATORS_TUNING_TABLE if set or sobel_tuning.yml.
+     * @return The default table path.
+     */
+    static std::string defaultPath();
+
+private:
+    std::vector<TuningEntry> entries;
+    double batchCrossoverPixels = -1; // images up to this size run one per thread in a batch
+    int measuredCpus = 0;             // CPU count of the host the table was measured on
+};
+
+class SobelAutoTuner {
+public:
+    /**
+     * @brief Constructs a SobelAutoTuner.
+     * @param repetitions The number of timed runs per candidate; the fastest run counts.
+     */
+    explicit SobelAutoTuner(int repetitions = 3);
+
+    /**
+     * @brief Benchmarks every candidate on a synthetic image of each size.
+     * @param sizes The image sizes to tune for.
+     * @return The table with the fastest candidate per size.
+     */
+    [[nodiscard]] TuningTable tune(const std::vector<cv::Size>& sizes) const;
+
+    /**
+     * @brief Measures where a batch should switch from one image per thread to all threads on one
+     * image: for each size, a batch of images is timed through the openmp backend both ways, each
+     * image detected and encoded as PNG.
+     * @param sizes The image sizes, in increasing area.
+     * @return The size in pixels between the last size at which one image per thread was faster
+     * and the first at which it was not, on a log scale; the largest size if it always was, 0 if
+     * it never was.
+     */
+    [[nodiscard]] double measureBatchCrossover(const std::vector<cv::Size>& sizes) const;
+
+    /**
+     * @brief Get the image sizes tuned by default, from thumbnails to 4K.
+     * @return The image sizes.
+     */
+    static std::vector<cv::Size> defaultSizes();
+
+    /**
+     * @brief Get the candidates benchmarked for each size: every backend, and for the parallel
+     * backends every power-of-two thread count up to the core count, and for the openmp backend
+     * the default tile size and its halves and doubles.
+     * @return The candidates with seconds left at 0.
+     */
+    static std::vector<TuningEntry> candidates();
+
+    /**
+     * @brief Creates the operator an entry describes, with its thread count and tile size.
+     * @param entry The entry.
+     * @throws std::runtime_error if the backend is unknown.
+     * @return The operator.
+     */
+    static std::unique_ptr<GradientOperator> createBackend(const TuningEntry& entry);
+
+    /**
+     * @brief Runs an entry's operator on an image with the entry's thread count. The OpenCV backend
+     * bounds its threads by its stripe count rather than cv::setNumThreads, which is process-wide,
+     * so concurrent jobs do not change each other's pool.
+     * @param entry The entry.
+     * @param image The input image.
+     * @param cancellation The token the operator checks, or nullptr.
+     * @param options The options passed on to the operator.
+     * @param planes Receives the operator's gradients, or nullptr.
+     * @throws OperationCancelled if the token is cancelled while the operator runs.
+     * @return The image with the edges detected.
+     */
+    static cv::Mat run(const TuningEntry& entry, const cv::Mat& image,
+                       const CancellationToken* cancellation = nullptr, const EdgeOptions& options = EdgeOptions(),
+                       GradientPlanes* planes = nullptr);
+
+private:
+    int repetitions;
+};
+
+#endif //OPERATORS_SOBEL_TUNER_H
@@ -0,0 +1,154 @@
+#ifndef OPERATORS_PIPELINE_H
+#define OPERATORS_PIPELINE_H
+
+#include "utils/cancellation.h"
+#include "utils/tile_scheduler.h"
+#include <opencv2/core.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @file pipeline.h
+ * @brief This file contains the declaration of the Pipeline that chains image stages such as
+ * gray, blur, gradient and threshold. Runs of adjacent pointwise and stencil stages are fused
+ * into one tiled pass, so their intermediate images only ever exist one tile at a time.
+ */
+
+/**
+ * @brief One step of a pipeline. Stages after gray read and write single-channel CV_32F images.
+ */
+class PipelineStage {
+public:
+    virtual ~PipelineStage() = default;
+
+    /**
+     * @brief Get the stage as written in a pipeline description, e.g. "blur=5".
+     * @return The stage description.
+     */
+    [[nodiscard]] virtual std::string describe() const = 0;
+
+    /**
+     * @brief Get the pixels of context the stage reads on each side of an output pixel.
+     * @return The radius, 0 for a pointwise stage.
+     */
+    [[nodiscard]] virtual int radius() const {
+        return 0;
+    }
+
+    /**
+     * @brief Checks whether the stage can run on a tile. Stages that need the whole image,
+     * e.g. a normalization by its global range, end the fused pass before them.
+     * @return true if the stage can be fused.
+     */
+    [[nodiscard]] virtual bool fusable() const {
+        return true;
+    }
+
+    /**
+     * @brief Get the rough cost of the stage.
+     * @return Nanoseconds per pixel on one core.
+     */
+    [[nodiscard]] virtual double nanosPerPixel() const = 0;
+
+    /**
+     * @brief Applies the stage.
+     * @param input The input, padded by radius() pixels on every side.
+     * @param output Receives the result, radius() pixels smaller than the input on every side.
+     */
+    virtual void apply(const cv::Mat& input, cv::Mat& output) const = 0;
+};
+
+class Pipeline {
+public:
+    /**
+     * @brief Constructs a Pipeline. A gray stage is prepended unless the first stage is gray.
+     * @param stages The stages in order.
+     * @throws std::runtime_error if gray appears after the first stage.
+     */
+    explicit Pipeline(std::vector<std::shared_ptr<const PipelineStage>> stages);
+
+    /**
+     * @brief Parses a pipeline description, either stages separated by commas, e.g.
+     * "gray,blur=5,sobel,threshold=40", or JSON, e.g.
+     * {"stages": [{"op": "blur", "size": 5}, {"op": "sobel"}]}.
+     * Stages: gray, blur[=size], sobel, prewitt, roberts, threshold=value, normalize.
+     * @param description The pipeline description.
+     * @throws std::runtime_error if the description is empty or names an unknown stage.
+     * @return The pipeline.
+     */
+    static Pipeline parse(const std::string& description);
+
+    /**
+     * @brief Creates a stage.
+     * @param name The stage name.
+     * @param value The stage argument, empty for the default.
+     * @throws std::runtime_error if the name is unknown or the argument is invalid.
+     * @return The stage.
+     */
+    static std::shared_ptr<const PipelineStage> makeStage(const std::string& name, const std::string& value);
+
+    /**
+     * @brief Runs the pipeline, each run of fusable stages as one pass over tiles.
+     * @param image The BGR or grayscale input image.
+     * @param scheduler Splits the image into tiles and runs them in parallel.
+     * @param cancellation The token checked before each tile and stage, or nullptr.
+     * @throws std::runtime_error if the input image is empty.
+     * @throws OperationCancelled if the token is cancelled.
+     * @return The 8-bit single-channel result, saturated to [0, 255].
+     */
+    cv::Mat run(const cv::Mat& image, const TileScheduler& scheduler,
+                const CancellationToken* cancellation = nullptr) const;
+
+    /**
+     * @brief Runs the pipeline one full image per stage, the reference the fused run matches.
+     * @param image The BGR or grayscale input image.
+     * @param cancellation The token checked between stages, or nullptr.
+     * @throws std::runtime_error if the input image is empty.
+     * @throws OperationCancelled if the token is cancelled.
+     * @return The 8-bit single-channel result, saturated to [0, 255].
+     */
+    cv::Mat runUnfused(const cv::Mat& image, const CancellationToken* cancellation = nullptr) const;
+
+    /**
+     * @brief Get the number of passes a run makes over the image.
+     * @return The number of fused passes plus the number of whole-image stages.
+     */
+    [[nodiscard]] int countPasses() const;
+
+    /**
+     * @brief Get the rough cost of the pipeline.
+     * @return Nanoseconds per pixel on one core.
+     */
+    [[nodiscard]] double nanosPerPixel() const;
+
+    /**
+     * @brief Formats the pipeline in the comma-separated form parse accepts.
+     * @return The description.
+     */
+    [[nodiscard]] std::string toString() const;
+
+    /**
+     * @brief Get the stages, starting with gray.
+     * @return The stages.
+     */
+    [[nodiscard]] const std::vector<std::shared_ptr<const PipelineStage>>& getStages() const;
+
+private:
+    std::vector<std::shared_ptr<const PipelineStage>> stages;
+
+    /**
+     * @brief Runs stages [begin, end) tile by tile, carrying each tile's halo through the stages.
+     * @param frame The input of the first stage.
+     * @param begin The first stage.
+     * @param end One past the last stage.
+     * @param outputType CV_8U for the last pass, CV_32F otherwise.
+     * @param scheduler Splits the image into tiles.
+     * @param cancellation The token checked before each tile, or nullptr.
+     * @return The output of the last stage.
+     */
+    cv::Mat runFused(const cv::Mat& frame, size_t begin, size_t end, int outputType,
+                     const TileScheduler& scheduler, const CancellationToken* cancellation) const;
+};
+
+#endif //OPERATORS_PIPELINE_H
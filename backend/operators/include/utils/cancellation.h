@@ -0,0 +1,87 @@
+#ifndef OPERATORS_CANCELLATION_H
+#define OPERATORS_CANCELLATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @file cancellation.h
+ * @brief This file contains the declaration of the CancellationToken that lets a job be stopped
+ * early, either explicitly or when its deadline passes. Operators check it between stages and
+ * at tile or row-block granularity inside them.
+ */
+
+/**
+ * @brief Thrown by an operator that stopped because its token was cancelled or timed out.
+ */
+class OperationCancelled : public std::runtime_error {
+public:
+    explicit OperationCancelled(const std::string& reason) : std::runtime_error(reason) {}
+};
+
+class CancellationToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CancellationToken() = default;
+    CancellationToken(const CancellationToken&) = delete;
+    CancellationToken& operator=(const CancellationToken&) = delete;
+
+    /**
+     * @brief Requests cancellation. Safe to call from a signal handler or another thread.
+     */
+    void cancel();
+
+    /**
+     * @brief Sets the point in time after which the token counts as cancelled.
+     * @param deadline The deadline.
+     */
+    void setDeadline(Clock::time_point deadline);
+
+    /**
+     * @brief Sets the deadline relative to now.
+     * @param timeout The time the job may take from now.
+     */
+    void setTimeout(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Applies one command line flag: --deadline-ms=N sets the deadline N milliseconds from now.
+     * @param arg The command line argument.
+     * @throws std::runtime_error if the flag is known but its value is invalid.
+     * @return true if the flag was recognized, false otherwise.
+     */
+    bool parseFlag(const std::string& arg);
+
+    /**
+     * @brief Checks whether cancellation was requested or the deadline has passed.
+     * @return true if the job should stop.
+     */
+    [[nodiscard]] bool isCancelled() const;
+
+    /**
+     * @brief Stops the job if it should stop.
+     * @throws OperationCancelled if cancellation was requested or the deadline has passed.
+     */
+    void throwIfCancelled() const;
+
+    /**
+     * @brief Gets the process-wide token that installSignalHandlers cancels.
+     * @return The process-wide token.
+     */
+    static CancellationToken& process();
+
+    /**
+     * @brief Cancels the process-wide token on SIGTERM, SIGINT and SIGUSR1. A second signal
+     * terminates the process immediately in case a stage is stuck in a library call.
+     */
+    static void installSignalHandlers();
+
+private:
+    std::atomic<bool> cancelled{false};
+    std::atomic<int64_t> deadline{0}; // steady clock ticks, 0 for no deadline
+};
+
+#endif //OPERATORS_CANCELLATION_H
@@ -0,0 +1,78 @@
+#ifndef OPERATORS_EDGE_MASK_H
+#define OPERATORS_EDGE_MASK_H
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @file edge_mask.h
+ * @brief This file contains the EdgeMask codecs for binary edge maps: bit-packed rows written as
+ * a binary PBM (P4) image, and run lengths written as an .rle file. Any nonzero pixel is an edge.
+ *
+ * The .rle file is the text header "EDGERLE1\n<width> <height>\n" followed by the lengths of the
+ * alternating background and edge runs in row-major order, starting with background (so the
+ * first run may be empty), each as an unsigned LEB128 varint. Runs continue across rows.
+ */
+class EdgeMask {
+public:
+    /**
+     * @brief Checks whether an extension selects one of the mask formats.
+     * @param extension The extension, e.g. ".pbm".
+     * @return true for ".pbm" and ".rle".
+     */
+    static bool isMaskFormat(const std::string& extension);
+
+    /**
+     * @brief Packs a mask 1 bit per pixel, most significant bit first, each row padded to a
+     * whole byte: the pixel layout of a P4 PBM. Edges are 1, which PBM viewers show as black.
+     * @param mask The 8-bit single-channel mask.
+     * @return The packed rows.
+     */
+    static std::vector<uint8_t> pack(const cv::Mat& mask);
+
+    /**
+     * @brief Unpacks rows produced by pack.
+     * @param bits The packed rows.
+     * @param size The image size.
+     * @throws std::runtime_error if there are fewer bytes than the size needs.
+     * @return The 0 / 255 mask.
+     */
+    static cv::Mat unpack(const std::vector<uint8_t>& bits, cv::Size size);
+
+    /**
+     * @brief Encodes a mask as alternating run lengths, starting with background.
+     * @param mask The 8-bit single-channel mask.
+     * @return The varint run lengths.
+     */
+    static std::vector<uint8_t> encodeRuns(const cv::Mat& mask);
+
+    /**
+     * @brief Decodes run lengths produced by encodeRuns.
+     * @param runs The varint run lengths.
+     * @param size The image size.
+     * @throws std::runtime_error if the runs do not cover the image exactly.
+     * @return The 0 / 255 mask.
+     */
+    static cv::Mat decodeRuns(const std::vector<uint8_t>& runs, cv::Size size);
+
+    /**
+     * @brief Encodes a mask as a complete .pbm or .rle file.
+     * @param mask The 8-bit single-channel mask.
+     * @param extension ".pbm" or ".rle".
+     * @throws std::runtime_error for another extension or another image type.
+     * @return The file contents.
+     */
+    static std::vector<uint8_t> encode(const cv::Mat& mask, const std::string& extension);
+
+    /**
+     * @brief Decodes a complete .pbm (P4) or .rle file.
+     * @param data The file contents.
+     * @throws std::runtime_error if the contents are not a valid mask file.
+     * @return The 0 / 255 mask.
+     */
+    static cv::Mat decode(const std::vector<uint8_t>& data);
+};
+
+#endif //OPERATORS_EDGE_MASK_H
@@ -0,0 +1,58 @@
+#ifndef OPERATORS_EDGE_OPTIONS_H
+#define OPERATORS_EDGE_OPTIONS_H
+
+#include <opencv2/core.hpp>
+#include <string>
+
+/**
+ * @file edge_options.h
+ * @brief This file contains the declaration of the EdgeOptions that change what the gradient
+ * operators compute, as opposed to how they run.
+ */
+struct EdgeOptions {
+    /**
+     * @brief How the magnitude is turned into a binary edge map, if at all.
+     */
+    enum class Threshold {
+        None,  // keep the 8-bit magnitude
+        Fixed, // edges are the pixels above thresholdValue
+        Otsu   // edges are the pixels above the level that best separates the histogram
+    };
+
+    double sigma = 0;                    // standard deviation of the Gaussian smoothing before the derivative, 0 for none
+    Threshold threshold = Threshold::None;
+    int thresholdValue = 0;              // the level for Threshold::Fixed
+    bool angles = false;                 // add the gradient direction to .pts point records
+    cv::Rect region;                     // the region of interest the output is limited to, empty for the whole image
+
+    /**
+     * @brief Applies one command line flag: --sigma=S smooths with a Gaussian of standard deviation S,
+     * --threshold=N keeps the pixels above N as edges, --threshold=otsu chooses N per image,
+     * --angles adds the gradient direction to point lists and --roi=X,Y,W,H limits the output to
+     * that rectangle.
+     * @param arg The command line argument.
+     * @throws std::runtime_error if the flag is known but its value is invalid.
+     * @return true if the flag was recognized, false otherwise.
+     */
+    bool parseFlag(const std::string& arg);
+
+    /**
+     * @brief Checks whether the gradients are smoothed.
+     * @return true if sigma is set.
+     */
+    [[nodiscard]] bool isSmoothing() const;
+
+    /**
+     * @brief Checks whether the output is a binary edge map.
+     * @return true if a threshold is set.
+     */
+    [[nodiscard]] bool isThresholding() const;
+
+    /**
+     * @brief Checks whether the output is limited to a region of interest.
+     * @return true if a region is set.
+     */
+    [[nodiscard]] bool hasRegion() const;
+};
+
+#endif //OPERATORS_EDGE_OPTIONS_H
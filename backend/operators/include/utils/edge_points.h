@@ -0,0 +1,72 @@
+#ifndef OPERATORS_EDGE_POINTS_H
+#define OPERATORS_EDGE_POINTS_H
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file edge_points.h
+ * @brief This file contains the EdgePoints codec for sparse edge output: the coordinates of the
+ * pixels above a level, with their magnitude and optionally their gradient direction.
+ *
+ * A .pts file is the text header "EDGEPTS1\n<width> <height> <count> <fields>\n", where fields is
+ * "xym" or "xyma", followed by count packed little-endian records in row-major order: x and y as
+ * uint16, the magnitude as uint8 and, for "xyma", the direction as uint16 in 1/65536 of a turn
+ * counterclockwise from the gradient's x axis (image y points down).
+ */
+
+/**
+ * @brief One record of a point list.
+ */
+struct EdgePoint {
+    uint16_t x = 0;
+    uint16_t y = 0;
+    uint8_t magnitude = 0;
+    uint16_t angle = 0; // 0 if the list has no directions
+};
+
+/**
+ * @brief A decoded point list.
+ */
+struct EdgePointList {
+    cv::Size size;               // the size of the image the points were taken from
+    bool hasAngles = false;      // whether the records carry directions
+    std::vector<EdgePoint> points;
+};
+
+class EdgePoints {
+public:
+    /**
+     * @brief Lists the pixels of a magnitude above a level. Each thread lists a band of rows into
+     * its own count, the counts are prefix-summed, and every band writes its records at its offset
+     * in the output, so the bands are concatenated in order without locks or a second copy.
+     * @param magnitude The 8-bit single-channel magnitude.
+     * @param level The level; pixels above it are listed.
+     * @param gradX The x gradient, single-channel 16S, 32S, 32F or 64F, or empty for a list without
+     * directions.
+     * @param gradY The y gradient, or empty.
+     * @throws std::runtime_error if a side exceeds 65536 pixels, or the gradients do not match the
+     * magnitude or are not 16S, 32S, 32F or 64F.
+     * @return The .pts file contents.
+     */
+    static std::vector<uint8_t> encode(const cv::Mat& magnitude, int level,
+                                       const cv::Mat& gradX = cv::Mat(), const cv::Mat& gradY = cv::Mat());
+
+    /**
+     * @brief Decodes a .pts file.
+     * @param data The file contents.
+     * @throws std::runtime_error if the contents are not a valid point list.
+     * @return The points.
+     */
+    static EdgePointList decode(const std::vector<uint8_t>& data);
+
+    /**
+     * @brief Converts a stored direction to radians.
+     * @param angle The stored direction.
+     * @return The direction in [0, 2π).
+     */
+    static double toRadians(uint16_t angle);
+};
+
+#endif //OPERATORS_EDGE_POINTS_H
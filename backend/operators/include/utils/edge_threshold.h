@@ -0,0 +1,51 @@
+#ifndef OPERATORS_EDGE_THRESHOLD_H
+#define OPERATORS_EDGE_THRESHOLD_H
+
+#include <opencv2/core.hpp>
+#include <array>
+#include <cstdint>
+#include "utils/edge_options.h"
+
+/**
+ * @file edge_threshold.h
+ * @brief This file contains the EdgeThreshold helpers that turn an 8-bit gradient magnitude into
+ * a binary edge map, with a fixed level or with Otsu's level computed from a parallel histogram.
+ */
+class EdgeThreshold {
+public:
+    using Histogram = std::array<uint64_t, 256>;
+
+    /**
+     * @brief Counts the pixels of each level. Every thread counts its rows into a private
+     * histogram and the histograms are summed once at the end, so no count is shared.
+     * @param edges The 8-bit single-channel image.
+     * @return The histogram.
+     */
+    static Histogram histogram(const cv::Mat& edges);
+
+    /**
+     * @brief Chooses the level that maximizes the between-class variance of a histogram,
+     * the same level cv::threshold picks with THRESH_OTSU.
+     * @param counts The histogram.
+     * @return The level; pixels above it are edges.
+     */
+    static int otsu(const Histogram& counts);
+
+    /**
+     * @brief Get the level the options threshold a magnitude at.
+     * @param edges The 8-bit single-channel magnitude.
+     * @param options The options.
+     * @return The level; pixels above it are edges. 0 if the options set no threshold.
+     */
+    static int level(const cv::Mat& edges, const EdgeOptions& options);
+
+    /**
+     * @brief Thresholds the magnitude as the options ask.
+     * @param edges The 8-bit single-channel magnitude.
+     * @param options The options.
+     * @return A 0 / 255 edge map, or edges itself if the options set no threshold.
+     */
+    static cv::Mat apply(const cv::Mat& edges, const EdgeOptions& options);
+};
+
+#endif //OPERATORS_EDGE_THRESHOLD_H
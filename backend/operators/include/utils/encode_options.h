@@ -0,0 +1,36 @@
+#ifndef OPERATORS_ENCODE_OPTIONS_H
+#define OPERATORS_ENCODE_OPTIONS_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @file encode_options.h
+ * @brief This file contains the declaration of the EncodeOptions that tune the codec of the
+ * output, trading its size for the time spent encoding it.
+ */
+struct EncodeOptions {
+    int quality = -1;     // JPEG and WebP quality from 1 to 100, -1 for the codec default
+    int pngLevel = -1;    // zlib level from 0 (stored) to 9, -1 for OpenCV's default
+    int pngStrategy = -1; // a cv::IMWRITE_PNG_STRATEGY_* value, -1 for OpenCV's default
+
+    /**
+     * @brief Applies one command line flag: --quality=N sets the JPEG and WebP quality,
+     * --png-level=N the zlib level and --png-strategy=default|filtered|huffman|rle|fixed the zlib
+     * strategy of PNG outputs.
+     * @param arg The command line argument.
+     * @throws std::runtime_error if the flag is known but its value is invalid.
+     * @return true if the flag was recognized, false otherwise.
+     */
+    bool parseFlag(const std::string& arg);
+
+    /**
+     * @brief Get the cv::imencode parameters for an output format. Options that do not apply to
+     * the format are left out.
+     * @param extension The lowercased extension, e.g. ".png".
+     * @return The parameters as key and value pairs.
+     */
+    [[nodiscard]] std::vector<int> params(const std::string& extension) const;
+};
+
+#endif //OPERATORS_ENCODE_OPTIONS_H
@@ -0,0 +1,82 @@
+#ifndef OPERATORS_EXECUTION_CONFIG_H
+#define OPERATORS_EXECUTION_CONFIG_H
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @file execution_config.h
+ * @brief This file contains the declaration of the ExecutionConfig that controls how the parallel
+ * operators use threads: how many, how work is scheduled and where the threads are pinned.
+ */
+
+/**
+ * @brief How the image is split into work items and handed to threads.
+ */
+enum class ScheduleKind {
+    Tiled,   // 2D cache-sized tiles on per-thread work-stealing deques
+    Static,  // full-width row bands assigned round-robin up front
+    Dynamic  // full-width row bands handed out on demand
+};
+
+/**
+ * @brief Which CPUs the worker threads are pinned to.
+ */
+enum class PinPolicy {
+    None,    // leave placement to the OS scheduler
+    Compact, // fill the hyperthreads of one core, then the next core of the same package
+    Scatter, // one thread per physical core, alternating packages, before reusing hyperthreads
+    List     // thread i on the i-th CPU of an explicit list
+};
+
+struct ExecutionConfig {
+    int numThreads = 0;                       // number of threads, 0 for the OpenMP default
+    ScheduleKind schedule = ScheduleKind::Tiled;
+    int chunkSize = 16;                       // rows per band for the static and dynamic schedules
+    cv::Size tileSize;                        // tile size for the tiled schedule, empty for the L2 default
+    PinPolicy pinning = PinPolicy::None;
+    std::vector<int> cpuList;                 // CPUs for the list policy, empty for every allowed CPU
+
+    /**
+     * @brief Applies one command line flag: --threads=N, --schedule=tiled|static|dynamic,
+     * --chunk=N, --tile=WxH|N|auto, --pin=none|compact|scatter|list or --cpus=0-3,8
+     * which also selects the list policy.
+     * @param arg The command line argument.
+     * @throws std::runtime_error if the flag is known but its value is invalid.
+     * @return true if the flag was recognized, false otherwise.
+     */
+    bool parseFlag(const std::string& arg);
+
+    /**
+     * @brief Formats the configuration as the flags parseFlag accepts.
+     * @return The flags separated by spaces.
+     */
+    [[nodiscard]] std::string toString() const;
+
+    /**
+     * @brief Parses a schedule kind.
+     * @param name tiled, static or dynamic.
+     * @throws std::runtime_error if the name is unknown.
+     * @return The schedule kind.
+     */
+    static ScheduleKind parseSchedule(const std::string& name);
+
+    /**
+     * @brief Parses a pinning policy.
+     * @param name none, compact, scatter or list.
+     * @throws std::runtime_error if the name is unknown.
+     * @return The pinning policy.
+     */
+    static PinPolicy parsePinPolicy(const std::string& name);
+
+    /**
+     * @brief Parses a CPU list in the format of cpuset and taskset, e.g. 0-3,8,10-11.
+     * @param list The CPU list.
+     * @throws std::runtime_error if the list is malformed.
+     * @return The CPU ids in ascending order without duplicates.
+     */
+    static std::vector<int> parseCpuList(const std::string& list);
+};
+
+#endif //OPERATORS_EXECUTION_CONFIG_H
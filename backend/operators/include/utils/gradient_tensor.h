@@ -0,0 +1,39 @@
+#ifndef OPERATORS_GRADIENT_TENSOR_H
+#define OPERATORS_GRADIENT_TENSOR_H
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file gradient_tensor.h
+ * @brief This file contains the GradientTensor codec that stores the signed gradients of an
+ * operator as an .npy array of shape (3, height, width) and dtype '<f4': the x gradient, the
+ * y gradient and their magnitude sqrt(gx² + gy²), unnormalized.
+ *
+ * The header is always headerBytes long, so the planes start at a fixed offset and the file can
+ * be memory-mapped without parsing it, or with numpy.load(path, mmap_mode="r").
+ */
+class GradientTensor {
+public:
+    static constexpr size_t headerBytes = 128; // the magic, version, length and padded dictionary
+
+    /**
+     * @brief Encodes the gradients with their magnitude.
+     * @param gradX The x gradient, single channel of any depth.
+     * @param gradY The y gradient, the size of gradX.
+     * @throws std::runtime_error if the gradients are empty or do not match.
+     * @return The .npy file contents.
+     */
+    static std::vector<uint8_t> encode(const cv::Mat& gradX, const cv::Mat& gradY);
+
+    /**
+     * @brief Decodes a file written by encode.
+     * @param data The file contents.
+     * @throws std::runtime_error if the contents are not a (3, height, width) '<f4' array.
+     * @return The x gradient, y gradient and magnitude as CV_32F images.
+     */
+    static std::vector<cv::Mat> decode(const std::vector<uint8_t>& data);
+};
+
+#endif //OPERATORS_GRADIENT_TENSOR_H
@@ -2,23 +2,152 @@
 #define OPERATORS_IMAGE_UTILS_H
 
 #include <opencv2/opencv.hpp>
+#include <optional>
+#include "utils/encode_options.h"
 using namespace std;
 
+/**
+ * @brief Image properties read from the file header without decoding the pixels.
+ */
+struct ImageInfo {
+    std::string format; // "png", "jpeg", "gif", "bmp", "webp" or "pnm"
+    int width = 0;
+    int height = 0;
+    int channels = 0;   // channels stored in the file, palette images count as 3
+    int bitDepth = 0;   // bits per channel
+
+    [[nodiscard]] cv::Size size() const { return {width, height}; }
+};
+
 class ImageUtils {
 public:
     /**
      * @brief Reads an image from the specified file.
      * @param inputPath The path to the input image.
+     * @param mode IMREAD_COLOR or IMREAD_GRAYSCALE.
+     * @param reduction 1 for full size, or 2, 4 or 8 to decode at that fraction of the size.
+     * JPEG scales while decoding; other formats are decoded at full size and then resized.
+     * @throws std::runtime_error if the image cannot be read.
+     * @return The image.
+     */
+    static cv::Mat getImage(const std::string &inputPath, cv::ImreadModes mode = cv::IMREAD_COLOR,
+                            int reduction = 1);
+
+    /**
+     * @brief Reads a rectangle of an image from the specified file. Uncompressed 8-bit formats,
+     * binary PGM and PPM and 24-bit BMP, are read row by row from the file, only the bytes inside
+     * the rectangle, so the cost follows the rectangle rather than the image. Other formats are
+     * decoded whole and cropped.
+     * @param inputPath The path to the input image.
+     * @param region The rectangle, clipped to the image.
+     * @param mode IMREAD_COLOR or IMREAD_GRAYSCALE.
+     * @throws std::runtime_error if the image cannot be read or the rectangle lies outside it.
+     * @return The pixels of the rectangle.
+     */
+    static cv::Mat getRegion(const std::string& inputPath, const cv::Rect& region,
+                             cv::ImreadModes mode = cv::IMREAD_COLOR);
+
+    /**
+     * @brief Checks whether getRegion reads only the rectangle of an image, rather than decoding
+     * all of it.
+     * @param inputPath The path to the input image.
+     * @return true for binary 8-bit PGM and PPM and uncompressed 24-bit BMP files.
+     */
+    static bool canDecodeRegion(const std::string& inputPath);
+
+    /**
+     * @brief Reads the dimensions, channels and bit depth from the file header without decoding.
+     * Supports PNG, JPEG, GIF, BMP, WebP and PNM.
+     * @param inputPath The path to the input image.
+     * @return The header information, or nothing if the file is unreadable or in another format.
+     */
+    static std::optional<ImageInfo> probeImage(const std::string& inputPath);
+
+    /**
+     * @brief Reads the header of an encoded image in memory, like probeImage on a file.
+     * @param data The encoded image.
+     * @param size The size of the encoded image in bytes.
+     * @return The header information, or nothing if the format is not recognized.
+     */
+    static std::optional<ImageInfo> probeImage(const uint8_t* data, size_t size);
+
+    /**
+     * @brief Decodes an image from memory.
+     * @param data The encoded image.
+     * @param size The size of the encoded image in bytes.
+     * @param mode IMREAD_COLOR or IMREAD_GRAYSCALE.
+     * @param reduction 1 for full size, or 2, 4 or 8 to decode at that fraction of the size.
+     * @throws std::runtime_error if the image cannot be decoded.
      * @return The image.
      */
-    static cv::Mat getImage(const std::string &inputPath, cv::ImreadModes mode = cv::IMREAD_COLOR);
+    static cv::Mat decodeImage(const uint8_t* data, size_t size, cv::ImreadModes mode = cv::IMREAD_COLOR,
+                               int reduction = 1);
+
+    /**
+     * @brief Decodes an image from memory into an existing image, reusing its buffer when the
+     * decoded size and type match. OpenCV leaves the image untouched if it finds no decoder for
+     * the data, so check the header with probeImage first.
+     * @param data The encoded image.
+     * @param size The size of the encoded image in bytes.
+     * @param image Receives the image.
+     * @param mode IMREAD_COLOR or IMREAD_GRAYSCALE.
+     * @param reduction 1 for full size, or 2, 4 or 8 to decode at that fraction of the size.
+     * @throws std::runtime_error if the image cannot be decoded.
+     */
+    static void decodeImage(const uint8_t* data, size_t size, cv::Mat& image,
+                            cv::ImreadModes mode = cv::IMREAD_COLOR, int reduction = 1);
 
     /**
-     * @brief Writes an image to the specified file.
+     * @brief Encodes an image in memory.
+     * @param image The image.
+     * @param extension The file extension that selects the format, e.g. ".png", or ".pbm" and
+     * ".rle" for the bit-packed and run-length EdgeMask formats. 8-bit PNGs are deflated in
+     * parallel by the PngEncoder.
+     * @param options The codec settings of the image formats.
+     * @throws std::runtime_error if the image cannot be encoded in that format.
+     * @return The encoded image.
+     */
+    static std::vector<uint8_t> encodeImage(const cv::Mat& image, const std::string& extension,
+                                            const EncodeOptions& options = EncodeOptions());
+
+    /**
+     * @brief Writes an image to the specified file, in the format its extension selects as for encodeImage.
      * @param image The image to write.
      * @param filename The name of the output file.
+     * @throws std::runtime_error if a mask file cannot be written.
      */
     static void writeImage(const cv::Mat& image, const std::string& outputName);
+
+    /**
+     * @brief Writes encoded bytes to the specified file.
+     * @param data The encoded image.
+     * @param outputName The name of the output file.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    static void writeFile(const std::vector<uint8_t>& data, const std::string& outputName);
+
+    /**
+     * @brief Get the extension of a path, lowercased, as encodeImage expects it.
+     * @param path The path.
+     * @return The extension including the dot, e.g. ".png", or "" if there is none.
+     */
+    static std::string extensionOf(const std::string& path);
+
+    /**
+     * @brief Converts an image to single-channel grayscale, sharing the data if it already is.
+     * @param image The BGR or grayscale image.
+     * @throws std::runtime_error if the image is empty.
+     * @return The grayscale image.
+     */
+    static cv::Mat toGrayscale(const cv::Mat& image);
+
+    /**
+     * @brief Converts an image to three-channel BGR, sharing the data if it already is.
+     * @param image The BGR or grayscale image.
+     * @throws std::runtime_error if the image is empty.
+     * @return The BGR image.
+     */
+    static cv::Mat toColor(const cv::Mat& image);
 };
 
 
@@ -29,6 +29,10 @@ namespace KernelUtil {
     static const Mat robertCrossY = (cv::Mat_<double>(2, 2) <<
             0, 1,
             -1, 0);
+    // the separable factors of the 3x3 kernels: a difference along the gradient and a smoothing across it
+    static const Mat derivativeDifference = (Mat_<float>(3, 1) << -1, 0, 1);
+    static const Mat sobelSmoothing = (Mat_<float>(3, 1) << 1, 2, 1);
+    static const Mat prewittSmoothing = (Mat_<float>(3, 1) << 1, 1, 1);
 }
 
 
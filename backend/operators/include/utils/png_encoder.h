@@ -0,0 +1,43 @@
+#ifndef OPERATORS_PNG_ENCODER_H
+#define OPERATORS_PNG_ENCODER_H
+
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file png_encoder.h
+ * @brief This file contains the PngEncoder, which deflates bands of rows on separate threads
+ * and stitches them into one standard PNG.
+ *
+ * Every row is filtered with the Up filter, then the filtered rows are cut into bands that are
+ * deflated in parallel as raw deflate streams. Each band is primed with the last 32 KB of the
+ * band before it as its dictionary, so matches still reach across band boundaries, and ends in a
+ * sync flush, so the bands concatenate on byte boundaries into a single zlib stream. The Adler-32
+ * checksums of the bands are combined into the one of the whole stream, and each band becomes an
+ * IDAT chunk.
+ */
+class PngEncoder {
+public:
+    static constexpr size_t bandBytes = 256 * 1024; // filtered bytes per band, at least one row
+
+    /**
+     * @brief Checks whether an image can be written by encode.
+     * @param image The image.
+     * @return true for non-empty 8-bit images with 1, 3 or 4 channels.
+     */
+    static bool canEncode(const cv::Mat& image);
+
+    /**
+     * @brief Encodes an image as a PNG with its bands deflated in parallel.
+     * @param image The 8-bit grayscale, BGR or BGRA image.
+     * @param level The zlib level from 0 to 9.
+     * @param strategy The zlib strategy, equal to its cv::IMWRITE_PNG_STRATEGY_* value.
+     * @throws std::runtime_error if the image cannot be encoded.
+     * @return The PNG file.
+     */
+    static std::vector<uint8_t> encode(const cv::Mat& image, int level, int strategy);
+};
+
+#endif //OPERATORS_PNG_ENCODER_H
@@ -0,0 +1,68 @@
+#ifndef OPERATORS_RESOURCE_LIMITS_H
+#define OPERATORS_RESOURCE_LIMITS_H
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @file resource_limits.h
+ * @brief This file contains the declaration of the per-job resource budget that is checked against
+ * an operator's estimate before the input image is decoded.
+ */
+
+/**
+ * @brief What to do with an input whose estimate exceeds the budget.
+ */
+enum class OversizePolicy {
+    Reject,   // fail the job before decoding
+    Downscale // decode at 1/2, 1/4 or 1/8 scale, the largest that fits
+};
+
+/**
+ * @brief Thrown when an input image does not fit the resource budget.
+ */
+class ImageTooLarge : public std::runtime_error {
+public:
+    explicit ImageTooLarge(const std::string& reason) : std::runtime_error(reason) {}
+};
+
+/**
+ * @brief Peak memory and time an operator is expected to need for one image.
+ */
+struct ResourceEstimate {
+    size_t peakBytes = 0; // decoded input, intermediates and output alive at the same time
+    double seconds = 0;   // rough single-threaded processing time, excluding decode and encode
+};
+
+struct ResourceLimits {
+    size_t maxBytes = 0;   // peak memory budget, 0 for no limit
+    uint64_t maxPixels = 0; // decoded pixel budget, 0 for no limit
+    OversizePolicy oversize = OversizePolicy::Reject;
+
+    /**
+     * @brief Applies one command line flag: --max-memory=MB, --max-pixels=N or
+     * --oversize=reject|downscale.
+     * @param arg The command line argument.
+     * @throws std::runtime_error if the flag is known but its value is invalid.
+     * @return true if the flag was recognized, false otherwise.
+     */
+    bool parseFlag(const std::string& arg);
+
+    /**
+     * @brief Checks whether any limit is set.
+     * @return true if at least one limit is set.
+     */
+    [[nodiscard]] bool isLimited() const;
+
+    /**
+     * @brief Checks an image size and its estimate against the limits.
+     * @param imageSize The decoded image size.
+     * @param estimate The estimate for that size.
+     * @return true if both fit.
+     */
+    [[nodiscard]] bool fits(cv::Size imageSize, const ResourceEstimate& estimate) const;
+};
+
+#endif //OPERATORS_RESOURCE_LIMITS_H
@@ -0,0 +1,65 @@
+#ifndef OPERATORS_SMOOTHED_KERNELS_H
+#define OPERATORS_SMOOTHED_KERNELS_H
+
+#include <opencv2/core.hpp>
+
+/**
+ * @file smoothed_kernels.h
+ * @brief This file contains the SmoothedKernels helpers that fold a Gaussian pre-smoothing into
+ * separable derivative kernels. Smoothing then filtering equals filtering with the convolution of
+ * the two kernels, so a smoothed gradient costs two 1D passes per direction like a plain one,
+ * only with longer kernels, and no blurred image is ever stored.
+ */
+
+/**
+ * @brief A kernel applied as sepFilter2D(src, dst, CV_32F, rowKernel, columnKernel).
+ */
+struct SeparableKernel {
+    cv::Mat rowKernel;    // applied along each row, i.e. in x
+    cv::Mat columnKernel; // applied along each column, i.e. in y
+};
+
+class SmoothedKernels {
+public:
+    /**
+     * @brief Creates a normalized 1D Gaussian of 2 * ceil(3 * sigma) + 1 taps.
+     * @param sigma The standard deviation, greater than 0.
+     * @return The CV_32F column kernel.
+     */
+    static cv::Mat gaussian(double sigma);
+
+    /**
+     * @brief Convolves two 1D kernels, keeping every tap of the result.
+     * @param first The first kernel.
+     * @param second The second kernel.
+     * @return The CV_32F column kernel of first.total() + second.total() - 1 taps.
+     */
+    static cv::Mat convolve(const cv::Mat& first, const cv::Mat& second);
+
+    /**
+     * @brief Builds the kernel of a smoothed separable derivative, e.g. Sobel from the
+     * difference [-1 0 1] and the smoothing [1 2 1].
+     * @param difference The 1D derivative kernel applied along the gradient direction.
+     * @param smoothing The 1D kernel applied across the gradient direction.
+     * @param sigma The standard deviation of the Gaussian folded into both.
+     * @param horizontal true for the x gradient, false for the y gradient.
+     * @return The separable kernel.
+     */
+    static SeparableKernel derivative(const cv::Mat& difference, const cv::Mat& smoothing, double sigma, bool horizontal);
+
+    /**
+     * @brief Get the pixels of context a derivative kernel built by derivative() reads on each side.
+     * @param kernel The kernel.
+     * @return The radius.
+     */
+    static int radius(const SeparableKernel& kernel);
+
+    /**
+     * @brief Get the radius of a 3x3 derivative with a Gaussian folded in, without building it.
+     * @param sigma The standard deviation of the Gaussian, 0 for none.
+     * @return 1 + ceil(3 * sigma), the radius of the kernel derivative() builds.
+     */
+    static int derivativeRadius(double sigma);
+};
+
+#endif //OPERATORS_SMOOTHED_KERNELS_H
@@ -0,0 +1,120 @@
+#ifndef OPERATORS_SPSC_QUEUE_H
+#define OPERATORS_SPSC_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @file spsc_queue.h
+ * @brief This file contains the SpscQueue, a bounded lock-free ring buffer between exactly one
+ * producer thread and one consumer thread.
+ *
+ * The producer only writes the tail index and the consumer only writes the head index, each on
+ * its own cache line, so neither side ever takes a lock or writes a line the other one writes.
+ * The blocking push and pop spin briefly, then yield, then sleep, so a stage waiting on a slow
+ * neighbour does not take CPU time from the OpenMP threads of the stage between them.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    /**
+     * @brief Constructs an empty queue.
+     * @param capacity The number of elements the queue holds before push waits.
+     */
+    explicit SpscQueue(size_t capacity) : slots(capacity + 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief Adds an element if there is room. Producer only.
+     * @param value The element, moved from on success.
+     * @return true if the element was added.
+     */
+    bool tryPush(T& value) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        size_t next = advance(tail);
+        if (next == headIndex.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots[tail] = std::move(value);
+        tailIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element if there is one. Consumer only.
+     * @param value Receives the element.
+     * @return true if an element was removed.
+     */
+    bool tryPop(T& value) {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(slots[head]);
+        headIndex.store(advance(head), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Adds an element, waiting for room. Producer only.
+     * @param value The element.
+     */
+    void push(T value) {
+        for (int attempt = 0; !tryPush(value); ++attempt) {
+            backoff(attempt);
+        }
+    }
+
+    /**
+     * @brief Removes the oldest element, waiting for one until the producer closes the queue.
+     * Consumer only.
+     * @param value Receives the element.
+     * @return true if an element was removed, false if the queue is closed and drained.
+     */
+    bool pop(T& value) {
+        for (int attempt = 0; !tryPop(value); ++attempt) {
+            // the close is published after the last push, so a final look cannot miss an element
+            if (closed.load(std::memory_order_acquire)) {
+                return tryPop(value);
+            }
+            backoff(attempt);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Marks the end of the stream: pop returns false once the queue is drained. Producer only.
+     */
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+private:
+    size_t advance(size_t index) const {
+        return index + 1 == slots.size() ? 0 : index + 1;
+    }
+
+    static void backoff(int attempt) {
+        if (attempt < 64) {
+            return;
+        }
+        if (attempt < 128) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    std::vector<T> slots;                        // one more than the capacity, a full ring leaves one free
+    alignas(64) std::atomic<size_t> headIndex{0}; // next element to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tailIndex{0}; // next slot to fill, written by the producer
+    alignas(64) std::atomic<bool> closed{false};
+};
+
+#endif //OPERATORS_SPSC_QUEUE_H
@@ -0,0 +1,64 @@
+#ifndef OPERATORS_THREAD_AFFINITY_H
+#define OPERATORS_THREAD_AFFINITY_H
+
+#include "execution_config.h"
+#include <vector>
+
+/**
+ * @file thread_affinity.h
+ * @brief This file contains the declaration of the ThreadAffinity utilities that pin OpenMP and
+ * OpenCV worker threads to CPUs. Pinning is only supported on Linux; elsewhere the calls do nothing.
+ */
+class ThreadAffinity {
+public:
+    /**
+     * @brief Gets the CPUs the process may run on, as reported by sched_getaffinity when the
+     * process started. This is the container's cpuset when running under Docker.
+     * @return The CPU ids in ascending order, empty if affinity is not supported.
+     */
+    static std::vector<int> allowedCpus();
+
+    /**
+     * @brief Orders the allowed CPUs for a pinning policy using the package and core ids from
+     * /sys/devices/system/cpu. Compact keeps hyperthreads of a core next to each other; scatter
+     * lists one hyperthread of every core, alternating packages, before the second ones.
+     * @param policy The pinning policy, compact or scatter.
+     * @return The allowed CPU ids in placement order.
+     */
+    static std::vector<int> orderCpus(PinPolicy policy);
+
+    /**
+     * @brief Assigns a CPU to each worker thread. Only CPUs in the allowed set are used; an
+     * explicit list is intersected with it.
+     * @param config The pinning policy and, for the list policy, the CPU list.
+     * @param numThreads The number of worker threads.
+     * @throws std::runtime_error if none of the listed CPUs is allowed.
+     * @return The CPU for each thread, empty if the threads should not be pinned.
+     */
+    static std::vector<int> planCpus(const ExecutionConfig& config, int numThreads);
+
+    /**
+     * @brief Pins the calling thread to one CPU.
+     * @param cpu The CPU id.
+     * @return true if the thread was pinned.
+     */
+    static bool pinCurrentThread(int cpu);
+
+    /**
+     * @brief Lets the calling thread run on every allowed CPU again.
+     */
+    static void resetCurrentThread();
+
+    /**
+     * @brief Pins the threads of the OpenCV parallel_for_ pool. Each pool thread has to take one
+     * stripe, so the stripes wait for each other for a short time before giving up; threads
+     * that never show up stay unpinned. OpenCV workers live for the whole process, so they
+     * stay pinned. The calling thread takes a stripe without being pinned, since the threads it
+     * creates afterwards inherit its CPU mask.
+     * @param config The pinning policy and CPU list.
+     * @return The number of threads that were pinned.
+     */
+    static int pinOpenCVWorkers(const ExecutionConfig& config);
+};
+
+#endif //OPERATORS_THREAD_AFFINITY_H
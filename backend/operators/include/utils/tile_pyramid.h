@@ -0,0 +1,166 @@
+#ifndef OPERATORS_TILE_PYRAMID_H
+#define OPERATORS_TILE_PYRAMID_H
+
+#include "utils/encode_options.h"
+#include "utils/spsc_queue.h"
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file tile_pyramid.h
+ * @brief This file contains the TilePyramid, which writes an edge map as a deep-zoom pyramid of
+ * 256-pixel tiles that a viewer loads lazily, instead of one image too large for a browser.
+ *
+ * The edge map arrives in bands of rows, top to bottom, so it never has to be held whole. Each
+ * level keeps the rows of its current tile row; once they are complete the tiles are cut and
+ * handed to the writer threads, which encode and write them while the next band is computed. The
+ * rows of each band are also downsampled by 2 into the next level, which fills its own tile rows
+ * the same way. Downsampling keeps the maximum of each 2x2 block rather than the mean, so thin
+ * edges stay visible at every level instead of fading out.
+ *
+ * Two layouts are written. A path ending in .dzi gets a Deep Zoom Image: the XML descriptor at
+ * the path and PNG tiles in <name>_files/<level>/<column>_<row>.png, level 0 being 1x1 pixel and
+ * the last level the full map, with edge tiles cut to the map and no overlap. A path template
+ * with {z}, {x} and {y}, e.g. tiles/{z}/{x}/{y}.png, gets XYZ tiles in the format of its
+ * extension: zoom 0 fits the map into one tile, each zoom doubles it, and edge tiles are padded
+ * to 256x256 with background.
+ */
+
+/**
+ * @brief What a pyramid wrote.
+ */
+struct PyramidStats {
+    int levels = 0;   // levels written, the full map included
+    size_t tiles = 0; // tiles over all levels
+};
+
+class TilePyramid {
+public:
+    static constexpr int tileSize = 256;
+
+    /**
+     * @brief Checks whether an output path selects a pyramid rather than a single image.
+     * @param path The output path.
+     * @return true for a .dzi path or a template with {z}, {x} and {y}.
+     */
+    static bool isPyramidPath(const std::string& path);
+
+    /**
+     * @brief Constructs a TilePyramid and starts its writer threads.
+     * @param path The .dzi path or XYZ template.
+     * @param mapSize The size of the full edge map.
+     * @param options The codec settings of the tiles.
+     * @param writerThreads The writer threads, 0 for half the cores, at most 8.
+     * @throws std::runtime_error if the path selects no pyramid or the map is empty.
+     */
+    TilePyramid(const std::string& path, cv::Size mapSize, const EncodeOptions& options, int writerThreads = 0);
+
+    /**
+     * @brief Stops the writer threads if finish was not called, e.g. on a failed band.
+     */
+    ~TilePyramid();
+
+    TilePyramid(const TilePyramid&) = delete;
+    TilePyramid& operator=(const TilePyramid&) = delete;
+
+    /**
+     * @brief Adds the next rows of the edge map.
+     * @param rows 8-bit single-channel rows, the width of the map, following the rows before them.
+     * @throws std::runtime_error if the rows do not fit the map.
+     */
+    void addRows(const cv::Mat& rows);
+
+    /**
+     * @brief Writes the last partial tile rows of every level and the descriptor, and waits for
+     * the writer threads.
+     * @throws std::runtime_error if fewer rows than the map has were added, or a tile or the
+     * descriptor could not be encoded or written.
+     * @return The levels and tiles written.
+     */
+    PyramidStats finish();
+
+    /**
+     * @brief Get the number of levels, the full map included.
+     * @return The count.
+     */
+    [[nodiscard]] int levelCount() const {
+        return static_cast<int>(levels.size());
+    }
+
+    /**
+     * @brief Get the path of a tile.
+     * @param level The level as the layout numbers it, the full map being levelCount() - 1.
+     * @param column The tile column.
+     * @param row The tile row.
+     * @return The path.
+     */
+    [[nodiscard]] std::string tilePath(int level, int column, int row) const;
+
+private:
+    /**
+     * @brief One level of the pyramid while the rows stream through it.
+     */
+    struct Level {
+        cv::Size size;
+        cv::Mat pending;     // the rows of the current tile row
+        int pendingRows = 0;
+        int tileRow = 0;     // index of the current tile row
+        int rowsAdded = 0;
+        cv::Mat carry;       // an odd last row, downsampled with the first row of the next band
+    };
+
+    /**
+     * @brief A tile on its way to a writer thread.
+     */
+    struct TileJob {
+        cv::Mat tile;
+        std::string path;
+    };
+
+    /**
+     * @brief Adds rows to a level, cuts its complete tile rows and passes pairs of rows down.
+     */
+    void feed(size_t step, const cv::Mat& rows);
+
+    /**
+     * @brief Cuts the pending rows of a level into tiles and queues them.
+     */
+    void emitTileRow(size_t step);
+
+    /**
+     * @brief Halves rows in both directions, keeping the maximum of each block.
+     */
+    static cv::Mat downsample(const cv::Mat& rows);
+
+    /**
+     * @brief Encodes and writes the tiles of one queue until it is closed.
+     */
+    void writeTiles(SpscQueue<TileJob>& queue);
+
+    /**
+     * @brief Closes the queues and joins the writer threads.
+     */
+    void stopWriters();
+
+    bool dzi;                  // Deep Zoom Image, otherwise XYZ
+    std::string path;
+    std::string tileExtension; // e.g. ".png"
+    EncodeOptions options;
+    std::vector<Level> levels; // step 0 is the full map, each step halves it
+    std::set<std::string> directories;
+    size_t tiles = 0;
+
+    std::vector<std::unique_ptr<SpscQueue<TileJob>>> queues;
+    std::vector<std::thread> writers;
+    size_t nextWriter = 0;
+    std::mutex failureMutex;
+    std::string failure; // the first tile that could not be written
+};
+
+#endif //OPERATORS_TILE_PYRAMID_H
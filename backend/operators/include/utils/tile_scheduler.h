@@ -0,0 +1,92 @@
+#ifndef OPERATORS_TILE_SCHEDULER_H
+#define OPERATORS_TILE_SCHEDULER_H
+
+#include "execution_config.h"
+#include "cancellation.h"
+#include <opencv2/core.hpp>
+#include <functional>
+#include <vector>
+
+/**
+ * @file tile_scheduler.h
+ * @brief This file contains the declaration of the TileScheduler class that splits an image into
+ * 2D tiles sized to the L2 cache and runs them on OpenMP threads with per-thread work-stealing deques.
+ * The static and dynamic schedules of an ExecutionConfig run full-width row bands instead.
+ */
+class TileScheduler {
+public:
+    /**
+     * @brief Constructs a TileScheduler.
+     * @param config The thread count, schedule, chunk or tile size and pinning policy.
+     * @param bytesPerPixel The working-set bytes one pixel needs across the per-tile pipeline,
+     * used to size tiles when the configured tile size is empty.
+     */
+    explicit TileScheduler(const ExecutionConfig& config = ExecutionConfig(), size_t bytesPerPixel = 4);
+
+    /**
+     * @brief Constructs a TileScheduler.
+     * @param tileSize The size of a tile. An empty size picks one from the L2 cache size.
+     * @param bytesPerPixel The working-set bytes one pixel needs across the per-tile pipeline,
+     * used to size tiles when tileSize is empty.
+     * @param numThreads The number of threads to run tiles on. 0 uses the OpenMP default.
+     */
+    explicit TileScheduler(cv::Size tileSize, size_t bytesPerPixel = 4, int numThreads = 0);
+
+    /**
+     * @brief Computes a square tile size whose working set fits in half of the L2 cache.
+     * @param bytesPerPixel The working-set bytes one pixel needs across the per-tile pipeline.
+     * @return The tile size.
+     */
+    static cv::Size defaultTileSize(size_t bytesPerPixel);
+
+    /**
+     * @brief Gets the size of the per-core L2 cache.
+     * @return The L2 cache size in bytes, or 256 KiB if the host does not report it.
+     */
+    static size_t l2CacheSize();
+
+    /**
+     * @brief Splits an image into tiles in row-major order, or into bands of chunkSize rows for
+     * the static and dynamic schedules. Tiles on the right and bottom edges are clipped to the image.
+     * @param imageSize The size of the image.
+     * @return The tiles.
+     */
+    [[nodiscard]] std::vector<cv::Rect> makeTiles(cv::Size imageSize) const;
+
+    /**
+     * @brief Runs the work function once for every tile of the image inside a single
+     * OpenMP parallel region. With the tiled schedule each thread starts on a contiguous band
+     * of tiles and steals from the back of the other threads' deques once its own deque is empty.
+     * Threads are pinned for the duration of the region if the configuration asks for it.
+     * @param imageSize The size of the image.
+     * @param work The per-tile pipeline.
+     * @param cancellation The token checked before each tile, or nullptr.
+     * @throws OperationCancelled if the token is cancelled before all tiles have run.
+     * @throws The first exception thrown by the work function, after all threads have stopped.
+     */
+    void run(cv::Size imageSize, const std::function<void(const cv::Rect&)>& work,
+             const CancellationToken* cancellation = nullptr) const;
+
+    /**
+     * @brief Get the tile size.
+     * @return The tile size.
+     */
+    [[nodiscard]] cv::Size getTileSize() const;
+
+    /**
+     * @brief Get the number of threads tiles run on.
+     * @return The number of threads, or 0 for the OpenMP default.
+     */
+    [[nodiscard]] int getNumThreads() const;
+
+    /**
+     * @brief Get the execution configuration, with the tile size resolved.
+     * @return The execution configuration.
+     */
+    [[nodiscard]] const ExecutionConfig& getExecutionConfig() const;
+
+private:
+    ExecutionConfig config;
+};
+
+#endif //OPERATORS_TILE_SCHEDULER_H
@@ -0,0 +1,294 @@
+#ifndef OPERATORS_FRAME_STREAM_H
+#define OPERATORS_FRAME_STREAM_H
+
+#include "gradient/gradient_operator.h"
+#include "utils/image_utils.h"
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @file frame_stream.h
+ * @brief This file contains the sources the video mode reads frames from and the sinks it writes
+ * edge frames to.
+ *
+ * Raw YUV4MPEG2 (Y4M) streams are read and written directly: a frame is a fixed number of bytes,
+ * so no codec runs, and for grayscale operators the luma plane is read straight into the frame.
+ * That makes Y4M the format of choice on pipes, e.g. from and to ffmpeg. Other video files go
+ * through cv::VideoCapture and cv::VideoWriter, and a path with a %d writes one image per frame
+ * in any format getEdges writes.
+ */
+
+/**
+ * @brief The frame rate of a video as a fraction, as Y4M stores it.
+ */
+struct FrameRate {
+    int numerator = 25;
+    int denominator = 1;
+
+    /**
+     * @brief Converts a rate reported as a number, recognizing the NTSC rates such as 30000/1001.
+     * @param fps The frames per second, or 0 if unknown.
+     * @return The rate, 25/1 if it is unknown.
+     */
+    static FrameRate fromFps(double fps);
+
+    [[nodiscard]] double fps() const {
+        return static_cast<double>(numerator) / denominator;
+    }
+};
+
+/**
+ * @brief Reads the frames of a video in order.
+ */
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    /**
+     * @brief Reads the next frame.
+     * @param frame Receives the frame in the mode the source was opened with. Its buffer is
+     * reused when the size and type are unchanged.
+     * @throws std::runtime_error if the stream is malformed or ends inside a frame.
+     * @return false at the end of the video.
+     */
+    virtual bool read(cv::Mat& frame) = 0;
+
+    /**
+     * @brief Get the frame rate of the video.
+     * @return The frame rate.
+     */
+    [[nodiscard]] virtual FrameRate rate() const = 0;
+
+    /**
+     * @brief Opens a video: "-" reads a Y4M stream from stdin, a .y4m path a Y4M file and any
+     * other path whatever cv::VideoCapture can decode.
+     * @param path The path.
+     * @param mode IMREAD_GRAYSCALE for 8-bit gray frames, otherwise 8-bit BGR frames.
+     * @throws std::runtime_error if the video cannot be opened.
+     * @return The source.
+     */
+    static std::unique_ptr<FrameSource> open(const std::string& path, cv::ImreadModes mode);
+};
+
+/**
+ * @brief Writes the edge frames of a video in order.
+ */
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+
+    /**
+     * @brief Writes the next frame.
+     * @param result The result of computeEdges for the extension().
+     * @throws std::runtime_error if the frame cannot be written.
+     */
+    virtual void write(const EdgeResult& result) = 0;
+
+    /**
+     * @brief Flushes the output after the last frame.
+     * @throws std::runtime_error if the output cannot be written.
+     */
+    virtual void close() {}
+
+    /**
+     * @brief Get the extension the frames are computed for, as computeEdges takes it.
+     * @return The extension, "" for an edge map.
+     */
+    [[nodiscard]] virtual std::string extension() const {
+        return "";
+    }
+
+    /**
+     * @brief Opens an output: "-" writes a Y4M stream to stdout, a .y4m path a Y4M file, a path
+     * with a %d (optionally %0Nd) one file per frame numbered from 1, and .avi, .mkv, .mp4, .mov
+     * or .m4v paths a video through cv::VideoWriter.
+     * @param path The path.
+     * @param rate The frame rate of the input.
+     * @param gradientOperator Encodes the frames of a frame sequence. Not owned.
+     * @throws std::runtime_error if the path names no supported output or cannot be opened.
+     * @return The sink.
+     */
+    static std::unique_ptr<FrameSink> open(const std::string& path, FrameRate rate,
+                                           GradientOperator& gradientOperator);
+};
+
+/**
+ * @brief Reads 8-bit Y4M streams with mono, 4:2:0, 4:2:2 or 4:4:4 sampling.
+ */
+class Y4mReader : public FrameSource {
+public:
+    /**
+     * @brief Opens and reads the header of a Y4M file.
+     * @param path The path.
+     * @param mode IMREAD_GRAYSCALE to read only the luma plane, otherwise frames are converted to BGR.
+     * @throws std::runtime_error if the file cannot be opened or its header is not supported.
+     */
+    Y4mReader(const std::string& path, cv::ImreadModes mode);
+
+    /**
+     * @brief Reads the header of a Y4M stream.
+     * @param input The stream, e.g. stdin. Not owned.
+     * @param mode IMREAD_GRAYSCALE to read only the luma plane, otherwise frames are converted to BGR.
+     * @throws std::runtime_error if the header is not supported.
+     */
+    Y4mReader(std::FILE* input, cv::ImreadModes mode);
+
+    ~Y4mReader() override;
+
+    Y4mReader(const Y4mReader&) = delete;
+    Y4mReader& operator=(const Y4mReader&) = delete;
+
+    /**
+     * @copydoc FrameSource::read
+     * BGR frames need even dimensions; chroma that is not 4:2:0 is resampled to 4:2:0 first, so
+     * every format is converted with the same BT.601 coefficients.
+     */
+    bool read(cv::Mat& frame) override;
+
+    [[nodiscard]] FrameRate rate() const override {
+        return frameRate;
+    }
+
+    [[nodiscard]] cv::Size size() const {
+        return frameSize;
+    }
+
+    /**
+     * @brief Get the colorspace of the stream as its C parameter names it.
+     * @return e.g. "420jpeg" or "mono".
+     */
+    [[nodiscard]] const std::string& colorspace() const {
+        return chroma;
+    }
+
+private:
+    void readHeader();
+    void readExactly(uint8_t* data, size_t size);
+
+    std::FILE* file;
+    bool owned;
+    cv::ImreadModes mode;
+    cv::Size frameSize;
+    cv::Size chromaSize; // of each chroma plane, empty for mono
+    FrameRate frameRate;
+    std::string chroma = "420jpeg";
+    cv::Mat planes;      // the raw planes of a BGR frame
+    cv::Mat upsampled;   // 4:2:2 or 4:4:4 chroma resampled to 4:2:0
+    std::vector<uint8_t> skipped; // the chroma planes of a gray frame
+};
+
+/**
+ * @brief Writes 8-bit single-channel frames as a mono Y4M stream.
+ */
+class Y4mWriter : public FrameSink {
+public:
+    /**
+     * @brief Creates a Y4M file. The header is written with the first frame, which sets the size.
+     * @param path The path.
+     * @param rate The frame rate.
+     * @throws std::runtime_error if the file cannot be created.
+     */
+    Y4mWriter(const std::string& path, FrameRate rate);
+
+    /**
+     * @brief Writes a Y4M stream.
+     * @param output The stream, e.g. stdout. Not owned.
+     * @param rate The frame rate.
+     */
+    Y4mWriter(std::FILE* output, FrameRate rate);
+
+    ~Y4mWriter() override;
+
+    Y4mWriter(const Y4mWriter&) = delete;
+    Y4mWriter& operator=(const Y4mWriter&) = delete;
+
+    /**
+     * @copydoc FrameSink::write
+     * @throws std::runtime_error if the edge map is not 8-bit single-channel or changes size.
+     */
+    void write(const EdgeResult& result) override;
+
+    /**
+     * @brief Writes one frame.
+     * @param frame The 8-bit single-channel frame.
+     * @throws std::runtime_error if the frame is not 8-bit single-channel, changes size or cannot be written.
+     */
+    void writeFrame(const cv::Mat& frame);
+
+    void close() override;
+
+private:
+    std::FILE* file;
+    bool owned;
+    FrameRate frameRate;
+    cv::Size frameSize; // empty until the header is written
+};
+
+/**
+ * @brief Writes one image per frame, encoded by the operator as getEdges would.
+ */
+class FrameSequenceWriter : public FrameSink {
+public:
+    /**
+     * @brief Constructs a FrameSequenceWriter.
+     * @param pattern The path with one %d or %0Nd, replaced by the frame number from 1.
+     * @param gradientOperator Encodes the frames with its encode options. Not owned.
+     * @throws std::runtime_error if the pattern has no %d or another % conversion.
+     */
+    FrameSequenceWriter(const std::string& pattern, GradientOperator& gradientOperator);
+
+    void write(const EdgeResult& result) override;
+
+    [[nodiscard]] std::string extension() const override {
+        return ImageUtils::extensionOf(pattern);
+    }
+
+    /**
+     * @brief Get the path of a frame.
+     * @param number The frame number.
+     * @return The pattern with the number in place of its %d.
+     */
+    [[nodiscard]] std::string pathOf(size_t number) const;
+
+private:
+    std::string pattern;
+    size_t conversion = 0; // where the % is
+    size_t length = 0;     // of the conversion
+    size_t width = 0;      // zero-padded digits, 0 for no padding
+    size_t frames = 0;
+    GradientOperator& gradientOperator;
+};
+
+/**
+ * @brief Writes an edge video through cv::VideoWriter: Motion JPEG in .avi and .mkv files, MPEG-4
+ * part 2 in .mp4, .mov and .m4v files.
+ */
+class VideoFileWriter : public FrameSink {
+public:
+    /**
+     * @brief Constructs a VideoFileWriter. The file is opened with the first frame, which sets the size.
+     * @param path The path.
+     * @param rate The frame rate.
+     * @throws std::runtime_error if the extension names no supported container.
+     */
+    VideoFileWriter(const std::string& path, FrameRate rate);
+
+    void write(const EdgeResult& result) override;
+
+    void close() override;
+
+private:
+    std::string path;
+    FrameRate frameRate;
+    int fourcc;
+    cv::VideoWriter writer;
+};
+
+#endif //OPERATORS_FRAME_STREAM_H
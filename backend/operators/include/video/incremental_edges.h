@@ -0,0 +1,133 @@
+#ifndef OPERATORS_INCREMENTAL_EDGES_H
+#define OPERATORS_INCREMENTAL_EDGES_H
+
+#include "gradient/gradient_operator.h"
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @file incremental_edges.h
+ * @brief This file contains IncrementalEdges, which detects the edges of a frame sequence by
+ * recomputing only the tiles that changed since the previous frame.
+ *
+ * Each tile of the output depends only on the input within the operator's halo radius of it, so
+ * a tile whose input region, halo included, is unchanged keeps its edges from the frame before.
+ * The changed tiles of each tile row are merged into runs, and each run is detected on its own
+ * with the halo around it, which gives exactly the edges the whole frame would give there.
+ * Thresholds such as Otsu's depend on the whole frame, so they are applied to the assembled edge
+ * map afterwards.
+ */
+
+/**
+ * @brief How frames are compared.
+ */
+struct IncrementalOptions {
+    bool enabled = false;
+    cv::Size tileSize = cv::Size(64, 64);
+    double threshold = 0; // mean absolute difference per sample a tile may change by and still be reused
+
+    /**
+     * @brief Applies one command line flag: --incremental enables the mode with 64x64 tiles,
+     * --incremental=N or =WxH with tiles of that size, and --dirty-threshold=D lets tiles whose
+     * input changed by at most D levels on average keep their edges.
+     * @param arg The command line argument.
+     * @throws std::runtime_error if the flag is known but its value is invalid.
+     * @return true if the flag was recognized, false otherwise.
+     */
+    bool parseFlag(const std::string& arg);
+};
+
+class IncrementalEdges {
+public:
+    /**
+     * @brief Constructs IncrementalEdges.
+     * @param gradientOperator The operator. Operators without a halo radius recompute every frame
+     * whole. Not owned.
+     * @param options The tile size and threshold.
+     * @throws std::runtime_error if the tile size is empty or the threshold negative.
+     */
+    IncrementalEdges(GradientOperator& gradientOperator, const IncrementalOptions& options);
+
+    /**
+     * @brief Detects the edges of the next frame.
+     * @param frame The frame, which is compared with the frames before it.
+     * @return The edge map, kept and updated in place by the next call.
+     */
+    const cv::Mat& detectEdges(const cv::Mat& frame);
+
+    /**
+     * @brief Computes a frame like GradientOperator::computeEdges, limited to the operator's
+     * region of interest if it has one. Point lists and gradient tensors need the gradients of the
+     * whole region, so they are always recomputed.
+     * @param frame The frame.
+     * @param extension The extension, e.g. ".png".
+     * @return The result, which owns its buffers.
+     */
+    EdgeResult computeEdges(const cv::Mat& frame, const std::string& extension);
+
+    /**
+     * @brief Forgets the previous frame, so the next one is computed whole.
+     */
+    void reset();
+
+    /**
+     * @brief Checks whether the operator allows recomputing parts of a frame.
+     * @return true if it has a halo radius.
+     */
+    [[nodiscard]] bool isIncremental() const {
+        return radius >= 0;
+    }
+
+    /**
+     * @brief Get the tiles of the last frame.
+     * @return The count.
+     */
+    [[nodiscard]] size_t lastTiles() const {
+        return tiles;
+    }
+
+    /**
+     * @brief Get the tiles the last frame recomputed.
+     * @return The count, all tiles for a frame computed whole.
+     */
+    [[nodiscard]] size_t lastDirtyTiles() const {
+        return dirtyTiles;
+    }
+
+private:
+    /**
+     * @brief Splits a frame of the given size into tiles.
+     */
+    void layoutTiles(cv::Size frameSize);
+
+    /**
+     * @brief Compares the input region of each tile with the reference and marks the changed ones.
+     * @return The number of changed tiles.
+     */
+    size_t markDirtyTiles(const cv::Mat& frame);
+
+    /**
+     * @brief Checks whether a region changed by more than the threshold.
+     */
+    [[nodiscard]] bool changed(const cv::Mat& current, const cv::Mat& previous) const;
+
+    /**
+     * @brief Computes the whole frame and makes it the reference.
+     */
+    void computeWhole(const cv::Mat& frame);
+
+    GradientOperator& gradientOperator;
+    IncrementalOptions options;
+    int radius;
+    cv::Mat reference;          // the input the edges of each tile were computed from
+    cv::Mat edges;              // the edge map of the last frame
+    cv::Size grid;              // tiles per row and column
+    std::vector<uint8_t> dirty; // per tile, whether it is recomputed
+    size_t tiles = 0;
+    size_t dirtyTiles = 0;
+};
+
+#endif //OPERATORS_INCREMENTAL_EDGES_H
@@ -0,0 +1,92 @@
+#ifndef OPERATORS_VIDEO_PIPELINE_H
+#define OPERATORS_VIDEO_PIPELINE_H
+
+#include "gradient/gradient_operator.h"
+#include "video/frame_stream.h"
+#include "video/incremental_edges.h"
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <string>
+
+/**
+ * @file video_pipeline.h
+ * @brief This file contains the declaration of the VideoPipeline that runs an operator over the
+ * frames of a video with decoding, edge detection and encoding overlapped on three threads.
+ *
+ * The stages are those of the BatchPipeline: the decode thread reads frame i + 1 from the source
+ * while the calling thread computes frame i and the encode thread writes frame i - 1 to the sink.
+ * Every stage is one thread and the queues keep their order, so the frames come out in the order
+ * they came in. The slots keep their frame buffers, so a video of one size decodes without
+ * allocating. In incremental mode the compute stage only recomputes the tiles that changed since
+ * the frame before.
+ */
+
+/**
+ * @brief The outcome of a video.
+ */
+struct VideoStats {
+    size_t frames = 0;         // frames written
+    double seconds = 0;        // wall time of the video
+    double decodeSeconds = 0;  // time each stage was busy
+    double computeSeconds = 0;
+    double encodeSeconds = 0;
+    size_t tiles = 0;          // tiles over all frames in incremental mode
+    size_t dirtyTiles = 0;     // of those, the tiles that were recomputed
+};
+
+class VideoPipeline {
+public:
+    /**
+     * @brief Constructs a VideoPipeline.
+     * @param gradientOperator The operator, with its options and token already set. Only the
+     * compute stage runs its detection. Not owned.
+     * @param depth The frames in flight across the stages.
+     * @throws std::runtime_error if the depth is 0.
+     */
+    explicit VideoPipeline(GradientOperator& gradientOperator, size_t depth = 4);
+
+    /**
+     * @brief Sets the token the decode stage checks before reading the next frame.
+     * @param token The token, or nullptr to always run to the end. Not owned.
+     */
+    void setCancellationToken(const CancellationToken* token) {
+        cancellation = token;
+    }
+
+    /**
+     * @brief Sets whether frames are computed whole or only where they changed.
+     * @param options The incremental options, disabled by default.
+     */
+    void setIncremental(const IncrementalOptions& options) {
+        incremental = options;
+    }
+
+    /**
+     * @brief Processes every frame of the source and closes the sink. Unlike a batch, a video
+     * stops at the first frame that fails, since a gap would shift every frame after it.
+     * @param source The frames, read in the mode of the operator's inputMode().
+     * @param sink Where the edge frames go, computed for its extension().
+     * @throws OperationCancelled if the token was cancelled before the end of the video.
+     * @throws std::runtime_error naming the frame if a frame could not be read, processed or written.
+     * @return The frame count and stage times.
+     */
+    VideoStats run(FrameSource& source, FrameSink& sink);
+
+private:
+    /**
+     * @brief The buffers of one frame in flight, recycled from frame to frame.
+     */
+    struct Slot {
+        size_t frame = 0;
+        cv::Mat image;     // the decoded frame, its buffer reused while the size stays the same
+        EdgeResult result;
+        std::string error; // why the frame failed, empty while it has not
+    };
+
+    GradientOperator& gradientOperator;
+    size_t depth;
+    IncrementalOptions incremental;
+    const CancellationToken* cancellation = nullptr;
+};
+
+#endif //OPERATORS_VIDEO_PIPELINE_H
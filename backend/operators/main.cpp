@@ -1,10 +1,19 @@
 #include <iostream>
 #include "include/gradient/gradient_operator.h"
-#include "include/gradient/ocv_sobel.h"
-#include "include/gradient/alt_sobel.h"
-#include "include/gradient/omp_sobel.h"
-#include "include/gradient/ocv_prewitt.h"
-#include "include/gradient/ocv_roberts_cross.h"
+#include "include/gradient/operator_registry.h"
+#include "include/gradient/sobel_tuner.h"
+#include "include/utils/execution_config.h"
+#include "include/utils/thread_affinity.h"
+#include "include/utils/cancellation.h"
+#include "include/utils/resource_limits.h"
+#include "include/utils/edge_options.h"
+#include "include/utils/encode_options.h"
+#include "include/batch/batch_pipeline.h"
+#include "include/video/video_pipeline.h"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <unistd.h>
 using namespace std;
 
 // helper method that applies the operator and gets the edges and onwards.
@@ -14,38 +23,236 @@ void applyOperator(GradientOperator* operatorPtr, const string& inputPath, const
     delete operatorPtr;
 }
 
+// prints the estimate of an input and how it will be decoded, before it is processed.
+void reportDecode(const DecodePlan& plan) {
+    if (!plan.probed) {
+        return;
+    }
+    double megabytes = static_cast<double>(plan.estimate.peakBytes) / (1 << 20);
+    if (plan.region.size() != plan.imageSize) {
+        printf("Estimated: %dx%d of %dx%d, %.1f MB, %.2fs, %s decode\n", plan.region.width, plan.region.height,
+               plan.imageSize.width, plan.imageSize.height, megabytes, plan.estimate.seconds,
+               plan.partial ? "partial" : "full");
+    } else {
+        printf("Estimated: %dx%d, %.1f MB, %.2fs\n", plan.imageSize.width, plan.imageSize.height, megabytes,
+               plan.estimate.seconds);
+    }
+    if (plan.reduction > 1) {
+        printf("Downscaling input by %d to fit the limits\n", plan.reduction);
+    }
+}
+
+// warns when the tuning table used by sobel:auto was measured on a host with another CPU count.
+void reportTuningTable(ostream& out) {
+    const TuningTable& table = TuningTable::hostTable();
+    if (!table.fitsHost()) {
+        out << "Warning: tuning table " << TuningTable::defaultPath() << " was measured on "
+            << table.getMeasuredCpus() << " CPUs, this host has " << cv::getNumberOfCPUs() << endl;
+    }
+}
+
+// benchmarks the Sobel backends on this host and writes the tuning table used by sobel:auto.
+int tune(const string& tablePath) {
+    cout << "Tuning Sobel backends, writing " << tablePath << endl;
+    TuningTable table = SobelAutoTuner().tune(SobelAutoTuner::defaultSizes());
+    for (const auto& entry : table.getEntries()) {
+        cout << entry.imageSize.width << "x" << entry.imageSize.height << ": " << entry.backend
+             << " threads=" << entry.threads
+             << " tile=" << entry.tileSize.width << "x" << entry.tileSize.height
+             << " time=" << entry.seconds << "s" << endl;
+    }
+    cout << "batch crossover: one image per thread up to " << table.getBatchCrossoverPixels() << " pixels" << endl;
+    table.save(tablePath);
+    return 0;
+}
+
+// prints the registered operators with their parameters and capabilities.
+int listOperators() {
+    for (const OperatorDescriptor* descriptor : OperatorRegistry::builtin().list()) {
+        const OperatorCapabilities& capabilities = descriptor->capabilities;
+        cout << descriptor->name << ": " << descriptor->description << endl;
+        cout << "  in-place: " << capabilities.inPlace << ", streaming: " << capabilities.streaming
+             << ", simd: " << capabilities.simd << ", thread-safe: " << capabilities.threadSafe << endl;
+        for (const OperatorParameter& parameter : descriptor->parameters) {
+            cout << "  " << parameter.flag << ": " << parameter.description << endl;
+        }
+    }
+    cout << "sobel:auto tuning table: " << TuningTable::defaultPath() << ", "
+         << TuningTable::hostTable().getEntries().size() << " sizes" << endl;
+    reportTuningTable(cout);
+    return 0;
+}
+
+// runs the operator over every frame of a video and prints the throughput.
+int processVideo(GradientOperator& gradientOperator, const string& inputPath, const string& outputPath,
+                 size_t depth, const IncrementalOptions& incremental, const CancellationToken& cancellation) {
+    unique_ptr<FrameSource> source = FrameSource::open(inputPath, gradientOperator.inputMode());
+    unique_ptr<FrameSink> sink;
+    FILE* report = stdout;
+    if (outputPath == "-") {
+        // the frames keep the real stdout; everything the operators print goes to stderr instead
+        FILE* stream = fdopen(dup(STDOUT_FILENO), "wb");
+        if (stream == nullptr || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            throw runtime_error("Could not redirect stdout for the video stream");
+        }
+        sink = make_unique<Y4mWriter>(stream, source->rate());
+        report = stderr;
+    } else {
+        sink = FrameSink::open(outputPath, source->rate(), gradientOperator);
+    }
+
+    if (incremental.enabled && gradientOperator.haloRadius() < 0) {
+        fprintf(report, "Incremental: %s depends on the whole frame, every frame is computed whole\n",
+                gradientOperator.getOperatorName().c_str());
+    }
+
+    VideoPipeline pipeline(gradientOperator, depth);
+    pipeline.setIncremental(incremental);
+    pipeline.setCancellationToken(&cancellation);
+    VideoStats stats = pipeline.run(*source, *sink);
+    double fps = stats.seconds > 0 ? static_cast<double>(stats.frames) / stats.seconds : 0.0;
+    fprintf(report, "Video: %zu frames in %.2fs (%.1f fps, %.2fx real time), busy decode %.2fs, compute %.2fs,"
+            " encode %.2fs\n", stats.frames, stats.seconds, fps, fps / source->rate().fps(),
+            stats.decodeSeconds, stats.computeSeconds, stats.encodeSeconds);
+    if (stats.tiles > 0) {
+        fprintf(report, "Incremental: recomputed %zu of %zu tiles (%.1f%%)\n", stats.dirtyTiles, stats.tiles,
+                100.0 * static_cast<double>(stats.dirtyTiles) / static_cast<double>(stats.tiles));
+    }
+    return 0;
+}
+
 // main method that processes the input arguments from the backend and applies the operator.
 int main(int argc, char* argv[]) {
+    if (argc >= 2 && string(argv[1]) == "--tune") {
+        try {
+            return tune(argc >= 3 ? argv[2] : TuningTable::defaultPath());
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << endl;
+            return 1;
+        }
+    }
+
+    if (argc >= 2 && string(argv[1]) == "--list") {
+        return listOperators();
+    }
+
     if (argc < 4) {
-        cerr << "Usage: operators <operator> <input_path> <output_path>" << endl;
+        cerr << "Usage: operators <operator> <input_path> <output_path> [options]" << endl;
+        cerr << "       operators --batch <operator> <manifest|-> [options] [--depth=N]"
+             << " [--parallelism=auto|intra|inter]" << endl;
+        cerr << "       operators --video <operator> <input|-> <output|-> [options] [--depth=N]"
+             << " [--incremental[=WxH]] [--dirty-threshold=D]" << endl;
+        cerr << "       operators --tune [tuning_table_path]" << endl;
+        cerr << "       operators --list" << endl;
+        cerr << "Operators: see --list, or pipeline:<stages> e.g. pipeline:blur=5,sobel,threshold=40" << endl;
+        cerr << "Options: --threads=N --schedule=tiled|static|dynamic --chunk=N --tile=WxH"
+             << " --pin=none|compact|scatter|list --cpus=0-3,8 --deadline-ms=N"
+             << " --max-memory=MB --max-pixels=N --oversize=reject|downscale --sigma=S"
+             << " --threshold=N|otsu --angles --roi=X,Y,W,H --quality=N --png-level=N"
+             << " --png-strategy=default|filtered|huffman|rle|fixed" << endl;
+        return 1;
+    }
+
+    // batch mode reads input and output paths from a manifest, one tab-separated pair per line
+    bool batch = string(argv[1]) == "--batch";
+    // video mode reads frames from a video or a Y4M stream, "-" for stdin and stdout
+    bool video = string(argv[1]) == "--video";
+    if (video && argc < 5) {
+        cerr << "Usage: operators --video <operator> <input|-> <output|-> [options] [--depth=N]" << endl;
         return 1;
     }
+    string operatorType = batch || video ? argv[2] : argv[1];
+    string inputPath = video ? argv[3] : argv[2];
+    string outputPath = video ? argv[4] : argv[3];
 
-    string operatorType = argv[1];
-    string inputPath = argv[2];
-    string outputPath = argv[3];
+    // SIGTERM/SIGINT/SIGUSR1 stop the operator at its next check instead of killing it mid-write
+    CancellationToken& cancellation = CancellationToken::process();
+    CancellationToken::installSignalHandlers();
 
     try {
-        if (operatorType == "opencv%20sobel") {
-            OcvSobel sobelOperator;
-            sobelOperator.getEdges(inputPath, outputPath);
-        } else if (operatorType == "alternative%20sobel") {
-            AltSobel altSobelOperator;
-            altSobelOperator.getEdges(inputPath, outputPath);
-        } else if (operatorType == "openmp%20sobel") {
-            OmpSobel ompSobelOperator;
-            ompSobelOperator.getEdges(inputPath, outputPath);
-        } else if (operatorType == "prewitt") {
-            OcvPrewitt prewittOperator;
-            prewittOperator.getEdges(inputPath, outputPath);
-        } else if (operatorType == "roberts%20cross") {
-            OcvRobertsCross robertsCross;
-            robertsCross.getEdges(inputPath, outputPath);
-        } else {
-            cerr << "Unknown operator: " << operatorType << endl;
-            return 1;
+        ExecutionConfig config;
+        ResourceLimits limits;
+        EdgeOptions options;
+        EncodeOptions encoding;
+        BatchOptions batchOptions;
+        IncrementalOptions incremental;
+        for (int i = video ? 5 : 4; i < argc; ++i) {
+            string arg = argv[i];
+            if (batch && batchOptions.parseFlag(arg)) {
+                continue;
+            }
+            // a video shares the overlapped stages of a batch but not its one image per thread
+            if (video && ((arg.rfind("--depth=", 0) == 0 && batchOptions.parseFlag(arg)) || incremental.parseFlag(arg))) {
+                continue;
+            }
+            if (!config.parseFlag(arg) && !limits.parseFlag(arg) && !cancellation.parseFlag(arg)
+                && !options.parseFlag(arg) && !encoding.parseFlag(arg)) {
+                cerr << "Unknown option: " << argv[i] << endl;
+                return 1;
+            }
         }
+        // backstop for formats the header probe does not know: OpenCV refuses to decode larger images
+        if (limits.maxPixels > 0) {
+            setenv("OPENCV_IO_MAX_IMAGE_PIXELS", to_string(limits.maxPixels).c_str(), 1);
+        }
+        // bounds the OpenCV worker pool used by the OpenCV-based operators
+        if (config.numThreads > 0) {
+            cv::setNumThreads(config.numThreads);
+        }
+        // OmpSobel pins its own threads per region; this covers the OpenCV pool workers, not the main
+        // thread, whose CPU mask every thread it creates later inherits
+        ThreadAffinity::pinOpenCVWorkers(config);
+
+        unique_ptr<GradientOperator> gradientOperator = OperatorRegistry::builtin().create(operatorType, config);
+        if (OperatorRegistry::decodeName(operatorType) == "sobel:auto") {
+            reportTuningTable(cerr);
+        }
+        gradientOperator->setCancellationToken(&cancellation);
+        gradientOperator->setResourceLimits(limits);
+        gradientOperator->setEdgeOptions(options);
+        gradientOperator->setEncodeOptions(encoding);
+        if (video) {
+            return processVideo(*gradientOperator, inputPath, outputPath, batchOptions.depth, incremental, cancellation);
+        }
+        if (batch) {
+            // workers that run one image each get a single-threaded copy of the operator
+            ExecutionConfig workerConfig = config;
+            workerConfig.numThreads = 1;
+            OperatorFactory factory = [&]() {
+                unique_ptr<GradientOperator> worker = OperatorRegistry::builtin().create(operatorType, workerConfig);
+                worker->setCancellationToken(&cancellation);
+                worker->setResourceLimits(limits);
+                worker->setEdgeOptions(options);
+                worker->setEncodeOptions(encoding);
+                return worker;
+            };
+            batchOptions.workers = config.numThreads;
+            double crossover = TuningTable::hostTable().getBatchCrossoverPixels();
+            if (crossover >= 0) {
+                batchOptions.crossoverPixels = crossover;
+            }
+
+            BatchPipeline pipeline(*gradientOperator, batchOptions, factory);
+            pipeline.setCancellationToken(&cancellation);
+            BatchStats stats = pipeline.run(BatchPipeline::readManifest(argv[3]));
+            printf("Batch: %zu images (%zu one per thread), %zu failed in %.2fs (%.1f images/s), busy decode %.2fs,"
+                   " compute %.2fs, encode %.2fs\n", stats.images, stats.interImages, stats.failed, stats.seconds,
+                   stats.seconds > 0 ? static_cast<double>(stats.images) / stats.seconds : 0.0,
+                   stats.decodeSeconds, stats.computeSeconds, stats.encodeSeconds);
+            return stats.failed > 0 ? 1 : 0;
+        }
+        reportDecode(gradientOperator->planDecode(inputPath, gradientOperator->inputMode()));
+        gradientOperator->getEdges(inputPath, outputPath);
         cout << "Processing completed successfully!" << endl;
+    } catch (const OperationCancelled& e) {
+        cerr << "Cancelled: " << e.what() << endl;
+        return 2;
+    } catch (const ImageTooLarge& e) {
+        cerr << "Rejected: " << e.what() << endl;
+        return 3;
+    } catch (const UnknownOperator& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 4;
     } catch (const exception& e) {
         cerr << "Error: " << e.what() << endl;
         return 1;
@@ -0,0 +1,285 @@
+#include "batch/batch_pipeline.h"
+#include "utils/image_utils.h"
+#include "utils/spsc_queue.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <omp.h>
+#include <thread>
+using namespace std;
+
+namespace {
+    double secondsSince(chrono::steady_clock::time_point start) {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    // Reads a file into a buffer, reusing its capacity.
+    void readFile(const string& path, vector<uint8_t>& buffer) {
+        ifstream file(path, ios::binary | ios::ate);
+        if (!file) {
+            throw runtime_error("Could not read the image: " + path);
+        }
+        buffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(buffer.data()), static_cast<streamsize>(buffer.size()));
+        if (!file || buffer.empty()) {
+            throw runtime_error("Could not read the image: " + path);
+        }
+    }
+
+    string trim(const string& text) {
+        size_t begin = text.find_first_not_of(" \t\r");
+        size_t end = text.find_last_not_of(" \t\r");
+        return begin == string::npos ? "" : text.substr(begin, end - begin + 1);
+    }
+}
+
+bool BatchOptions::parseFlag(const string& arg) {
+    const string parallelismFlag = "--parallelism=";
+    if (arg.rfind(parallelismFlag, 0) == 0) {
+        string value = arg.substr(parallelismFlag.size());
+        if (value == "auto") {
+            parallelism = BatchParallelism::Auto;
+        } else if (value == "intra") {
+            parallelism = BatchParallelism::Intra;
+        } else if (value == "inter") {
+            parallelism = BatchParallelism::Inter;
+        } else {
+            throw runtime_error("Invalid value for --parallelism: " + value + ", expected auto, intra or inter");
+        }
+        return true;
+    }
+
+    const string depthFlag = "--depth=";
+    if (arg.rfind(depthFlag, 0) != 0) {
+        return false;
+    }
+    string value = arg.substr(depthFlag.size());
+    size_t end = 0;
+    int number = 0;
+    try {
+        number = stoi(value, &end);
+    } catch (const exception&) {
+        end = 0;
+    }
+    if (end == 0 || end != value.size() || number < 1 || number > 64) {
+        throw runtime_error("Invalid value for --depth: " + value + ", expected 1 to 64");
+    }
+    depth = static_cast<size_t>(number);
+    return true;
+}
+
+BatchPipeline::BatchPipeline(GradientOperator& gradientOperator, const BatchOptions& options, OperatorFactory factory)
+        : gradientOperator(gradientOperator), options(options), factory(std::move(factory)) {
+    if (options.depth == 0) {
+        throw runtime_error("A batch needs at least one slot");
+    }
+}
+
+bool BatchPipeline::runsPerThread(const optional<ImageInfo>& info) const {
+    if (!factory || options.parallelism == BatchParallelism::Intra) {
+        return false;
+    }
+    if (options.parallelism == BatchParallelism::Inter) {
+        return true;
+    }
+    // an unknown header may hide a large image, which would hold one worker for the whole batch
+    return info && static_cast<double>(info->width) * info->height <= options.crossoverPixels;
+}
+
+BatchStats BatchPipeline::run(const vector<BatchJob>& jobs) {
+    BatchStats stats;
+    auto batchStart = chrono::steady_clock::now();
+
+    vector<size_t> perThread;
+    vector<size_t> overlapped;
+    for (size_t job = 0; job < jobs.size(); ++job) {
+        (runsPerThread(ImageUtils::probeImage(jobs[job].inputPath)) ? perThread : overlapped).push_back(job);
+    }
+    if (!perThread.empty()) {
+        runPerThread(jobs, perThread, stats);
+    }
+    if (!overlapped.empty()) {
+        runOverlapped(jobs, overlapped, stats);
+    }
+    stats.seconds = secondsSince(batchStart);
+
+    // a cancelled operator fails the image it was computing, so any unwritten image counts
+    if (cancellation && stats.images < jobs.size()) {
+        cancellation->throwIfCancelled();
+    }
+    return stats;
+}
+
+void BatchPipeline::runPerThread(const vector<BatchJob>& jobs, const vector<size_t>& indices, BatchStats& stats) {
+    const int workers = options.workers > 0 ? options.workers : omp_get_max_threads();
+    const int count = static_cast<int>(indices.size());
+    vector<unique_ptr<GradientOperator>> operators;
+    for (int worker = 0; worker < min(workers, count); ++worker) {
+        operators.push_back(factory());
+    }
+
+    // the OpenCV-based operators would otherwise each start the OpenCV pool from every worker
+    int previousThreads = cv::getNumThreads();
+    cv::setNumThreads(1);
+
+    size_t images = 0;
+    size_t failed = 0;
+    double decodeSeconds = 0;
+    double computeSeconds = 0;
+    double encodeSeconds = 0;
+#pragma omp parallel num_threads(static_cast<int>(operators.size())) \
+        reduction(+:images, failed, decodeSeconds, computeSeconds, encodeSeconds)
+    {
+        GradientOperator& worker = *operators[omp_get_thread_num()];
+        // per-thread buffers, recycled from image to image like the slots of the overlapped stages
+        vector<uint8_t> input;
+        cv::Mat image;
+
+#pragma omp for schedule(dynamic, 1)
+        for (int i = 0; i < count; ++i) {
+            const BatchJob& job = jobs[indices[i]];
+            if (cancellation && cancellation->isCancelled()) {
+                continue;
+            }
+            string extension = ImageUtils::extensionOf(job.outputPath);
+            auto start = chrono::steady_clock::now();
+            try {
+                readFile(job.inputPath, input);
+                worker.decodeImage(input.data(), input.size(), image);
+                auto computeStart = chrono::steady_clock::now();
+                decodeSeconds += chrono::duration<double>(computeStart - start).count();
+
+                EdgeResult result = worker.computeEdges(image, extension);
+                auto encodeStart = chrono::steady_clock::now();
+                computeSeconds += chrono::duration<double>(encodeStart - computeStart).count();
+
+                ImageUtils::writeFile(worker.encodeResult(result, extension), job.outputPath);
+                encodeSeconds += secondsSince(encodeStart);
+                ++images;
+            } catch (const exception& e) {
+                ++failed;
+#pragma omp critical(batch_report)
+                cerr << "Failed: " << job.inputPath << ": " << e.what() << endl;
+            }
+        }
+    }
+    cv::setNumThreads(previousThreads);
+
+    stats.images += images;
+    stats.failed += failed;
+    stats.interImages += images;
+    stats.decodeSeconds += decodeSeconds;
+    stats.computeSeconds += computeSeconds;
+    stats.encodeSeconds += encodeSeconds;
+}
+
+void BatchPipeline::runOverlapped(const vector<BatchJob>& jobs, const vector<size_t>& indices, BatchStats& stats) {
+    const size_t depth = options.depth;
+    vector<Slot> slots(depth);
+    SpscQueue<Slot*> freeSlots(depth);
+    SpscQueue<Slot*> decoded(depth);
+    SpscQueue<Slot*> computed(depth);
+    // filled before the stage threads start, so the producer of freeSlots is still unique
+    for (Slot& slot : slots) {
+        freeSlots.push(&slot);
+    }
+
+    thread decoder([&]() {
+        for (size_t job : indices) {
+            if (cancellation && cancellation->isCancelled()) {
+                break;
+            }
+            Slot* slot = nullptr;
+            freeSlots.pop(slot);
+            auto start = chrono::steady_clock::now();
+            slot->job = job;
+            slot->error.clear();
+            try {
+                readFile(jobs[job].inputPath, slot->input);
+                gradientOperator.decodeImage(slot->input.data(), slot->input.size(), slot->image);
+            } catch (const exception& e) {
+                slot->error = e.what();
+            }
+            stats.decodeSeconds += secondsSince(start);
+            decoded.push(slot);
+        }
+        decoded.close();
+    });
+
+    thread encoder([&]() {
+        Slot* slot = nullptr;
+        while (computed.pop(slot)) {
+            const BatchJob& job = jobs[slot->job];
+            auto start = chrono::steady_clock::now();
+            if (slot->error.empty()) {
+                try {
+                    string extension = ImageUtils::extensionOf(job.outputPath);
+                    ImageUtils::writeFile(gradientOperator.encodeResult(slot->result, extension), job.outputPath);
+                } catch (const exception& e) {
+                    slot->error = e.what();
+                }
+            }
+            stats.encodeSeconds += secondsSince(start);
+
+            if (slot->error.empty()) {
+                ++stats.images;
+            } else {
+                ++stats.failed;
+                cerr << "Failed: " << job.inputPath << ": " << slot->error << endl;
+            }
+            // the result is the operator's own allocation, only the input buffers are pooled
+            slot->result = EdgeResult();
+            freeSlots.push(slot);
+        }
+    });
+
+    // the operator runs on the calling thread, which keeps the pinning and OpenMP settings of the job
+    Slot* slot = nullptr;
+    while (decoded.pop(slot)) {
+        auto start = chrono::steady_clock::now();
+        if (slot->error.empty()) {
+            try {
+                slot->result = gradientOperator.computeEdges(slot->image, ImageUtils::extensionOf(jobs[slot->job].outputPath));
+            } catch (const exception& e) {
+                slot->error = e.what();
+            }
+        }
+        stats.computeSeconds += secondsSince(start);
+        computed.push(slot);
+    }
+    computed.close();
+
+    decoder.join();
+    encoder.join();
+}
+
+vector<BatchJob> BatchPipeline::readManifest(const string& path) {
+    ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) {
+            throw runtime_error("Could not read the batch manifest: " + path);
+        }
+    }
+    istream& input = path == "-" ? cin : file;
+
+    vector<BatchJob> jobs;
+    string line;
+    for (int number = 1; getline(input, line); ++number) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t separator = line.find('\t');
+        if (separator == string::npos) {
+            separator = line.find_first_of(" \t");
+        }
+        string outputPath = separator == string::npos ? "" : trim(line.substr(separator + 1));
+        if (outputPath.empty()) {
+            throw runtime_error("Line " + to_string(number) + " of the batch manifest has no output path");
+        }
+        jobs.push_back({trim(line.substr(0, separator)), outputPath});
+    }
+    return jobs;
+}
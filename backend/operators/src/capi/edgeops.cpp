@@ -0,0 +1,125 @@
+#include "capi/edgeops.h"
+#include "gradient/operator_registry.h"
+#include "utils/image_utils.h"
+#include "utils/tile_pyramid.h"
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+using namespace std;
+
+struct edgeops_token {
+    CancellationToken token;
+};
+
+namespace {
+    void setError(char* error, size_t errorSize, const string& message) {
+        if (error == nullptr || errorSize == 0) {
+            return;
+        }
+        size_t length = min(message.size(), errorSize - 1);
+        memcpy(error, message.data(), length);
+        error[length] = '\0';
+    }
+}
+
+int edgeops_abi_version(void) {
+    return EDGEOPS_ABI_VERSION;
+}
+
+edgeops_token* edgeops_token_create(void) {
+    return new (nothrow) edgeops_token();
+}
+
+void edgeops_token_cancel(edgeops_token* token) {
+    if (token != nullptr) {
+        token->token.cancel();
+    }
+}
+
+void edgeops_token_destroy(edgeops_token* token) {
+    delete token;
+}
+
+edgeops_status edgeops_process(const char* operator_name,
+                               const uint8_t* input, size_t input_size,
+                               const char* output_extension, const char* flags,
+                               edgeops_token* token,
+                               uint8_t** output, size_t* output_size,
+                               char* error, size_t error_size) {
+    if (operator_name == nullptr || input == nullptr || output_extension == nullptr
+        || output == nullptr || output_size == nullptr) {
+        setError(error, error_size, "Missing argument");
+        return EDGEOPS_ERROR;
+    }
+    *output = nullptr;
+    *output_size = 0;
+    if (TilePyramid::isPyramidPath(output_extension)) {
+        setError(error, error_size, string("A tile pyramid is a directory of files and cannot be returned in one ")
+                                    + "buffer, write " + output_extension + " outputs with the operators executable");
+        return EDGEOPS_ERROR;
+    }
+
+    // exceptions must not cross the C boundary, every failure becomes a status and a message
+    try {
+        edgeops_token localToken;
+        CancellationToken& cancellation = token != nullptr ? token->token : localToken.token;
+
+        // the process-wide flags of the executable (OpenCV pool size, pinning) are not applied
+        // here: the library shares its process with other jobs and the host application
+        ExecutionConfig config;
+        ResourceLimits limits;
+        EdgeOptions options;
+        EncodeOptions encoding;
+        istringstream flagStream(flags != nullptr ? flags : "");
+        string flag;
+        while (flagStream >> flag) {
+            if (!config.parseFlag(flag) && !limits.parseFlag(flag) && !cancellation.parseFlag(flag)
+                && !options.parseFlag(flag) && !encoding.parseFlag(flag)) {
+                throw runtime_error("Unknown option: " + flag);
+            }
+        }
+
+        // leased rather than created, so later jobs with the same operator and flags reuse it
+        OperatorLease gradientOperator = OperatorRegistry::builtin().acquire(operator_name, config);
+        gradientOperator->setCancellationToken(&cancellation);
+        gradientOperator->setResourceLimits(limits);
+        gradientOperator->setEdgeOptions(options);
+        gradientOperator->setEncodeOptions(encoding);
+
+        cv::Mat image = gradientOperator->decodeImage(input, input_size);
+        cv::Mat edges;
+        vector<uint8_t> encoded = gradientOperator->encodeEdges(image, ImageUtils::extensionOf(output_extension), edges);
+        cancellation.throwIfCancelled();
+
+        // malloc so that callers in any language can release it through edgeops_free
+        auto* buffer = static_cast<uint8_t*>(malloc(max<size_t>(encoded.size(), 1)));
+        if (buffer == nullptr) {
+            throw bad_alloc();
+        }
+        memcpy(buffer, encoded.data(), encoded.size());
+        *output = buffer;
+        *output_size = encoded.size();
+        return EDGEOPS_OK;
+    } catch (const OperationCancelled& e) {
+        setError(error, error_size, e.what());
+        return EDGEOPS_CANCELLED;
+    } catch (const ImageTooLarge& e) {
+        setError(error, error_size, e.what());
+        return EDGEOPS_TOO_LARGE;
+    } catch (const UnknownOperator& e) {
+        setError(error, error_size, e.what());
+        return EDGEOPS_UNKNOWN_OPERATOR;
+    } catch (const exception& e) {
+        setError(error, error_size, e.what());
+        return EDGEOPS_ERROR;
+    } catch (...) {
+        setError(error, error_size, "Unknown error");
+        return EDGEOPS_ERROR;
+    }
+}
+
+void edgeops_free(uint8_t* buffer) {
+    free(buffer);
+}
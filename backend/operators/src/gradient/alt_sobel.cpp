@@ -1,6 +1,7 @@
 #include "../include/gradient/alt_sobel.h"
 #include "../include/utils/image_utils.h"
 #include "../include/utils/kernels_util.h"
+#include "../include/utils/smoothed_kernels.h"
 
 AltSobel::AltSobel(int kernelSize) : ksize(kernelSize), scale(1), delta(0) {
     height = 0;
@@ -10,32 +11,67 @@ AltSobel::AltSobel(int kernelSize) : ksize(kernelSize), scale(1), delta(0) {
 cv::Mat AltSobel::getEdges(const string &inputPath, const string &outputName) {
     clock_t t = clock();
 
-    cv::Mat image = ImageUtils::getImage(inputPath);
-    height = image.rows;
-    width = image.cols;
-
-    vector<vector<vector<uint8_t>>> rgbImage = convertToRGB(image);
-    vector<vector<uint8_t>> grayImage = convertToGrayscale(rgbImage);
-    vector<vector<int>> gradX = computeGradientX(grayImage);
-    vector<vector<int>> gradY = computeGradientY(grayImage);
-    cv::Mat edges = combineGradients(gradX, gradY);
-
-    ImageUtils::writeImage(edges, outputName);
+    cv::Mat image = loadImage(inputPath);
+    cv::Mat edges = writeEdges(image, outputName);
 
     printf("Time taken: %.4fs\n", (float)(clock() - t)/CLOCKS_PER_SEC);
 
     return edges;
 }
 
+cv::Mat AltSobel::detectEdges(const cv::Mat& image) {
+    return detect(image, nullptr);
+}
+
+cv::Mat AltSobel::detectEdgesWithGradients(const cv::Mat& image, GradientPlanes& planes) {
+    return detect(image, &planes);
+}
+
+cv::Mat AltSobel::detect(const cv::Mat& image, GradientPlanes* planes) {
+    cv::Mat colorImage = ImageUtils::toColor(image);
+    height = colorImage.rows;
+    width = colorImage.cols;
+
+    vector<vector<vector<uint8_t>>> rgbImage = convertToRGB(colorImage);
+    vector<vector<uint8_t>> grayImage = convertToGrayscale(rgbImage);
+    if (edgeOptions.isSmoothing()) {
+        smoothGrayscale(grayImage);
+    }
+    vector<vector<int>> gradX = computeGradientX(grayImage);
+    vector<vector<int>> gradY = computeGradientY(grayImage);
+    if (planes != nullptr) {
+        planes->gradX.create(height, width, CV_32SC1);
+        planes->gradY.create(height, width, CV_32SC1);
+        for (int i = 0; i < height; ++i) {
+            copy(gradX[i].begin(), gradX[i].end(), planes->gradX.ptr<int>(i));
+            copy(gradY[i].begin(), gradY[i].end(), planes->gradY.ptr<int>(i));
+        }
+    }
+    return combineGradients(gradX, gradY);
+}
+
 string AltSobel::getOperatorName() const {
     return "AltSobel";
 }
 
+ResourceEstimate AltSobel::estimateResources(cv::Size imageSize) const {
+    // BGR input, the RGB matrix with one heap-allocated vector per pixel (about 56 bytes),
+    // the grayscale matrix, two int gradients and the 8-bit output
+    size_t pixels = static_cast<size_t>(imageSize.width) * imageSize.height;
+    return {pixels * (3 + 56 + 1 + 4 + 4 + 1), pixels * 60e-9};
+}
+
+int AltSobel::haloRadius() const {
+    // the blur clamps at the borders, which only changes pixels within the halo of a region
+    return SmoothedKernels::derivativeRadius(edgeOptions.sigma);
+}
+
 vector<vector<vector<uint8_t>>> AltSobel::convertToRGB(const cv::Mat& input) const {
     vector<vector<vector<uint8_t>>> rgbMatrix(
             height, vector<vector<uint8_t>>(width, vector<uint8_t>(3)));
 
     for (int i = 0; i < height; ++i) {
+        checkCancelled();
         for (int j = 0; j < width; ++j) {
             const auto& pixel = input.at<cv::Vec3b>(i, j);
             rgbMatrix[i][j][0] = pixel[2];
@@ -51,6 +87,7 @@ vector<vector<uint8_t>> AltSobel::convertToGrayscale(const vector<vector<vector<
     vector<vector<uint8_t>> grayMatrix(height, vector<uint8_t>(width));
 
     for (int i = 0; i < height; ++i) {
+        checkCancelled();
         for (int j = 0; j < width; ++j) {
             const auto& pixel = rgbMatrix[i][j];
             grayMatrix[i][j] = static_cast<uint8_t>(
@@ -64,6 +101,35 @@ vector<vector<uint8_t>> AltSobel::convertToGrayscale(const vector<vector<vector<
     return grayMatrix;
 }
 
+void AltSobel::smoothGrayscale(vector<vector<uint8_t>>& grayImage) const {
+    cv::Mat kernel = SmoothedKernels::gaussian(edgeOptions.sigma);
+    const auto* taps = kernel.ptr<float>();
+    int radius = static_cast<int>(kernel.total()) / 2;
+
+    vector<vector<float>> rowPass(height, vector<float>(width, 0));
+    for (int i = 0; i < height; ++i) {
+        checkCancelled();
+        for (int j = 0; j < width; ++j) {
+            float sum = 0;
+            for (int k = -radius; k <= radius; ++k) {
+                sum += taps[k + radius] * grayImage[i][min(max(j + k, 0), width - 1)];
+            }
+            rowPass[i][j] = sum;
+        }
+    }
+
+    for (int i = 0; i < height; ++i) {
+        checkCancelled();
+        for (int j = 0; j < width; ++j) {
+            float sum = 0;
+            for (int k = -radius; k <= radius; ++k) {
+                sum += taps[k + radius] * rowPass[min(max(i + k, 0), height - 1)][j];
+            }
+            grayImage[i][j] = static_cast<uint8_t>(min(255.0f, sum + 0.5f));
+        }
+    }
+}
+
 vector<vector<int>> AltSobel::computeGradientX(const vector<vector<uint8_t>>& grayImage) const {
     int kernelSize = static_cast<int>(KernelUtil::sobelX.size());
     int offset = kernelSize / 2;
@@ -71,6 +137,7 @@ vector<vector<int>> AltSobel::computeGradientX(const vector<vector<uint8_t>>& gr
     vector<vector<int>> gradX(height, vector<int>(width, 0));
 
     for (int i = offset; i < height - offset; ++i) {
+        checkCancelled();
         for (int j = offset; j < width - offset; ++j) {
             int gradient = 0;
             for (int ki = 0; ki < kernelSize; ++ki) {
@@ -92,6 +159,7 @@ vector<vector<int>> AltSobel::computeGradientY(const vector<vector<uint8_t>>& gr
     vector<vector<int>> gradY(height, vector<int>(width, 0));
 
     for (int i = offset; i < height - offset; ++i) {
+        checkCancelled();
         for (int j = offset; j < width - offset; ++j) {
             int gradient = 0;
             for (int ki = 0; ki < kernelSize; ++ki) {
@@ -110,6 +178,7 @@ cv::Mat AltSobel::combineGradients(const vector<vector<int>>& gradX, const vecto
     cv::Mat combined(height, width, CV_8UC1);
 
     for (int i = 0; i < height; ++i) {
+        checkCancelled();
         for (int j = 0; j < width; ++j) {
             int magnitude = static_cast<int>(sqrt(gradX[i][j] * gradX[i][j] + gradY[i][j] * gradY[i][j]));
 
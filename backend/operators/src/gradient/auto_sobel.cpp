@@ -0,0 +1,65 @@
+#include "gradient/auto_sobel.h"
+#include "utils/image_utils.h"
+
+AutoSobel::AutoSobel(TuningTable table, const ExecutionConfig& limits) : table(std::move(table)), limits(limits) {}
+
+string AutoSobel::getOperatorName() const {
+    return "AutoSobel";
+}
+
+ResourceEstimate AutoSobel::estimateResources(Size imageSize) const {
+    // the BGR input decoded here plus the selected backend's own estimate, an upper bound
+    // for the backends that work on the BGR input directly
+    TuningEntry variant = selectVariant(imageSize);
+    ResourceEstimate estimate = SobelAutoTuner::createBackend(variant)->estimateResources(imageSize);
+    estimate.peakBytes += static_cast<size_t>(imageSize.width) * imageSize.height * 3;
+    return estimate;
+}
+
+Mat AutoSobel::getEdges(const string& inputPath, const string& outputName) {
+    clock_t t = clock();
+
+    Mat image = loadImage(inputPath);
+    // reported once per file here, detect runs per band, video frame or API request
+    TuningEntry variant = selectVariant(image.size());
+    printf("Selected backend: %s (threads: %d, tile: %dx%d)\n", variant.backend.c_str(),
+           variant.threads, variant.tileSize.width, variant.tileSize.height);
+    Mat edges = writeEdges(image, outputName);
+
+    printf("Time taken: %.4fs\n", (float)(clock() - t)/CLOCKS_PER_SEC);
+
+    return edges;
+}
+
+Mat AutoSobel::detectEdges(const Mat& image) {
+    return detect(image, nullptr);
+}
+
+Mat AutoSobel::detectEdgesWithGradients(const Mat& image, GradientPlanes& planes) {
+    return detect(image, &planes);
+}
+
+Mat AutoSobel::detect(const Mat& image, GradientPlanes* planes) {
+    if (image.empty()) {
+        throw runtime_error("Input image is empty");
+    }
+
+    TuningEntry variant = selectVariant(image.size());
+    return SobelAutoTuner::run(variant, image, cancellation, edgeOptions, planes);
+}
+
+TuningEntry AutoSobel::selectVariant(Size imageSize) const {
+    const TuningEntry* entry = table.lookup(imageSize);
+    TuningEntry variant;
+    if (entry) {
+        variant = *entry;
+    } else {
+        variant.imageSize = imageSize;
+        variant.backend = "opencv";
+    }
+
+    if (limits.numThreads > 0) {
+        variant.threads = variant.threads > 0 ? min(variant.threads, limits.numThreads) : limits.numThreads;
+    }
+    return variant;
+}
@@ -0,0 +1,248 @@
+#include "gradient/gradient_operator.h"
+#include "utils/image_utils.h"
+#include "utils/edge_threshold.h"
+#include "utils/edge_points.h"
+#include "utils/gradient_tensor.h"
+#include "utils/tile_pyramid.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int GradientOperator::planReduction(const ImageInfo& info, cv::ImreadModes mode) const {
+    size_t fullDecodeBytes = static_cast<size_t>(info.width) * info.height * (mode == cv::IMREAD_GRAYSCALE ? 1 : 3);
+    ResourceEstimate estimate;
+
+    for (int reduction = 1; reduction <= 8; reduction *= 2) {
+        cv::Size size((info.width + reduction - 1) / reduction, (info.height + reduction - 1) / reduction);
+        estimate = estimateResources(size);
+        // only JPEG scales while decoding, other formats hold the full image until it is resized
+        if (reduction > 1 && info.format != "jpeg") {
+            estimate.peakBytes += fullDecodeBytes;
+        }
+        if (resourceLimits.fits(size, estimate)) {
+            return reduction;
+        }
+        if (resourceLimits.oversize == OversizePolicy::Reject) {
+            break;
+        }
+    }
+
+    throw ImageTooLarge("Image of " + std::to_string(info.width) + "x" + std::to_string(info.height)
+                        + " exceeds the limits, it needs about " + std::to_string(estimate.peakBytes >> 20) + " MB");
+}
+
+DecodePlan GradientOperator::planDecode(const std::optional<ImageInfo>& info, cv::ImreadModes mode) const {
+    DecodePlan plan;
+    if (!info) {
+        return plan;
+    }
+    plan.probed = true;
+    plan.imageSize = info->size();
+    plan.region = cv::Rect(0, 0, info->width, info->height);
+    plan.estimate = estimateResources(info->size());
+    plan.reduction = resourceLimits.isLimited() ? planReduction(*info, mode) : 1;
+    return plan;
+}
+
+DecodePlan GradientOperator::planDecode(const std::string& inputPath, cv::ImreadModes mode) const {
+    std::optional<ImageInfo> info = ImageUtils::probeImage(inputPath);
+    if (!edgeOptions.hasRegion() || !info) {
+        return planDecode(info, mode);
+    }
+
+    // a region is decoded at full resolution, downscaling it would move it
+    DecodePlan plan;
+    plan.probed = true;
+    plan.imageSize = info->size();
+    plan.region = inputRegion(info->size());
+    plan.estimate = estimateResources(plan.region.size());
+    const cv::Rect& input = plan.region;
+    plan.partial = ImageUtils::canDecodeRegion(inputPath);
+    if (!plan.partial) {
+        size_t channels = mode == cv::IMREAD_GRAYSCALE ? 1 : 3;
+        plan.estimate.peakBytes += static_cast<size_t>(info->width) * info->height * channels;
+    }
+    if (resourceLimits.isLimited() && !resourceLimits.fits(input.size(), plan.estimate)) {
+        throw ImageTooLarge("Region of " + std::to_string(input.width) + "x" + std::to_string(input.height)
+                            + " exceeds the limits, it needs about " + std::to_string(plan.estimate.peakBytes >> 20)
+                            + " MB");
+    }
+    return plan;
+}
+
+cv::Mat GradientOperator::loadImage(const std::string& inputPath, cv::ImreadModes mode) const {
+    DecodePlan plan = planDecode(inputPath, mode);
+    if (!edgeOptions.hasRegion()) {
+        return ImageUtils::getImage(inputPath, mode, plan.reduction);
+    }
+    if (!plan.probed) {
+        cv::Mat image = ImageUtils::getImage(inputPath, mode);
+        return image(inputRegion(image.size())).clone();
+    }
+    return ImageUtils::getRegion(inputPath, plan.region, mode);
+}
+
+cv::Mat GradientOperator::decodeImage(const uint8_t* data, size_t size) const {
+    cv::ImreadModes mode = inputMode();
+    int reduction = planDecode(ImageUtils::probeImage(data, size), mode).reduction;
+    return ImageUtils::decodeImage(data, size, mode, reduction);
+}
+
+void GradientOperator::decodeImage(const uint8_t* data, size_t size, cv::Mat& image) const {
+    cv::ImreadModes mode = inputMode();
+    std::optional<ImageInfo> info = ImageUtils::probeImage(data, size);
+    int reduction = planDecode(info, mode).reduction;
+    if (!info) {
+        // OpenCV leaves the target untouched when it finds no decoder, so the old image would survive
+        image = ImageUtils::decodeImage(data, size, mode, reduction);
+        return;
+    }
+    ImageUtils::decodeImage(data, size, image, mode, reduction);
+}
+
+cv::Mat GradientOperator::thresholdEdges(const cv::Mat& edges) const {
+    return EdgeThreshold::apply(edges, edgeOptions);
+}
+
+cv::Mat GradientOperator::detectEdgesWithGradients(const cv::Mat&, GradientPlanes&) {
+    throw std::runtime_error(getOperatorName() + " does not compute separate gradients");
+}
+
+std::vector<uint8_t> GradientOperator::encodeEdges(const cv::Mat& image, const std::string& extension, cv::Mat& edges) {
+    EdgeResult result = computeEdges(image, extension);
+    edges = result.edges;
+    return encodeResult(result, extension);
+}
+
+EdgeResult GradientOperator::computeEdges(const cv::Mat& image, const std::string& extension) {
+    if (!edgeOptions.hasRegion()) {
+        cv::Rect whole(0, 0, image.cols, image.rows);
+        return computeRegion(image, whole, whole, extension);
+    }
+    return computeRegion(image, inputRegion(image.size()), outputRegion(image.size()), extension);
+}
+
+EdgeResult GradientOperator::computeRegion(const cv::Mat& image, const cv::Rect& input, const cv::Rect& output,
+                                           const std::string& extension) {
+    cv::Mat region = input.size() == image.size() ? image : image(input);
+    bool gradients = extension == ".npy" || (extension == ".pts" && edgeOptions.angles);
+    EdgeResult result;
+    cv::Mat magnitude = gradients ? detectEdgesWithGradients(region, result.planes) : detectEdges(region);
+    checkCancelled();
+    if (output != input) {
+        // the halo only feeds the derivative, thresholds such as Otsu's see the region alone
+        cv::Rect crop = output - input.tl();
+        magnitude = magnitude(crop).clone();
+        if (!result.planes.gradX.empty()) {
+            result.planes.gradX = result.planes.gradX(crop).clone();
+            result.planes.gradY = result.planes.gradY(crop).clone();
+        }
+    }
+
+    if (extension != ".pts") {
+        result.edges = thresholdEdges(magnitude);
+        if (extension == ".npy") {
+            result.magnitude = magnitude;
+        }
+        return result;
+    }
+
+    // the point list keeps the magnitude of each edge, so it is taken before thresholding
+    result.magnitude = magnitude;
+    result.level = EdgeThreshold::level(result.magnitude, edgeOptions);
+    if (edgeOptions.isThresholding()) {
+        cv::threshold(result.magnitude, result.edges, result.level, 255, cv::THRESH_BINARY);
+    } else {
+        result.edges = result.magnitude;
+    }
+    return result;
+}
+
+cv::Rect GradientOperator::outputRegion(cv::Size imageSize) const {
+    cv::Rect whole(0, 0, imageSize.width, imageSize.height);
+    if (!edgeOptions.hasRegion()) {
+        return whole;
+    }
+    cv::Rect region = edgeOptions.region & whole;
+    if (region.empty()) {
+        const cv::Rect& roi = edgeOptions.region;
+        throw std::runtime_error("The region " + std::to_string(roi.width) + "x" + std::to_string(roi.height) + "+"
+                                 + std::to_string(roi.x) + "+" + std::to_string(roi.y) + " lies outside the "
+                                 + std::to_string(imageSize.width) + "x" + std::to_string(imageSize.height) + " image");
+    }
+    return region;
+}
+
+cv::Rect GradientOperator::inputRegion(cv::Size imageSize) const {
+    cv::Rect region = outputRegion(imageSize);
+    int halo = std::max(haloRadius(), 0);
+    cv::Rect padded(region.x - halo, region.y - halo, region.width + 2 * halo, region.height + 2 * halo);
+    return padded & cv::Rect(0, 0, imageSize.width, imageSize.height);
+}
+
+std::vector<uint8_t> GradientOperator::encodeResult(const EdgeResult& result, const std::string& extension) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint8_t> encoded;
+    if (extension == ".npy") {
+        encoded = GradientTensor::encode(result.planes.gradX, result.planes.gradY);
+    } else if (extension == ".pts") {
+        encoded = EdgePoints::encode(result.magnitude, result.level, result.planes.gradX, result.planes.gradY);
+    } else {
+        encoded = ImageUtils::encodeImage(result.edges, extension, encodeOptions);
+    }
+    encodeSeconds = secondsSince(start);
+    return encoded;
+}
+
+cv::Mat GradientOperator::writeEdges(const cv::Mat& image, const std::string& outputName) {
+    std::string extension = ImageUtils::extensionOf(outputName);
+    cv::Rect input(0, 0, image.cols, image.rows);
+    cv::Rect output = input;
+    if (edgeOptions.hasRegion()) {
+        // loadImage decoded the region with the halo its top and left sides had room for
+        int halo = std::max(haloRadius(), 0);
+        const cv::Rect& region = edgeOptions.region;
+        output = (region - cv::Point(std::max(region.x - halo, 0), std::max(region.y - halo, 0))) & input;
+    }
+    if (TilePyramid::isPyramidPath(outputName)) {
+        writePyramid(image, input, output, outputName);
+        return cv::Mat();
+    }
+    EdgeResult result = computeRegion(image, input, output, extension);
+    cv::Mat edges = result.edges;
+    std::vector<uint8_t> encoded = encodeResult(result, extension);
+    printf("Encoded: %s, %zu bytes, %.2f ms\n", extension.c_str(), encoded.size(), encodeSeconds * 1000);
+    checkCancelled();
+    ImageUtils::writeFile(encoded, outputName);
+    return edges;
+}
+
+void GradientOperator::writePyramid(const cv::Mat& image, const cv::Rect& input, const cv::Rect& output,
+                                    const std::string& outputName) {
+    auto start = std::chrono::steady_clock::now();
+    TilePyramid pyramid(outputName, output.size(), encodeOptions);
+    const int halo = haloRadius();
+    if (halo < 0 || edgeOptions.threshold == EdgeOptions::Threshold::Otsu) {
+        // a normalization or an Otsu level depends on the whole map, so it is computed at once
+        pyramid.addRows(computeRegion(image, input, output, ".png").edges);
+    } else {
+        // one tile row per band: the writers encode its tiles while the next band is detected
+        for (int y = 0; y < output.height; y += TilePyramid::tileSize) {
+            cv::Rect band(output.x, output.y + y, output.width, std::min(TilePyramid::tileSize, output.height - y));
+            cv::Rect bandInput = cv::Rect(band.x - halo, band.y - halo, band.width + 2 * halo,
+                                          band.height + 2 * halo) & input;
+            pyramid.addRows(computeRegion(image, bandInput, band, ".png").edges);
+        }
+    }
+    PyramidStats stats = pyramid.finish();
+    encodeSeconds = secondsSince(start);
+    printf("Pyramid: %dx%d in %d levels, %zu tiles, %.2f ms\n", output.width, output.height, stats.levels,
+           stats.tiles, encodeSeconds * 1000);
+}
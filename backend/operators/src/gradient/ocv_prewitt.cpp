@@ -1,6 +1,7 @@
 #include "../../include/gradient/ocv_prewitt.h"
 #include "../include/utils/image_utils.h"
 #include "../include/utils/kernels_util.h"
+#include "../include/utils/smoothed_kernels.h"
 
 using namespace KernelUtil;
 
@@ -9,23 +10,44 @@ OcvPrewitt::OcvPrewitt() {}
 Mat OcvPrewitt::getEdges(const string& inputPath, const string& outputName) {
     clock_t t = clock();
 
-    Mat image = ImageUtils::getImage(inputPath, cv::IMREAD_GRAYSCALE);
-    // Mat rgbImage = convertToRGB(image);
-    // Mat grayImage = convertToGrayscale(rgbImage);
-    Mat gradX = computeGradientX(image);
-    Mat gradY = computeGradientY(image);
-    Mat edges = combineGradients(gradX, gradY);
-    ImageUtils::writeImage(edges, outputName);
+    Mat image = loadImage(inputPath, inputMode());
+    Mat edges = writeEdges(image, outputName);
 
     printf("Time taken: %.4fs\n", (float)(clock() - t)/CLOCKS_PER_SEC);
 
     return edges;
 }
 
+Mat OcvPrewitt::detectEdges(const Mat& image) {
+    GradientPlanes planes;
+    return detectEdgesWithGradients(image, planes);
+}
+
+Mat OcvPrewitt::detectEdgesWithGradients(const Mat& image, GradientPlanes& planes) {
+    checkCancelled();
+    Mat grayImage = ImageUtils::toGrayscale(image);
+    checkCancelled();
+    planes.gradX = computeGradientX(grayImage);
+    checkCancelled();
+    planes.gradY = computeGradientY(grayImage);
+    checkCancelled();
+    return combineGradients(planes.gradX, planes.gradY);
+}
+
 string OcvPrewitt::getOperatorName() const {
     return "OcvPrewitt";
 }
 
+ResourceEstimate OcvPrewitt::estimateResources(Size imageSize) const {
+    // grayscale input, two CV_64F gradients, the CV_64F magnitude and the 8-bit output
+    size_t pixels = static_cast<size_t>(imageSize.width) * imageSize.height;
+    return {pixels * (1 + 8 + 8 + 8 + 1), pixels * 12e-9};
+}
+
+ImreadModes OcvPrewitt::inputMode() const {
+    return IMREAD_GRAYSCALE;
+}
+
 Mat OcvPrewitt::convertToRGB(const Mat& image) {
     Mat rgbImage;
     cvtColor(image, rgbImage, COLOR_BGR2RGB);
@@ -40,12 +62,22 @@ Mat OcvPrewitt::convertToGrayscale(const Mat& image) {
 
 Mat OcvPrewitt::computeGradientX(const Mat& grayImage) {
     Mat gradX;
+    if (edgeOptions.isSmoothing()) {
+        SeparableKernel kernel = SmoothedKernels::derivative(derivativeDifference, prewittSmoothing, edgeOptions.sigma, true);
+        sepFilter2D(grayImage, gradX, CV_64F, kernel.rowKernel, kernel.columnKernel);
+        return gradX;
+    }
     filter2D(grayImage, gradX, CV_64F, KernelUtil::prewittX);
     return gradX;
 }
 
 Mat OcvPrewitt::computeGradientY(const Mat& grayImage) {
     Mat gradY;
+    if (edgeOptions.isSmoothing()) {
+        SeparableKernel kernel = SmoothedKernels::derivative(derivativeDifference, prewittSmoothing, edgeOptions.sigma, false);
+        sepFilter2D(grayImage, gradY, CV_64F, kernel.rowKernel, kernel.columnKernel);
+        return gradY;
+    }
     filter2D(grayImage, gradY, CV_64F, KernelUtil::prewittY);
     return gradY;
 }
@@ -7,23 +7,51 @@ OcvRobertsCross::OcvRobertsCross(int kernelSize) {}
 Mat OcvRobertsCross::getEdges(const std::string& inputPath, const std::string& outputName) {
     clock_t t = clock();
 
-    Mat image = ImageUtils::getImage(inputPath, cv::IMREAD_GRAYSCALE);
-    // Mat rgbImage = convertToRGB(image);
-    // Mat grayImage = convertToGrayscale(rgbImage);
-    Mat gradX = computeGradientX(image);
-    Mat gradY = computeGradientY(image);
-    Mat edges = combineGradients(gradX, gradY);
-    ImageUtils::writeImage(edges, outputName);
+    Mat image = loadImage(inputPath, inputMode());
+    Mat edges = writeEdges(image, outputName);
 
     printf("Time taken: %.4fs\n", (float)(clock() - t)/CLOCKS_PER_SEC);
 
     return edges;
 }
 
+Mat OcvRobertsCross::detectEdges(const Mat& image) {
+    GradientPlanes planes;
+    return detectEdgesWithGradients(image, planes);
+}
+
+Mat OcvRobertsCross::detectEdgesWithGradients(const Mat& image, GradientPlanes& planes) {
+    checkCancelled();
+    Mat grayImage = ImageUtils::toGrayscale(image);
+    if (edgeOptions.isSmoothing()) {
+        // the diagonal 2x2 kernels do not factor into rows and columns, so the Gaussian runs as
+        // its own pass, kept in floating point so the small differences are not rounded away
+        Mat smoothed;
+        grayImage.convertTo(smoothed, CV_32F);
+        GaussianBlur(smoothed, grayImage, Size(), edgeOptions.sigma, edgeOptions.sigma);
+    }
+    checkCancelled();
+    planes.gradX = computeGradientX(grayImage);
+    checkCancelled();
+    planes.gradY = computeGradientY(grayImage);
+    checkCancelled();
+    return combineGradients(planes.gradX, planes.gradY);
+}
+
 string OcvRobertsCross::getOperatorName() const {
     return "OcvRobertsCross";
 }
 
+ResourceEstimate OcvRobertsCross::estimateResources(Size imageSize) const {
+    // grayscale input, two CV_64F gradients, the CV_64F magnitude and the 8-bit output
+    size_t pixels = static_cast<size_t>(imageSize.width) * imageSize.height;
+    return {pixels * (1 + 8 + 8 + 8 + 1), pixels * 10e-9};
+}
+
+ImreadModes OcvRobertsCross::inputMode() const {
+    return IMREAD_GRAYSCALE;
+}
+
 Mat OcvRobertsCross::convertToRGB(const cv::Mat &image) {
     Mat rgbImage;
     cvtColor(image, rgbImage, COLOR_BGR2RGB);
@@ -1,28 +1,90 @@
 #include "../include/gradient/ocv_sobel.h"
 #include "../include/utils/image_utils.h"
+#include "../include/utils/kernels_util.h"
+#include "../include/utils/smoothed_kernels.h"
 
-OcvSobel::OcvSobel(int kernelSize) : ksize(kernelSize), scale(1), delta(0) {}
+OcvSobel::OcvSobel(int kernelSize, int threads) : ksize(kernelSize), scale(1), delta(0), threads(threads) {}
 
 std::string OcvSobel::getOperatorName() const {
     return "OcvSobel";
 }
 
+ResourceEstimate OcvSobel::estimateResources(cv::Size imageSize) const {
+    // grayscale input, two CV_32F gradients, the CV_32F magnitude and the 8-bit output
+    size_t pixels = static_cast<size_t>(imageSize.width) * imageSize.height;
+    return {pixels * (1 + 4 + 4 + 4 + 1), pixels * 6e-9};
+}
+
+cv::ImreadModes OcvSobel::inputMode() const {
+    return cv::IMREAD_GRAYSCALE;
+}
+
 cv::Mat OcvSobel::getEdges(const std::string& inputPath, const std::string& outputName) {
     clock_t t = clock();
 
-    cv::Mat image = ImageUtils::getImage(inputPath, cv::IMREAD_GRAYSCALE);
-    // cv::Mat rgbImage = convertToRGB(image);
-    // cv::Mat grayImage = convertToGrayscale(rgbImage);
-    cv::Mat gradX = computeGradientX(image);
-    cv::Mat gradY = computeGradientY(image);
-    cv::Mat edges = combineGradients(gradX, gradY);
-    ImageUtils::writeImage(edges, outputName);
+    cv::Mat image = loadImage(inputPath, inputMode());
+    cv::Mat edges = writeEdges(image, outputName);
 
     printf("Time taken: %.4fs\n", (float)(clock() - t)/CLOCKS_PER_SEC);
 
     return edges;
 }
 
+cv::Mat OcvSobel::detectEdges(const cv::Mat& image) {
+    GradientPlanes planes;
+    return detectEdgesWithGradients(image, planes);
+}
+
+cv::Mat OcvSobel::detectEdgesWithGradients(const cv::Mat& image, GradientPlanes& planes) {
+    if (threads > 0) {
+        return detectInStripes(image, planes);
+    }
+    checkCancelled();
+    cv::Mat grayImage = ImageUtils::toGrayscale(image);
+    checkCancelled();
+    planes.gradX = computeGradientX(grayImage);
+    checkCancelled();
+    planes.gradY = computeGradientY(grayImage);
+    checkCancelled();
+    return combineGradients(planes.gradX, planes.gradY);
+}
+
+cv::Mat OcvSobel::detectInStripes(const cv::Mat& image, GradientPlanes& planes) const {
+    if (image.empty()) {
+        throw std::runtime_error("Input image is empty");
+    }
+    checkCancelled();
+    // the stripe count bounds this call alone, cv::setNumThreads would change every job in the process
+    cv::Mat grayImage = image;
+    if (image.channels() != 1) {
+        grayImage = cv::Mat(image.size(), CV_8UC1);
+        cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& rows) {
+            cv::Mat stripe = grayImage.rowRange(rows.start, rows.end);
+            ImageUtils::toGrayscale(image.rowRange(rows.start, rows.end)).copyTo(stripe);
+        }, threads);
+    }
+    checkCancelled();
+
+    planes.gradX.create(grayImage.size(), CV_32F);
+    planes.gradY.create(grayImage.size(), CV_32F);
+    cv::Mat magnitude(grayImage.size(), CV_32F);
+    cv::parallel_for_(cv::Range(0, grayImage.rows), [&](const cv::Range& rows) {
+        // a row range keeps its parent, so the filters take the rows above and below from the image
+        cv::Mat stripe = grayImage.rowRange(rows.start, rows.end);
+        cv::Mat gradX = planes.gradX.rowRange(rows.start, rows.end);
+        cv::Mat gradY = planes.gradY.rowRange(rows.start, rows.end);
+        computeGradientX(stripe).copyTo(gradX);
+        computeGradientY(stripe).copyTo(gradY);
+        cv::Mat stripeMagnitude = magnitude.rowRange(rows.start, rows.end);
+        cv::magnitude(gradX, gradY, stripeMagnitude);
+    }, threads);
+    checkCancelled();
+
+    cv::Mat edges;
+    cv::normalize(magnitude, edges, 0, 255, cv::NORM_MINMAX, CV_8U);
+    return edges;
+}
+
 cv::Mat OcvSobel::convertToRGB(const cv::Mat& image) {
     cv::Mat rgbImage;
     cv::cvtColor(image, rgbImage, cv::COLOR_BGR2RGB);
@@ -37,12 +99,28 @@ cv::Mat OcvSobel::convertToGrayscale(const cv::Mat &image) {
 
 cv::Mat OcvSobel::computeGradientX(const cv::Mat &image) const {
     cv::Mat gradX;
+    if (edgeOptions.isSmoothing()) {
+        // the Gaussian is folded into the two 1D Sobel factors, so smoothing costs no extra pass
+        SeparableKernel kernel = SmoothedKernels::derivative(KernelUtil::derivativeDifference, KernelUtil::sobelSmoothing,
+                                                             edgeOptions.sigma, true);
+        cv::sepFilter2D(image, gradX, CV_32F, kernel.rowKernel, kernel.columnKernel,
+                        cv::Point(-1, -1), delta, cv::BORDER_DEFAULT);
+        return gradX;
+    }
     cv::Sobel(image, gradX, CV_32F, 1, 0, ksize, scale, delta, cv::BORDER_DEFAULT);
     return gradX;
 }
 
 cv::Mat OcvSobel::computeGradientY(const cv::Mat &image) const {
     cv::Mat gradY;
+    if (edgeOptions.isSmoothing()) {
+        // the Gaussian is folded into the two 1D Sobel factors, so smoothing costs no extra pass
+        SeparableKernel kernel = SmoothedKernels::derivative(KernelUtil::derivativeDifference, KernelUtil::sobelSmoothing,
+                                                             edgeOptions.sigma, false);
+        cv::sepFilter2D(image, gradY, CV_32F, kernel.rowKernel, kernel.columnKernel,
+                        cv::Point(-1, -1), delta, cv::BORDER_DEFAULT);
+        return gradY;
+    }
     cv::Sobel(image, gradY, CV_32F, 0, 1, ksize, scale, delta, cv::BORDER_DEFAULT);
     return gradY;
 }
@@ -1,10 +1,17 @@
 #include "gradient/omp_sobel.h"
 #include "../include/utils/image_utils.h"
 #include "../include/utils/kernels_util.h"
+#include "../include/utils/smoothed_kernels.h"
 using namespace std;
 using namespace cv;
 
-OmpSobel::OmpSobel(int kernelSize) : ksize(kernelSize), scale(1), delta(0) {
+namespace {
+    // bytes per pixel held by a tile: BGR input, gray, gradX, gradY and the output
+    const size_t tileBytesPerPixel = 3 + 1 + sizeof(int) + sizeof(int) + 1;
+}
+
+OmpSobel::OmpSobel(int kernelSize, const ExecutionConfig& config)
+        : ksize(kernelSize), scale(1), delta(0), scheduler(config, tileBytesPerPixel) {
     height = 0;
     width = 0;
 }
@@ -13,116 +20,207 @@ string OmpSobel::getOperatorName() const {
     return "OpenMP Sobel";
 }
 
+ResourceEstimate OmpSobel::estimateResources(Size imageSize) const {
+    // BGR input and 8-bit output; the per-thread tile buffers stay within L2
+    size_t pixels = static_cast<size_t>(imageSize.width) * imageSize.height;
+    size_t tileBytes = static_cast<size_t>(scheduler.getTileSize().area()) * tileBytesPerPixel;
+    int threads = max(1, scheduler.getNumThreads());
+    return {pixels * (3 + 1) + tileBytes * threads, pixels * 8e-9};
+}
+
+int OmpSobel::haloRadius() const {
+    return SmoothedKernels::derivativeRadius(edgeOptions.sigma);
+}
+
+const ExecutionConfig& OmpSobel::getExecutionConfig() const {
+    return scheduler.getExecutionConfig();
+}
+
 Mat OmpSobel::getEdges(const string& inputPath, const string& outputName) {
     clock_t t = clock();
 
-    Mat image = ImageUtils::getImage(inputPath);
-    height = image.rows;
-    width = image.cols;
+    Mat image = loadImage(inputPath);
+    Mat edges = writeEdges(image, outputName);
 
-    Mat rgbImage = convertToRGB(image);
-    Mat grayImage = convertToGrayscale(rgbImage);
-    Mat gradX = computeGradientX(grayImage);
-    Mat gradY = computeGradientY(grayImage);
+    printf("Time taken: %.4fs\n", (float)(clock() - t)/CLOCKS_PER_SEC);
+
+    return edges;
+}
 
-    Mat edges = combineGradients(gradX, gradY);
+Mat OmpSobel::detectEdges(const Mat& image) {
+    return detect(image, nullptr);
+}
+
+Mat OmpSobel::detectEdgesWithGradients(const Mat& image, GradientPlanes& planes) {
+    return detect(image, &planes);
+}
 
-    ImageUtils::writeImage(edges, outputName);
+Mat OmpSobel::detect(const Mat& image, GradientPlanes* planes) {
+    Mat colorImage = ImageUtils::toColor(image);
+    height = colorImage.rows;
+    width = colorImage.cols;
 
-    printf("Time taken: %.4fs\n", (float)(clock() - t)/CLOCKS_PER_SEC);
+    if (edgeOptions.isSmoothing()) {
+        smoothedX = SmoothedKernels::derivative(KernelUtil::derivativeDifference, KernelUtil::sobelSmoothing,
+                                                edgeOptions.sigma, true);
+        smoothedY = SmoothedKernels::derivative(KernelUtil::derivativeDifference, KernelUtil::sobelSmoothing,
+                                                edgeOptions.sigma, false);
+    }
+
+    if (planes != nullptr) {
+        int depth = edgeOptions.isSmoothing() ? CV_32FC1 : CV_32SC1;
+        planes->gradX.create(height, width, depth);
+        planes->gradY.create(height, width, depth);
+    }
+
+    Mat edges(height, width, CV_8UC1);
+    scheduler.run(colorImage.size(), [&](const Rect& tile) {
+        processTile(colorImage, tile, edges, planes);
+    }, cancellation);
 
     return edges;
 }
 
-Mat OmpSobel::convertToRGB(const Mat& input) const {
-    Mat rgbImage(height, width, CV_8UC3);
+void OmpSobel::processTile(const Mat& input, const Rect& tile, Mat& edges, GradientPlanes* planes) const {
+    if (edgeOptions.isSmoothing()) {
+        processSmoothedTile(input, tile, edges, planes);
+        return;
+    }
 
-#pragma omp parallel for default(none) shared(input, rgbImage) schedule(dynamic)
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            const auto& pixel = input.at<Vec3b>(i, j);
-            rgbImage.at<Vec3b>(i, j)[0] = pixel[2];
-            rgbImage.at<Vec3b>(i, j)[1] = pixel[1];
-            rgbImage.at<Vec3b>(i, j)[2] = pixel[0];
-        }
+    int offset = static_cast<int>(KernelUtil::sobelX.size()) / 2;
+    Rect region = Rect(tile.x - offset, tile.y - offset, tile.width + 2 * offset, tile.height + 2 * offset)
+                  & Rect(0, 0, width, height);
+
+    // per-thread scratch buffers are reused across tiles, so steady state does not allocate
+    thread_local Mat grayImage;
+    thread_local Mat gradX;
+    thread_local Mat gradY;
+
+    convertToGrayscale(input, region, grayImage);
+    computeGradientX(grayImage, region, tile, gradX);
+    computeGradientY(grayImage, region, tile, gradY);
+    if (planes != nullptr) {
+        gradX.copyTo(planes->gradX(tile));
+        gradY.copyTo(planes->gradY(tile));
     }
 
-    return rgbImage;
+    Mat combined = edges(tile);
+    combineGradients(gradX, gradY, combined);
 }
 
-Mat OmpSobel::convertToGrayscale(const Mat& rgbImage) const {
-    Mat grayMatrix(height, width, CV_8UC1);
+void OmpSobel::processSmoothedTile(const Mat& input, const Rect& tile, Mat& edges, GradientPlanes* planes) const {
+    int radius = SmoothedKernels::radius(smoothedX);
+    Rect region = Rect(tile.x - radius, tile.y - radius, tile.width + 2 * radius, tile.height + 2 * radius)
+                  & Rect(0, 0, width, height);
+
+    thread_local Mat grayImage;
+    thread_local Mat padded;
+    thread_local Mat gradX;
+    thread_local Mat gradY;
+
+    convertToGrayscale(input, region, grayImage);
+
+    // pad the sides the image ends on, so the tile sits at (radius, radius) with a full halo
+    int left = radius - (tile.x - region.x);
+    int top = radius - (tile.y - region.y);
+    int right = radius - (region.x + region.width - tile.x - tile.width);
+    int bottom = radius - (region.y + region.height - tile.y - tile.height);
+    copyMakeBorder(grayImage, padded, top, bottom, left, right, BORDER_REFLECT_101);
+
+    Rect interior(radius, radius, tile.width, tile.height);
+    sepFilter2D(padded, gradX, CV_32F, smoothedX.rowKernel, smoothedX.columnKernel);
+    sepFilter2D(padded, gradY, CV_32F, smoothedY.rowKernel, smoothedY.columnKernel);
+
+    Mat tileX = gradX(interior);
+    Mat tileY = gradY(interior);
+    if (planes != nullptr) {
+        tileX.copyTo(planes->gradX(tile));
+        tileY.copyTo(planes->gradY(tile));
+    }
+    magnitude(tileX, tileY, tileX);
+    Mat combined = edges(tile);
+    tileX.convertTo(combined, CV_8U);
+}
 
-#pragma omp parallel for default(none) shared(rgbImage, grayMatrix) schedule(dynamic)
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            const auto& pixel = rgbImage.at<Vec3b>(i, j);
-            grayMatrix.at<uint8_t>(i, j) = static_cast<uint8_t>(
-                    0.299 * pixel[2] +
-                    0.587 * pixel[1] +
-                    0.114 * pixel[0]
+void OmpSobel::convertToGrayscale(const Mat& input, const Rect& region, Mat& grayImage) const {
+    grayImage.create(region.height, region.width, CV_8UC1);
+
+    for (int i = 0; i < region.height; ++i) {
+        const auto* pixel = input.ptr<Vec3b>(region.y + i) + region.x;
+        auto* gray = grayImage.ptr<uint8_t>(i);
+        for (int j = 0; j < region.width; ++j) {
+            gray[j] = static_cast<uint8_t>(
+                    0.299 * pixel[j][0] +
+                    0.587 * pixel[j][1] +
+                    0.114 * pixel[j][2]
             );
         }
     }
-
-    return grayMatrix;
 }
 
-Mat OmpSobel::computeGradientX(const Mat& grayImage) const {
+void OmpSobel::computeGradientX(const Mat& grayImage, const Rect& region, const Rect& tile, Mat& gradX) const {
     int kernelSize = static_cast<int>(KernelUtil::sobelX.size());
     int offset = kernelSize / 2;
 
-    Mat gradX(height, width, CV_32SC1, Scalar(0));
+    gradX.create(tile.height, tile.width, CV_32SC1);
+    gradX.setTo(Scalar(0));
+
+    int rowBegin = max(tile.y, offset);
+    int rowEnd = min(tile.y + tile.height, height - offset);
+    int colBegin = max(tile.x, offset);
+    int colEnd = min(tile.x + tile.width, width - offset);
 
-#pragma omp parallel for default(none) shared(gradX, grayImage, kernelSize, offset) shared(KernelUtil::sobelX) schedule(dynamic)
-    for (int i = offset; i < height - offset; ++i) {
-        for (int j = offset; j < width - offset; ++j) {
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        auto* grad = gradX.ptr<int>(i - tile.y);
+        for (int j = colBegin; j < colEnd; ++j) {
             int gradient = 0;
             for (int ki = 0; ki < kernelSize; ++ki) {
+                const auto* gray = grayImage.ptr<uint8_t>(i + ki - offset - region.y);
                 for (int kj = 0; kj < kernelSize; ++kj) {
-                    gradient += KernelUtil::sobelX[ki][kj] * grayImage.at<uint8_t>(i + ki - offset, j + kj - offset);
+                    gradient += KernelUtil::sobelX[ki][kj] * gray[j + kj - offset - region.x];
                 }
             }
-            gradX.at<int>(i, j) = static_cast<int>(scale * gradient + delta);
+            grad[j - tile.x] = static_cast<int>(scale * gradient + delta);
         }
     }
-
-    return gradX;
 }
 
-Mat OmpSobel::computeGradientY(const Mat& grayImage) const {
+void OmpSobel::computeGradientY(const Mat& grayImage, const Rect& region, const Rect& tile, Mat& gradY) const {
     int kernelSize = static_cast<int>(KernelUtil::sobelY.size());
     int offset = kernelSize / 2;
 
-    Mat gradY(height, width, CV_32SC1, Scalar(0));
+    gradY.create(tile.height, tile.width, CV_32SC1);
+    gradY.setTo(Scalar(0));
+
+    int rowBegin = max(tile.y, offset);
+    int rowEnd = min(tile.y + tile.height, height - offset);
+    int colBegin = max(tile.x, offset);
+    int colEnd = min(tile.x + tile.width, width - offset);
 
-#pragma omp parallel for default(none) shared(gradY, grayImage, kernelSize, offset) shared(KernelUtil::sobelY) schedule(dynamic)
-    for (int i = offset; i < height - offset; ++i) {
-        for (int j = offset; j < width - offset; ++j) {
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        auto* grad = gradY.ptr<int>(i - tile.y);
+        for (int j = colBegin; j < colEnd; ++j) {
             int gradient = 0;
             for (int ki = 0; ki < kernelSize; ++ki) {
+                const auto* gray = grayImage.ptr<uint8_t>(i + ki - offset - region.y);
                 for (int kj = 0; kj < kernelSize; ++kj) {
-                    gradient += KernelUtil::sobelY[ki][kj] * grayImage.at<uint8_t>(i + ki - offset, j + kj - offset);
+                    gradient += KernelUtil::sobelY[ki][kj] * gray[j + kj - offset - region.x];
                 }
             }
-            gradY.at<int>(i, j) = static_cast<int>(scale * gradient + delta);
+            grad[j - tile.x] = static_cast<int>(scale * gradient + delta);
         }
     }
-
-    return gradY;
 }
 
-Mat OmpSobel::combineGradients(const Mat& gradX, const Mat& gradY) const {
-    Mat combined(height, width, CV_8UC1);
-
-#pragma omp parallel for default(none) shared(combined, gradX, gradY) schedule(dynamic)
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            int magnitude = static_cast<int>(sqrt(gradX.at<int>(i, j) * gradX.at<int>(i, j) + gradY.at<int>(i, j) * gradY.at<int>(i, j)));
+void OmpSobel::combineGradients(const Mat& gradX, const Mat& gradY, Mat& combined) {
+    for (int i = 0; i < combined.rows; ++i) {
+        const auto* gx = gradX.ptr<int>(i);
+        const auto* gy = gradY.ptr<int>(i);
+        auto* out = combined.ptr<uint8_t>(i);
+        for (int j = 0; j < combined.cols; ++j) {
+            int magnitude = static_cast<int>(sqrt(gx[j] * gx[j] + gy[j] * gy[j]));
 
-            combined.at<uint8_t>(i, j) = static_cast<uint8_t>(min(255, magnitude));
+            out[j] = static_cast<uint8_t>(min(255, magnitude));
         }
     }
-
-    return combined;
-}
\ No newline at end of file
+}
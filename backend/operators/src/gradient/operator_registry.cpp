@@ -0,0 +1,183 @@
+#include "gradient/operator_registry.h"
+#include "gradient/ocv_sobel.h"
+#include "gradient/alt_sobel.h"
+#include "gradient/omp_sobel.h"
+#include "gradient/ocv_prewitt.h"
+#include "gradient/ocv_roberts_cross.h"
+#include "gradient/auto_sobel.h"
+#include "gradient/pipeline_operator.h"
+using namespace std;
+
+namespace {
+    const vector<OperatorParameter> executionParameters = {
+        {"--threads", "worker threads"},
+        {"--schedule", "tiled, static or dynamic work distribution"},
+        {"--chunk", "rows per band for the static and dynamic schedules"},
+        {"--tile", "tile size for the tiled schedule"},
+        {"--pin", "thread pinning policy"},
+        {"--cpus", "CPUs to pin the worker threads to"},
+    };
+
+    void registerBuiltins(OperatorRegistry& registry) {
+        // the OpenCV filters are vectorized and keep no per-image state, but normalize by the
+        // global range of the image, so they have no halo and do not stream
+        registry.add({"opencv sobel", "3x3 Sobel gradient magnitude through cv::Sobel",
+                      {{"--threads", "size of the OpenCV worker pool"}},
+                      {false, false, true, true},
+                      [](const ExecutionConfig&, const string&) { return make_unique<OcvSobel>(); }});
+        registry.add({"prewitt", "3x3 Prewitt gradient magnitude through cv::filter2D",
+                      {{"--threads", "size of the OpenCV worker pool"}},
+                      {false, false, true, true},
+                      [](const ExecutionConfig&, const string&) { return make_unique<OcvPrewitt>(); }});
+        registry.add({"roberts cross", "2x2 Roberts cross gradient magnitude through cv::filter2D",
+                      {{"--threads", "size of the OpenCV worker pool"}},
+                      {false, false, true, true},
+                      [](const ExecutionConfig&, const string&) { return make_unique<OcvRobertsCross>(); }});
+        // AltSobel and OmpSobel record the image size in members while they run
+        registry.add({"alternative sobel", "Single-threaded scalar Sobel on nested vectors",
+                      {},
+                      {false, true, false, false},
+                      [](const ExecutionConfig&, const string&) { return make_unique<AltSobel>(); }});
+        registry.add({"openmp sobel", "Sobel on cache-sized tiles across OpenMP threads",
+                      executionParameters,
+                      {false, true, false, false},
+                      [](const ExecutionConfig& config, const string&) { return make_unique<OmpSobel>(3, config); }});
+        // the selected backend may be the normalizing OcvSobel
+        registry.add({"sobel:auto", "Sobel backend measured fastest for the image size on this host",
+                      {{"--threads", "upper bound on the threads of the selected backend"}},
+                      {false, false, false, true},
+                      [](const ExecutionConfig& config, const string&) {
+                          return make_unique<AutoSobel>(TuningTable::hostTable(), config);
+                      }});
+        // streaming as long as every stage is local, see PipelineOperator::haloRadius
+        registry.add({"pipeline", "Stages such as gray, blur=5, sobel and threshold=40 fused into tiled passes",
+                      executionParameters,
+                      {false, true, true, true},
+                      [](const ExecutionConfig& config, const string& description) {
+                          return make_unique<PipelineOperator>(Pipeline::parse(description), config);
+                      },
+                      true});
+    }
+
+    int hexValue(char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+}
+
+OperatorRegistry& OperatorRegistry::builtin() {
+    static OperatorRegistry registry;
+    static bool registered = (registerBuiltins(registry), true);
+    (void)registered;
+    return registry;
+}
+
+void OperatorRegistry::add(OperatorDescriptor descriptor) {
+    if (descriptor.name.empty() || !descriptor.create) {
+        throw runtime_error("An operator needs a name and a factory");
+    }
+    if (operators.count(descriptor.name) > 0) {
+        throw runtime_error("Operator already registered: " + descriptor.name);
+    }
+    string name = descriptor.name;
+    operators.emplace(name, std::move(descriptor));
+}
+
+const OperatorDescriptor* OperatorRegistry::find(const string& name) const {
+    string decoded = decodeName(name);
+    auto it = operators.find(decoded);
+    if (it != operators.end()) {
+        return &it->second;
+    }
+
+    size_t separator = decoded.find(':');
+    if (separator != string::npos) {
+        it = operators.find(decoded.substr(0, separator));
+        if (it != operators.end() && it->second.takesArgument) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+unique_ptr<GradientOperator> OperatorRegistry::create(const string& name, const ExecutionConfig& config) const {
+    const OperatorDescriptor* descriptor = find(name);
+    if (descriptor == nullptr) {
+        throw UnknownOperator(name);
+    }
+
+    string decoded = decodeName(name);
+    string argument = descriptor->takesArgument && decoded.size() > descriptor->name.size()
+                      ? decoded.substr(descriptor->name.size() + 1) : "";
+    return descriptor->create(config, argument);
+}
+
+OperatorLease OperatorRegistry::acquire(const string& name, const ExecutionConfig& config) {
+    if (find(name) == nullptr) {
+        throw UnknownOperator(name);
+    }
+
+    string key = decodeName(name) + '\0' + config.toString();
+    unique_ptr<GradientOperator> gradientOperator;
+    {
+        lock_guard<mutex> lock(idleMutex);
+        vector<unique_ptr<GradientOperator>>& instances = idle[key];
+        if (!instances.empty()) {
+            gradientOperator = move(instances.back());
+            instances.pop_back();
+        }
+    }
+    if (!gradientOperator) {
+        gradientOperator = create(name, config);
+    }
+
+    return OperatorLease(gradientOperator.release(), [this, key](GradientOperator* released) {
+        // the next job must not see this one's token, which may be gone by then, or its options
+        released->setCancellationToken(nullptr);
+        released->setResourceLimits(ResourceLimits());
+        released->setEdgeOptions(EdgeOptions());
+        released->setEncodeOptions(EncodeOptions());
+        try {
+            lock_guard<mutex> lock(idleMutex);
+            idle[key].emplace_back(released);
+        } catch (...) {
+            // releasing must not throw; an instance that cannot be kept is simply not reused
+            delete released;
+        }
+    });
+}
+
+ResourceEstimate OperatorRegistry::estimate(const string& name, cv::Size imageSize) {
+    return acquire(name)->estimateResources(imageSize);
+}
+
+vector<const OperatorDescriptor*> OperatorRegistry::list() const {
+    vector<const OperatorDescriptor*> descriptors;
+    for (const auto& entry : operators) {
+        descriptors.push_back(&entry.second);
+    }
+    return descriptors;
+}
+
+string OperatorRegistry::decodeName(const string& name) {
+    string decoded;
+    for (size_t i = 0; i < name.size(); ++i) {
+        int high = name[i] == '%' && i + 2 < name.size() ? hexValue(name[i + 1]) : -1;
+        int low = high >= 0 ? hexValue(name[i + 2]) : -1;
+        if (low >= 0) {
+            decoded += static_cast<char>(high * 16 + low);
+            i += 2;
+        } else {
+            decoded += name[i];
+        }
+    }
+    return decoded;
+}
@@ -0,0 +1,53 @@
+#include "gradient/pipeline_operator.h"
+#include "utils/image_utils.h"
+
+namespace {
+    // bytes per pixel held by a tile: the input, two stage buffers, the padded copy and gradient scratch
+    const size_t tileBytesPerPixel = 3 + 4 * 6;
+}
+
+PipelineOperator::PipelineOperator(Pipeline pipeline, const ExecutionConfig& config)
+        : pipeline(std::move(pipeline)), scheduler(config, tileBytesPerPixel) {}
+
+string PipelineOperator::getOperatorName() const {
+    return "Pipeline(" + pipeline.toString() + ")";
+}
+
+ResourceEstimate PipelineOperator::estimateResources(Size imageSize) const {
+    size_t pixels = static_cast<size_t>(imageSize.width) * imageSize.height;
+    size_t tileBytes = static_cast<size_t>(scheduler.getTileSize().area()) * tileBytesPerPixel;
+    int threads = max(1, scheduler.getNumThreads());
+    // a pipeline of more than one pass keeps a CV_32F image between them
+    size_t betweenPasses = pipeline.countPasses() > 1 ? pixels * 2 * sizeof(float) : 0;
+    return {pixels * (3 + 1) + betweenPasses + tileBytes * threads, pixels * pipeline.nanosPerPixel() * 1e-9};
+}
+
+int PipelineOperator::haloRadius() const {
+    int radius = 0;
+    for (const auto& stage : pipeline.getStages()) {
+        if (!stage->fusable()) {
+            return -1;
+        }
+        radius += stage->radius();
+    }
+    return radius;
+}
+
+const Pipeline& PipelineOperator::getPipeline() const {
+    return pipeline;
+}
+
+Mat PipelineOperator::getEdges(const string& inputPath, const string& outputName) {
+    clock_t t = clock();
+
+    Mat image = loadImage(inputPath);
+    Mat edges = writeEdges(image, outputName);
+
+    printf("Time taken: %.4fs\n", (float)(clock() - t)/CLOCKS_PER_SEC);
+
+    return edges;
+}
+
+Mat PipelineOperator::detectEdges(const Mat& image) {
+    return pipeline.run(image, scheduler, cancellation);
+}
@@ -0,0 +1,271 @@
+#include "gradient/sobel_tuner.h"
+#include "gradient/ocv_sobel.h"
+#include "gradient/alt_sobel.h"
+#include "gradient/omp_sobel.h"
+#include "utils/tile_scheduler.h"
+#include "utils/image_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+using namespace std;
+using namespace cv;
+
+namespace {
+    // a candidate slower than this multiple of the best time so far is not repeated
+    const double abandonFactor = 4.0;
+
+    // matches the per-pixel working set of the OmpSobel tile pipeline
+    const size_t ompBytesPerPixel = 13;
+
+    Mat createBenchmarkImage(Size size) {
+        Mat image(size, CV_8UC3);
+        randu(image, Scalar::all(0), Scalar::all(256));
+        int step = max(8, min(size.width, size.height) / 8);
+        for (int y = 0; y < size.height; y += step) {
+            for (int x = (y / step % 2) * step; x < size.width; x += 2 * step) {
+                rectangle(image, Point(x, y), Point(x + step - 1, y + step - 1), Scalar(255, 255, 255), -1);
+            }
+        }
+        return image;
+    }
+
+    double areaOf(Size size) {
+        return static_cast<double>(size.width) * size.height;
+    }
+}
+
+void TuningTable::add(const TuningEntry& entry) {
+    entries.erase(remove_if(entries.begin(), entries.end(), [&](const TuningEntry& existing) {
+        return existing.imageSize == entry.imageSize;
+    }), entries.end());
+    entries.push_back(entry);
+    sort(entries.begin(), entries.end(), [](const TuningEntry& a, const TuningEntry& b) {
+        return areaOf(a.imageSize) < areaOf(b.imageSize);
+    });
+}
+
+const TuningEntry* TuningTable::lookup(Size imageSize) const {
+    const TuningEntry* best = nullptr;
+    double bestDistance = 0;
+    double area = log(max(1.0, areaOf(imageSize)));
+    for (const auto& entry : entries) {
+        double distance = fabs(log(max(1.0, areaOf(entry.imageSize))) - area);
+        if (!best || distance < bestDistance) {
+            best = &entry;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+const vector<TuningEntry>& TuningTable::getEntries() const {
+    return entries;
+}
+
+void TuningTable::save(const string& path) const {
+    FileStorage fs(path, FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        throw runtime_error("Could not write the tuning table: " + path);
+    }
+
+    fs << "cpus" << (measuredCpus > 0 ? measuredCpus : getNumberOfCPUs());
+    fs << "batchCrossoverPixels" << batchCrossoverPixels;
+    fs << "entries" << "[";
+    for (const auto& entry : entries) {
+        fs << "{"
+           << "width" << entry.imageSize.width
+           << "height" << entry.imageSize.height
+           << "backend" << entry.backend
+           << "tileWidth" << entry.tileSize.width
+           << "tileHeight" << entry.tileSize.height
+           << "threads" << entry.threads
+           << "seconds" << entry.seconds
+           << "}";
+    }
+    fs << "]";
+}
+
+TuningTable TuningTable::load(const string& path) {
+    TuningTable table;
+    if (!filesystem::exists(path)) {
+        return table;
+    }
+
+    FileStorage fs(path, FileStorage::READ);
+    if (!fs.isOpened()) {
+        return table;
+    }
+
+    table.setMeasuredCpus(static_cast<int>(fs["cpus"]));
+
+    if (!fs["batchCrossoverPixels"].empty()) {
+        table.setBatchCrossoverPixels(static_cast<double>(fs["batchCrossoverPixels"]));
+    }
+
+    FileNode nodes = fs["entries"];
+    for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+        FileNode node = *it;
+        TuningEntry entry;
+        entry.imageSize = Size(static_cast<int>(node["width"]), static_cast<int>(node["height"]));
+        entry.backend = static_cast<string>(node["backend"]);
+        entry.tileSize = Size(static_cast<int>(node["tileWidth"]), static_cast<int>(node["tileHeight"]));
+        entry.threads = static_cast<int>(node["threads"]);
+        entry.seconds = static_cast<double>(node["seconds"]);
+        table.add(entry);
+    }
+
+    return table;
+}
+
+const TuningTable& TuningTable::hostTable() {
+    static const TuningTable table = load(defaultPath());
+    return table;
+}
+
+bool TuningTable::fitsHost() const {
+    return measuredCpus <= 0 || measuredCpus == getNumberOfCPUs();
+}
+
+string TuningTable::defaultPath() {
+    const char* path = getenv("OPERATORS_TUNING_TABLE");
+    return path && *path ? string(path) : string("sobel_tuning.yml");
+}
+
+SobelAutoTuner::SobelAutoTuner(int repetitions) : repetitions(max(1, repetitions)) {}
+
+vector<Size> SobelAutoTuner::defaultSizes() {
+    return {Size(200, 200), Size(640, 480), Size(1280, 720), Size(1920, 1080), Size(3840, 2160)};
+}
+
+vector<TuningEntry> SobelAutoTuner::candidates() {
+    vector<int> threadCounts;
+    for (int threads = 1; threads < getNumberOfCPUs(); threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(getNumberOfCPUs());
+
+    Size tileSize = TileScheduler::defaultTileSize(ompBytesPerPixel);
+    vector<Size> tileSizes = {
+            Size(tileSize.width / 2, tileSize.height / 2),
+            tileSize,
+            Size(tileSize.width * 2, tileSize.height * 2)
+    };
+
+    vector<TuningEntry> result;
+    result.push_back({Size(), "alternative", Size(), 1, 0});
+    for (int threads : threadCounts) {
+        result.push_back({Size(), "opencv", Size(), threads, 0});
+        for (const auto& tile : tileSizes) {
+            result.push_back({Size(), "openmp", tile, threads, 0});
+        }
+    }
+    return result;
+}
+
+unique_ptr<GradientOperator> SobelAutoTuner::createBackend(const TuningEntry& entry) {
+    if (entry.backend == "opencv") {
+        return make_unique<OcvSobel>(3, entry.threads);
+    } else if (entry.backend == "alternative") {
+        return make_unique<AltSobel>();
+    } else if (entry.backend == "openmp") {
+        ExecutionConfig config;
+        config.tileSize = entry.tileSize;
+        config.numThreads = entry.threads;
+        return make_unique<OmpSobel>(3, config);
+    }
+    throw runtime_error("Unknown Sobel backend: " + entry.backend);
+}
+
+Mat SobelAutoTuner::run(const TuningEntry& entry, const Mat& image, const CancellationToken* cancellation,
+                        const EdgeOptions& options, GradientPlanes* planes) {
+    unique_ptr<GradientOperator> backend = createBackend(entry);
+    backend->setCancellationToken(cancellation);
+    backend->setEdgeOptions(options);
+    return planes != nullptr ? backend->detectEdgesWithGradients(image, *planes) : backend->detectEdges(image);
+}
+
+TuningTable SobelAutoTuner::tune(const vector<Size>& sizes) const {
+    TuningTable table;
+    vector<TuningEntry> candidateList = candidates();
+
+    for (const auto& size : sizes) {
+        Mat image = createBenchmarkImage(size);
+        TuningEntry best;
+
+        for (auto candidate : candidateList) {
+            candidate.imageSize = size;
+            candidate.seconds = 0;
+            for (int r = 0; r < repetitions; ++r) {
+                auto start = chrono::steady_clock::now();
+                run(candidate, image);
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+                if (candidate.seconds == 0 || seconds < candidate.seconds) {
+                    candidate.seconds = seconds;
+                }
+                if (!best.backend.empty() && seconds > abandonFactor * best.seconds) {
+                    break;
+                }
+            }
+
+            if (best.backend.empty() || candidate.seconds < best.seconds) {
+                best = candidate;
+            }
+        }
+
+        table.add(best);
+    }
+
+    table.setBatchCrossoverPixels(measureBatchCrossover(sizes));
+    table.setMeasuredCpus(getNumberOfCPUs());
+    return table;
+}
+
+double SobelAutoTuner::measureBatchCrossover(const vector<Size>& sizes) const {
+    const int workers = getNumberOfCPUs();
+    const int batchSize = max(8, 2 * workers);
+    double crossover = 0;
+
+    for (const auto& size : sizes) {
+        Mat image = createBenchmarkImage(size);
+        double intraSeconds = 0;
+        double interSeconds = 0;
+
+        for (int r = 0; r < repetitions; ++r) {
+            // every thread on each image in turn
+            OmpSobel shared;
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < batchSize; ++i) {
+                ImageUtils::encodeImage(shared.detectEdges(image), ".png");
+            }
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            intraSeconds = r == 0 ? seconds : min(intraSeconds, seconds);
+
+            // one image per thread, each run single-threaded
+            ExecutionConfig single;
+            single.numThreads = 1;
+            start = chrono::steady_clock::now();
+#pragma omp parallel num_threads(workers)
+            {
+                OmpSobel own(3, single);
+#pragma omp for schedule(dynamic, 1)
+                for (int i = 0; i < batchSize; ++i) {
+                    ImageUtils::encodeImage(own.detectEdges(image), ".png");
+                }
+            }
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            interSeconds = r == 0 ? seconds : min(interSeconds, seconds);
+        }
+
+        if (interSeconds >= intraSeconds) {
+            // the switch lies between the last size one image per thread won and this one
+            crossover = crossover > 0 ? sqrt(crossover * areaOf(size)) : 0;
+            break;
+        }
+        crossover = areaOf(size);
+    }
+    return crossover;
+}
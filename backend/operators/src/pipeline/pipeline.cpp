@@ -0,0 +1,383 @@
+#include "pipeline/pipeline.h"
+#include <opencv2/imgproc.hpp>
+using namespace cv;
+#include "utils/kernels_util.h"
+#include <numeric>
+#include <sstream>
+using namespace std;
+
+namespace {
+    // Crops the interior of a filtered stencil input, the pixels the padding was read for.
+    void cropInterior(const Mat& filtered, int radius, Mat& output) {
+        filtered(Rect(radius, radius, filtered.cols - 2 * radius, filtered.rows - 2 * radius)).copyTo(output);
+    }
+
+    class GrayStage : public PipelineStage {
+    public:
+        string describe() const override {
+            return "gray";
+        }
+
+        double nanosPerPixel() const override {
+            return 1;
+        }
+
+        void apply(const Mat& input, Mat& output) const override {
+            if (input.channels() == 1) {
+                input.convertTo(output, CV_32F);
+                return;
+            }
+            thread_local Mat gray;
+            cvtColor(input, gray, input.channels() == 4 ? COLOR_BGRA2GRAY : COLOR_BGR2GRAY);
+            gray.convertTo(output, CV_32F);
+        }
+    };
+
+    class BlurStage : public PipelineStage {
+    public:
+        explicit BlurStage(int size) : size(size), kernel(getGaussianKernel(size, 0, CV_32F)) {}
+
+        string describe() const override {
+            return "blur=" + to_string(size);
+        }
+
+        int radius() const override {
+            return size / 2;
+        }
+
+        double nanosPerPixel() const override {
+            return 0.5 * size;
+        }
+
+        void apply(const Mat& input, Mat& output) const override {
+            thread_local Mat filtered;
+            sepFilter2D(input, filtered, CV_32F, kernel, kernel);
+            cropInterior(filtered, radius(), output);
+        }
+
+    private:
+        int size;   // odd kernel size
+        Mat kernel; // separable Gaussian, sigma derived from the size
+    };
+
+    class GradientStage : public PipelineStage {
+    public:
+        GradientStage(string name, Mat kernelX, Mat kernelY)
+                : name(std::move(name)), kernelX(std::move(kernelX)), kernelY(std::move(kernelY)) {}
+
+        string describe() const override {
+            return name;
+        }
+
+        int radius() const override {
+            return 1;
+        }
+
+        double nanosPerPixel() const override {
+            return 4;
+        }
+
+        void apply(const Mat& input, Mat& output) const override {
+            thread_local Mat gradX;
+            thread_local Mat gradY;
+            thread_local Mat combined;
+            filter2D(input, gradX, CV_32F, kernelX);
+            filter2D(input, gradY, CV_32F, kernelY);
+            magnitude(gradX, gradY, combined);
+            cropInterior(combined, radius(), output);
+        }
+
+    private:
+        string name;
+        Mat kernelX;
+        Mat kernelY;
+    };
+
+    class ThresholdStage : public PipelineStage {
+    public:
+        explicit ThresholdStage(double value) : value(value) {}
+
+        string describe() const override {
+            ostringstream description;
+            description << "threshold=" << value;
+            return description.str();
+        }
+
+        double nanosPerPixel() const override {
+            return 0.5;
+        }
+
+        void apply(const Mat& input, Mat& output) const override {
+            threshold(input, output, value, 255, THRESH_BINARY);
+        }
+
+    private:
+        double value;
+    };
+
+    class NormalizeStage : public PipelineStage {
+    public:
+        string describe() const override {
+            return "normalize";
+        }
+
+        bool fusable() const override {
+            return false;
+        }
+
+        double nanosPerPixel() const override {
+            return 1;
+        }
+
+        void apply(const Mat& input, Mat& output) const override {
+            normalize(input, output, 0, 255, NORM_MINMAX, CV_32F);
+        }
+    };
+
+    Mat sobelKernel(bool dx) {
+        Mat kernel(3, 3, CV_32F);
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                kernel.at<float>(i, j) = static_cast<float>(dx ? KernelUtil::sobelX[i][j] : KernelUtil::sobelY[i][j]);
+            }
+        }
+        return kernel;
+    }
+
+    int parseInt(const string& stage, const string& value) {
+        size_t end = 0;
+        int number = 0;
+        try {
+            number = stoi(value, &end);
+        } catch (const exception&) {
+            end = 0;
+        }
+        if (end == 0 || end != value.size()) {
+            throw runtime_error("Invalid value for " + stage + ": " + value);
+        }
+        return number;
+    }
+
+    // Applies a stage to a whole image, padded the way cv::BORDER_DEFAULT pads.
+    void applyToImage(const PipelineStage& stage, const Mat& input, Mat& output) {
+        int radius = stage.radius();
+        if (radius == 0) {
+            stage.apply(input, output);
+            return;
+        }
+        Mat padded;
+        copyMakeBorder(input, padded, radius, radius, radius, radius, BORDER_REFLECT_101);
+        stage.apply(padded, output);
+    }
+}
+
+Pipeline::Pipeline(vector<shared_ptr<const PipelineStage>> stages) : stages(std::move(stages)) {
+    for (size_t i = 1; i < this->stages.size(); ++i) {
+        if (this->stages[i]->describe() == "gray") {
+            throw runtime_error("gray must be the first stage of a pipeline");
+        }
+    }
+    if (this->stages.empty() || this->stages.front()->describe() != "gray") {
+        this->stages.insert(this->stages.begin(), makeStage("gray", ""));
+    }
+}
+
+shared_ptr<const PipelineStage> Pipeline::makeStage(const string& name, const string& value) {
+    if (name == "gray") {
+        return make_shared<GrayStage>();
+    } else if (name == "blur") {
+        int size = value.empty() ? 3 : parseInt(name, value);
+        if (size < 3 || size > 31 || size % 2 == 0) {
+            throw runtime_error("Invalid value for blur: " + value + ", expected an odd size from 3 to 31");
+        }
+        return make_shared<BlurStage>(size);
+    } else if (name == "sobel") {
+        return make_shared<GradientStage>(name, sobelKernel(true), sobelKernel(false));
+    } else if (name == "prewitt") {
+        return make_shared<GradientStage>(name, KernelUtil::prewittX, KernelUtil::prewittY);
+    } else if (name == "roberts") {
+        return make_shared<GradientStage>(name, KernelUtil::robertCrossX, KernelUtil::robertCrossY);
+    } else if (name == "threshold") {
+        return make_shared<ThresholdStage>(parseInt(name, value));
+    } else if (name == "normalize") {
+        return make_shared<NormalizeStage>();
+    }
+    throw runtime_error("Unknown pipeline stage: " + name);
+}
+
+Pipeline Pipeline::parse(const string& description) {
+    vector<shared_ptr<const PipelineStage>> stages;
+
+    if (!description.empty() && description[0] == '{') {
+        FileStorage storage(description, FileStorage::READ | FileStorage::MEMORY | FileStorage::FORMAT_JSON);
+        FileNode stageNodes = storage["stages"];
+        if (!stageNodes.isSeq()) {
+            throw runtime_error("A JSON pipeline needs a \"stages\" array");
+        }
+        for (const FileNode& node : stageNodes) {
+            string value;
+            FileNode argument = !node["size"].empty() ? node["size"] : node["value"];
+            if (argument.isInt() || argument.isReal()) {
+                value = to_string(static_cast<int>(argument.real()));
+            }
+            stages.push_back(makeStage(static_cast<string>(node["op"]), value));
+        }
+    } else {
+        stringstream stream(description);
+        string token;
+        while (getline(stream, token, ',')) {
+            if (token.empty()) {
+                continue;
+            }
+            size_t separator = token.find('=');
+            stages.push_back(makeStage(token.substr(0, separator),
+                                       separator == string::npos ? "" : token.substr(separator + 1)));
+        }
+    }
+
+    if (stages.empty()) {
+        throw runtime_error("Empty pipeline");
+    }
+    return Pipeline(std::move(stages));
+}
+
+Mat Pipeline::run(const Mat& image, const TileScheduler& scheduler, const CancellationToken* cancellation) const {
+    if (image.empty()) {
+        throw runtime_error("Input image is empty");
+    }
+
+    Mat frame = image;
+    size_t begin = 0;
+    while (begin < stages.size()) {
+        if (cancellation != nullptr) {
+            cancellation->throwIfCancelled();
+        }
+        if (!stages[begin]->fusable()) {
+            Mat output;
+            applyToImage(*stages[begin], frame, output);
+            frame = output;
+            ++begin;
+            continue;
+        }
+
+        size_t end = begin;
+        while (end < stages.size() && stages[end]->fusable()) {
+            ++end;
+        }
+        frame = runFused(frame, begin, end, end == stages.size() ? CV_8U : CV_32F, scheduler, cancellation);
+        begin = end;
+    }
+
+    // a pipeline ending in a whole-image stage still has to be brought to 8 bits
+    if (frame.depth() != CV_8U) {
+        Mat output;
+        frame.convertTo(output, CV_8U);
+        return output;
+    }
+    return frame;
+}
+
+Mat Pipeline::runFused(const Mat& frame, size_t begin, size_t end, int outputType,
+                       const TileScheduler& scheduler, const CancellationToken* cancellation) const {
+    int halo = 0;
+    for (size_t i = begin; i < end; ++i) {
+        halo += stages[i]->radius();
+    }
+
+    Rect bounds(0, 0, frame.cols, frame.rows);
+    Mat output(frame.size(), outputType);
+
+    scheduler.run(frame.size(), [&](const Rect& tile) {
+        // per-thread buffers are reused across tiles, so steady state does not allocate
+        thread_local Mat buffers[2];
+        thread_local Mat padded;
+
+        // the tile plus the context every later stage reads; each stencil stage gives up its
+        // radius on the inner sides, and pads the outer sides as the whole image would be padded
+        Rect region = Rect(tile.x - halo, tile.y - halo, tile.width + 2 * halo, tile.height + 2 * halo) & bounds;
+        Mat current = frame(region);
+        int next = 0;
+
+        for (size_t i = begin; i < end; ++i) {
+            const PipelineStage& stage = *stages[i];
+            int radius = stage.radius();
+            Mat input = current;
+
+            if (radius > 0) {
+                int left = region.x == 0 ? radius : 0;
+                int top = region.y == 0 ? radius : 0;
+                int right = region.x + region.width == bounds.width ? radius : 0;
+                int bottom = region.y + region.height == bounds.height ? radius : 0;
+                if (left + top + right + bottom > 0) {
+                    copyMakeBorder(current, padded, top, bottom, left, right, BORDER_REFLECT_101);
+                    input = padded;
+                }
+                region = Rect(region.x + radius - left, region.y + radius - top,
+                              region.width - 2 * radius + left + right, region.height - 2 * radius + top + bottom);
+            }
+
+            stage.apply(input, buffers[next]);
+            current = buffers[next];
+            next ^= 1;
+        }
+
+        Mat result = current(Rect(tile.x - region.x, tile.y - region.y, tile.width, tile.height));
+        Mat destination = output(tile);
+        result.convertTo(destination, outputType);
+    }, cancellation);
+
+    return output;
+}
+
+Mat Pipeline::runUnfused(const Mat& image, const CancellationToken* cancellation) const {
+    if (image.empty()) {
+        throw runtime_error("Input image is empty");
+    }
+
+    Mat frame = image;
+    for (const auto& stage : stages) {
+        if (cancellation != nullptr) {
+            cancellation->throwIfCancelled();
+        }
+        Mat output;
+        applyToImage(*stage, frame, output);
+        frame = output;
+    }
+
+    Mat output;
+    frame.convertTo(output, CV_8U);
+    return output;
+}
+
+int Pipeline::countPasses() const {
+    int passes = 0;
+    bool inPass = false;
+    for (const auto& stage : stages) {
+        if (!stage->fusable()) {
+            ++passes;
+            inPass = false;
+        } else if (!inPass) {
+            ++passes;
+            inPass = true;
+        }
+    }
+    return passes;
+}
+
+double Pipeline::nanosPerPixel() const {
+    return accumulate(stages.begin(), stages.end(), 0.0, [](double total, const auto& stage) {
+        return total + stage->nanosPerPixel();
+    });
+}
+
+string Pipeline::toString() const {
+    string description;
+    for (const auto& stage : stages) {
+        description += (description.empty() ? "" : ",") + stage->describe();
+    }
+    return description;
+}
+
+const vector<shared_ptr<const PipelineStage>>& Pipeline::getStages() const {
+    return stages;
+}
@@ -0,0 +1,80 @@
+#include "utils/cancellation.h"
+#include <csignal>
+#include <unistd.h>
+using namespace std;
+
+namespace {
+    // namespace scope so the signal handler never runs a static initialization guard
+    CancellationToken processToken;
+
+    void handleSignal(int signal) {
+        static volatile sig_atomic_t received = 0;
+        if (received) {
+            _exit(128 + signal);
+        }
+        received = 1;
+        processToken.cancel();
+    }
+}
+
+void CancellationToken::cancel() {
+    cancelled.store(true, memory_order_relaxed);
+}
+
+void CancellationToken::setDeadline(Clock::time_point point) {
+    deadline.store(point.time_since_epoch().count(), memory_order_relaxed);
+}
+
+void CancellationToken::setTimeout(chrono::milliseconds timeout) {
+    setDeadline(Clock::now() + timeout);
+}
+
+bool CancellationToken::parseFlag(const string& arg) {
+    const string flag = "--deadline-ms=";
+    if (arg.rfind(flag, 0) != 0) {
+        return false;
+    }
+    string value = arg.substr(flag.size());
+    size_t end = 0;
+    long long milliseconds = -1;
+    try {
+        milliseconds = stoll(value, &end);
+    } catch (const exception&) {
+        end = 0;
+    }
+    if (end == 0 || end != value.size() || milliseconds <= 0) {
+        throw runtime_error("Invalid value for --deadline-ms: " + value);
+    }
+    setTimeout(chrono::milliseconds(milliseconds));
+    return true;
+}
+
+bool CancellationToken::isCancelled() const {
+    if (cancelled.load(memory_order_relaxed)) {
+        return true;
+    }
+    int64_t ticks = deadline.load(memory_order_relaxed);
+    return ticks != 0 && Clock::now().time_since_epoch().count() >= ticks;
+}
+
+void CancellationToken::throwIfCancelled() const {
+    if (cancelled.load(memory_order_relaxed)) {
+        throw OperationCancelled("Operation cancelled");
+    }
+    if (isCancelled()) {
+        throw OperationCancelled("Deadline exceeded");
+    }
+}
+
+CancellationToken& CancellationToken::process() {
+    return processToken;
+}
+
+void CancellationToken::installSignalHandlers() {
+    struct sigaction action {};
+    action.sa_handler = handleSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGUSR1, &action, nullptr);
+}
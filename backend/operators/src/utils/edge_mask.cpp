@@ -0,0 +1,171 @@
+#include "utils/edge_mask.h"
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+using namespace cv;
+
+namespace {
+    const string runLengthMagic = "EDGERLE1";
+
+    void checkMask(const Mat& mask) {
+        if (mask.type() != CV_8UC1) {
+            throw runtime_error("An edge mask must be an 8-bit single-channel image");
+        }
+    }
+
+    void appendVarint(vector<uint8_t>& output, uint64_t value) {
+        while (value >= 0x80) {
+            output.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        output.push_back(static_cast<uint8_t>(value));
+    }
+
+    uint64_t readVarint(const vector<uint8_t>& input, size_t& position) {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (position >= input.size()) {
+                throw runtime_error("Truncated run length");
+            }
+            uint8_t byte = input[position++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw runtime_error("Invalid run length");
+    }
+
+    // Reads "<magic>\n<width> <height>\n" and returns the offset of the payload.
+    size_t readHeader(const vector<uint8_t>& data, const string& magic, Size& size) {
+        string header(data.begin(), data.begin() + static_cast<ptrdiff_t>(min<size_t>(data.size(), 64)));
+        istringstream stream(header);
+        string token;
+        int width = 0;
+        int height = 0;
+        if (!(stream >> token) || token != magic || !(stream >> width >> height) || stream.eof()
+            || width <= 0 || height <= 0) {
+            throw runtime_error("Invalid " + magic + " header");
+        }
+        // exactly one whitespace character separates the header from the payload
+        auto offset = static_cast<size_t>(stream.tellg()) + 1;
+        if (offset > data.size()) {
+            throw runtime_error("Invalid " + magic + " header");
+        }
+        size = Size(width, height);
+        return offset;
+    }
+}
+
+bool EdgeMask::isMaskFormat(const string& extension) {
+    return extension == ".pbm" || extension == ".rle";
+}
+
+vector<uint8_t> EdgeMask::pack(const Mat& mask) {
+    checkMask(mask);
+    const size_t stride = (static_cast<size_t>(mask.cols) + 7) / 8;
+    vector<uint8_t> bits(stride * mask.rows, 0);
+
+    // rows start on byte boundaries, so they pack independently
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < mask.rows; ++i) {
+        const auto* pixel = mask.ptr<uint8_t>(i);
+        uint8_t* row = bits.data() + stride * i;
+        for (int j = 0; j < mask.cols; ++j) {
+            if (pixel[j] != 0) {
+                row[j >> 3] |= static_cast<uint8_t>(0x80 >> (j & 7));
+            }
+        }
+    }
+    return bits;
+}
+
+Mat EdgeMask::unpack(const vector<uint8_t>& bits, Size size) {
+    const size_t stride = (static_cast<size_t>(size.width) + 7) / 8;
+    if (bits.size() < stride * size.height) {
+        throw runtime_error("Truncated bit-packed mask");
+    }
+
+    Mat mask(size, CV_8UC1);
+    for (int i = 0; i < size.height; ++i) {
+        const uint8_t* row = bits.data() + stride * i;
+        auto* pixel = mask.ptr<uint8_t>(i);
+        for (int j = 0; j < size.width; ++j) {
+            pixel[j] = (row[j >> 3] & (0x80 >> (j & 7))) != 0 ? 255 : 0;
+        }
+    }
+    return mask;
+}
+
+vector<uint8_t> EdgeMask::encodeRuns(const Mat& mask) {
+    checkMask(mask);
+    vector<uint8_t> runs;
+    bool edge = false;
+    uint64_t length = 0;
+    for (int i = 0; i < mask.rows; ++i) {
+        const auto* pixel = mask.ptr<uint8_t>(i);
+        for (int j = 0; j < mask.cols; ++j) {
+            if ((pixel[j] != 0) != edge) {
+                appendVarint(runs, length);
+                edge = !edge;
+                length = 0;
+            }
+            ++length;
+        }
+    }
+    appendVarint(runs, length);
+    return runs;
+}
+
+Mat EdgeMask::decodeRuns(const vector<uint8_t>& runs, Size size) {
+    Mat mask(size, CV_8UC1);
+    const auto total = static_cast<uint64_t>(size.area());
+    uint64_t filled = 0;
+    size_t position = 0;
+    bool edge = false;
+
+    // the mask is continuous, so the runs fill it as one row
+    uint8_t* pixel = mask.ptr<uint8_t>();
+    while (position < runs.size()) {
+        uint64_t length = readVarint(runs, position);
+        if (length > total - filled) {
+            throw runtime_error("Run lengths exceed the image size");
+        }
+        std::fill(pixel + filled, pixel + filled + length, edge ? 255 : 0);
+        filled += length;
+        edge = !edge;
+    }
+    if (filled != total) {
+        throw runtime_error("Run lengths do not cover the image");
+    }
+    return mask;
+}
+
+vector<uint8_t> EdgeMask::encode(const Mat& mask, const string& extension) {
+    checkMask(mask);
+    string header;
+    vector<uint8_t> payload;
+    if (extension == ".pbm") {
+        header = "P4\n" + to_string(mask.cols) + " " + to_string(mask.rows) + "\n";
+        payload = pack(mask);
+    } else if (extension == ".rle") {
+        header = runLengthMagic + "\n" + to_string(mask.cols) + " " + to_string(mask.rows) + "\n";
+        payload = encodeRuns(mask);
+    } else {
+        throw runtime_error("Not an edge mask format: " + extension);
+    }
+
+    vector<uint8_t> encoded(header.begin(), header.end());
+    encoded.insert(encoded.end(), payload.begin(), payload.end());
+    return encoded;
+}
+
+Mat EdgeMask::decode(const vector<uint8_t>& data) {
+    Size size;
+    if (data.size() >= 2 && data[0] == 'P' && data[1] == '4') {
+        size_t offset = readHeader(data, "P4", size);
+        return unpack(vector<uint8_t>(data.begin() + static_cast<ptrdiff_t>(offset), data.end()), size);
+    }
+    size_t offset = readHeader(data, runLengthMagic, size);
+    return decodeRuns(vector<uint8_t>(data.begin() + static_cast<ptrdiff_t>(offset), data.end()), size);
+}
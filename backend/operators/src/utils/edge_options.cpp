@@ -0,0 +1,95 @@
+#include "utils/edge_options.h"
+#include <stdexcept>
+using namespace std;
+
+namespace {
+    cv::Rect parseRegion(const string& value) {
+        int numbers[4] = {0, 0, 0, 0};
+        size_t position = 0;
+        for (int i = 0; i < 4; ++i) {
+            size_t end = 0;
+            try {
+                numbers[i] = stoi(value.substr(position), &end);
+            } catch (const exception&) {
+                end = 0;
+            }
+            position += end;
+            bool separated = i < 3 ? position < value.size() && value[position] == ',' : position == value.size();
+            if (end == 0 || !separated || numbers[i] < 0) {
+                throw runtime_error("Invalid value for --roi: " + value + ", expected X,Y,W,H");
+            }
+            ++position;
+        }
+        if (numbers[2] == 0 || numbers[3] == 0) {
+            throw runtime_error("Invalid value for --roi: " + value + ", the region is empty");
+        }
+        return {numbers[0], numbers[1], numbers[2], numbers[3]};
+    }
+}
+
+bool EdgeOptions::parseFlag(const string& arg) {
+    if (arg == "--angles") {
+        angles = true;
+        return true;
+    }
+
+    const string thresholdFlag = "--threshold=";
+    if (arg.rfind(thresholdFlag, 0) == 0) {
+        string value = arg.substr(thresholdFlag.size());
+        if (value == "otsu") {
+            threshold = Threshold::Otsu;
+            return true;
+        }
+        size_t end = 0;
+        int level = -1;
+        try {
+            level = stoi(value, &end);
+        } catch (const exception&) {
+            end = 0;
+        }
+        if (end == 0 || end != value.size() || level < 0 || level > 254) {
+            throw runtime_error("Invalid value for --threshold: " + value + ", expected 0 to 254 or otsu");
+        }
+        threshold = Threshold::Fixed;
+        thresholdValue = level;
+        return true;
+    }
+
+    const string regionFlag = "--roi=";
+    if (arg.rfind(regionFlag, 0) == 0) {
+        region = parseRegion(arg.substr(regionFlag.size()));
+        return true;
+    }
+
+    const string flag = "--sigma=";
+    if (arg.rfind(flag, 0) != 0) {
+        return false;
+    }
+
+    string value = arg.substr(flag.size());
+    size_t end = 0;
+    double number = -1;
+    try {
+        number = stod(value, &end);
+    } catch (const exception&) {
+        end = 0;
+    }
+    // beyond 20 the kernel is wider than 120 pixels and the gradient is mostly gone
+    if (end == 0 || end != value.size() || number < 0 || number > 20) {
+        throw runtime_error("Invalid value for --sigma: " + value);
+    }
+    sigma = number;
+    return true;
+}
+
+bool EdgeOptions::isSmoothing() const {
+    return sigma > 0;
+}
+
+bool EdgeOptions::isThresholding() const {
+    return threshold != Threshold::None;
+}
+
+bool EdgeOptions::hasRegion() const {
+    return !region.empty();
+}
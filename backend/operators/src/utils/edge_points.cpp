@@ -0,0 +1,164 @@
+#include "utils/edge_points.h"
+#include <omp.h>
+#include <cmath>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+using namespace std;
+using namespace cv;
+
+namespace {
+    const string magic = "EDGEPTS1";
+    const size_t pointBytes = 2 + 2 + 1;
+    const size_t angleBytes = 2;
+
+    bool isGradientDepth(int depth) {
+        return depth == CV_16S || depth == CV_32S || depth == CV_32F || depth == CV_64F;
+    }
+
+    // Reads one pixel of a gradient plane, whatever depth the operator computed it in. Runs
+    // inside the parallel region, where it must not throw; encode checks the depth up front.
+    double gradientAt(const Mat& plane, int y, int x) {
+        switch (plane.depth()) {
+            case CV_16S:
+                return plane.at<int16_t>(y, x);
+            case CV_32S:
+                return plane.at<int32_t>(y, x);
+            case CV_32F:
+                return plane.at<float>(y, x);
+            case CV_64F:
+                return plane.at<double>(y, x);
+            default:
+                return 0;
+        }
+    }
+
+    uint16_t toAngle(double gradX, double gradY) {
+        // image rows grow downwards, so the y gradient is negated for a counterclockwise angle
+        double radians = atan2(-gradY, gradX);
+        if (radians < 0) {
+            radians += 2 * CV_PI;
+        }
+        return static_cast<uint16_t>(static_cast<long>(lround(radians / (2 * CV_PI) * 65536)) & 0xffff);
+    }
+
+    void putLE16(uint8_t* output, uint16_t value) {
+        output[0] = static_cast<uint8_t>(value);
+        output[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    uint16_t getLE16(const uint8_t* input) {
+        return static_cast<uint16_t>(input[0] | (input[1] << 8));
+    }
+}
+
+vector<uint8_t> EdgePoints::encode(const Mat& magnitude, int level, const Mat& gradX, const Mat& gradY) {
+    if (magnitude.type() != CV_8UC1) {
+        throw runtime_error("A point list needs an 8-bit single-channel magnitude");
+    }
+    if (magnitude.cols > 65536 || magnitude.rows > 65536) {
+        throw runtime_error("A point list holds images of up to 65536 pixels per side");
+    }
+    const bool withAngles = !gradX.empty();
+    if (withAngles && (gradX.size() != magnitude.size() || gradY.size() != magnitude.size()
+                       || gradX.channels() != 1 || gradY.channels() != 1)) {
+        throw runtime_error("The gradients do not match the magnitude");
+    }
+    if (withAngles && (!isGradientDepth(gradX.depth()) || !isGradientDepth(gradY.depth()))) {
+        throw runtime_error("Unsupported gradient depth, expected 16S, 32S, 32F or 64F");
+    }
+
+    const size_t recordBytes = pointBytes + (withAngles ? angleBytes : 0);
+    const int rows = magnitude.rows;
+    const int cols = magnitude.cols;
+    vector<size_t> offsets(static_cast<size_t>(omp_get_max_threads()) + 1, 0);
+    vector<uint8_t> output;
+    size_t headerBytes = 0;
+
+#pragma omp parallel
+    {
+        const int thread = omp_get_thread_num();
+        const int threads = omp_get_num_threads();
+        const int rowBegin = static_cast<int>(static_cast<long>(rows) * thread / threads);
+        const int rowEnd = static_cast<int>(static_cast<long>(rows) * (thread + 1) / threads);
+
+        size_t count = 0;
+        for (int i = rowBegin; i < rowEnd; ++i) {
+            const auto* pixel = magnitude.ptr<uint8_t>(i);
+            for (int j = 0; j < cols; ++j) {
+                count += pixel[j] > level;
+            }
+        }
+        offsets[thread + 1] = count;
+
+#pragma omp barrier
+#pragma omp single
+        {
+            partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            string header = magic + "\n" + to_string(cols) + " " + to_string(rows) + " "
+                            + to_string(offsets.back()) + " " + (withAngles ? "xyma" : "xym") + "\n";
+            headerBytes = header.size();
+            output.resize(headerBytes + offsets.back() * recordBytes);
+            copy(header.begin(), header.end(), output.begin());
+        }
+
+        uint8_t* record = output.data() + headerBytes + offsets[thread] * recordBytes;
+        for (int i = rowBegin; i < rowEnd; ++i) {
+            const auto* pixel = magnitude.ptr<uint8_t>(i);
+            for (int j = 0; j < cols; ++j) {
+                if (pixel[j] <= level) {
+                    continue;
+                }
+                putLE16(record, static_cast<uint16_t>(j));
+                putLE16(record + 2, static_cast<uint16_t>(i));
+                record[4] = pixel[j];
+                if (withAngles) {
+                    putLE16(record + pointBytes, toAngle(gradientAt(gradX, i, j), gradientAt(gradY, i, j)));
+                }
+                record += recordBytes;
+            }
+        }
+    }
+    return output;
+}
+
+EdgePointList EdgePoints::decode(const vector<uint8_t>& data) {
+    string header(data.begin(), data.begin() + static_cast<ptrdiff_t>(min<size_t>(data.size(), 96)));
+    istringstream stream(header);
+    string token;
+    string fields;
+    int width = 0;
+    int height = 0;
+    size_t count = 0;
+    if (!(stream >> token) || token != magic || !(stream >> width >> height >> count >> fields) || stream.eof()
+        || width <= 0 || height <= 0 || (fields != "xym" && fields != "xyma")) {
+        throw runtime_error("Invalid " + magic + " header");
+    }
+
+    EdgePointList list;
+    list.size = Size(width, height);
+    list.hasAngles = fields == "xyma";
+    const size_t recordBytes = pointBytes + (list.hasAngles ? angleBytes : 0);
+    const auto offset = static_cast<size_t>(stream.tellg()) + 1;
+    if (offset > data.size() || (data.size() - offset) / recordBytes < count) {
+        throw runtime_error("Truncated point list");
+    }
+
+    list.points.resize(count);
+    const uint8_t* record = data.data() + offset;
+    for (EdgePoint& point : list.points) {
+        point.x = getLE16(record);
+        point.y = getLE16(record + 2);
+        point.magnitude = record[4];
+        if (list.hasAngles) {
+            point.angle = getLE16(record + pointBytes);
+        }
+        record += recordBytes;
+    }
+    return list;
+}
+
+double EdgePoints::toRadians(uint16_t angle) {
+    return angle / 65536.0 * 2 * CV_PI;
+}
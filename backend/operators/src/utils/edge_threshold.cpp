@@ -0,0 +1,87 @@
+#include "utils/edge_threshold.h"
+#include <opencv2/imgproc.hpp>
+#include <cfloat>
+#include <stdexcept>
+using namespace std;
+using namespace cv;
+
+EdgeThreshold::Histogram EdgeThreshold::histogram(const Mat& edges) {
+    if (edges.type() != CV_8UC1) {
+        throw runtime_error("The edge threshold needs an 8-bit single-channel image");
+    }
+
+    uint64_t counts[256] = {};
+    const int rows = edges.rows;
+    const int cols = edges.cols;
+#pragma omp parallel for schedule(static) reduction(+:counts[:256]) default(none) shared(edges, rows, cols)
+    for (int i = 0; i < rows; ++i) {
+        const auto* pixel = edges.ptr<uint8_t>(i);
+        for (int j = 0; j < cols; ++j) {
+            ++counts[pixel[j]];
+        }
+    }
+
+    Histogram merged{};
+    copy(begin(counts), end(counts), merged.begin());
+    return merged;
+}
+
+int EdgeThreshold::otsu(const Histogram& counts) {
+    uint64_t total = 0;
+    double mean = 0;
+    for (int i = 0; i < 256; ++i) {
+        total += counts[i];
+        mean += i * static_cast<double>(counts[i]);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    double scale = 1.0 / static_cast<double>(total);
+    mean *= scale;
+
+    // the loop of OpenCV's getThreshVal_Otsu_8u, so the level matches THRESH_OTSU exactly
+    double lowerWeight = 0;
+    double lowerMean = 0;
+    double bestVariance = 0;
+    int bestLevel = 0;
+    for (int i = 0; i < 256; ++i) {
+        double probability = static_cast<double>(counts[i]) * scale;
+        lowerMean *= lowerWeight;
+        lowerWeight += probability;
+        double upperWeight = 1 - lowerWeight;
+
+        if (min(lowerWeight, upperWeight) < FLT_EPSILON || max(lowerWeight, upperWeight) > 1 - FLT_EPSILON) {
+            continue;
+        }
+
+        lowerMean = (lowerMean + i * probability) / lowerWeight;
+        double upperMean = (mean - lowerWeight * lowerMean) / upperWeight;
+        double variance = lowerWeight * upperWeight * (lowerMean - upperMean) * (lowerMean - upperMean);
+        if (variance > bestVariance) {
+            bestVariance = variance;
+            bestLevel = i;
+        }
+    }
+    return bestLevel;
+}
+
+int EdgeThreshold::level(const Mat& edges, const EdgeOptions& options) {
+    switch (options.threshold) {
+        case EdgeOptions::Threshold::Otsu:
+            return otsu(histogram(edges));
+        case EdgeOptions::Threshold::Fixed:
+            return options.thresholdValue;
+        default:
+            return 0;
+    }
+}
+
+Mat EdgeThreshold::apply(const Mat& edges, const EdgeOptions& options) {
+    if (!options.isThresholding()) {
+        return edges;
+    }
+
+    Mat binary;
+    threshold(edges, binary, level(edges, options), 255, THRESH_BINARY);
+    return binary;
+}
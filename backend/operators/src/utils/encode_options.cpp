@@ -0,0 +1,79 @@
+#include "utils/encode_options.h"
+#include <opencv2/imgcodecs.hpp>
+#include <stdexcept>
+using namespace std;
+
+namespace {
+    const vector<pair<string, int>> pngStrategies = {
+        {"default", cv::IMWRITE_PNG_STRATEGY_DEFAULT},
+        {"filtered", cv::IMWRITE_PNG_STRATEGY_FILTERED},
+        {"huffman", cv::IMWRITE_PNG_STRATEGY_HUFFMAN_ONLY},
+        {"rle", cv::IMWRITE_PNG_STRATEGY_RLE},
+        {"fixed", cv::IMWRITE_PNG_STRATEGY_FIXED},
+    };
+
+    int parseLevel(const string& flag, const string& value, int minimum, int maximum) {
+        size_t end = 0;
+        int number = minimum - 1;
+        try {
+            number = stoi(value, &end);
+        } catch (const exception&) {
+            end = 0;
+        }
+        if (end == 0 || end != value.size() || number < minimum || number > maximum) {
+            throw runtime_error("Invalid value for " + flag + ": " + value + ", expected "
+                                + to_string(minimum) + " to " + to_string(maximum));
+        }
+        return number;
+    }
+}
+
+bool EncodeOptions::parseFlag(const string& arg) {
+    size_t equals = arg.find('=');
+    string flag = arg.substr(0, equals);
+    if (flag != "--quality" && flag != "--png-level" && flag != "--png-strategy") {
+        return false;
+    }
+    string value = equals == string::npos ? "" : arg.substr(equals + 1);
+
+    if (flag == "--quality") {
+        quality = parseLevel(flag, value, 1, 100);
+    } else if (flag == "--png-level") {
+        pngLevel = parseLevel(flag, value, 0, 9);
+    } else {
+        for (const auto& strategy : pngStrategies) {
+            if (strategy.first == value) {
+                pngStrategy = strategy.second;
+                return true;
+            }
+        }
+        throw runtime_error("Invalid value for --png-strategy: " + value
+                            + ", expected default, filtered, huffman, rle or fixed");
+    }
+    return true;
+}
+
+vector<int> EncodeOptions::params(const string& extension) const {
+    vector<int> result;
+    if (extension == ".png") {
+        // OpenCV resets the strategy when it reads the level, so the level goes first
+        if (pngLevel >= 0) {
+            result.insert(result.end(), {cv::IMWRITE_PNG_COMPRESSION, pngLevel});
+        }
+        if (pngStrategy >= 0) {
+            result.insert(result.end(), {cv::IMWRITE_PNG_STRATEGY, pngStrategy});
+        }
+    } else if (extension == ".jpg" || extension == ".jpeg") {
+        if (quality > 0) {
+            result.insert(result.end(), {cv::IMWRITE_JPEG_QUALITY, quality});
+        }
+    } else if (extension == ".webp") {
+        if (quality > 0) {
+            result.insert(result.end(), {cv::IMWRITE_WEBP_QUALITY, quality});
+        }
+    } else if (extension == ".pgm" || extension == ".ppm" || extension == ".pnm") {
+        // raw samples, no encoding beyond the header
+        result.insert(result.end(), {cv::IMWRITE_PXM_BINARY, 1});
+    }
+    return result;
+}
@@ -0,0 +1,143 @@
+#include "utils/execution_config.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+
+namespace {
+    int parsePositive(const string& flag, const string& value, int minimum) {
+        size_t end = 0;
+        int number = 0;
+        try {
+            number = stoi(value, &end);
+        } catch (const exception&) {
+            end = 0;
+        }
+        if (end == 0 || end != value.size() || number < minimum) {
+            throw runtime_error("Invalid value for " + flag + ": " + value);
+        }
+        return number;
+    }
+
+    cv::Size parseTileSize(const string& value) {
+        if (value == "auto") {
+            return {};
+        }
+        size_t separator = value.find('x');
+        if (separator == string::npos) {
+            int side = parsePositive("--tile", value, 1);
+            return {side, side};
+        }
+        return {parsePositive("--tile", value.substr(0, separator), 1),
+                parsePositive("--tile", value.substr(separator + 1), 1)};
+    }
+
+    const char* scheduleName(ScheduleKind schedule) {
+        switch (schedule) {
+            case ScheduleKind::Static: return "static";
+            case ScheduleKind::Dynamic: return "dynamic";
+            default: return "tiled";
+        }
+    }
+
+    const char* pinPolicyName(PinPolicy pinning) {
+        switch (pinning) {
+            case PinPolicy::Compact: return "compact";
+            case PinPolicy::Scatter: return "scatter";
+            case PinPolicy::List: return "list";
+            default: return "none";
+        }
+    }
+}
+
+bool ExecutionConfig::parseFlag(const string& arg) {
+    size_t separator = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || separator == string::npos) {
+        return false;
+    }
+
+    string flag = arg.substr(0, separator);
+    string value = arg.substr(separator + 1);
+
+    if (flag == "--threads") {
+        numThreads = parsePositive(flag, value, 0);
+    } else if (flag == "--schedule") {
+        schedule = parseSchedule(value);
+    } else if (flag == "--chunk") {
+        chunkSize = parsePositive(flag, value, 1);
+    } else if (flag == "--tile") {
+        tileSize = parseTileSize(value);
+    } else if (flag == "--pin") {
+        pinning = parsePinPolicy(value);
+    } else if (flag == "--cpus") {
+        cpuList = parseCpuList(value);
+        pinning = PinPolicy::List;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+string ExecutionConfig::toString() const {
+    ostringstream flags;
+    flags << "--threads=" << numThreads
+          << " --schedule=" << scheduleName(schedule)
+          << " --chunk=" << chunkSize
+          << " --tile=" << (tileSize.empty() ? "auto" : to_string(tileSize.width) + "x" + to_string(tileSize.height))
+          << " --pin=" << pinPolicyName(pinning);
+    if (!cpuList.empty()) {
+        flags << " --cpus=";
+        for (size_t i = 0; i < cpuList.size(); ++i) {
+            flags << (i > 0 ? "," : "") << cpuList[i];
+        }
+    }
+    return flags.str();
+}
+
+ScheduleKind ExecutionConfig::parseSchedule(const string& name) {
+    if (name == "tiled") {
+        return ScheduleKind::Tiled;
+    } else if (name == "static") {
+        return ScheduleKind::Static;
+    } else if (name == "dynamic") {
+        return ScheduleKind::Dynamic;
+    }
+    throw runtime_error("Unknown schedule: " + name);
+}
+
+PinPolicy ExecutionConfig::parsePinPolicy(const string& name) {
+    if (name == "none") {
+        return PinPolicy::None;
+    } else if (name == "compact") {
+        return PinPolicy::Compact;
+    } else if (name == "scatter") {
+        return PinPolicy::Scatter;
+    } else if (name == "list") {
+        return PinPolicy::List;
+    }
+    throw runtime_error("Unknown pinning policy: " + name);
+}
+
+vector<int> ExecutionConfig::parseCpuList(const string& list) {
+    vector<int> cpus;
+    stringstream ranges(list);
+    string range;
+    while (getline(ranges, range, ',')) {
+        size_t dash = range.find('-');
+        int first = parsePositive("--cpus", range.substr(0, dash), 0);
+        int last = dash == string::npos ? first : parsePositive("--cpus", range.substr(dash + 1), 0);
+        if (last < first) {
+            throw runtime_error("Invalid value for --cpus: " + list);
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    if (cpus.empty()) {
+        throw runtime_error("Invalid value for --cpus: " + list);
+    }
+
+    sort(cpus.begin(), cpus.end());
+    cpus.erase(unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
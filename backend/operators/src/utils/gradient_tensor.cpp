@@ -0,0 +1,75 @@
+#include "utils/gradient_tensor.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+using namespace std;
+using namespace cv;
+
+namespace {
+    const char npyMagic[] = "\x93NUMPY";
+    const size_t magicBytes = 6;
+    const size_t preambleBytes = magicBytes + 2 + 2; // magic, version 1.0, little-endian header length
+
+    string dictionary(int height, int width) {
+        return "{'descr': '<f4', 'fortran_order': False, 'shape': (3, " + to_string(height) + ", "
+               + to_string(width) + "), }";
+    }
+}
+
+vector<uint8_t> GradientTensor::encode(const Mat& gradX, const Mat& gradY) {
+    if (gradX.empty() || gradX.size() != gradY.size() || gradX.channels() != 1 || gradY.channels() != 1) {
+        throw runtime_error("The gradients are empty or do not match");
+    }
+
+    // the dictionary is padded with spaces and ends in a newline, as the format asks
+    string header = dictionary(gradX.rows, gradX.cols);
+    header.resize(headerBytes - preambleBytes - 1, ' ');
+    header += '\n';
+
+    const size_t planeBytes = gradX.total() * sizeof(float);
+    vector<uint8_t> output(headerBytes + 3 * planeBytes);
+    memcpy(output.data(), npyMagic, magicBytes);
+    output[magicBytes] = 1;
+    output[magicBytes + 1] = 0;
+    output[magicBytes + 2] = static_cast<uint8_t>(header.size());
+    output[magicBytes + 3] = static_cast<uint8_t>(header.size() >> 8);
+    memcpy(output.data() + preambleBytes, header.data(), header.size());
+
+    // the planes are written in place through headers over the output, without intermediate copies
+    uint8_t* data = output.data() + headerBytes;
+    Mat planeX(gradX.size(), CV_32FC1, data);
+    Mat planeY(gradX.size(), CV_32FC1, data + planeBytes);
+    Mat planeMagnitude(gradX.size(), CV_32FC1, data + 2 * planeBytes);
+    gradX.convertTo(planeX, CV_32F);
+    gradY.convertTo(planeY, CV_32F);
+    magnitude(planeX, planeY, planeMagnitude);
+    return output;
+}
+
+vector<Mat> GradientTensor::decode(const vector<uint8_t>& data) {
+    if (data.size() < headerBytes || memcmp(data.data(), npyMagic, magicBytes) != 0) {
+        throw runtime_error("Not an .npy file");
+    }
+    string header(data.begin() + preambleBytes, data.begin() + headerBytes);
+    size_t shape = header.find("'shape': (3, ");
+    int height = 0;
+    int width = 0;
+    if (header.find("'descr': '<f4'") == string::npos || header.find("'fortran_order': False") == string::npos
+        || shape == string::npos || sscanf(header.c_str() + shape, "'shape': (3, %d, %d)", &height, &width) != 2
+        || height <= 0 || width <= 0) {
+        throw runtime_error("Not a gradient tensor");
+    }
+
+    const size_t planeBytes = static_cast<size_t>(height) * width * sizeof(float);
+    if (data.size() < headerBytes + 3 * planeBytes) {
+        throw runtime_error("Truncated gradient tensor");
+    }
+
+    vector<Mat> planes;
+    for (int i = 0; i < 3; ++i) {
+        auto* plane = const_cast<uint8_t*>(data.data() + headerBytes + i * planeBytes);
+        planes.push_back(Mat(height, width, CV_32FC1, plane).clone());
+    }
+    return planes;
+}
@@ -1,16 +1,439 @@
 #include "../include/utils/image_utils.h"
+#include "../include/utils/edge_mask.h"
+#include "../include/utils/png_encoder.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <streambuf>
+
+namespace {
+    // read-only stream over a caller's buffer, so in-memory images are probed without a copy
+    class MemoryBuffer : public std::streambuf {
+    public:
+        MemoryBuffer(const uint8_t* data, size_t size) {
+            char* begin = reinterpret_cast<char*>(const_cast<uint8_t*>(data));
+            setg(begin, begin, begin + size);
+        }
+
+    protected:
+        pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode) override {
+            char* base = direction == std::ios_base::beg ? eback() : direction == std::ios_base::cur ? gptr() : egptr();
+            char* target = base + offset;
+            if (target < eback() || target > egptr()) {
+                return pos_type(off_type(-1));
+            }
+            setg(eback(), target, egptr());
+            return pos_type(target - eback());
+        }
+
+        pos_type seekpos(pos_type position, std::ios_base::openmode mode) override {
+            return seekoff(off_type(position), std::ios_base::beg, mode);
+        }
+    };
+
+    uint32_t readBE(const std::vector<uint8_t>& bytes, size_t offset, int length) {
+        uint32_t value = 0;
+        for (int i = 0; i < length; ++i) {
+            value = (value << 8) | bytes[offset + i];
+        }
+        return value;
+    }
+
+    uint32_t readLE(const std::vector<uint8_t>& bytes, size_t offset, int length) {
+        uint32_t value = 0;
+        for (int i = length - 1; i >= 0; --i) {
+            value = (value << 8) | bytes[offset + i];
+        }
+        return value;
+    }
+
+    std::vector<uint8_t> readAt(std::istream& file, std::streamoff position, size_t length) {
+        std::vector<uint8_t> bytes(length);
+        file.clear();
+        file.seekg(position);
+        file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(length));
+        bytes.resize(static_cast<size_t>(std::max<std::streamsize>(file.gcount(), 0)));
+        return bytes;
+    }
+
+    // JPEG stores the size in the first start-of-frame segment, which may follow large EXIF
+    // or ICC segments, so walk the segment chain instead of reading a fixed prefix.
+    std::optional<ImageInfo> probeJpeg(std::istream& file) {
+        std::streamoff position = 2;
+        for (;;) {
+            std::vector<uint8_t> marker = readAt(file, position, 4);
+            if (marker.size() < 4 || marker[0] != 0xff) {
+                return std::nullopt;
+            }
+            uint8_t type = marker[1];
+            if (type == 0xff) { // fill byte
+                position += 1;
+                continue;
+            }
+            bool startOfFrame = type >= 0xc0 && type <= 0xcf && type != 0xc4 && type != 0xc8 && type != 0xcc;
+            if (startOfFrame) {
+                std::vector<uint8_t> frame = readAt(file, position + 4, 6);
+                if (frame.size() < 6) {
+                    return std::nullopt;
+                }
+                ImageInfo info;
+                info.format = "jpeg";
+                info.bitDepth = frame[0];
+                info.height = static_cast<int>(readBE(frame, 1, 2));
+                info.width = static_cast<int>(readBE(frame, 3, 2));
+                info.channels = frame[5];
+                return info;
+            }
+            uint32_t length = readBE(marker, 2, 2);
+            if (length < 2) {
+                return std::nullopt;
+            }
+            position += 2 + length;
+        }
+    }
+
+    std::optional<ImageInfo> probeWebp(const std::vector<uint8_t>& header) {
+        ImageInfo info;
+        info.format = "webp";
+        info.bitDepth = 8;
+        std::string chunk(header.begin() + 12, header.begin() + 16);
+        if (chunk == "VP8 " && header.size() >= 30) {
+            info.width = static_cast<int>(readLE(header, 26, 2) & 0x3fff);
+            info.height = static_cast<int>(readLE(header, 28, 2) & 0x3fff);
+            info.channels = 3;
+        } else if (chunk == "VP8L" && header.size() >= 25) {
+            uint32_t bits = readLE(header, 21, 4);
+            info.width = static_cast<int>(bits & 0x3fff) + 1;
+            info.height = static_cast<int>((bits >> 14) & 0x3fff) + 1;
+            info.channels = (bits >> 28) & 1 ? 4 : 3;
+        } else if (chunk == "VP8X" && header.size() >= 30) {
+            info.width = static_cast<int>(readLE(header, 24, 3)) + 1;
+            info.height = static_cast<int>(readLE(header, 27, 3)) + 1;
+            info.channels = header[20] & 0x10 ? 4 : 3;
+        } else {
+            return std::nullopt;
+        }
+        return info;
+    }
+
+    std::optional<ImageInfo> probePnm(std::istream& file, char kind) {
+        // width, height and, except for bitmaps, the maximum value, separated by whitespace or comments
+        file.clear();
+        file.seekg(2);
+        long values[3] = {0, 0, 1};
+        int count = (kind == '1' || kind == '4') ? 2 : 3;
+        for (int i = 0; i < count; ++i) {
+            file >> std::ws;
+            while (file.peek() == '#') {
+                std::string comment;
+                std::getline(file, comment);
+                file >> std::ws;
+            }
+            if (!(file >> values[i]) || values[i] <= 0) {
+                return std::nullopt;
+            }
+        }
+        ImageInfo info;
+        info.format = "pnm";
+        info.width = static_cast<int>(values[0]);
+        info.height = static_cast<int>(values[1]);
+        info.channels = (kind == '3' || kind == '6') ? 3 : 1;
+        info.bitDepth = count == 2 ? 1 : (values[2] > 255 ? 16 : 8);
+        return info;
+    }
+}
+
+namespace {
+    /**
+     * @brief Where the rows of an uncompressed image are in its file.
+     */
+    struct RasterLayout {
+        cv::Size size;
+        int channels = 0;          // 1 or 3 bytes per pixel
+        std::streamoff offset = 0; // of the first stored row
+        size_t stride = 0;         // bytes from one stored row to the next
+        bool bottomUp = false;     // BMP stores the last row first
+        bool rgb = false;          // PPM stores RGB, BMP BGR
+    };
+
+    std::optional<RasterLayout> pnmLayout(std::istream& file, char kind) {
+        file.clear();
+        file.seekg(2);
+        long values[3] = {0, 0, 0};
+        for (long& value : values) {
+            file >> std::ws;
+            while (file.peek() == '#') {
+                std::string comment;
+                std::getline(file, comment);
+                file >> std::ws;
+            }
+            if (!(file >> value) || value <= 0) {
+                return std::nullopt;
+            }
+        }
+        // a single whitespace character separates the maximum value from the pixels
+        if (values[2] > 255 || !std::isspace(file.get())) {
+            return std::nullopt;
+        }
+        RasterLayout layout;
+        layout.size = cv::Size(static_cast<int>(values[0]), static_cast<int>(values[1]));
+        layout.channels = kind == '6' ? 3 : 1;
+        layout.offset = file.tellg();
+        layout.stride = static_cast<size_t>(layout.size.width) * layout.channels;
+        layout.rgb = true;
+        return layout;
+    }
+
+    std::optional<RasterLayout> bmpLayout(const std::vector<uint8_t>& header) {
+        // BITMAPINFOHEADER or later, one plane of 24 bits without compression
+        if (readLE(header, 14, 4) < 40 || readLE(header, 28, 2) != 24 || readLE(header, 30, 4) != 0) {
+            return std::nullopt;
+        }
+        int32_t width = static_cast<int32_t>(readLE(header, 18, 4));
+        int32_t height = static_cast<int32_t>(readLE(header, 22, 4));
+        if (width <= 0 || height == 0 || height == INT32_MIN) {
+            return std::nullopt;
+        }
+        RasterLayout layout;
+        layout.size = cv::Size(width, std::abs(height));
+        layout.channels = 3;
+        layout.offset = static_cast<std::streamoff>(readLE(header, 10, 4));
+        layout.stride = (static_cast<size_t>(width) * 3 + 3) / 4 * 4;
+        layout.bottomUp = height > 0;
+        return layout;
+    }
+
+    std::optional<RasterLayout> rasterLayout(std::istream& file) {
+        std::vector<uint8_t> header = readAt(file, 0, 64);
+        if (header.size() >= 3 && header[0] == 'P' && (header[1] == '5' || header[1] == '6')) {
+            return pnmLayout(file, static_cast<char>(header[1]));
+        }
+        if (header.size() >= 34 && header[0] == 'B' && header[1] == 'M') {
+            return bmpLayout(header);
+        }
+        return std::nullopt;
+    }
+
+    cv::Mat readRaster(std::istream& file, const RasterLayout& layout, const cv::Rect& region) {
+        cv::Mat pixels(region.size(), CV_8UC(layout.channels));
+        size_t rowBytes = static_cast<size_t>(region.width) * layout.channels;
+        for (int y = 0; y < region.height; ++y) {
+            int row = region.y + y;
+            size_t storedRow = static_cast<size_t>(layout.bottomUp ? layout.size.height - 1 - row : row);
+            file.seekg(layout.offset + static_cast<std::streamoff>(storedRow * layout.stride
+                                                                   + static_cast<size_t>(region.x) * layout.channels));
+            file.read(reinterpret_cast<char*>(pixels.ptr(y)), static_cast<std::streamsize>(rowBytes));
+            if (!file) {
+                throw std::runtime_error("The image ends before row " + std::to_string(row));
+            }
+        }
+        if (layout.rgb && layout.channels == 3) {
+            cv::cvtColor(pixels, pixels, cv::COLOR_RGB2BGR);
+        }
+        return pixels;
+    }
+
+    int readFlags(cv::ImreadModes mode, int reduction) {
+        if (reduction <= 1) {
+            return mode;
+        }
+        bool gray = mode == cv::IMREAD_GRAYSCALE;
+        switch (reduction) {
+            case 2: return gray ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2;
+            case 4: return gray ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4;
+            case 8: return gray ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8;
+            default: throw std::runtime_error("Unsupported reduction: " + std::to_string(reduction));
+        }
+    }
+
+    std::optional<ImageInfo> probeStream(std::istream& file) {
+        std::vector<uint8_t> header = readAt(file, 0, 64);
+        ImageInfo info;
+
+        if (header.size() >= 26 && readBE(header, 0, 4) == 0x89504e47) {
+            static const int pngChannels[] = {1, 0, 3, 3, 2, 0, 4};
+            uint8_t colorType = header[25];
+            info.format = "png";
+            info.width = static_cast<int>(readBE(header, 16, 4));
+            info.height = static_cast<int>(readBE(header, 20, 4));
+            info.bitDepth = colorType == 3 ? 8 : header[24];
+            info.channels = colorType <= 6 ? pngChannels[colorType] : 0;
+        } else if (header.size() >= 4 && header[0] == 0xff && header[1] == 0xd8) {
+            return probeJpeg(file);
+        } else if (header.size() >= 10 && header[0] == 'G' && header[1] == 'I' && header[2] == 'F') {
+            info.format = "gif";
+            info.width = static_cast<int>(readLE(header, 6, 2));
+            info.height = static_cast<int>(readLE(header, 8, 2));
+            info.channels = 3;
+            info.bitDepth = 8;
+        } else if (header.size() >= 30 && header[0] == 'B' && header[1] == 'M') {
+            info.format = "bmp";
+            info.width = std::abs(static_cast<int32_t>(readLE(header, 18, 4)));
+            info.height = std::abs(static_cast<int32_t>(readLE(header, 22, 4)));
+            info.channels = readLE(header, 28, 2) == 32 ? 4 : 3;
+            info.bitDepth = 8;
+        } else if (header.size() >= 16 && std::string(header.begin(), header.begin() + 4) == "RIFF"
+                   && std::string(header.begin() + 8, header.begin() + 12) == "WEBP") {
+            return probeWebp(header);
+        } else if (header.size() >= 3 && header[0] == 'P' && header[1] >= '1' && header[1] <= '6') {
+            return probePnm(file, static_cast<char>(header[1]));
+        } else {
+            return std::nullopt;
+        }
+
+        if (info.width <= 0 || info.height <= 0 || info.channels <= 0) {
+            return std::nullopt;
+        }
+        return info;
+    }
+}
 
 cv::Mat ImageUtils::getImage(
         const std::string &inputPath,
-        cv::ImreadModes mode
+        cv::ImreadModes mode,
+        int reduction
 ) {
-    cv:: Mat image = cv::imread(inputPath, mode);
+    cv:: Mat image = cv::imread(inputPath, readFlags(mode, reduction));
     if (image.empty()) {
         throw std::runtime_error("Could not read the image: " + inputPath);
     }
     return image;
 }
 
+cv::Mat ImageUtils::getRegion(const std::string& inputPath, const cv::Rect& region, cv::ImreadModes mode) {
+    std::ifstream file(inputPath, std::ios::binary);
+    std::optional<RasterLayout> layout = file ? rasterLayout(file) : std::nullopt;
+    if (!layout) {
+        cv::Mat image = getImage(inputPath, mode);
+        cv::Rect bounded = region & cv::Rect(0, 0, image.cols, image.rows);
+        if (bounded.empty()) {
+            throw std::runtime_error("The region lies outside the image: " + inputPath);
+        }
+        // the copy lets the whole image go before the operator runs
+        return image(bounded).clone();
+    }
+
+    cv::Rect bounded = region & cv::Rect(cv::Point(0, 0), layout->size);
+    if (bounded.empty()) {
+        throw std::runtime_error("The region lies outside the image: " + inputPath);
+    }
+    cv::Mat pixels;
+    try {
+        pixels = readRaster(file, *layout, bounded);
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error("Could not read the image: " + inputPath + ", " + e.what());
+    }
+    if (mode == cv::IMREAD_GRAYSCALE) {
+        return toGrayscale(pixels);
+    }
+    return toColor(pixels);
+}
+
+bool ImageUtils::canDecodeRegion(const std::string& inputPath) {
+    std::ifstream file(inputPath, std::ios::binary);
+    return file && rasterLayout(file).has_value();
+}
+
+std::optional<ImageInfo> ImageUtils::probeImage(const std::string& inputPath) {
+    std::ifstream file(inputPath, std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+    return probeStream(file);
+}
+
+std::optional<ImageInfo> ImageUtils::probeImage(const uint8_t* data, size_t size) {
+    MemoryBuffer buffer(data, size);
+    std::istream stream(&buffer);
+    return probeStream(stream);
+}
+
+cv::Mat ImageUtils::decodeImage(const uint8_t* data, size_t size, cv::ImreadModes mode, int reduction) {
+    cv::Mat encoded(1, static_cast<int>(size), CV_8UC1, const_cast<uint8_t*>(data));
+    cv::Mat image = cv::imdecode(encoded, readFlags(mode, reduction));
+    if (image.empty()) {
+        throw std::runtime_error("Could not decode the image");
+    }
+    return image;
+}
+
+void ImageUtils::decodeImage(const uint8_t* data, size_t size, cv::Mat& image, cv::ImreadModes mode, int reduction) {
+    cv::Mat encoded(1, static_cast<int>(size), CV_8UC1, const_cast<uint8_t*>(data));
+    cv::imdecode(encoded, readFlags(mode, reduction), &image);
+    if (image.empty()) {
+        throw std::runtime_error("Could not decode the image");
+    }
+}
+
+std::vector<uint8_t> ImageUtils::encodeImage(const cv::Mat& image, const std::string& extension,
+                                             const EncodeOptions& options) {
+    if (EdgeMask::isMaskFormat(extension)) {
+        return EdgeMask::encode(image, extension);
+    }
+    if (extension == ".png" && PngEncoder::canEncode(image)) {
+        // OpenCV's defaults: level 1 with Z_RLE, or the default strategy once a level is given
+        int level = options.pngLevel >= 0 ? options.pngLevel : 1;
+        int strategy = options.pngStrategy >= 0 ? options.pngStrategy
+                       : options.pngLevel >= 0 ? cv::IMWRITE_PNG_STRATEGY_DEFAULT : cv::IMWRITE_PNG_STRATEGY_RLE;
+        return PngEncoder::encode(image, level, strategy);
+    }
+    std::vector<uint8_t> encoded;
+    if (!cv::imencode(extension, image, encoded, options.params(extension))) {
+        throw std::runtime_error("Could not encode the image as " + extension);
+    }
+    return encoded;
+}
+
 void ImageUtils::writeImage(const cv::Mat& image, const std::string& outputName) {
+    std::string extension = extensionOf(outputName);
+    if (EdgeMask::isMaskFormat(extension)) {
+        writeFile(EdgeMask::encode(image, extension), outputName);
+        return;
+    }
     cv::imwrite(outputName, image);
-}
\ No newline at end of file
+}
+
+void ImageUtils::writeFile(const std::vector<uint8_t>& data, const std::string& outputName) {
+    std::ofstream file(outputName, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        throw std::runtime_error("Could not write the image: " + outputName);
+    }
+}
+
+std::string ImageUtils::extensionOf(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return "";
+    }
+    std::string extension = path.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+cv::Mat ImageUtils::toGrayscale(const cv::Mat& image) {
+    if (image.empty()) {
+        throw std::runtime_error("Input image is empty");
+    }
+    if (image.channels() == 1) {
+        return image;
+    }
+    cv::Mat grayImage;
+    cv::cvtColor(image, grayImage, image.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    return grayImage;
+}
+
+cv::Mat ImageUtils::toColor(const cv::Mat& image) {
+    if (image.empty()) {
+        throw std::runtime_error("Input image is empty");
+    }
+    if (image.channels() == 3) {
+        return image;
+    }
+    cv::Mat colorImage;
+    cv::cvtColor(image, colorImage, image.channels() == 4 ? cv::COLOR_BGRA2BGR : cv::COLOR_GRAY2BGR);
+    return colorImage;
+}
@@ -0,0 +1,162 @@
+#include "utils/png_encoder.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+using namespace std;
+
+namespace {
+    const size_t windowBytes = 32 * 1024;
+    const size_t idatHeaderBytes = 2; // the zlib header ahead of the first band
+    const size_t adlerBytes = 4;      // the zlib trailer after the last band
+
+    void appendBigEndian(vector<uint8_t>& out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    // Appends a chunk whose data is the concatenation of the given parts.
+    void appendChunk(vector<uint8_t>& out, const char* type, initializer_list<pair<const uint8_t*, size_t>> parts) {
+        size_t length = 0;
+        for (const auto& part : parts) {
+            length += part.second;
+        }
+        appendBigEndian(out, static_cast<uint32_t>(length));
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        for (const auto& part : parts) {
+            out.insert(out.end(), part.first, part.first + part.second);
+        }
+        appendBigEndian(out, static_cast<uint32_t>(crc32(0, out.data() + start, static_cast<uInt>(out.size() - start))));
+    }
+
+    // Writes one row in PNG channel order (RGB rather than BGR) with the Up filter.
+    void filterRow(const cv::Mat& image, int row, uint8_t* out) {
+        const int channels = image.channels();
+        const size_t rowBytes = static_cast<size_t>(image.cols) * channels;
+        const uint8_t* current = image.ptr<uint8_t>(row);
+        const uint8_t* previous = row > 0 ? image.ptr<uint8_t>(row - 1) : nullptr;
+        out[0] = 2;
+        uint8_t* filtered = out + 1;
+
+        if (channels == 1) {
+            for (size_t i = 0; i < rowBytes; ++i) {
+                filtered[i] = static_cast<uint8_t>(current[i] - (previous ? previous[i] : 0));
+            }
+            return;
+        }
+        for (size_t i = 0; i < rowBytes; i += channels) {
+            for (int c = 0; c < channels; ++c) {
+                // BGR(A) to RGB(A): swap the first and third channel
+                size_t source = i + (c == 0 ? 2 : c == 2 ? 0 : c);
+                filtered[i + c] = static_cast<uint8_t>(current[source] - (previous ? previous[source] : 0));
+            }
+        }
+    }
+
+    // Deflates one band as raw deflate, primed with the data before it, ending on a byte boundary.
+    vector<uint8_t> deflateBand(const uint8_t* data, size_t size, const uint8_t* dictionary, size_t dictionarySize,
+                                bool last, int level, int strategy) {
+        z_stream stream{};
+        if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, strategy) != Z_OK) {
+            throw runtime_error("Could not initialize the PNG deflate stream");
+        }
+        if (dictionarySize > 0) {
+            deflateSetDictionary(&stream, dictionary, static_cast<uInt>(dictionarySize));
+        }
+
+        // the bound covers a finished stream, a sync flush adds at most an empty stored block
+        vector<uint8_t> out(deflateBound(&stream, static_cast<uLong>(size)) + 16);
+        stream.next_in = const_cast<Bytef*>(data);
+        stream.avail_in = static_cast<uInt>(size);
+        stream.next_out = out.data();
+        stream.avail_out = static_cast<uInt>(out.size());
+        int status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+        out.resize(out.size() - stream.avail_out);
+        deflateEnd(&stream);
+
+        if ((last && status != Z_STREAM_END) || (!last && (status != Z_OK || stream.avail_in != 0))) {
+            throw runtime_error("Could not deflate a PNG band");
+        }
+        return out;
+    }
+}
+
+bool PngEncoder::canEncode(const cv::Mat& image) {
+    return !image.empty() && image.depth() == CV_8U
+           && (image.channels() == 1 || image.channels() == 3 || image.channels() == 4);
+}
+
+vector<uint8_t> PngEncoder::encode(const cv::Mat& image, int level, int strategy) {
+    if (!canEncode(image)) {
+        throw runtime_error("PNG encoding needs an 8-bit image with 1, 3 or 4 channels");
+    }
+    if (level < 0 || level > 9) {
+        throw runtime_error("Invalid PNG compression level: " + to_string(level));
+    }
+
+    const size_t stride = static_cast<size_t>(image.cols) * image.channels() + 1;
+    const int rows = image.rows;
+    const int bandRows = static_cast<int>(max<size_t>(1, bandBytes / stride));
+    const int bands = (rows + bandRows - 1) / bandRows;
+
+    vector<uint8_t> filtered(stride * rows);
+#pragma omp parallel for schedule(static)
+    for (int row = 0; row < rows; ++row) {
+        filterRow(image, row, filtered.data() + stride * row);
+    }
+
+    vector<vector<uint8_t>> deflated(bands);
+    vector<uLong> checksums(bands);
+    // the compression time varies with the content of each band
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int band = 0; band < bands; ++band) {
+        size_t begin = stride * band * bandRows;
+        size_t end = min(filtered.size(), begin + stride * bandRows);
+        size_t dictionarySize = min(begin, windowBytes);
+        deflated[band] = deflateBand(filtered.data() + begin, end - begin, filtered.data() + begin - dictionarySize,
+                                     dictionarySize, band == bands - 1, level, strategy);
+        checksums[band] = adler32(adler32(0, nullptr, 0), filtered.data() + begin, static_cast<uInt>(end - begin));
+    }
+
+    uLong checksum = checksums[0];
+    for (int band = 1; band < bands; ++band) {
+        size_t begin = stride * band * bandRows;
+        size_t length = min(filtered.size(), begin + stride * bandRows) - begin;
+        checksum = adler32_combine(checksum, checksums[band], static_cast<z_off_t>(length));
+    }
+
+    vector<uint8_t> out;
+    size_t compressed = idatHeaderBytes + adlerBytes;
+    for (const auto& band : deflated) {
+        compressed += band.size() + 12;
+    }
+    out.reserve(8 + 25 + compressed + 12);
+
+    const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    out.insert(out.end(), signature, signature + sizeof(signature));
+
+    vector<uint8_t> header;
+    appendBigEndian(header, static_cast<uint32_t>(image.cols));
+    appendBigEndian(header, static_cast<uint32_t>(rows));
+    const uint8_t colorType = image.channels() == 1 ? 0 : image.channels() == 3 ? 2 : 6;
+    header.insert(header.end(), {8, colorType, 0, 0, 0});
+    appendChunk(out, "IHDR", {{header.data(), header.size()}});
+
+    // zlib header with the FLEVEL hint for the level, the check bits make it a multiple of 31
+    const uint8_t levelFlags[] = {0x01, 0x01, 0x5e, 0x5e, 0x5e, 0x5e, 0x9c, 0xda, 0xda, 0xda};
+    const uint8_t zlibHeader[] = {0x78, levelFlags[level]};
+    vector<uint8_t> trailer;
+    appendBigEndian(trailer, static_cast<uint32_t>(checksum));
+    for (int band = 0; band < bands; ++band) {
+        bool first = band == 0;
+        bool last = band == bands - 1;
+        appendChunk(out, "IDAT", {{zlibHeader, first ? idatHeaderBytes : 0},
+                                  {deflated[band].data(), deflated[band].size()},
+                                  {trailer.data(), last ? adlerBytes : 0}});
+    }
+    appendChunk(out, "IEND", {});
+    return out;
+}
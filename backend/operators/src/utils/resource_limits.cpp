@@ -0,0 +1,56 @@
+#include "utils/resource_limits.h"
+using namespace std;
+
+namespace {
+    uint64_t parseCount(const string& flag, const string& value) {
+        size_t end = 0;
+        unsigned long long number = 0;
+        try {
+            number = stoull(value, &end);
+        } catch (const exception&) {
+            end = 0;
+        }
+        if (end == 0 || end != value.size() || number == 0 || value[0] == '-') {
+            throw runtime_error("Invalid value for " + flag + ": " + value);
+        }
+        return number;
+    }
+}
+
+bool ResourceLimits::parseFlag(const string& arg) {
+    size_t separator = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || separator == string::npos) {
+        return false;
+    }
+
+    string flag = arg.substr(0, separator);
+    string value = arg.substr(separator + 1);
+
+    if (flag == "--max-memory") {
+        maxBytes = static_cast<size_t>(parseCount(flag, value)) << 20;
+    } else if (flag == "--max-pixels") {
+        maxPixels = parseCount(flag, value);
+    } else if (flag == "--oversize") {
+        if (value == "reject") {
+            oversize = OversizePolicy::Reject;
+        } else if (value == "downscale") {
+            oversize = OversizePolicy::Downscale;
+        } else {
+            throw runtime_error("Invalid value for --oversize: " + value);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool ResourceLimits::isLimited() const {
+    return maxBytes > 0 || maxPixels > 0;
+}
+
+bool ResourceLimits::fits(cv::Size imageSize, const ResourceEstimate& estimate) const {
+    if (maxBytes > 0 && estimate.peakBytes > maxBytes) {
+        return false;
+    }
+    return maxPixels == 0 || static_cast<uint64_t>(imageSize.width) * imageSize.height <= maxPixels;
+}
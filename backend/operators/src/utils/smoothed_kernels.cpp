@@ -0,0 +1,44 @@
+#include "utils/smoothed_kernels.h"
+#include <opencv2/imgproc.hpp>
+#include <cmath>
+using namespace std;
+using namespace cv;
+
+Mat SmoothedKernels::gaussian(double sigma) {
+    int size = 2 * static_cast<int>(ceil(3 * sigma)) + 1;
+    return getGaussianKernel(size, sigma, CV_32F);
+}
+
+Mat SmoothedKernels::convolve(const Mat& first, const Mat& second) {
+    Mat a;
+    Mat b;
+    first.reshape(1, static_cast<int>(first.total())).convertTo(a, CV_32F);
+    second.reshape(1, static_cast<int>(second.total())).convertTo(b, CV_32F);
+
+    Mat result = Mat::zeros(a.rows + b.rows - 1, 1, CV_32F);
+    const auto* x = a.ptr<float>();
+    const auto* y = b.ptr<float>();
+    auto* z = result.ptr<float>();
+    for (int i = 0; i < a.rows; ++i) {
+        for (int j = 0; j < b.rows; ++j) {
+            z[i + j] += x[i] * y[j];
+        }
+    }
+    return result;
+}
+
+SeparableKernel SmoothedKernels::derivative(const Mat& difference, const Mat& smoothing, double sigma, bool horizontal) {
+    Mat gauss = gaussian(sigma);
+    Mat smoothedDifference = convolve(gauss, difference);
+    Mat smoothedSmoothing = convolve(gauss, smoothing);
+    return horizontal ? SeparableKernel{smoothedDifference, smoothedSmoothing}
+                      : SeparableKernel{smoothedSmoothing, smoothedDifference};
+}
+
+int SmoothedKernels::radius(const SeparableKernel& kernel) {
+    return static_cast<int>(max(kernel.rowKernel.total(), kernel.columnKernel.total()) / 2);
+}
+
+int SmoothedKernels::derivativeRadius(double sigma) {
+    return 1 + (sigma > 0 ? static_cast<int>(ceil(3 * sigma)) : 0);
+}
@@ -0,0 +1,194 @@
+#include "utils/thread_affinity.h"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#ifdef __linux__
+#include <sched.h>
+#endif
+using namespace std;
+
+namespace {
+    // how long OpenCV stripes wait for the rest of the pool before pinning without them
+    const chrono::milliseconds workerRendezvousTimeout(50);
+
+    struct CpuTopology {
+        int cpu;
+        int package;
+        int core;
+    };
+
+    vector<int> queryAllowedCpus() {
+        vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+        return cpus;
+    }
+
+    int readTopology(int cpu, const string& name, int fallback) {
+        ifstream file("/sys/devices/system/cpu/cpu" + to_string(cpu) + "/topology/" + name);
+        int value = fallback;
+        if (!(file >> value)) {
+            value = fallback;
+        }
+        return value;
+    }
+
+    vector<CpuTopology> queryTopology(const vector<int>& cpus) {
+        vector<CpuTopology> topology;
+        for (int cpu : cpus) {
+            // without sysfs every CPU counts as its own core
+            topology.push_back({cpu, readTopology(cpu, "physical_package_id", 0),
+                                readTopology(cpu, "core_id", cpu)});
+        }
+        return topology;
+    }
+
+#ifdef __linux__
+    bool applyCpus(const vector<int>& cpus) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        return CPU_COUNT(&set) > 0 && sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+#endif
+}
+
+vector<int> ThreadAffinity::allowedCpus() {
+    // captured once: after the first pinning the calling thread only sees its own CPU
+    static const vector<int> cpus = queryAllowedCpus();
+    return cpus;
+}
+
+vector<int> ThreadAffinity::orderCpus(PinPolicy policy) {
+    vector<CpuTopology> topology = queryTopology(allowedCpus());
+
+    if (policy == PinPolicy::Scatter) {
+        // rank each CPU among the hyperthreads of its core and each core within its package
+        map<pair<int, int>, int> siblings;
+        map<int, map<int, int>> coreRanks;
+        vector<tuple<int, int, int, int>> keys;
+        for (const auto& entry : topology) {
+            auto& ranks = coreRanks[entry.package];
+            ranks.emplace(entry.core, static_cast<int>(ranks.size()));
+        }
+        for (const auto& entry : topology) {
+            int sibling = siblings[{entry.package, entry.core}]++;
+            keys.emplace_back(sibling, coreRanks[entry.package][entry.core], entry.package, entry.cpu);
+        }
+        sort(keys.begin(), keys.end());
+
+        vector<int> order;
+        for (const auto& key : keys) {
+            order.push_back(get<3>(key));
+        }
+        return order;
+    }
+
+    sort(topology.begin(), topology.end(), [](const CpuTopology& a, const CpuTopology& b) {
+        return tie(a.package, a.core, a.cpu) < tie(b.package, b.core, b.cpu);
+    });
+    vector<int> order;
+    for (const auto& entry : topology) {
+        order.push_back(entry.cpu);
+    }
+    return order;
+}
+
+vector<int> ThreadAffinity::planCpus(const ExecutionConfig& config, int numThreads) {
+    vector<int> plan;
+    if (config.pinning == PinPolicy::None || numThreads <= 0 || allowedCpus().empty()) {
+        return plan;
+    }
+
+    vector<int> cpus;
+    if (config.pinning == PinPolicy::List && !config.cpuList.empty()) {
+        vector<int> allowed = allowedCpus();
+        for (int cpu : config.cpuList) {
+            if (binary_search(allowed.begin(), allowed.end(), cpu)) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (cpus.empty()) {
+            throw runtime_error("None of the CPUs in --cpus are available to this process");
+        }
+    } else {
+        cpus = orderCpus(config.pinning == PinPolicy::Scatter ? PinPolicy::Scatter : PinPolicy::Compact);
+    }
+
+    int count = static_cast<int>(cpus.size());
+    for (int thread = 0; thread < numThreads; ++thread) {
+        plan.push_back(cpus[thread % count]);
+    }
+    return plan;
+}
+
+bool ThreadAffinity::pinCurrentThread(int cpu) {
+#ifdef __linux__
+    return applyCpus({cpu});
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+void ThreadAffinity::resetCurrentThread() {
+#ifdef __linux__
+    vector<int> allowed = allowedCpus();
+    if (!allowed.empty()) {
+        applyCpus(allowed);
+    }
+#endif
+}
+
+int ThreadAffinity::pinOpenCVWorkers(const ExecutionConfig& config) {
+    int numThreads = max(1, cv::getNumThreads());
+    vector<int> plan = planCpus(config, numThreads);
+    if (plan.empty()) {
+        return 0;
+    }
+
+    mutex lock;
+    condition_variable arrived;
+    int waiting = 0;
+    atomic<int> pinned(0);
+    const thread::id caller = this_thread::get_id();
+
+    cv::parallel_for_(cv::Range(0, numThreads), [&](const cv::Range& range) {
+        // the calling thread runs a stripe too but stays unpinned: every thread it creates later
+        // (the OpenMP team, pipeline stages, pyramid writers) would inherit its single CPU
+        for (int stripe = range.start; stripe < range.end && this_thread::get_id() != caller; ++stripe) {
+            if (pinCurrentThread(plan[stripe])) {
+                ++pinned;
+            }
+        }
+
+        // hold this thread until every stripe has started, so no thread takes two stripes
+        unique_lock<mutex> guard(lock);
+        waiting += range.end - range.start;
+        arrived.notify_all();
+        arrived.wait_for(guard, workerRendezvousTimeout, [&] { return waiting >= numThreads; });
+    }, numThreads);
+
+    return pinned.load();
+}
@@ -0,0 +1,245 @@
+#include "utils/tile_pyramid.h"
+#include "utils/image_utils.h"
+#include <omp.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+using namespace std;
+
+namespace {
+    void replaceAll(string& text, const string& token, const string& value) {
+        for (size_t position = text.find(token); position != string::npos; position = text.find(token, position)) {
+            text.replace(position, token.size(), value);
+            position += value.size();
+        }
+    }
+}
+
+bool TilePyramid::isPyramidPath(const string& path) {
+    if (ImageUtils::extensionOf(path) == ".dzi") {
+        return true;
+    }
+    return path.find("{z}") != string::npos && path.find("{x}") != string::npos && path.find("{y}") != string::npos;
+}
+
+TilePyramid::TilePyramid(const string& path, cv::Size mapSize, const EncodeOptions& options, int writerThreads)
+        : dzi(ImageUtils::extensionOf(path) == ".dzi"), path(path), options(options) {
+    if (!isPyramidPath(path)) {
+        throw runtime_error("Not a pyramid path: " + path + ", expected a .dzi path or a {z}/{x}/{y} template");
+    }
+    if (mapSize.empty()) {
+        throw runtime_error("A pyramid needs a nonempty edge map");
+    }
+    tileExtension = dzi ? ".png" : ImageUtils::extensionOf(path);
+    if (tileExtension.empty()) {
+        throw runtime_error("The tile template has no extension: " + path);
+    }
+
+    // Deep Zoom halves down to a single pixel, XYZ down to the level that fits one tile
+    const int smallest = dzi ? 1 : tileSize;
+    cv::Size size = mapSize;
+    levels.push_back(Level());
+    levels.back().size = size;
+    while (max(size.width, size.height) > smallest) {
+        size = cv::Size((size.width + 1) / 2, (size.height + 1) / 2);
+        levels.push_back(Level());
+        levels.back().size = size;
+    }
+    for (Level& level : levels) {
+        level.pending.create(min(tileSize, level.size.height), level.size.width, CV_8UC1);
+    }
+
+    if (writerThreads <= 0) {
+        writerThreads = static_cast<int>(min(8u, max(1u, thread::hardware_concurrency() / 2)));
+    }
+    for (int i = 0; i < writerThreads; ++i) {
+        queues.push_back(make_unique<SpscQueue<TileJob>>(16));
+    }
+    for (int i = 0; i < writerThreads; ++i) {
+        SpscQueue<TileJob>& queue = *queues[i];
+        writers.emplace_back([this, &queue]() { writeTiles(queue); });
+    }
+}
+
+TilePyramid::~TilePyramid() {
+    stopWriters();
+}
+
+string TilePyramid::tilePath(int level, int column, int row) const {
+    if (dzi) {
+        string base = path.substr(0, path.size() - 4);
+        return base + "_files/" + to_string(level) + "/" + to_string(column) + "_" + to_string(row) + tileExtension;
+    }
+    string tile = path;
+    replaceAll(tile, "{z}", to_string(level));
+    replaceAll(tile, "{x}", to_string(column));
+    replaceAll(tile, "{y}", to_string(row));
+    return tile;
+}
+
+void TilePyramid::addRows(const cv::Mat& rows) {
+    if (rows.type() != CV_8UC1 || rows.cols != levels[0].size.width
+        || levels[0].rowsAdded + rows.rows > levels[0].size.height) {
+        throw runtime_error("The rows do not fit the pyramid's edge map");
+    }
+    feed(0, rows);
+}
+
+void TilePyramid::feed(size_t step, const cv::Mat& rows) {
+    Level& level = levels[step];
+    for (int i = 0; i < rows.rows;) {
+        int count = min(tileSize - level.pendingRows, rows.rows - i);
+        rows.rowRange(i, i + count).copyTo(level.pending.rowRange(level.pendingRows, level.pendingRows + count));
+        level.pendingRows += count;
+        i += count;
+        if (level.pendingRows == tileSize) {
+            emitTileRow(step);
+        }
+    }
+    level.rowsAdded += rows.rows;
+    if (step + 1 == levels.size()) {
+        return;
+    }
+
+    // pairs of rows go down a level, an odd last row waits for the first row of the next band
+    cv::Mat source = rows;
+    if (!level.carry.empty()) {
+        cv::vconcat(level.carry, rows, source);
+        level.carry.release();
+    }
+    int paired = source.rows / 2 * 2;
+    if (paired < source.rows) {
+        level.carry = source.row(paired).clone();
+    }
+    if (paired > 0) {
+        feed(step + 1, downsample(source.rowRange(0, paired)));
+    }
+}
+
+cv::Mat TilePyramid::downsample(const cv::Mat& rows) {
+    cv::Mat half((rows.rows + 1) / 2, (rows.cols + 1) / 2, CV_8UC1);
+    const int lastColumn = rows.cols - 1;
+
+#pragma omp parallel for schedule(static)
+    for (int y = 0; y < half.rows; ++y) {
+        const uint8_t* top = rows.ptr<uint8_t>(2 * y);
+        const uint8_t* bottom = rows.ptr<uint8_t>(min(2 * y + 1, rows.rows - 1));
+        uint8_t* out = half.ptr<uint8_t>(y);
+        for (int x = 0; x < half.cols; ++x) {
+            int left = 2 * x;
+            int right = min(left + 1, lastColumn);
+            out[x] = max(max(top[left], top[right]), max(bottom[left], bottom[right]));
+        }
+    }
+    return half;
+}
+
+void TilePyramid::emitTileRow(size_t step) {
+    {
+        lock_guard<mutex> lock(failureMutex);
+        if (!failure.empty()) {
+            throw runtime_error(failure);
+        }
+    }
+
+    Level& level = levels[step];
+    const int number = static_cast<int>(levels.size() - 1 - step);
+    for (int column = 0; column * tileSize < level.size.width; ++column) {
+        cv::Rect area(column * tileSize, 0, min(tileSize, level.size.width - column * tileSize), level.pendingRows);
+        TileJob job;
+        if (dzi) {
+            job.tile = level.pending(area).clone();
+        } else {
+            // XYZ viewers place every tile on a 256-pixel grid
+            job.tile = cv::Mat::zeros(tileSize, tileSize, CV_8UC1);
+            level.pending(area).copyTo(job.tile(cv::Rect(0, 0, area.width, area.height)));
+        }
+        job.path = tilePath(number, column, level.tileRow);
+
+        string directory = filesystem::path(job.path).parent_path().string();
+        if (!directory.empty() && directories.insert(directory).second) {
+            filesystem::create_directories(directory);
+        }
+        queues[nextWriter]->push(move(job));
+        nextWriter = (nextWriter + 1) % queues.size();
+        ++tiles;
+    }
+    level.pendingRows = 0;
+    ++level.tileRow;
+}
+
+PyramidStats TilePyramid::finish() {
+    if (levels[0].rowsAdded != levels[0].size.height) {
+        throw runtime_error("The pyramid got " + to_string(levels[0].rowsAdded) + " of "
+                            + to_string(levels[0].size.height) + " rows");
+    }
+    // each level hands its odd last row down before the level below flushes
+    for (size_t step = 0; step < levels.size(); ++step) {
+        Level& level = levels[step];
+        if (!level.carry.empty()) {
+            cv::Mat carry = level.carry;
+            level.carry.release();
+            feed(step + 1, downsample(carry));
+        }
+        if (level.pendingRows > 0) {
+            emitTileRow(step);
+        }
+    }
+    stopWriters();
+    if (!failure.empty()) {
+        throw runtime_error(failure);
+    }
+
+    if (dzi) {
+        ofstream descriptor(path);
+        descriptor << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\""
+                   << tileExtension.substr(1) << "\" Overlap=\"0\" TileSize=\"" << tileSize << "\">\n"
+                   << "  <Size Width=\"" << levels[0].size.width << "\" Height=\"" << levels[0].size.height << "\"/>\n"
+                   << "</Image>\n";
+        if (!descriptor) {
+            throw runtime_error("Could not write the pyramid descriptor: " + path);
+        }
+    }
+
+    PyramidStats stats;
+    stats.levels = levelCount();
+    stats.tiles = tiles;
+    return stats;
+}
+
+void TilePyramid::writeTiles(SpscQueue<TileJob>& queue) {
+    // a tile is one PNG band, so the writers encode on their own thread instead of forking teams
+    omp_set_num_threads(1);
+    TileJob job;
+    while (queue.pop(job)) {
+        {
+            lock_guard<mutex> lock(failureMutex);
+            if (!failure.empty()) {
+                continue;
+            }
+        }
+        try {
+            ImageUtils::writeFile(ImageUtils::encodeImage(job.tile, tileExtension, options), job.path);
+        } catch (const exception& e) {
+            lock_guard<mutex> lock(failureMutex);
+            if (failure.empty()) {
+                failure = e.what();
+            }
+        }
+    }
+}
+
+void TilePyramid::stopWriters() {
+    if (writers.empty()) {
+        return;
+    }
+    for (auto& queue : queues) {
+        queue->close();
+    }
+    for (thread& writer : writers) {
+        writer.join();
+    }
+    writers.clear();
+}
@@ -0,0 +1,213 @@
+#include "utils/tile_scheduler.h"
+#include "utils/thread_affinity.h"
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+using namespace std;
+using namespace cv;
+
+namespace {
+    const size_t fallbackL2CacheSize = 256 * 1024;
+    const int tileAlignment = 16;
+    const int minTileSide = 32;
+
+    // A thread's share of the tiles. The owner pops from the front so it walks its band in
+    // order; thieves take from the back so they land as far from the owner as possible.
+    struct TileDeque {
+        mutex lock;
+        deque<int> tiles;
+
+        bool popFront(int& index) {
+            lock_guard<mutex> guard(lock);
+            if (tiles.empty()) {
+                return false;
+            }
+            index = tiles.front();
+            tiles.pop_front();
+            return true;
+        }
+
+        bool popBack(int& index) {
+            lock_guard<mutex> guard(lock);
+            if (tiles.empty()) {
+                return false;
+            }
+            index = tiles.back();
+            tiles.pop_back();
+            return true;
+        }
+    };
+
+    bool steal(vector<TileDeque>& deques, int self, int& index) {
+        int count = static_cast<int>(deques.size());
+        for (int k = 1; k < count; ++k) {
+            if (deques[(self + k) % count].popBack(index)) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+TileScheduler::TileScheduler(const ExecutionConfig& config, size_t bytesPerPixel) : config(config) {
+    if (this->config.tileSize.empty()) {
+        this->config.tileSize = defaultTileSize(bytesPerPixel);
+    }
+    this->config.numThreads = max(0, this->config.numThreads);
+    this->config.chunkSize = max(1, this->config.chunkSize);
+}
+
+TileScheduler::TileScheduler(Size tileSize, size_t bytesPerPixel, int numThreads)
+        : TileScheduler([&] {
+            ExecutionConfig tiled;
+            tiled.tileSize = tileSize;
+            tiled.numThreads = numThreads;
+            return tiled;
+        }(), bytesPerPixel) {}
+
+size_t TileScheduler::l2CacheSize() {
+    long size = 0;
+#if defined(__APPLE__)
+    size_t length = sizeof(size);
+    if (sysctlbyname("hw.l2cachesize", &size, &length, nullptr, 0) != 0) {
+        size = 0;
+    }
+#elif defined(_SC_LEVEL2_CACHE_SIZE)
+    size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    return size > 0 ? static_cast<size_t>(size) : fallbackL2CacheSize;
+}
+
+Size TileScheduler::defaultTileSize(size_t bytesPerPixel) {
+    // half of L2 leaves room for the halo rows, the stack and the other hyperthread
+    size_t budget = l2CacheSize() / 2;
+    int side = static_cast<int>(sqrt(static_cast<double>(budget) / max<size_t>(bytesPerPixel, 1)));
+    side = max(minTileSide, side / tileAlignment * tileAlignment);
+    return {side, side};
+}
+
+vector<Rect> TileScheduler::makeTiles(Size imageSize) const {
+    vector<Rect> tiles;
+    if (imageSize.width <= 0 || imageSize.height <= 0) {
+        return tiles;
+    }
+
+    if (config.schedule != ScheduleKind::Tiled) {
+        for (int y = 0; y < imageSize.height; y += config.chunkSize) {
+            tiles.emplace_back(0, y, imageSize.width, min(config.chunkSize, imageSize.height - y));
+        }
+        return tiles;
+    }
+
+    const Size& tileSize = config.tileSize;
+    for (int y = 0; y < imageSize.height; y += tileSize.height) {
+        for (int x = 0; x < imageSize.width; x += tileSize.width) {
+            tiles.emplace_back(x, y,
+                               min(tileSize.width, imageSize.width - x),
+                               min(tileSize.height, imageSize.height - y));
+        }
+    }
+
+    return tiles;
+}
+
+void TileScheduler::run(Size imageSize, const function<void(const Rect&)>& work,
+                        const CancellationToken* cancellation) const {
+    vector<Rect> tiles = makeTiles(imageSize);
+    if (tiles.empty()) {
+        return;
+    }
+
+    int tileCount = static_cast<int>(tiles.size());
+    int threadCount = min(config.numThreads > 0 ? config.numThreads : omp_get_max_threads(), tileCount);
+    bool stealing = config.schedule == ScheduleKind::Tiled;
+    vector<int> cpus = ThreadAffinity::planCpus(config, threadCount);
+
+    // contiguous bands keep vertically adjacent tiles, which share halo rows, on one core
+    vector<TileDeque> deques(stealing ? threadCount : 0);
+    for (int t = 0; t < static_cast<int>(deques.size()); ++t) {
+        int begin = static_cast<int>(static_cast<long>(tileCount) * t / threadCount);
+        int end = static_cast<int>(static_cast<long>(tileCount) * (t + 1) / threadCount);
+        for (int index = begin; index < end; ++index) {
+            deques[t].tiles.push_back(index);
+        }
+    }
+    bool dynamic = config.schedule == ScheduleKind::Dynamic;
+
+    atomic<bool> failed(false);
+    exception_ptr error;
+    mutex errorLock;
+
+    auto runTile = [&](int index) {
+        if (failed.load(memory_order_relaxed)) {
+            return;
+        }
+        try {
+            if (cancellation) {
+                cancellation->throwIfCancelled();
+            }
+            work(tiles[index]);
+        } catch (...) {
+            lock_guard<mutex> guard(errorLock);
+            if (!error) {
+                error = current_exception();
+            }
+            failed.store(true, memory_order_relaxed);
+        }
+    };
+
+#pragma omp parallel num_threads(threadCount) default(none) shared(tiles, tileCount, deques, cpus, stealing, dynamic, failed, runTile)
+    {
+        int self = omp_get_thread_num();
+        if (!cpus.empty()) {
+            ThreadAffinity::pinCurrentThread(cpus[self]);
+        }
+
+        if (stealing) {
+            int index;
+            while (!failed.load(memory_order_relaxed) &&
+                   (deques[self].popFront(index) || steal(deques, self, index))) {
+                runTile(index);
+            }
+        } else if (dynamic) {
+            // explicit schedules rather than schedule(runtime), whose setting would outlive the call
+#pragma omp for schedule(dynamic, 1)
+            for (int index = 0; index < tileCount; ++index) {
+                runTile(index);
+            }
+        } else {
+#pragma omp for schedule(static, 1)
+            for (int index = 0; index < tileCount; ++index) {
+                runTile(index);
+            }
+        }
+
+        if (!cpus.empty()) {
+            ThreadAffinity::resetCurrentThread();
+        }
+    }
+
+    if (error) {
+        rethrow_exception(error);
+    }
+}
+
+Size TileScheduler::getTileSize() const {
+    return config.tileSize;
+}
+
+int TileScheduler::getNumThreads() const {
+    return config.numThreads;
+}
+
+const ExecutionConfig& TileScheduler::getExecutionConfig() const {
+    return config;
+}
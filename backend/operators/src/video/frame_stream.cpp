@@ -0,0 +1,338 @@
+#include "video/frame_stream.h"
+#include <opencv2/imgproc.hpp>
+#include <cmath>
+#include <sstream>
+using namespace std;
+
+namespace {
+    const string y4mMagic = "YUV4MPEG2";
+
+    // Reads a header or frame line up to its newline, without the newline.
+    bool readLine(FILE* file, string& line, size_t limit) {
+        line.clear();
+        int c;
+        while ((c = fgetc(file)) != EOF && c != '\n') {
+            if (line.size() == limit) {
+                throw runtime_error("Malformed Y4M stream: line too long");
+            }
+            line += static_cast<char>(c);
+        }
+        return c == '\n' || !line.empty();
+    }
+
+    int parsePositive(const string& value, const string& name) {
+        size_t end = 0;
+        int number = 0;
+        try {
+            number = stoi(value, &end);
+        } catch (const exception&) {
+            end = 0;
+        }
+        if (end == 0 || end != value.size() || number <= 0) {
+            throw runtime_error("Malformed Y4M header: invalid " + name + " " + value);
+        }
+        return number;
+    }
+
+    // cv::VideoCapture frames, converted to gray for grayscale operators.
+    class CaptureSource : public FrameSource {
+    public:
+        CaptureSource(const string& path, cv::ImreadModes mode) : capture(path), mode(mode) {
+            if (!capture.isOpened()) {
+                throw runtime_error("Could not open the video: " + path);
+            }
+            frameRate = FrameRate::fromFps(capture.get(cv::CAP_PROP_FPS));
+        }
+
+        bool read(cv::Mat& frame) override {
+            if (mode != cv::IMREAD_GRAYSCALE) {
+                return capture.read(frame);
+            }
+            if (!capture.read(decoded)) {
+                return false;
+            }
+            cv::cvtColor(decoded, frame, cv::COLOR_BGR2GRAY);
+            return true;
+        }
+
+        [[nodiscard]] FrameRate rate() const override {
+            return frameRate;
+        }
+
+    private:
+        cv::VideoCapture capture;
+        cv::ImreadModes mode;
+        FrameRate frameRate;
+        cv::Mat decoded;
+    };
+}
+
+FrameRate FrameRate::fromFps(double fps) {
+    if (!(fps > 0) || fps > 1000) {
+        return FrameRate();
+    }
+    long whole = lround(fps);
+    if (abs(fps - static_cast<double>(whole)) < 1e-3) {
+        return {static_cast<int>(whole), 1};
+    }
+    long ntsc = lround(fps * 1.001);
+    if (abs(fps - ntsc / 1.001) < 1e-3) {
+        return {static_cast<int>(ntsc * 1000), 1001};
+    }
+    return {static_cast<int>(lround(fps * 1000)), 1000};
+}
+
+unique_ptr<FrameSource> FrameSource::open(const string& path, cv::ImreadModes mode) {
+    if (path == "-") {
+        return make_unique<Y4mReader>(stdin, mode);
+    }
+    if (ImageUtils::extensionOf(path) == ".y4m") {
+        return make_unique<Y4mReader>(path, mode);
+    }
+    return make_unique<CaptureSource>(path, mode);
+}
+
+unique_ptr<FrameSink> FrameSink::open(const string& path, FrameRate rate, GradientOperator& gradientOperator) {
+    if (path == "-") {
+        return make_unique<Y4mWriter>(stdout, rate);
+    }
+    if (path.find('%') != string::npos) {
+        return make_unique<FrameSequenceWriter>(path, gradientOperator);
+    }
+    if (ImageUtils::extensionOf(path) == ".y4m") {
+        return make_unique<Y4mWriter>(path, rate);
+    }
+    return make_unique<VideoFileWriter>(path, rate);
+}
+
+Y4mReader::Y4mReader(const string& path, cv::ImreadModes mode)
+        : file(fopen(path.c_str(), "rb")), owned(true), mode(mode) {
+    if (file == nullptr) {
+        throw runtime_error("Could not open the video: " + path);
+    }
+    try {
+        readHeader();
+    } catch (...) {
+        fclose(file);
+        throw;
+    }
+}
+
+Y4mReader::Y4mReader(FILE* input, cv::ImreadModes mode) : file(input), owned(false), mode(mode) {
+    readHeader();
+}
+
+Y4mReader::~Y4mReader() {
+    if (owned) {
+        fclose(file);
+    }
+}
+
+void Y4mReader::readHeader() {
+    string line;
+    if (!readLine(file, line, 1024) || line.rfind(y4mMagic + " ", 0) != 0) {
+        throw runtime_error("Not a Y4M stream");
+    }
+
+    istringstream parameters(line.substr(y4mMagic.size()));
+    string parameter;
+    while (parameters >> parameter) {
+        string value = parameter.substr(1);
+        switch (parameter[0]) {
+            case 'W':
+                frameSize.width = parsePositive(value, "width");
+                break;
+            case 'H':
+                frameSize.height = parsePositive(value, "height");
+                break;
+            case 'F': {
+                size_t colon = value.find(':');
+                if (colon == string::npos) {
+                    throw runtime_error("Malformed Y4M header: invalid frame rate " + value);
+                }
+                frameRate.numerator = parsePositive(value.substr(0, colon), "frame rate");
+                frameRate.denominator = parsePositive(value.substr(colon + 1), "frame rate");
+                break;
+            }
+            case 'C':
+                chroma = value;
+                break;
+            default:
+                // interlacing, aspect ratio and extensions do not change the frame layout
+                break;
+        }
+    }
+    if (frameSize.empty()) {
+        throw runtime_error("Malformed Y4M header: no frame size");
+    }
+
+    int halfWidth = (frameSize.width + 1) / 2;
+    int halfHeight = (frameSize.height + 1) / 2;
+    if (chroma == "mono") {
+        chromaSize = cv::Size();
+    } else if (chroma == "420jpeg" || chroma == "420paldv" || chroma == "420mpeg2" || chroma == "420") {
+        chromaSize = cv::Size(halfWidth, halfHeight);
+    } else if (chroma == "422") {
+        chromaSize = cv::Size(halfWidth, frameSize.height);
+    } else if (chroma == "444") {
+        chromaSize = frameSize;
+    } else {
+        throw runtime_error("Unsupported Y4M colorspace: " + chroma + ", expected 8-bit mono, 420, 422 or 444");
+    }
+    if (mode != cv::IMREAD_GRAYSCALE && chroma != "mono" && (frameSize.width % 2 != 0 || frameSize.height % 2 != 0)) {
+        throw runtime_error("Converting Y4M frames to BGR needs even dimensions, got "
+                            + to_string(frameSize.width) + "x" + to_string(frameSize.height));
+    }
+}
+
+void Y4mReader::readExactly(uint8_t* data, size_t size) {
+    if (fread(data, 1, size, file) != size) {
+        throw runtime_error("Truncated Y4M frame");
+    }
+}
+
+bool Y4mReader::read(cv::Mat& frame) {
+    string line;
+    if (!readLine(file, line, 256)) {
+        return false;
+    }
+    if (line.rfind("FRAME", 0) != 0) {
+        throw runtime_error("Malformed Y4M stream: expected FRAME");
+    }
+
+    const size_t lumaBytes = static_cast<size_t>(frameSize.area());
+    const size_t chromaBytes = 2 * static_cast<size_t>(chromaSize.area());
+    if (mode == cv::IMREAD_GRAYSCALE) {
+        // the luma plane is the gray image, the chroma planes are only skipped
+        frame.create(frameSize, CV_8UC1);
+        readExactly(frame.data, lumaBytes);
+        skipped.resize(chromaBytes);
+        if (chromaBytes > 0) {
+            readExactly(skipped.data(), chromaBytes);
+        }
+        return true;
+    }
+
+    if (chroma == "mono") {
+        planes.create(frameSize, CV_8UC1);
+        readExactly(planes.data, lumaBytes);
+        cv::cvtColor(planes, frame, cv::COLOR_GRAY2BGR);
+        return true;
+    }
+
+    // I420 layout: the luma rows followed by the quarter-size U and V planes
+    const cv::Size halfSize(frameSize.width / 2, frameSize.height / 2);
+    planes.create(frameSize.height * 3 / 2, frameSize.width, CV_8UC1);
+    readExactly(planes.data, lumaBytes);
+    if (chromaSize == halfSize) {
+        readExactly(planes.data + lumaBytes, chromaBytes);
+    } else {
+        upsampled.create(chromaSize.height * 2, chromaSize.width, CV_8UC1);
+        readExactly(upsampled.data, chromaBytes);
+        for (int plane = 0; plane < 2; ++plane) {
+            cv::Mat source = upsampled.rowRange(plane * chromaSize.height, (plane + 1) * chromaSize.height);
+            cv::Mat target(halfSize, CV_8UC1, planes.data + lumaBytes + plane * halfSize.area());
+            cv::resize(source, target, halfSize, 0, 0, cv::INTER_AREA);
+        }
+    }
+    cv::cvtColor(planes, frame, cv::COLOR_YUV2BGR_I420);
+    return true;
+}
+
+Y4mWriter::Y4mWriter(const string& path, FrameRate rate)
+        : file(fopen(path.c_str(), "wb")), owned(true), frameRate(rate) {
+    if (file == nullptr) {
+        throw runtime_error("Could not create the video: " + path);
+    }
+}
+
+Y4mWriter::Y4mWriter(FILE* output, FrameRate rate) : file(output), owned(false), frameRate(rate) {}
+
+Y4mWriter::~Y4mWriter() {
+    if (owned) {
+        fclose(file);
+    }
+}
+
+void Y4mWriter::write(const EdgeResult& result) {
+    writeFrame(result.edges);
+}
+
+void Y4mWriter::writeFrame(const cv::Mat& frame) {
+    if (frame.type() != CV_8UC1) {
+        throw runtime_error("Y4M output needs 8-bit single-channel frames");
+    }
+    if (frameSize.empty()) {
+        frameSize = frame.size();
+        fprintf(file, "%s W%d H%d F%d:%d Ip A1:1 Cmono\n", y4mMagic.c_str(), frameSize.width, frameSize.height,
+                frameRate.numerator, frameRate.denominator);
+    } else if (frame.size() != frameSize) {
+        throw runtime_error("Y4M frames must all have the same size");
+    }
+
+    bool written = fputs("FRAME\n", file) >= 0;
+    for (int i = 0; written && i < frame.rows; ++i) {
+        written = fwrite(frame.ptr(i), 1, frame.cols, file) == static_cast<size_t>(frame.cols);
+    }
+    if (!written) {
+        throw runtime_error("Could not write the Y4M frame");
+    }
+}
+
+void Y4mWriter::close() {
+    if (fflush(file) != 0 || ferror(file)) {
+        throw runtime_error("Could not write the Y4M stream");
+    }
+}
+
+FrameSequenceWriter::FrameSequenceWriter(const string& pattern, GradientOperator& gradientOperator)
+        : pattern(pattern), gradientOperator(gradientOperator) {
+    conversion = pattern.find('%');
+    size_t end = conversion == string::npos ? string::npos : pattern.find_first_not_of("0123456789", conversion + 1);
+    if (end == string::npos || pattern[end] != 'd' || pattern.find('%', end) != string::npos) {
+        throw runtime_error("A frame sequence needs one %d or %0Nd in its path: " + pattern);
+    }
+    length = end + 1 - conversion;
+    string digits = pattern.substr(conversion + 1, end - conversion - 1);
+    width = digits.empty() || digits.size() > 2 ? digits.size() * 10 : stoul(digits);
+    if (width > 12) {
+        throw runtime_error("A frame sequence pads to at most 12 digits: " + pattern);
+    }
+}
+
+string FrameSequenceWriter::pathOf(size_t number) const {
+    string digits = to_string(number);
+    if (digits.size() < width) {
+        digits.insert(0, width - digits.size(), '0');
+    }
+    return pattern.substr(0, conversion) + digits + pattern.substr(conversion + length);
+}
+
+void FrameSequenceWriter::write(const EdgeResult& result) {
+    ImageUtils::writeFile(gradientOperator.encodeResult(result, extension()), pathOf(++frames));
+}
+
+VideoFileWriter::VideoFileWriter(const string& path, FrameRate rate) : path(path), frameRate(rate) {
+    string extension = ImageUtils::extensionOf(path);
+    if (extension == ".avi" || extension == ".mkv") {
+        fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+    } else if (extension == ".mp4" || extension == ".mov" || extension == ".m4v") {
+        fourcc = cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+    } else {
+        throw runtime_error("Unsupported video output: " + path
+                            + ", expected -, .y4m, .avi, .mkv, .mp4, .mov, .m4v or a %d frame sequence");
+    }
+}
+
+void VideoFileWriter::write(const EdgeResult& result) {
+    if (!writer.isOpened()) {
+        if (!writer.open(path, fourcc, frameRate.fps(), result.edges.size(), false)) {
+            throw runtime_error("Could not create the video: " + path);
+        }
+    }
+    writer.write(result.edges);
+}
+
+void VideoFileWriter::close() {
+    writer.release();
+}
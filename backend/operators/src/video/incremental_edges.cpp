@@ -0,0 +1,175 @@
+#include "video/incremental_edges.h"
+#include <cstring>
+#include <stdexcept>
+using namespace std;
+
+namespace {
+    int parseSide(const string& value) {
+        size_t end = 0;
+        int number = 0;
+        try {
+            number = stoi(value, &end);
+        } catch (const exception&) {
+            end = 0;
+        }
+        if (end == 0 || end != value.size() || number < 8 || number > 4096) {
+            throw runtime_error("Invalid value for --incremental: " + value + ", expected tiles of 8 to 4096 pixels");
+        }
+        return number;
+    }
+}
+
+bool IncrementalOptions::parseFlag(const string& arg) {
+    const string incrementalFlag = "--incremental";
+    const string thresholdFlag = "--dirty-threshold=";
+    if (arg == incrementalFlag) {
+        enabled = true;
+        return true;
+    }
+    if (arg.rfind(incrementalFlag + "=", 0) == 0) {
+        string value = arg.substr(incrementalFlag.size() + 1);
+        size_t separator = value.find('x');
+        tileSize = separator == string::npos
+                   ? cv::Size(parseSide(value), parseSide(value))
+                   : cv::Size(parseSide(value.substr(0, separator)), parseSide(value.substr(separator + 1)));
+        enabled = true;
+        return true;
+    }
+    if (arg.rfind(thresholdFlag, 0) != 0) {
+        return false;
+    }
+    string value = arg.substr(thresholdFlag.size());
+    size_t end = 0;
+    double number = 0;
+    try {
+        number = stod(value, &end);
+    } catch (const exception&) {
+        end = 0;
+    }
+    if (end == 0 || end != value.size() || !(number >= 0 && number <= 255)) {
+        throw runtime_error("Invalid value for --dirty-threshold: " + value + ", expected 0 to 255");
+    }
+    threshold = number;
+    return true;
+}
+
+IncrementalEdges::IncrementalEdges(GradientOperator& gradientOperator, const IncrementalOptions& options)
+        : gradientOperator(gradientOperator), options(options), radius(gradientOperator.haloRadius()) {
+    if (options.tileSize.empty() || !(options.threshold >= 0)) {
+        throw runtime_error("Incremental edges need a tile size and a threshold of at least 0");
+    }
+}
+
+void IncrementalEdges::reset() {
+    reference.release();
+    edges.release();
+}
+
+void IncrementalEdges::layoutTiles(cv::Size frameSize) {
+    grid = cv::Size((frameSize.width + options.tileSize.width - 1) / options.tileSize.width,
+                    (frameSize.height + options.tileSize.height - 1) / options.tileSize.height);
+    tiles = static_cast<size_t>(grid.area());
+}
+
+const cv::Mat& IncrementalEdges::detectEdges(const cv::Mat& frame) {
+    layoutTiles(frame.size());
+    if (!isIncremental() || reference.size() != frame.size() || reference.type() != frame.type()) {
+        computeWhole(frame);
+        return edges;
+    }
+
+    // past half the tiles, e.g. on a cut, one parallel pass over the frame beats many small runs
+    dirtyTiles = markDirtyTiles(frame);
+    if (dirtyTiles * 2 > tiles) {
+        computeWhole(frame);
+        return edges;
+    }
+
+    const cv::Rect bounds(0, 0, frame.cols, frame.rows);
+    for (int row = 0; row < grid.height; ++row) {
+        for (int column = 0; column < grid.width; ++column) {
+            if (!dirty[row * grid.width + column]) {
+                continue;
+            }
+            int end = column;
+            while (end + 1 < grid.width && dirty[row * grid.width + end + 1]) {
+                ++end;
+            }
+            cv::Rect run = cv::Rect(column * options.tileSize.width, row * options.tileSize.height,
+                                    (end + 1 - column) * options.tileSize.width, options.tileSize.height) & bounds;
+            cv::Rect region = cv::Rect(run.x - radius, run.y - radius, run.width + 2 * radius,
+                                       run.height + 2 * radius) & bounds;
+
+            cv::Mat regionEdges = gradientOperator.detectEdges(frame(region));
+            regionEdges(run - region.tl()).copyTo(edges(run));
+            frame(run).copyTo(reference(run));
+            column = end;
+        }
+    }
+    return edges;
+}
+
+EdgeResult IncrementalEdges::computeEdges(const cv::Mat& frame, const string& extension) {
+    if (extension == ".npy" || extension == ".pts") {
+        reset();
+        layoutTiles(frame.size());
+        dirtyTiles = tiles;
+        return gradientOperator.computeEdges(frame, extension);
+    }
+
+    // with a region of interest only the region and its halo are tracked
+    cv::Rect input = gradientOperator.inputRegion(frame.size());
+    cv::Rect output = gradientOperator.outputRegion(frame.size());
+    const cv::Mat& magnitude = detectEdges(input.size() == frame.size() ? frame : frame(input));
+    cv::Mat region = output == input ? magnitude : magnitude(output - input.tl());
+
+    EdgeResult result;
+    result.edges = gradientOperator.thresholdEdges(region);
+    // the magnitude is updated in place by the next frame while this one is encoded
+    if (result.edges.datastart == magnitude.datastart) {
+        result.edges = region.clone();
+    }
+    return result;
+}
+
+void IncrementalEdges::computeWhole(const cv::Mat& frame) {
+    edges = gradientOperator.detectEdges(frame);
+    frame.copyTo(reference);
+    dirtyTiles = tiles;
+}
+
+size_t IncrementalEdges::markDirtyTiles(const cv::Mat& frame) {
+    dirty.assign(tiles, 0);
+    const cv::Rect bounds(0, 0, frame.cols, frame.rows);
+    const int count = static_cast<int>(tiles);
+    size_t changedTiles = 0;
+
+#pragma omp parallel for schedule(static) reduction(+:changedTiles)
+    for (int i = 0; i < count; ++i) {
+        cv::Rect tile((i % grid.width) * options.tileSize.width, (i / grid.width) * options.tileSize.height,
+                      options.tileSize.width, options.tileSize.height);
+        // a change in the halo reaches into the tile
+        cv::Rect region = cv::Rect(tile.x - radius, tile.y - radius, tile.width + 2 * radius,
+                                   tile.height + 2 * radius) & bounds;
+        if (changed(frame(region), reference(region))) {
+            dirty[i] = 1;
+            ++changedTiles;
+        }
+    }
+    return changedTiles;
+}
+
+bool IncrementalEdges::changed(const cv::Mat& current, const cv::Mat& previous) const {
+    if (options.threshold == 0) {
+        // exact comparison stops at the first differing row
+        size_t rowBytes = current.cols * current.elemSize();
+        for (int i = 0; i < current.rows; ++i) {
+            if (memcmp(current.ptr(i), previous.ptr(i), rowBytes) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+    double samples = static_cast<double>(current.total()) * current.channels();
+    return cv::norm(current, previous, cv::NORM_L1) > options.threshold * samples;
+}
@@ -0,0 +1,129 @@
+#include "video/video_pipeline.h"
+#include "utils/spsc_queue.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+using namespace std;
+
+namespace {
+    double secondsSince(chrono::steady_clock::time_point start) {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+}
+
+VideoPipeline::VideoPipeline(GradientOperator& gradientOperator, size_t depth)
+        : gradientOperator(gradientOperator), depth(depth) {
+    if (depth == 0) {
+        throw runtime_error("A video needs at least one slot");
+    }
+}
+
+VideoStats VideoPipeline::run(FrameSource& source, FrameSink& sink) {
+    VideoStats stats;
+    auto videoStart = chrono::steady_clock::now();
+    const string extension = sink.extension();
+
+    vector<Slot> slots(depth);
+    SpscQueue<Slot*> freeSlots(depth);
+    SpscQueue<Slot*> decoded(depth);
+    SpscQueue<Slot*> computed(depth);
+    for (Slot& slot : slots) {
+        freeSlots.push(&slot);
+    }
+    // set by the encode stage on the first failure, so the decode stage stops reading
+    atomic<bool> failed(false);
+    string failure;
+
+    thread decoder([&]() {
+        for (size_t frame = 1; !failed.load(memory_order_relaxed); ++frame) {
+            if (cancellation && cancellation->isCancelled()) {
+                break;
+            }
+            Slot* slot = nullptr;
+            freeSlots.pop(slot);
+            auto start = chrono::steady_clock::now();
+            slot->frame = frame;
+            slot->error.clear();
+            bool more = true;
+            try {
+                more = source.read(slot->image);
+            } catch (const exception& e) {
+                slot->error = e.what();
+            }
+            stats.decodeSeconds += secondsSince(start);
+            if (!more) {
+                break;
+            }
+            decoded.push(slot);
+            if (!slot->error.empty()) {
+                break;
+            }
+        }
+        decoded.close();
+    });
+
+    thread encoder([&]() {
+        Slot* slot = nullptr;
+        while (computed.pop(slot)) {
+            auto start = chrono::steady_clock::now();
+            if (slot->error.empty() && !failed.load(memory_order_relaxed)) {
+                try {
+                    sink.write(slot->result);
+                    ++stats.frames;
+                } catch (const exception& e) {
+                    slot->error = e.what();
+                }
+            }
+            stats.encodeSeconds += secondsSince(start);
+
+            if (!slot->error.empty() && !failed.load(memory_order_relaxed)) {
+                failure = "Frame " + to_string(slot->frame) + ": " + slot->error;
+                failed.store(true, memory_order_relaxed);
+            }
+            slot->result = EdgeResult();
+            freeSlots.push(slot);
+        }
+    });
+
+    // the operator runs on the calling thread, which keeps the pinning and OpenMP settings of the job
+    unique_ptr<IncrementalEdges> tiles;
+    if (incremental.enabled) {
+        tiles = make_unique<IncrementalEdges>(gradientOperator, incremental);
+    }
+    Slot* slot = nullptr;
+    while (decoded.pop(slot)) {
+        auto start = chrono::steady_clock::now();
+        if (slot->error.empty() && !failed.load(memory_order_relaxed)) {
+            try {
+                if (tiles) {
+                    slot->result = tiles->computeEdges(slot->image, extension);
+                    stats.tiles += tiles->lastTiles();
+                    stats.dirtyTiles += tiles->lastDirtyTiles();
+                } else {
+                    slot->result = gradientOperator.computeEdges(slot->image, extension);
+                }
+            } catch (const exception& e) {
+                slot->error = e.what();
+            }
+        }
+        stats.computeSeconds += secondsSince(start);
+        computed.push(slot);
+    }
+    computed.close();
+
+    decoder.join();
+    encoder.join();
+
+    // a cancelled operator fails the frame it was computing, so cancellation is reported first
+    if (cancellation) {
+        cancellation->throwIfCancelled();
+    }
+    if (failed) {
+        throw runtime_error(failure);
+    }
+    sink.close();
+    stats.seconds = secondsSince(videoStart);
+    return stats;
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/auto_sobel.h"
+#include "gradient/omp_sobel.h"
+#include <opencv2/opencv.hpp>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the Sobel auto-tuner and the AutoSobel operator.
+ *
+ * Tests persistence and lookup of the tuning table, that tuning
+ * produces a usable entry, and that AutoSobel dispatches to the
+ * variant the table selects.
+ */
+class AutoSobelTest : public GradientOperatorTest {
+protected:
+    TuningEntry makeEntry(cv::Size imageSize, const std::string& backend, int threads = 0) {
+        TuningEntry entry;
+        entry.imageSize = imageSize;
+        entry.backend = backend;
+        entry.threads = threads;
+        entry.seconds = 0.01;
+        return entry;
+    }
+};
+
+/**
+ * Tests that a saved tuning table loads back unchanged.
+ */
+TEST_F(AutoSobelTest, TableRoundTrip) {
+    TuningTable table;
+    TuningEntry entry = makeEntry(cv::Size(640, 480), "openmp", 4);
+    entry.tileSize = cv::Size(96, 96);
+    table.add(entry);
+    table.add(makeEntry(cv::Size(200, 200), "opencv", 1));
+    table.setBatchCrossoverPixels(250000);
+
+    std::string path = testOutputDir + "/tuning.yml";
+    table.save(path);
+    TuningTable loaded = TuningTable::load(path);
+
+    ASSERT_EQ(loaded.getEntries().size(), 2u);
+    const TuningEntry& first = loaded.getEntries()[0];
+    const TuningEntry& second = loaded.getEntries()[1];
+    EXPECT_EQ(first.imageSize, cv::Size(200, 200));
+    EXPECT_EQ(first.backend, "opencv");
+    EXPECT_EQ(second.backend, "openmp");
+    EXPECT_EQ(second.tileSize, cv::Size(96, 96));
+    EXPECT_EQ(second.threads, 4);
+    EXPECT_DOUBLE_EQ(second.seconds, 0.01);
+    EXPECT_DOUBLE_EQ(loaded.getBatchCrossoverPixels(), 250000);
+    EXPECT_EQ(loaded.getMeasuredCpus(), cv::getNumberOfCPUs());
+    EXPECT_TRUE(loaded.fitsHost());
+
+    // a table from another host loads as is and reports the mismatch instead of printing it
+    table.setMeasuredCpus(cv::getNumberOfCPUs() + 1);
+    table.save(path);
+    loaded = TuningTable::load(path);
+    EXPECT_EQ(loaded.getMeasuredCpus(), cv::getNumberOfCPUs() + 1);
+    EXPECT_FALSE(loaded.fitsHost());
+    EXPECT_EQ(loaded.getEntries().size(), 2u);
+}
+
+/**
+ * Tests that a missing table file loads as an empty table.
+ */
+TEST_F(AutoSobelTest, MissingTableIsEmpty) {
+    TuningTable table = TuningTable::load(testOutputDir + "/missing.yml");
+    EXPECT_TRUE(table.getEntries().empty());
+    EXPECT_EQ(table.lookup(cv::Size(100, 100)), nullptr);
+    EXPECT_LT(table.getBatchCrossoverPixels(), 0);
+    EXPECT_TRUE(table.fitsHost());
+}
+
+/**
+ * Tests that lookup picks the entry closest in area and that
+ * adding an entry for the same size replaces the old one.
+ */
+TEST_F(AutoSobelTest, LookupNearestSize) {
+    TuningTable table;
+    table.add(makeEntry(cv::Size(200, 200), "alternative"));
+    table.add(makeEntry(cv::Size(1920, 1080), "openmp"));
+    table.add(makeEntry(cv::Size(200, 200), "opencv"));
+
+    ASSERT_EQ(table.getEntries().size(), 2u);
+    EXPECT_EQ(table.lookup(cv::Size(300, 300))->backend, "opencv");
+    EXPECT_EQ(table.lookup(cv::Size(2000, 1500))->backend, "openmp");
+}
+
+/**
+ * Tests that tuning yields one valid entry per size.
+ */
+TEST_F(AutoSobelTest, TuneProducesEntries) {
+    TuningTable table = SobelAutoTuner(1).tune({cv::Size(64, 64), cv::Size(128, 96)});
+
+    ASSERT_EQ(table.getEntries().size(), 2u);
+    for (const auto& entry : table.getEntries()) {
+        EXPECT_FALSE(entry.backend.empty());
+        EXPECT_GT(entry.seconds, 0.0);
+        EXPECT_NO_THROW(SobelAutoTuner::createBackend(entry));
+    }
+    EXPECT_GE(table.getBatchCrossoverPixels(), 0);
+    EXPECT_LE(table.getBatchCrossoverPixels(), 128 * 96);
+}
+
+/**
+ * Tests that AutoSobel falls back to OcvSobel without a table
+ * and still produces an output image.
+ */
+TEST_F(AutoSobelTest, FallbackWithoutTable) {
+    AutoSobel autoSobel{TuningTable()};
+    EXPECT_EQ(autoSobel.selectVariant(cv::Size(100, 100)).backend, "opencv");
+    EXPECT_EQ(autoSobel.getOperatorName(), "AutoSobel");
+
+    std::string outputPath = getUniqueOutputPath("auto_sobel_fallback");
+    cv::Mat result = autoSobel.getEdges(testImagePath, outputPath);
+    EXPECT_FALSE(result.empty());
+    verifyOutputImage(outputPath);
+}
+
+/**
+ * Tests that AutoSobel runs the backend the table selects.
+ *
+ * The backends differ in normalization, so matching OmpSobel
+ * exactly shows that the openmp variant was the one dispatched.
+ */
+TEST_F(AutoSobelTest, DispatchesToTunedBackend) {
+    TuningTable table;
+    table.add(makeEntry(cv::Size(200, 200), "openmp", 2));
+    AutoSobel autoSobel(table);
+
+    cv::Mat image = createSimpleTestImage(200, 200);
+    cv::Mat result = autoSobel.detectEdges(image);
+    cv::Mat expected = OmpSobel().detectEdges(image);
+
+    EXPECT_EQ(cv::norm(result, expected, cv::NORM_INF), 0.0);
+}
+
+/**
+ * Tests that an unknown backend name is rejected.
+ */
+TEST_F(AutoSobelTest, UnknownBackend) {
+    EXPECT_THROW(SobelAutoTuner::createBackend(makeEntry(cv::Size(10, 10), "gpu")), std::runtime_error);
+}
@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/ocv_sobel.h"
+#include "gradient/omp_sobel.h"
+#include "batch/batch_pipeline.h"
+#include "utils/spsc_queue.h"
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the overlapped batch pipeline.
+ *
+ * Tests the ring buffer between two threads, the manifest format,
+ * and that a batch writes what getEdges writes for every image with
+ * more images than slots, while failed images do not stop the rest,
+ * and that small images run one per thread with the same result.
+ */
+class BatchPipelineTest : public GradientOperatorTest {
+protected:
+    std::vector<BatchJob> makeJobs(int count, const std::string& extension) {
+        std::vector<BatchJob> jobs;
+        for (int i = 0; i < count; ++i) {
+            jobs.push_back({testImagePath, testOutputDir + "/batch_" + std::to_string(i) + extension});
+        }
+        return jobs;
+    }
+
+    // Thumbnails of the test image in several sizes, each with its own output path.
+    std::vector<BatchJob> makeThumbnailJobs(int count, const std::string& prefix) {
+        cv::Mat image = loadTestImage();
+        std::vector<BatchJob> jobs;
+        for (int i = 0; i < count; ++i) {
+            std::string inputPath = testOutputDir + "/thumb_" + std::to_string(i) + ".png";
+            if (!std::filesystem::exists(inputPath)) {
+                cv::Mat thumbnail;
+                cv::resize(image, thumbnail, cv::Size(160 + 8 * i, 120 + 6 * i));
+                cv::imwrite(inputPath, thumbnail);
+            }
+            jobs.push_back({inputPath, testOutputDir + "/" + prefix + std::to_string(i) + ".png"});
+        }
+        return jobs;
+    }
+
+    static OperatorFactory singleThreadedSobel() {
+        return []() {
+            ExecutionConfig config;
+            config.numThreads = 1;
+            return std::unique_ptr<GradientOperator>(std::make_unique<OmpSobel>(3, config));
+        };
+    }
+};
+
+/**
+ * Tests that every element crosses the queue once and in order while
+ * both sides wait on each other, and that close ends the stream.
+ */
+TEST_F(BatchPipelineTest, QueuePassesElementsInOrder) {
+    SpscQueue<int> queue(3);
+    const int count = 100000;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < count; ++i) {
+            queue.push(i);
+        }
+        queue.close();
+    });
+
+    int expected = 0;
+    int value = -1;
+    while (queue.pop(value)) {
+        ASSERT_EQ(value, expected);
+        ++expected;
+    }
+    producer.join();
+    EXPECT_EQ(expected, count);
+
+    SpscQueue<int> full(2);
+    int element = 1;
+    EXPECT_TRUE(full.tryPush(element));
+    EXPECT_TRUE(full.tryPush(element));
+    EXPECT_FALSE(full.tryPush(element));
+}
+
+/**
+ * Tests the manifest separators, comments and errors.
+ */
+TEST_F(BatchPipelineTest, ReadsManifest) {
+    std::string manifestPath = testOutputDir + "/manifest.txt";
+    {
+        std::ofstream manifest(manifestPath);
+        manifest << "# input and output\n"
+                 << "in/a b.jpg\tout/a b.png\n"
+                 << "\n"
+                 << "in/c.jpg out/c.pts\r\n";
+    }
+    std::vector<BatchJob> jobs = BatchPipeline::readManifest(manifestPath);
+    ASSERT_EQ(jobs.size(), 2u);
+    EXPECT_EQ(jobs[0].inputPath, "in/a b.jpg");
+    EXPECT_EQ(jobs[0].outputPath, "out/a b.png");
+    EXPECT_EQ(jobs[1].inputPath, "in/c.jpg");
+    EXPECT_EQ(jobs[1].outputPath, "out/c.pts");
+
+    {
+        std::ofstream manifest(manifestPath);
+        manifest << "in/a.jpg\n";
+    }
+    EXPECT_THROW(BatchPipeline::readManifest(manifestPath), std::runtime_error);
+    EXPECT_THROW(BatchPipeline::readManifest(testOutputDir + "/missing.txt"), std::runtime_error);
+}
+
+/**
+ * Tests that a batch through fewer slots than images writes exactly
+ * what getEdges writes, for the tiled operator and a lossless format.
+ */
+TEST_F(BatchPipelineTest, MatchesSequentialRuns) {
+    OmpSobel sequential;
+    std::string referencePath = testOutputDir + "/reference.png";
+    cv::Mat expected = sequential.getEdges(testImagePath, referencePath);
+
+    OmpSobel batched;
+    BatchOptions options;
+    options.depth = 2;
+    BatchPipeline pipeline(batched, options);
+    std::vector<BatchJob> jobs = makeJobs(7, ".png");
+    BatchStats stats = pipeline.run(jobs);
+    EXPECT_EQ(stats.images, jobs.size());
+    EXPECT_EQ(stats.failed, 0u);
+    EXPECT_GT(stats.computeSeconds, 0);
+
+    for (const BatchJob& job : jobs) {
+        cv::Mat written = cv::imread(job.outputPath, cv::IMREAD_UNCHANGED);
+        ASSERT_EQ(written.size(), expected.size()) << job.outputPath;
+        EXPECT_EQ(cv::norm(written, expected, cv::NORM_INF), 0) << job.outputPath;
+    }
+    options.depth = 0;
+    EXPECT_THROW(BatchPipeline(batched, options), std::runtime_error);
+}
+
+/**
+ * Tests parsing of the batch flags.
+ */
+TEST_F(BatchPipelineTest, ParsesBatchFlags) {
+    BatchOptions options;
+    EXPECT_EQ(options.parallelism, BatchParallelism::Auto);
+    EXPECT_TRUE(options.parseFlag("--depth=8"));
+    EXPECT_EQ(options.depth, 8u);
+    EXPECT_TRUE(options.parseFlag("--parallelism=inter"));
+    EXPECT_EQ(options.parallelism, BatchParallelism::Inter);
+    EXPECT_FALSE(options.parseFlag("--threads=2"));
+
+    EXPECT_THROW(options.parseFlag("--depth=0"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--parallelism=both"), std::runtime_error);
+}
+
+/**
+ * Tests which images run one per thread for each setting.
+ */
+TEST_F(BatchPipelineTest, ChoosesParallelismBySize) {
+    OcvSobel sobel;
+    ImageInfo thumbnail{"png", 200, 200, 3, 8};
+    ImageInfo scan{"jpeg", 8000, 6000, 3, 8};
+
+    BatchOptions options;
+    BatchPipeline automatic(sobel, options, singleThreadedSobel());
+    EXPECT_TRUE(automatic.runsPerThread(thumbnail));
+    EXPECT_FALSE(automatic.runsPerThread(scan));
+    EXPECT_FALSE(automatic.runsPerThread(std::nullopt));
+
+    options.parallelism = BatchParallelism::Inter;
+    EXPECT_TRUE(BatchPipeline(sobel, options, singleThreadedSobel()).runsPerThread(scan));
+    options.parallelism = BatchParallelism::Intra;
+    EXPECT_FALSE(BatchPipeline(sobel, options, singleThreadedSobel()).runsPerThread(thumbnail));
+
+    // without a factory there is nothing to run per thread
+    EXPECT_FALSE(BatchPipeline(sobel).runsPerThread(thumbnail));
+}
+
+/**
+ * Tests that thumbnails run one per thread give the same files as
+ * the overlapped stages.
+ */
+TEST_F(BatchPipelineTest, PerThreadMatchesOverlapped) {
+    const int count = 12;
+    OmpSobel sobel;
+
+    BatchOptions options;
+    options.parallelism = BatchParallelism::Intra;
+    std::vector<BatchJob> overlapped = makeThumbnailJobs(count, "intra_");
+    BatchStats intraStats = BatchPipeline(sobel, options, singleThreadedSobel()).run(overlapped);
+    EXPECT_EQ(intraStats.images, static_cast<size_t>(count));
+    EXPECT_EQ(intraStats.interImages, 0u);
+
+    options.parallelism = BatchParallelism::Auto;
+    options.workers = 4;
+    std::vector<BatchJob> perThread = makeThumbnailJobs(count, "inter_");
+    perThread[5].inputPath = testOutputDir + "/missing.png";
+    BatchStats interStats = BatchPipeline(sobel, options, singleThreadedSobel()).run(perThread);
+    EXPECT_EQ(interStats.images, static_cast<size_t>(count - 1));
+    EXPECT_EQ(interStats.interImages, static_cast<size_t>(count - 1));
+    EXPECT_EQ(interStats.failed, 1u);
+
+    for (int i = 0; i < count; ++i) {
+        if (i == 5) {
+            continue;
+        }
+        cv::Mat expected = cv::imread(overlapped[i].outputPath, cv::IMREAD_UNCHANGED);
+        cv::Mat written = cv::imread(perThread[i].outputPath, cv::IMREAD_UNCHANGED);
+        ASSERT_EQ(written.size(), expected.size()) << i;
+        EXPECT_EQ(cv::norm(written, expected, cv::NORM_INF), 0) << i;
+    }
+}
+
+/**
+ * Tests that unreadable inputs and unwritable formats fail alone.
+ */
+TEST_F(BatchPipelineTest, ContinuesAfterFailures) {
+    std::vector<BatchJob> jobs = makeJobs(4, ".png");
+    jobs[1].inputPath = testOutputDir + "/missing.jpg";
+    jobs[2].outputPath = testOutputDir + "/batch_2.unknown";
+
+    OcvSobel sobel;
+    BatchStats stats = BatchPipeline(sobel).run(jobs);
+    EXPECT_EQ(stats.images, 2u);
+    EXPECT_EQ(stats.failed, 2u);
+    EXPECT_FALSE(cv::imread(jobs[3].outputPath).empty());
+}
+
+/**
+ * Tests that a cancelled batch stops and reports the cancellation.
+ */
+TEST_F(BatchPipelineTest, StopsWhenCancelled) {
+    CancellationToken token;
+    token.cancel();
+    OcvSobel sobel;
+    BatchPipeline pipeline(sobel);
+    pipeline.setCancellationToken(&token);
+    EXPECT_THROW(pipeline.run(makeJobs(3, ".png")), OperationCancelled);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "utils/cancellation.h"
+#include "utils/tile_scheduler.h"
+#include "gradient/ocv_sobel.h"
+#include "gradient/alt_sobel.h"
+#include "gradient/omp_sobel.h"
+#include "gradient/auto_sobel.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for cooperative cancellation.
+ *
+ * Tests the token itself, that every operator stops with
+ * OperationCancelled once its token is cancelled, and that an
+ * operator without a cancelled token runs to completion.
+ */
+class CancellationTest : public GradientOperatorTest {};
+
+/**
+ * Tests that a fresh token is not cancelled and that cancel()
+ * and a past deadline both cancel it with distinct reasons.
+ */
+TEST_F(CancellationTest, TokenStates) {
+    CancellationToken token;
+    EXPECT_FALSE(token.isCancelled());
+    EXPECT_NO_THROW(token.throwIfCancelled());
+
+    token.setTimeout(std::chrono::hours(1));
+    EXPECT_FALSE(token.isCancelled());
+
+    token.setDeadline(CancellationToken::Clock::now() - std::chrono::milliseconds(1));
+    EXPECT_TRUE(token.isCancelled());
+    try {
+        token.throwIfCancelled();
+        FAIL() << "Expected OperationCancelled";
+    } catch (const OperationCancelled& e) {
+        EXPECT_STREQ(e.what(), "Deadline exceeded");
+    }
+
+    CancellationToken cancelled;
+    cancelled.cancel();
+    try {
+        cancelled.throwIfCancelled();
+        FAIL() << "Expected OperationCancelled";
+    } catch (const OperationCancelled& e) {
+        EXPECT_STREQ(e.what(), "Operation cancelled");
+    }
+}
+
+/**
+ * Tests that --deadline-ms sets the deadline and other flags are left alone.
+ */
+TEST_F(CancellationTest, ParsesDeadlineFlag) {
+    CancellationToken token;
+    EXPECT_FALSE(token.parseFlag("--threads=2"));
+    EXPECT_TRUE(token.parseFlag("--deadline-ms=3600000"));
+    EXPECT_FALSE(token.isCancelled());
+
+    EXPECT_THROW(token.parseFlag("--deadline-ms=0"), std::runtime_error);
+    EXPECT_THROW(token.parseFlag("--deadline-ms=soon"), std::runtime_error);
+}
+
+/**
+ * Tests that cancelling from inside a tile stops the scheduler
+ * before the remaining tiles run.
+ */
+TEST_F(CancellationTest, SchedulerStopsAfterCancel) {
+    TileScheduler scheduler(cv::Size(16, 16), 4, 1);
+    CancellationToken token;
+    std::atomic<int> calls(0);
+
+    EXPECT_THROW({
+        scheduler.run(cv::Size(256, 256), [&](const cv::Rect&) {
+            if (++calls == 3) {
+                token.cancel();
+            }
+        }, &token);
+    }, OperationCancelled);
+    EXPECT_EQ(calls.load(), 3);
+}
+
+/**
+ * Tests that every operator throws OperationCancelled on a
+ * cancelled token and runs normally once the token is removed.
+ */
+TEST_F(CancellationTest, OperatorsStop) {
+    cv::Mat image = createSimpleTestImage(200, 200);
+    CancellationToken token;
+    token.cancel();
+
+    OcvSobel ocvSobel;
+    AltSobel altSobel;
+    OmpSobel ompSobel;
+    AutoSobel autoSobel{TuningTable()};
+    for (GradientOperator* op : std::initializer_list<GradientOperator*>{&ocvSobel, &altSobel, &ompSobel, &autoSobel}) {
+        op->setCancellationToken(&token);
+        EXPECT_THROW(op->detectEdges(image), OperationCancelled) << op->getOperatorName();
+
+        op->setCancellationToken(nullptr);
+        EXPECT_FALSE(op->detectEdges(image).empty()) << op->getOperatorName();
+    }
+}
+
+/**
+ * Tests that a cancelled job does not write its output image.
+ */
+TEST_F(CancellationTest, NoOutputWhenCancelled) {
+    CancellationToken token;
+    token.cancel();
+    OmpSobel ompSobel;
+    ompSobel.setCancellationToken(&token);
+
+    std::string outputPath = getUniqueOutputPath("omp_sobel_cancelled");
+    EXPECT_THROW(ompSobel.getEdges(testImagePath, outputPath), OperationCancelled);
+    EXPECT_FALSE(std::filesystem::exists(outputPath));
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "capi/edgeops.h"
+#include "gradient/ocv_sobel.h"
+#include <opencv2/opencv.hpp>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the C API used to run the operators in-process.
+ *
+ * Tests that an encoded image goes through an operator in memory
+ * with the same result as the file-based path, and that failures
+ * come back as status codes instead of exceptions.
+ */
+class CApiTest : public GradientOperatorTest {
+protected:
+    std::vector<uint8_t> readTestImage() {
+        std::ifstream file(testImagePath, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+};
+
+/**
+ * Tests that the in-memory path matches getEdges on the same input.
+ */
+TEST_F(CApiTest, ProcessMatchesGetEdges) {
+    std::vector<uint8_t> input = readTestImage();
+    ASSERT_FALSE(input.empty());
+
+    uint8_t* output = nullptr;
+    size_t outputSize = 0;
+    char error[256] = "";
+    edgeops_status status = edgeops_process("opencv%20sobel", input.data(), input.size(), ".png", nullptr,
+                                            nullptr, &output, &outputSize, error, sizeof(error));
+    ASSERT_EQ(status, EDGEOPS_OK) << error;
+    ASSERT_NE(output, nullptr);
+
+    cv::Mat decoded = cv::imdecode(cv::Mat(1, static_cast<int>(outputSize), CV_8U, output), cv::IMREAD_UNCHANGED);
+    edgeops_free(output);
+
+    OcvSobel ocvSobel;
+    cv::Mat expected = ocvSobel.getEdges(testImagePath, getUniqueOutputPath("ocv_sobel_capi"));
+    ASSERT_EQ(decoded.size(), expected.size());
+    EXPECT_EQ(cv::norm(decoded, expected, cv::NORM_INF), 0);
+}
+
+/**
+ * Tests the status codes for an unknown operator, an unknown flag,
+ * an undecodable input, an oversize input and a cancelled token.
+ */
+TEST_F(CApiTest, ReportsFailures) {
+    std::vector<uint8_t> input = readTestImage();
+    uint8_t* output = nullptr;
+    size_t outputSize = 0;
+    char error[256] = "";
+
+    EXPECT_EQ(edgeops_process("canny", input.data(), input.size(), ".png", nullptr, nullptr,
+                              &output, &outputSize, error, sizeof(error)), EDGEOPS_UNKNOWN_OPERATOR);
+    EXPECT_EQ(edgeops_process("prewitt", input.data(), input.size(), ".png", "--bogus=1", nullptr,
+                              &output, &outputSize, error, sizeof(error)), EDGEOPS_ERROR);
+    EXPECT_NE(std::string(error).find("--bogus"), std::string::npos);
+
+    const uint8_t garbage[] = {1, 2, 3, 4};
+    EXPECT_EQ(edgeops_process("prewitt", garbage, sizeof(garbage), ".png", nullptr, nullptr,
+                              &output, &outputSize, error, sizeof(error)), EDGEOPS_ERROR);
+    EXPECT_EQ(edgeops_process("prewitt", input.data(), input.size(), ".png", "--max-pixels=1000", nullptr,
+                              &output, &outputSize, error, sizeof(error)), EDGEOPS_TOO_LARGE);
+    EXPECT_EQ(edgeops_process("prewitt", input.data(), input.size(), ".dzi", nullptr, nullptr,
+                              &output, &outputSize, error, sizeof(error)), EDGEOPS_ERROR);
+    EXPECT_NE(std::string(error).find("pyramid"), std::string::npos);
+
+    edgeops_token* token = edgeops_token_create();
+    edgeops_token_cancel(token);
+    EXPECT_EQ(edgeops_process("openmp%20sobel", input.data(), input.size(), ".png", nullptr, token,
+                              &output, &outputSize, error, sizeof(error)), EDGEOPS_CANCELLED);
+    edgeops_token_destroy(token);
+
+    EXPECT_EQ(output, nullptr);
+    EXPECT_EQ(outputSize, 0u);
+    EXPECT_EQ(edgeops_abi_version(), EDGEOPS_ABI_VERSION);
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/ocv_sobel.h"
+#include "utils/edge_mask.h"
+#include "utils/edge_threshold.h"
+#include "utils/image_utils.h"
+#include <opencv2/opencv.hpp>
+#include <fstream>
+#include <iterator>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for binary edge maps.
+ *
+ * Tests the --threshold flag, that the parallel Otsu level equals
+ * OpenCV's, and that the bit-packed and run-length formats round
+ * trip and are written by getEdges for .pbm and .rle outputs.
+ */
+class EdgeMaskTest : public GradientOperatorTest {
+protected:
+    static cv::Mat randomMask(cv::Size size, double density) {
+        cv::Mat noise(size, CV_32F);
+        cv::randu(noise, 0, 1);
+        cv::Mat mask;
+        cv::threshold(noise, mask, 1 - density, 255, cv::THRESH_BINARY);
+        mask.convertTo(mask, CV_8U);
+        return mask;
+    }
+
+    static std::vector<uint8_t> readFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+};
+
+/**
+ * Tests parsing of the --threshold flag.
+ */
+TEST_F(EdgeMaskTest, ParsesThresholdFlag) {
+    EdgeOptions options;
+    EXPECT_FALSE(options.isThresholding());
+
+    EXPECT_TRUE(options.parseFlag("--threshold=40"));
+    EXPECT_EQ(options.threshold, EdgeOptions::Threshold::Fixed);
+    EXPECT_EQ(options.thresholdValue, 40);
+    EXPECT_TRUE(options.parseFlag("--threshold=otsu"));
+    EXPECT_EQ(options.threshold, EdgeOptions::Threshold::Otsu);
+    EXPECT_TRUE(options.isThresholding());
+
+    EXPECT_THROW(options.parseFlag("--threshold=255"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--threshold=-1"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--threshold=auto"), std::runtime_error);
+}
+
+/**
+ * Tests that the merged per-thread histogram counts every pixel and
+ * that the Otsu level equals cv::threshold with THRESH_OTSU.
+ */
+TEST_F(EdgeMaskTest, OtsuMatchesOpenCV) {
+    OcvSobel sobel;
+    cv::Mat edges = sobel.detectEdges(loadTestImage());
+
+    EdgeThreshold::Histogram counts = EdgeThreshold::histogram(edges);
+    uint64_t total = 0;
+    for (uint64_t count : counts) {
+        total += count;
+    }
+    EXPECT_EQ(total, edges.total());
+    EXPECT_EQ(counts[0], edges.total() - cv::countNonZero(edges));
+
+    cv::Mat binary;
+    double expected = cv::threshold(edges, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+    EXPECT_EQ(EdgeThreshold::otsu(counts), static_cast<int>(expected));
+
+    EdgeOptions options;
+    options.threshold = EdgeOptions::Threshold::Otsu;
+    EXPECT_EQ(cv::norm(EdgeThreshold::apply(edges, options), binary, cv::NORM_INF), 0);
+    EXPECT_THROW(EdgeThreshold::histogram(cv::Mat(4, 4, CV_32F)), std::runtime_error);
+}
+
+/**
+ * Tests that both formats round trip, including widths that are not
+ * a multiple of 8 and masks with no edges or only edges, and that the
+ * bit-packed file is a PBM that OpenCV reads.
+ */
+TEST_F(EdgeMaskTest, FormatsRoundTrip) {
+    std::vector<cv::Mat> masks = {
+        randomMask(cv::Size(13, 7), 0.3),
+        randomMask(cv::Size(640, 480), 0.05),
+        cv::Mat::zeros(5, 9, CV_8U),
+        cv::Mat(3, 8, CV_8U, cv::Scalar(255)),
+    };
+
+    for (const cv::Mat& mask : masks) {
+        EXPECT_EQ(EdgeMask::pack(mask).size(), static_cast<size_t>((mask.cols + 7) / 8 * mask.rows));
+        for (const std::string extension : {".pbm", ".rle"}) {
+            std::vector<uint8_t> encoded = ImageUtils::encodeImage(mask, extension);
+            cv::Mat decoded = EdgeMask::decode(encoded);
+            ASSERT_EQ(decoded.size(), mask.size()) << extension;
+            EXPECT_EQ(cv::norm(decoded, mask, cv::NORM_INF), 0) << extension;
+        }
+
+        // PBM shows set bits as black
+        std::vector<uint8_t> pbm = EdgeMask::encode(mask, ".pbm");
+        cv::Mat viewed = cv::imdecode(pbm, cv::IMREAD_GRAYSCALE);
+        cv::Mat inverted;
+        cv::bitwise_not(mask, inverted);
+        EXPECT_EQ(cv::norm(viewed, inverted, cv::NORM_INF), 0);
+    }
+
+    // a sparse mask needs far less than a byte per pixel as runs
+    EXPECT_LT(EdgeMask::encodeRuns(masks[1]).size(), masks[1].total() / 4);
+
+    EXPECT_THROW(EdgeMask::decode({'P', '4', '\n', '8', ' ', '2', '\n', 0}), std::runtime_error);
+    EXPECT_THROW(EdgeMask::decodeRuns({3}, cv::Size(2, 2)), std::runtime_error);
+    EXPECT_THROW(EdgeMask::encode(masks[0], ".png"), std::runtime_error);
+}
+
+/**
+ * Tests that getEdges thresholds the magnitude and writes the mask
+ * formats when the output path asks for them.
+ */
+TEST_F(EdgeMaskTest, WritesThresholdedMasks) {
+    EdgeOptions options;
+    options.threshold = EdgeOptions::Threshold::Fixed;
+    options.thresholdValue = 40;
+
+    // getEdges decodes straight to grayscale, which can differ by one level from converting after
+    OcvSobel sobel;
+    cv::Mat magnitude = sobel.getEdges(testImagePath, getUniqueOutputPath("magnitude"));
+    cv::Mat expected;
+    cv::threshold(magnitude, expected, 40, 255, cv::THRESH_BINARY);
+
+    for (const std::string extension : {".pbm", ".rle"}) {
+        OcvSobel thresholded;
+        thresholded.setEdgeOptions(options);
+        std::string outputPath = getUniqueOutputPath("mask") + extension;
+        cv::Mat edges = thresholded.getEdges(testImagePath, outputPath);
+        EXPECT_EQ(cv::norm(edges, expected, cv::NORM_INF), 0);
+
+        cv::Mat written = EdgeMask::decode(readFile(outputPath));
+        ASSERT_EQ(written.size(), expected.size());
+        EXPECT_EQ(cv::norm(written, expected, cv::NORM_INF), 0) << extension;
+    }
+}
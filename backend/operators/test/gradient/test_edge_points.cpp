@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/ocv_sobel.h"
+#include "gradient/omp_sobel.h"
+#include "gradient/operator_registry.h"
+#include "utils/edge_points.h"
+#include <opencv2/opencv.hpp>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the sparse point list output.
+ *
+ * Tests that the bands listed in parallel come out in row-major
+ * order, that directions follow the gradient, and that getEdges
+ * writes a .pts list with the operator's own gradients.
+ */
+class EdgePointsTest : public GradientOperatorTest {
+protected:
+    // The points above a level in row-major order, listed sequentially.
+    static std::vector<cv::Point> pointsAbove(const cv::Mat& magnitude, int level) {
+        std::vector<cv::Point> points;
+        for (int i = 0; i < magnitude.rows; ++i) {
+            for (int j = 0; j < magnitude.cols; ++j) {
+                if (magnitude.at<uint8_t>(i, j) > level) {
+                    points.emplace_back(j, i);
+                }
+            }
+        }
+        return points;
+    }
+
+    static std::vector<uint8_t> readFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+};
+
+/**
+ * Tests that the concatenated bands list every point above the level
+ * once, in row-major order, with its magnitude.
+ */
+TEST_F(EdgePointsTest, ListsPointsInOrder) {
+    cv::Mat magnitude(480, 640, CV_8U);
+    cv::randu(magnitude, 0, 256);
+
+    std::vector<uint8_t> encoded = EdgePoints::encode(magnitude, 240);
+    EdgePointList list = EdgePoints::decode(encoded);
+    EXPECT_EQ(list.size, magnitude.size());
+    EXPECT_FALSE(list.hasAngles);
+
+    std::vector<cv::Point> expected = pointsAbove(magnitude, 240);
+    ASSERT_EQ(list.points.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(list.points[i].x, expected[i].x) << i;
+        ASSERT_EQ(list.points[i].y, expected[i].y) << i;
+        ASSERT_EQ(list.points[i].magnitude, magnitude.at<uint8_t>(expected[i].y, expected[i].x));
+    }
+
+    // five bytes a point
+    std::string header = "EDGEPTS1\n640 480 " + std::to_string(expected.size()) + " xym\n";
+    EXPECT_EQ(encoded.size(), header.size() + expected.size() * 5);
+
+    EXPECT_EQ(EdgePoints::decode(EdgePoints::encode(cv::Mat::zeros(3, 3, CV_8U), 0)).points.size(), 0u);
+    EXPECT_THROW(EdgePoints::decode(std::vector<uint8_t>(header.begin(), header.end())), std::runtime_error);
+    EXPECT_THROW(EdgePoints::encode(cv::Mat(2, 2, CV_32F), 0), std::runtime_error);
+}
+
+/**
+ * Tests that directions are counterclockwise from the x axis with
+ * image rows growing downwards.
+ */
+TEST_F(EdgePointsTest, StoresDirections) {
+    cv::Mat magnitude(1, 4, CV_8U, cv::Scalar(200));
+    cv::Mat gradX = (cv::Mat_<float>(1, 4) << 1, 0, -1, 0);
+    cv::Mat gradY = (cv::Mat_<float>(1, 4) << 0, -1, 0, 1);
+
+    EdgePointList list = EdgePoints::decode(EdgePoints::encode(magnitude, 0, gradX, gradY));
+    ASSERT_TRUE(list.hasAngles);
+    ASSERT_EQ(list.points.size(), 4u);
+    EXPECT_EQ(list.points[0].angle, 0);
+    EXPECT_EQ(list.points[1].angle, 16384);
+    EXPECT_EQ(list.points[2].angle, 32768);
+    EXPECT_EQ(list.points[3].angle, 49152);
+    EXPECT_NEAR(EdgePoints::toRadians(list.points[1].angle), CV_PI / 2, 1e-9);
+
+    EXPECT_THROW(EdgePoints::encode(magnitude, 0, gradX, cv::Mat(1, 3, CV_32F)), std::runtime_error);
+    EXPECT_THROW(EdgePoints::encode(magnitude, 0, cv::Mat(1, 4, CV_8U), gradY), std::runtime_error);
+}
+
+/**
+ * Tests that getEdges writes the points above the threshold with
+ * directions from the operator's gradients, for integer and floating
+ * point gradients.
+ */
+TEST_F(EdgePointsTest, WritesOperatorPoints) {
+    EdgeOptions options;
+    options.threshold = EdgeOptions::Threshold::Fixed;
+    options.thresholdValue = 60;
+    options.angles = true;
+
+    std::vector<std::unique_ptr<GradientOperator>> operators;
+    operators.push_back(std::make_unique<OcvSobel>());
+    operators.push_back(std::make_unique<OmpSobel>());
+
+    for (auto& gradientOperator : operators) {
+        gradientOperator->setEdgeOptions(options);
+        cv::Mat image = cv::imread(testImagePath, gradientOperator->inputMode());
+        GradientPlanes planes;
+        cv::Mat magnitude = gradientOperator->detectEdgesWithGradients(image, planes);
+        ASSERT_EQ(planes.gradX.size(), magnitude.size());
+
+        std::string outputPath = getUniqueOutputPath("points") + ".pts";
+        gradientOperator->getEdges(testImagePath, outputPath);
+        EdgePointList list = EdgePoints::decode(readFile(outputPath));
+        ASSERT_EQ(list.points.size(), pointsAbove(magnitude, 60).size()) << gradientOperator->getOperatorName();
+
+        cv::Mat gradX;
+        cv::Mat gradY;
+        planes.gradX.convertTo(gradX, CV_64F);
+        planes.gradY.convertTo(gradY, CV_64F);
+        for (size_t i = 0; i < list.points.size(); i += 97) {
+            const EdgePoint& point = list.points[i];
+            double expected = std::atan2(-gradY.at<double>(point.y, point.x), gradX.at<double>(point.y, point.x));
+            double difference = std::remainder(EdgePoints::toRadians(point.angle) - expected, 2 * CV_PI);
+            EXPECT_LT(std::abs(difference), 1e-3) << gradientOperator->getOperatorName() << " point " << i;
+        }
+    }
+}
+
+/**
+ * Tests that operators without separate gradients refuse directions.
+ */
+TEST_F(EdgePointsTest, PipelineHasNoGradients) {
+    std::unique_ptr<GradientOperator> pipeline = OperatorRegistry::builtin().create("pipeline:sobel");
+    GradientPlanes planes;
+    EXPECT_THROW((void)pipeline->detectEdgesWithGradients(createSimpleTestImage(), planes), std::runtime_error);
+}
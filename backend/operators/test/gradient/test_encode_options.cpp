@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/ocv_sobel.h"
+#include "utils/encode_options.h"
+#include "utils/image_utils.h"
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the output codec settings.
+ *
+ * Tests the encoding flags, the imencode parameters they map to for
+ * each format, and that getEdges encodes with them and times it.
+ */
+class EncodeOptionsTest : public GradientOperatorTest {
+protected:
+    static EncodeOptions parse(const std::vector<std::string>& flags) {
+        EncodeOptions options;
+        for (const std::string& flag : flags) {
+            EXPECT_TRUE(options.parseFlag(flag)) << flag;
+        }
+        return options;
+    }
+};
+
+/**
+ * Tests parsing of the encoding flags.
+ */
+TEST_F(EncodeOptionsTest, ParsesEncodeFlags) {
+    EncodeOptions options = parse({"--quality=70", "--png-level=0", "--png-strategy=rle"});
+    EXPECT_EQ(options.quality, 70);
+    EXPECT_EQ(options.pngLevel, 0);
+    EXPECT_EQ(options.pngStrategy, cv::IMWRITE_PNG_STRATEGY_RLE);
+    EXPECT_FALSE(options.parseFlag("--sigma=1"));
+    EXPECT_FALSE(options.parseFlag("--qualityx=1"));
+
+    EXPECT_THROW(options.parseFlag("--quality=0"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--quality"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--png-level=10"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--png-strategy=zopfli"), std::runtime_error);
+}
+
+/**
+ * Tests that each format gets only its own parameters, with the PNG
+ * level ahead of the strategy it would otherwise reset.
+ */
+TEST_F(EncodeOptionsTest, MapsParamsPerFormat) {
+    EncodeOptions options = parse({"--quality=70", "--png-level=1", "--png-strategy=huffman"});
+    EXPECT_EQ(options.params(".png"), std::vector<int>({cv::IMWRITE_PNG_COMPRESSION, 1,
+                                                        cv::IMWRITE_PNG_STRATEGY, cv::IMWRITE_PNG_STRATEGY_HUFFMAN_ONLY}));
+    EXPECT_EQ(options.params(".jpg"), std::vector<int>({cv::IMWRITE_JPEG_QUALITY, 70}));
+    EXPECT_EQ(options.params(".webp"), std::vector<int>({cv::IMWRITE_WEBP_QUALITY, 70}));
+    EXPECT_EQ(options.params(".pgm"), std::vector<int>({cv::IMWRITE_PXM_BINARY, 1}));
+    EXPECT_TRUE(EncodeOptions().params(".png").empty());
+    EXPECT_TRUE(options.params(".bmp").empty());
+}
+
+/**
+ * Tests that getEdges encodes with the options: lossless formats keep
+ * the edges whatever the effort, a lower JPEG quality is smaller, and
+ * PGM stores the samples as they are.
+ */
+TEST_F(EncodeOptionsTest, WritesConfiguredFormats) {
+    OcvSobel sobel;
+    cv::Mat expected = sobel.getEdges(testImagePath, getUniqueOutputPath("reference") + ".png");
+
+    auto encodedSize = [&](const std::vector<std::string>& flags, const std::string& extension, cv::Mat& written) {
+        OcvSobel encoder;
+        encoder.setEncodeOptions(parse(flags));
+        std::string outputPath = getUniqueOutputPath("encoded") + extension;
+        encoder.getEdges(testImagePath, outputPath);
+        EXPECT_GE(encoder.lastEncodeSeconds(), 0);
+        written = cv::imread(outputPath, cv::IMREAD_GRAYSCALE);
+        return std::filesystem::file_size(outputPath);
+    };
+
+    cv::Mat written;
+    uintmax_t stored = encodedSize({"--png-level=0"}, ".png", written);
+    EXPECT_EQ(cv::norm(written, expected, cv::NORM_INF), 0);
+    uintmax_t rle = encodedSize({"--png-level=9", "--png-strategy=rle"}, ".png", written);
+    EXPECT_EQ(cv::norm(written, expected, cv::NORM_INF), 0);
+    EXPECT_LT(rle, stored);
+
+    uintmax_t pgm = encodedSize({}, ".pgm", written);
+    EXPECT_EQ(cv::norm(written, expected, cv::NORM_INF), 0);
+    EXPECT_GE(pgm, expected.total());
+    EXPECT_LT(pgm, expected.total() + 64);
+
+    uintmax_t low = encodedSize({"--quality=20"}, ".jpg", written);
+    uintmax_t high = encodedSize({"--quality=95"}, ".jpg", written);
+    EXPECT_LT(low, high);
+
+    if (cv::haveImageWriter(".webp")) {
+        encodedSize({"--quality=50"}, ".webp", written);
+        EXPECT_EQ(written.size(), expected.size());
+    }
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include "utils/execution_config.h"
+#include "utils/thread_affinity.h"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <stdexcept>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/**
+ * Test suite for the execution configuration and thread pinning.
+ *
+ * Tests command line flag parsing, rejection of invalid values,
+ * and the CPU plans produced for each pinning policy.
+ */
+class ExecutionConfigTest : public ::testing::Test {
+protected:
+    ExecutionConfig config;
+};
+
+/**
+ * Tests that the defaults leave threading to OpenMP.
+ */
+TEST_F(ExecutionConfigTest, Defaults) {
+    EXPECT_EQ(config.numThreads, 0);
+    EXPECT_EQ(config.schedule, ScheduleKind::Tiled);
+    EXPECT_TRUE(config.tileSize.empty());
+    EXPECT_EQ(config.pinning, PinPolicy::None);
+}
+
+/**
+ * Tests that every flag is parsed into the matching field.
+ */
+TEST_F(ExecutionConfigTest, ParsesFlags) {
+    EXPECT_TRUE(config.parseFlag("--threads=3"));
+    EXPECT_TRUE(config.parseFlag("--schedule=dynamic"));
+    EXPECT_TRUE(config.parseFlag("--chunk=8"));
+    EXPECT_TRUE(config.parseFlag("--tile=128x64"));
+    EXPECT_TRUE(config.parseFlag("--pin=scatter"));
+
+    EXPECT_EQ(config.numThreads, 3);
+    EXPECT_EQ(config.schedule, ScheduleKind::Dynamic);
+    EXPECT_EQ(config.chunkSize, 8);
+    EXPECT_EQ(config.tileSize, cv::Size(128, 64));
+    EXPECT_EQ(config.pinning, PinPolicy::Scatter);
+
+    EXPECT_TRUE(config.parseFlag("--tile=96"));
+    EXPECT_EQ(config.tileSize, cv::Size(96, 96));
+}
+
+/**
+ * Tests that toString produces flags that parse back to the same configuration.
+ */
+TEST_F(ExecutionConfigTest, RoundTrip) {
+    config.numThreads = 5;
+    config.schedule = ScheduleKind::Static;
+    config.chunkSize = 4;
+    config.pinning = PinPolicy::Compact;
+
+    ExecutionConfig parsed;
+    std::string flags = config.toString();
+    size_t begin = 0;
+    while (begin < flags.size()) {
+        size_t end = flags.find(' ', begin);
+        if (end == std::string::npos) {
+            end = flags.size();
+        }
+        EXPECT_TRUE(parsed.parseFlag(flags.substr(begin, end - begin)));
+        begin = end + 1;
+    }
+
+    EXPECT_EQ(parsed.numThreads, 5);
+    EXPECT_EQ(parsed.schedule, ScheduleKind::Static);
+    EXPECT_EQ(parsed.chunkSize, 4);
+    EXPECT_TRUE(parsed.tileSize.empty());
+    EXPECT_EQ(parsed.pinning, PinPolicy::Compact);
+}
+
+/**
+ * Tests that unknown flags are reported and invalid values rejected.
+ */
+TEST_F(ExecutionConfigTest, RejectsInvalidValues) {
+    EXPECT_FALSE(config.parseFlag("--verbose"));
+    EXPECT_FALSE(config.parseFlag("--colour=red"));
+    EXPECT_FALSE(config.parseFlag("threads=2"));
+
+    EXPECT_THROW(config.parseFlag("--threads=-1"), std::runtime_error);
+    EXPECT_THROW(config.parseFlag("--threads=two"), std::runtime_error);
+    EXPECT_THROW(config.parseFlag("--chunk=0"), std::runtime_error);
+    EXPECT_THROW(config.parseFlag("--tile=64x"), std::runtime_error);
+    EXPECT_THROW(config.parseFlag("--schedule=guided"), std::runtime_error);
+    EXPECT_THROW(config.parseFlag("--pin=everywhere"), std::runtime_error);
+}
+
+/**
+ * Tests that CPU plans only use allowed CPUs.
+ *
+ * Compact packs threads onto the first allowed CPUs and
+ * scatter spreads them over the whole allowed set.
+ */
+TEST_F(ExecutionConfigTest, CpuPlans) {
+    EXPECT_TRUE(ThreadAffinity::planCpus(config, 4).empty());
+
+    std::vector<int> allowed = ThreadAffinity::allowedCpus();
+    if (allowed.empty()) {
+        GTEST_SKIP() << "Thread affinity is not supported on this platform";
+    }
+
+    for (PinPolicy policy : {PinPolicy::Compact, PinPolicy::Scatter}) {
+        config.pinning = policy;
+        std::vector<int> plan = ThreadAffinity::planCpus(config, 3);
+        ASSERT_EQ(plan.size(), 3u);
+        for (int cpu : plan) {
+            EXPECT_NE(std::find(allowed.begin(), allowed.end(), cpu), allowed.end());
+        }
+
+        std::vector<int> order = ThreadAffinity::orderCpus(policy);
+        std::vector<int> sortedOrder = order;
+        std::sort(sortedOrder.begin(), sortedOrder.end());
+        EXPECT_EQ(sortedOrder, allowed) << "every allowed CPU appears exactly once";
+    }
+}
+
+/**
+ * Tests parsing of cpuset-style CPU lists.
+ */
+TEST_F(ExecutionConfigTest, ParsesCpuList) {
+    EXPECT_EQ(ExecutionConfig::parseCpuList("0-3,8,2"), std::vector<int>({0, 1, 2, 3, 8}));
+    EXPECT_EQ(ExecutionConfig::parseCpuList("5"), std::vector<int>({5}));
+
+    EXPECT_THROW(ExecutionConfig::parseCpuList(""), std::runtime_error);
+    EXPECT_THROW(ExecutionConfig::parseCpuList("3-1"), std::runtime_error);
+    EXPECT_THROW(ExecutionConfig::parseCpuList("0,,2"), std::runtime_error);
+    EXPECT_THROW(ExecutionConfig::parseCpuList("a-b"), std::runtime_error);
+
+    EXPECT_TRUE(config.parseFlag("--cpus=1,0"));
+    EXPECT_EQ(config.pinning, PinPolicy::List);
+    EXPECT_EQ(config.cpuList, std::vector<int>({0, 1}));
+}
+
+/**
+ * Tests that an explicit CPU list is limited to the allowed CPUs.
+ *
+ * Listed CPUs outside the process's cpuset are dropped, and a
+ * list with no allowed CPU at all is rejected.
+ */
+TEST_F(ExecutionConfigTest, CpuListRespectsAllowedSet) {
+    std::vector<int> allowed = ThreadAffinity::allowedCpus();
+    if (allowed.empty()) {
+        GTEST_SKIP() << "Thread affinity is not supported on this platform";
+    }
+
+    config.pinning = PinPolicy::List;
+    config.cpuList = {allowed.front(), 100000};
+    std::vector<int> plan = ThreadAffinity::planCpus(config, 2);
+    EXPECT_EQ(plan, std::vector<int>({allowed.front(), allowed.front()}));
+
+    config.cpuList = {100000};
+    EXPECT_THROW(ThreadAffinity::planCpus(config, 2), std::runtime_error);
+}
+
+/**
+ * Tests that OpenCV workers can be pinned without hanging
+ * when the pool is smaller than requested, and that the calling
+ * thread, whose mask later threads inherit, is left unpinned.
+ */
+TEST_F(ExecutionConfigTest, PinsOpenCVWorkers) {
+    EXPECT_EQ(ThreadAffinity::pinOpenCVWorkers(config), 0);
+
+    if (ThreadAffinity::allowedCpus().empty()) {
+        GTEST_SKIP() << "Thread affinity is not supported on this platform";
+    }
+
+    config.pinning = PinPolicy::Compact;
+    int pinned = ThreadAffinity::pinOpenCVWorkers(config);
+    EXPECT_GE(pinned, 0);
+    EXPECT_LE(pinned, std::max(0, cv::getNumThreads() - 1));
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    ASSERT_EQ(sched_getaffinity(0, sizeof(set), &set), 0);
+    EXPECT_EQ(CPU_COUNT(&set), static_cast<int>(ThreadAffinity::allowedCpus().size()));
+#endif
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/ocv_prewitt.h"
+#include "gradient/alt_sobel.h"
+#include "utils/gradient_tensor.h"
+#include <opencv2/opencv.hpp>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the gradient tensor output.
+ *
+ * Tests that the .npy file has a fixed-size header and holds the
+ * operator's own gradients and their magnitude as float planes.
+ */
+class GradientTensorTest : public GradientOperatorTest {
+protected:
+    static std::vector<uint8_t> readFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+};
+
+/**
+ * Tests the layout: the header, then three planes at fixed offsets.
+ */
+TEST_F(GradientTensorTest, WritesFixedLayout) {
+    cv::Mat gradX = (cv::Mat_<int>(2, 3) << 3, 0, -1, 2, 5, 0);
+    cv::Mat gradY = (cv::Mat_<int>(2, 3) << 4, 0, 0, -2, 12, 7);
+
+    std::vector<uint8_t> encoded = GradientTensor::encode(gradX, gradY);
+    ASSERT_EQ(encoded.size(), GradientTensor::headerBytes + 3 * 6 * sizeof(float));
+    EXPECT_EQ(std::memcmp(encoded.data(), "\x93NUMPY\x01\x00", 8), 0);
+    EXPECT_EQ(encoded[8] | (encoded[9] << 8), GradientTensor::headerBytes - 10);
+    EXPECT_EQ(encoded[GradientTensor::headerBytes - 1], '\n');
+
+    // the magnitude of (3, 4) at the first pixel, read in place
+    float first = 0;
+    std::memcpy(&first, encoded.data() + GradientTensor::headerBytes + 2 * 6 * sizeof(float), sizeof(float));
+    EXPECT_FLOAT_EQ(first, 5);
+
+    std::vector<cv::Mat> planes = GradientTensor::decode(encoded);
+    ASSERT_EQ(planes.size(), 3u);
+    EXPECT_FLOAT_EQ(planes[0].at<float>(1, 1), 5);
+    EXPECT_FLOAT_EQ(planes[1].at<float>(1, 1), 12);
+    EXPECT_FLOAT_EQ(planes[2].at<float>(1, 1), 13);
+
+    EXPECT_THROW(GradientTensor::encode(gradX, cv::Mat(3, 2, CV_32S)), std::runtime_error);
+    EXPECT_THROW(GradientTensor::decode(std::vector<uint8_t>(encoded.begin(), encoded.end() - 4)), std::runtime_error);
+}
+
+/**
+ * Tests that getEdges writes the gradients the operator computed, for
+ * floating point and integer gradients.
+ */
+TEST_F(GradientTensorTest, WritesOperatorGradients) {
+    std::vector<std::unique_ptr<GradientOperator>> operators;
+    operators.push_back(std::make_unique<OcvPrewitt>());
+    operators.push_back(std::make_unique<AltSobel>());
+
+    for (auto& gradientOperator : operators) {
+        cv::Mat image = cv::imread(testImagePath, gradientOperator->inputMode());
+        GradientPlanes expected;
+        (void)gradientOperator->detectEdgesWithGradients(image, expected);
+
+        std::string outputPath = getUniqueOutputPath("gradients") + ".npy";
+        gradientOperator->getEdges(testImagePath, outputPath);
+        std::vector<cv::Mat> planes = GradientTensor::decode(readFile(outputPath));
+        ASSERT_EQ(planes[0].size(), image.size()) << gradientOperator->getOperatorName();
+
+        cv::Mat gradX;
+        cv::Mat gradY;
+        cv::Mat magnitude;
+        expected.gradX.convertTo(gradX, CV_32F);
+        expected.gradY.convertTo(gradY, CV_32F);
+        cv::magnitude(gradX, gradY, magnitude);
+        EXPECT_EQ(cv::norm(planes[0], gradX, cv::NORM_INF), 0) << gradientOperator->getOperatorName();
+        EXPECT_EQ(cv::norm(planes[1], gradY, cv::NORM_INF), 0) << gradientOperator->getOperatorName();
+        EXPECT_LT(cv::norm(planes[2], magnitude, cv::NORM_INF), 1e-3) << gradientOperator->getOperatorName();
+    }
+}
@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/alt_sobel.h"
+#include "gradient/ocv_sobel.h"
+#include "gradient/omp_sobel.h"
+#include "gradient/operator_registry.h"
+#include "video/incremental_edges.h"
+#include "video/video_pipeline.h"
+#include <opencv2/opencv.hpp>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the incremental recomputation of frame sequences.
+ *
+ * Tests the flags and halo radii, that recomputing only the changed
+ * tiles gives the edges of the whole frame for every frame of a
+ * mostly static sequence, and that cuts, noise below the threshold
+ * and operators without a halo are handled.
+ */
+class IncrementalEdgesTest : public GradientOperatorTest {
+protected:
+    // A static background with a square moving across it.
+    std::vector<cv::Mat> makeFrames(int count) {
+        cv::Mat background;
+        cv::resize(loadTestImage(), background, cv::Size(320, 240));
+        std::vector<cv::Mat> frames;
+        for (int i = 0; i < count; ++i) {
+            cv::Mat frame = background.clone();
+            cv::rectangle(frame, cv::Rect(40 + 13 * i, 60 + 5 * i, 24, 24), cv::Scalar(20, 200, 90), -1);
+            frames.push_back(frame);
+        }
+        return frames;
+    }
+
+    static IncrementalOptions withTiles(int side, double threshold = 0) {
+        IncrementalOptions options;
+        options.enabled = true;
+        options.tileSize = cv::Size(side, side);
+        options.threshold = threshold;
+        return options;
+    }
+
+    // Checks every frame against the whole-frame edges and returns the share of tiles recomputed.
+    double expectWholeFrameEdges(GradientOperator& gradientOperator, const std::vector<cv::Mat>& frames,
+                                 double tolerance = 0) {
+        IncrementalEdges incremental(gradientOperator, withTiles(32));
+        size_t tiles = 0;
+        size_t dirtyTiles = 0;
+        for (size_t i = 0; i < frames.size(); ++i) {
+            cv::Mat edges = incremental.detectEdges(frames[i]).clone();
+            EXPECT_LE(cv::norm(edges, gradientOperator.detectEdges(frames[i]), cv::NORM_INF), tolerance)
+                << gradientOperator.getOperatorName() << " frame " << i;
+            if (i > 0) {
+                tiles += incremental.lastTiles();
+                dirtyTiles += incremental.lastDirtyTiles();
+            }
+        }
+        return static_cast<double>(dirtyTiles) / static_cast<double>(tiles);
+    }
+};
+
+/**
+ * Tests parsing of the --incremental and --dirty-threshold flags.
+ */
+TEST_F(IncrementalEdgesTest, ParsesFlags) {
+    IncrementalOptions options;
+    EXPECT_FALSE(options.enabled);
+    EXPECT_FALSE(options.parseFlag("--depth=2"));
+
+    EXPECT_TRUE(options.parseFlag("--incremental"));
+    EXPECT_TRUE(options.enabled);
+    EXPECT_EQ(options.tileSize, cv::Size(64, 64));
+    EXPECT_TRUE(options.parseFlag("--incremental=128x32"));
+    EXPECT_EQ(options.tileSize, cv::Size(128, 32));
+    EXPECT_TRUE(options.parseFlag("--dirty-threshold=1.5"));
+    EXPECT_DOUBLE_EQ(options.threshold, 1.5);
+
+    EXPECT_THROW(options.parseFlag("--incremental=4"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--incremental=64x"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--dirty-threshold=-1"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--dirty-threshold=many"), std::runtime_error);
+}
+
+/**
+ * Tests the halo radius of local operators, with and without
+ * smoothing, and that normalizing operators have none.
+ */
+TEST_F(IncrementalEdgesTest, ReportsHaloRadius) {
+    OmpSobel ompSobel;
+    EXPECT_EQ(ompSobel.haloRadius(), 1);
+    EdgeOptions smoothing;
+    smoothing.sigma = 1.5;
+    ompSobel.setEdgeOptions(smoothing);
+    EXPECT_EQ(ompSobel.haloRadius(), 6);
+
+    EXPECT_EQ(OcvSobel().haloRadius(), -1);
+    EXPECT_EQ(OperatorRegistry::builtin().create("pipeline:blur=5,sobel")->haloRadius(), 3);
+    EXPECT_EQ(OperatorRegistry::builtin().create("pipeline:sobel,normalize")->haloRadius(), -1);
+}
+
+/**
+ * Tests that every frame gets the edges of the whole frame while only
+ * the tiles around the moving square are recomputed.
+ */
+TEST_F(IncrementalEdgesTest, MatchesWholeFrames) {
+    std::vector<cv::Mat> frames = makeFrames(6);
+
+    OmpSobel ompSobel;
+    EXPECT_LT(expectWholeFrameEdges(ompSobel, frames), 0.25);
+
+    AltSobel altSobel;
+    EXPECT_LT(expectWholeFrameEdges(altSobel, frames), 0.25);
+
+    std::unique_ptr<GradientOperator> pipeline = OperatorRegistry::builtin().create("pipeline:blur=5,sobel");
+    EXPECT_LT(expectWholeFrameEdges(*pipeline, frames), 0.25);
+
+    // the separable filters may round one level differently on regions of another width
+    OmpSobel smoothed;
+    EdgeOptions smoothing;
+    smoothing.sigma = 1.5;
+    smoothed.setEdgeOptions(smoothing);
+    EXPECT_LT(expectWholeFrameEdges(smoothed, frames, 1), 0.5);
+}
+
+/**
+ * Tests that a cut recomputes the whole frame, that noise below the
+ * threshold keeps every tile and that the first frame is whole.
+ */
+TEST_F(IncrementalEdgesTest, HandlesCutsAndNoise) {
+    std::vector<cv::Mat> frames = makeFrames(2);
+    OmpSobel ompSobel;
+
+    IncrementalEdges incremental(ompSobel, withTiles(32));
+    incremental.detectEdges(frames[0]);
+    EXPECT_EQ(incremental.lastDirtyTiles(), incremental.lastTiles());
+    EXPECT_EQ(incremental.lastTiles(), 10u * 8u);
+
+    cv::Mat cut;
+    cv::flip(frames[0], cut, 1);
+    EXPECT_EQ(cv::norm(incremental.detectEdges(cut), ompSobel.detectEdges(cut), cv::NORM_INF), 0);
+    EXPECT_EQ(incremental.lastDirtyTiles(), incremental.lastTiles());
+    incremental.detectEdges(cut);
+    EXPECT_EQ(incremental.lastDirtyTiles(), 0u);
+
+    cv::Mat noise(frames[0].size(), CV_8UC3);
+    cv::randu(noise, 0, 2);
+    cv::Mat noisy = frames[0] + noise;
+
+    IncrementalEdges tolerant(ompSobel, withTiles(32, 2));
+    tolerant.detectEdges(frames[0]);
+    tolerant.detectEdges(noisy);
+    EXPECT_EQ(tolerant.lastDirtyTiles(), 0u);
+
+    IncrementalEdges exact(ompSobel, withTiles(32));
+    exact.detectEdges(frames[0]);
+    EXPECT_EQ(cv::norm(exact.detectEdges(noisy), ompSobel.detectEdges(noisy), cv::NORM_INF), 0);
+    EXPECT_EQ(exact.lastDirtyTiles(), exact.lastTiles());
+}
+
+/**
+ * Tests that operators that normalize by the whole frame compute every
+ * frame whole, and that global thresholds are applied to the assembled
+ * edge map.
+ */
+TEST_F(IncrementalEdgesTest, KeepsWholeFrameSemantics) {
+    std::vector<cv::Mat> frames = makeFrames(3);
+
+    OcvSobel ocvSobel;
+    IncrementalEdges normalizing(ocvSobel, withTiles(32));
+    EXPECT_FALSE(normalizing.isIncremental());
+    for (const cv::Mat& frame : frames) {
+        EXPECT_EQ(cv::norm(normalizing.detectEdges(frame), ocvSobel.detectEdges(frame), cv::NORM_INF), 0);
+        EXPECT_EQ(normalizing.lastDirtyTiles(), normalizing.lastTiles());
+    }
+
+    OmpSobel ompSobel;
+    EdgeOptions otsu;
+    otsu.threshold = EdgeOptions::Threshold::Otsu;
+    ompSobel.setEdgeOptions(otsu);
+    IncrementalEdges incremental(ompSobel, withTiles(32));
+    for (const cv::Mat& frame : frames) {
+        EdgeResult result = incremental.computeEdges(frame, ".png");
+        EXPECT_EQ(cv::norm(result.edges, ompSobel.computeEdges(frame, ".png").edges, cv::NORM_INF), 0);
+    }
+
+    // a result still being encoded is not changed by the next frame
+    OmpSobel plain;
+    IncrementalEdges unthresholded(plain, withTiles(32));
+    EdgeResult first = unthresholded.computeEdges(frames[0], ".png");
+    cv::Mat expected = first.edges.clone();
+    unthresholded.computeEdges(frames[1], ".png");
+    EXPECT_EQ(cv::norm(first.edges, expected, cv::NORM_INF), 0);
+
+    EXPECT_THROW(IncrementalEdges(ompSobel, withTiles(0)), std::runtime_error);
+}
+
+/**
+ * Tests that the video pipeline writes the same frames incrementally
+ * and counts the recomputed tiles.
+ */
+TEST_F(IncrementalEdgesTest, RunsInVideoPipeline) {
+    std::vector<cv::Mat> frames = makeFrames(8);
+    std::string inputPath = testOutputDir + "/moving.y4m";
+    {
+        Y4mWriter writer(inputPath, FrameRate());
+        for (const cv::Mat& frame : frames) {
+            cv::Mat gray;
+            cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+            writer.writeFrame(gray);
+        }
+        writer.close();
+    }
+
+    OmpSobel ompSobel;
+    std::vector<std::vector<cv::Mat>> outputs;
+    for (bool enabled : {false, true}) {
+        std::string outputPath = testOutputDir + (enabled ? "/incremental.y4m" : "/whole.y4m");
+        Y4mReader source(inputPath, ompSobel.inputMode());
+        Y4mWriter sink(outputPath, source.rate());
+        VideoPipeline pipeline(ompSobel, 3);
+        IncrementalOptions options = withTiles(32);
+        options.enabled = enabled;
+        pipeline.setIncremental(options);
+        VideoStats stats = pipeline.run(source, sink);
+        EXPECT_EQ(stats.frames, frames.size());
+        if (enabled) {
+            EXPECT_EQ(stats.tiles, frames.size() * 80);
+            EXPECT_LT(stats.dirtyTiles, stats.tiles / 2);
+        } else {
+            EXPECT_EQ(stats.tiles, 0u);
+        }
+
+        Y4mReader written(outputPath, cv::IMREAD_GRAYSCALE);
+        std::vector<cv::Mat> edges;
+        cv::Mat frame;
+        while (written.read(frame)) {
+            edges.push_back(frame.clone());
+        }
+        outputs.push_back(edges);
+    }
+    ASSERT_EQ(outputs[1].size(), outputs[0].size());
+    for (size_t i = 0; i < outputs[0].size(); ++i) {
+        EXPECT_EQ(cv::norm(outputs[1][i], outputs[0][i], cv::NORM_INF), 0) << "frame " << i;
+    }
+}
@@ -162,3 +162,31 @@ TEST_F(OcvSobelTest, MemoryUsage) {
     
     verifyOutputImage(outputPath);
 }
+
+/**
+ * Tests that a bounded stripe count gives the edges and gradients of
+ * a single pass, with and without smoothing, and leaves the OpenCV
+ * thread count of the process alone.
+ */
+TEST_F(OcvSobelTest, StripesMatchSinglePass) {
+    cv::Mat image = loadTestImage();
+    int threadsBefore = cv::getNumThreads();
+
+    for (double sigma : {0.0, 1.5}) {
+        EdgeOptions options;
+        options.sigma = sigma;
+        OcvSobel whole;
+        OcvSobel striped(3, 3);
+        whole.setEdgeOptions(options);
+        striped.setEdgeOptions(options);
+
+        GradientPlanes expected;
+        GradientPlanes planes;
+        cv::Mat expectedEdges = whole.detectEdgesWithGradients(image, expected);
+        EXPECT_EQ(cv::norm(striped.detectEdgesWithGradients(image, planes), expectedEdges, cv::NORM_INF), 0)
+            << "sigma " << sigma;
+        EXPECT_EQ(cv::norm(planes.gradX, expected.gradX, cv::NORM_INF), 0) << "sigma " << sigma;
+        EXPECT_EQ(cv::norm(planes.gradY, expected.gradY, cv::NORM_INF), 0) << "sigma " << sigma;
+    }
+    EXPECT_EQ(cv::getNumThreads(), threadsBefore);
+}
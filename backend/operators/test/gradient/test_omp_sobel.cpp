@@ -51,20 +51,49 @@ TEST_F(OmpSobelTest, BasicEdgeDetection) {
  */
 TEST_F(OmpSobelTest, DifferentThreadCounts) {
     std::vector<int> threadCounts = {1, 2, 4, 8};
+    cv::Mat reference = operator_->detectEdges(loadTestImage());
     
     for (int threads : threadCounts) {
-        OmpSobel sobel(threads);
+        ExecutionConfig config;
+        config.numThreads = threads;
+        OmpSobel sobel(3, config);
+        EXPECT_EQ(sobel.getExecutionConfig().numThreads, threads);
+
         std::string outputPath = getUniqueOutputPath("omp_sobel_threads_" + std::to_string(threads));
         
         EXPECT_NO_THROW({
             cv::Mat result = sobel.getEdges(testImagePath, outputPath);
             EXPECT_FALSE(result.empty());
+            EXPECT_EQ(compareImages(result, reference), 0.0);
         });
         
         verifyOutputImage(outputPath);
     }
 }
 
+/**
+ * Tests that every schedule kind produces the same result.
+ *
+ * The static and dynamic schedules run row bands instead of
+ * tiles, which changes the halo seams but must not change
+ * the output.
+ */
+TEST_F(OmpSobelTest, ScheduleKindsAgree) {
+    cv::Mat image = loadTestImage();
+    cv::Mat reference = operator_->detectEdges(image);
+
+    for (const char* schedule : {"tiled", "static", "dynamic"}) {
+        ExecutionConfig config;
+        config.schedule = ExecutionConfig::parseSchedule(schedule);
+        config.chunkSize = 7;
+        config.tileSize = cv::Size(40, 24);
+        config.numThreads = 3;
+
+        cv::Mat result = OmpSobel(3, config).detectEdges(image);
+        EXPECT_EQ(compareImages(result, reference), 0.0) << "schedule: " << schedule;
+    }
+}
+
 /**
  * Tests operator name consistency.
  * 
@@ -123,7 +152,9 @@ TEST_F(OmpSobelTest, SyntheticImageEdgeDetection) {
  * potentially improving performance. Ensures thread safety.
  */
 TEST_F(OmpSobelTest, ParallelizationBenefits) {
-    OmpSobel singleThread(1);
+    ExecutionConfig singleConfig;
+    singleConfig.numThreads = 1;
+    OmpSobel singleThread(3, singleConfig);
     std::string outputPath1 = getUniqueOutputPath("omp_sobel_single");
     
     auto start1 = std::chrono::high_resolution_clock::now();
@@ -131,7 +162,9 @@ TEST_F(OmpSobelTest, ParallelizationBenefits) {
     auto end1 = std::chrono::high_resolution_clock::now();
     auto duration1 = std::chrono::duration_cast<std::chrono::milliseconds>(end1 - start1);
     
-    OmpSobel multiThread(4);
+    ExecutionConfig multiConfig;
+    multiConfig.numThreads = 4;
+    OmpSobel multiThread(3, multiConfig);
     std::string outputPath4 = getUniqueOutputPath("omp_sobel_multi");
     
     auto start4 = std::chrono::high_resolution_clock::now();
@@ -149,6 +182,44 @@ TEST_F(OmpSobelTest, ParallelizationBenefits) {
     verifyOutputImage(outputPath4);
 }
 
+/**
+ * Tests that the tiled pipeline matches a whole-image reference.
+ *
+ * Uses an image that spans many tiles with edges crossing tile
+ * boundaries, so a wrong halo or clipping would show up as a
+ * mismatch along the seams.
+ */
+TEST_F(OmpSobelTest, TiledMatchesReference) {
+    cv::Mat testImage = createSimpleTestImage(700, 530);
+    cv::line(testImage, cv::Point(0, 0), cv::Point(699, 529), cv::Scalar(30, 200, 90), 3);
+    std::string inputPath = testOutputDir + "/tiled_input_omp.png";
+    cv::imwrite(inputPath, testImage);
+
+    cv::Mat result = operator_->getEdges(inputPath, getUniqueOutputPath("omp_sobel_tiled"));
+
+    cv::Mat input = cv::imread(inputPath);
+    cv::Mat gray(input.rows, input.cols, CV_8UC1);
+    for (int i = 0; i < input.rows; ++i) {
+        for (int j = 0; j < input.cols; ++j) {
+            const auto& pixel = input.at<cv::Vec3b>(i, j);
+            gray.at<uint8_t>(i, j) = static_cast<uint8_t>(0.299 * pixel[0] + 0.587 * pixel[1] + 0.114 * pixel[2]);
+        }
+    }
+
+    cv::Mat expected(input.rows, input.cols, CV_8UC1, cv::Scalar(0));
+    for (int i = 1; i < input.rows - 1; ++i) {
+        for (int j = 1; j < input.cols - 1; ++j) {
+            auto g = [&](int di, int dj) { return static_cast<int>(gray.at<uint8_t>(i + di, j + dj)); };
+            int gx = -g(-1, -1) + g(-1, 1) - 2 * g(0, -1) + 2 * g(0, 1) - g(1, -1) + g(1, 1);
+            int gy = -g(-1, -1) - 2 * g(-1, 0) - g(-1, 1) + g(1, -1) + 2 * g(1, 0) + g(1, 1);
+            int magnitude = static_cast<int>(std::sqrt(gx * gx + gy * gy));
+            expected.at<uint8_t>(i, j) = static_cast<uint8_t>(std::min(255, magnitude));
+        }
+    }
+
+    EXPECT_EQ(cv::norm(result, expected, cv::NORM_INF), 0.0);
+}
+
 /**
  * Tests performance consistency across multiple runs.
  * 
@@ -217,7 +288,9 @@ TEST_F(OmpSobelTest, ThreadSafety) {
     
     for (int i = 0; i < numThreads; ++i) {
         threads.emplace_back([this, i, &outputPaths]() {
-            OmpSobel sobel(2);
+            ExecutionConfig config;
+            config.numThreads = 2;
+            OmpSobel sobel(3, config);
             cv::Mat result = sobel.getEdges(testImagePath, outputPaths[i]);
             EXPECT_FALSE(result.empty());
         });
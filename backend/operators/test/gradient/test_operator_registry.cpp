@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/operator_registry.h"
+#include "gradient/ocv_sobel.h"
+#include <opencv2/opencv.hpp>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the operator registry.
+ *
+ * Tests lookup by canonical and URL-encoded names, that the
+ * built-in operators are all registered and produce edges, and
+ * that leased instances are reused per configuration.
+ */
+class OperatorRegistryTest : public GradientOperatorTest {};
+
+/**
+ * Tests that names sent by the backend routes find the same
+ * operators as their decoded forms.
+ */
+TEST_F(OperatorRegistryTest, FindsEncodedNames) {
+    OperatorRegistry& registry = OperatorRegistry::builtin();
+    EXPECT_EQ(OperatorRegistry::decodeName("sobel%3Aauto"), "sobel:auto");
+    EXPECT_EQ(OperatorRegistry::decodeName("100%"), "100%");
+
+    const OperatorDescriptor* descriptor = registry.find("opencv%20sobel");
+    ASSERT_NE(descriptor, nullptr);
+    EXPECT_EQ(descriptor, registry.find("opencv sobel"));
+    EXPECT_TRUE(descriptor->capabilities.threadSafe);
+
+    EXPECT_EQ(registry.find("canny"), nullptr);
+    EXPECT_THROW((void)registry.create("canny"), UnknownOperator);
+}
+
+/**
+ * Tests that every built-in operator is registered, detects
+ * edges on a synthetic image and streams exactly if it has a halo.
+ */
+TEST_F(OperatorRegistryTest, CreatesBuiltins) {
+    std::vector<const OperatorDescriptor*> descriptors = OperatorRegistry::builtin().list();
+    EXPECT_EQ(descriptors.size(), 7u);
+
+    cv::Mat image = createSimpleTestImage();
+    for (const OperatorDescriptor* descriptor : descriptors) {
+        std::string name = descriptor->takesArgument ? descriptor->name + ":sobel" : descriptor->name;
+        std::unique_ptr<GradientOperator> gradientOperator = OperatorRegistry::builtin().create(name);
+        cv::Mat edges = gradientOperator->detectEdges(image);
+        EXPECT_EQ(edges.size(), image.size()) << descriptor->name;
+        EXPECT_GT(cv::countNonZero(edges), 0) << descriptor->name;
+        EXPECT_EQ(descriptor->capabilities.streaming, gradientOperator->haloRadius() >= 0) << descriptor->name;
+    }
+}
+
+/**
+ * Tests that leased instances are reused per name and configuration
+ * but never shared between live leases, that their options are reset
+ * on release, and that registering a taken name fails.
+ */
+TEST_F(OperatorRegistryTest, ReusesInstances) {
+    OperatorRegistry registry;
+    int created = 0;
+    registry.add({"counted", "OcvSobel that counts its instances", {}, {false, true, true, true},
+                  [&created](const ExecutionConfig&, const std::string&) {
+                      ++created;
+                      return std::make_unique<OcvSobel>();
+                  }});
+
+    ExecutionConfig twoThreads;
+    twoThreads.numThreads = 2;
+    GradientOperator* reused = nullptr;
+    {
+        OperatorLease first = registry.acquire("counted");
+        OperatorLease concurrent = registry.acquire("counted");
+        OperatorLease configured = registry.acquire("counted", twoThreads);
+        EXPECT_NE(first.get(), concurrent.get());
+        EXPECT_NE(first.get(), configured.get());
+        EXPECT_EQ(created, 3);
+
+        EdgeOptions options;
+        options.sigma = 2;
+        first->setEdgeOptions(options);
+        reused = first.get();
+        concurrent.reset();
+    }
+
+    // released instances are handed out again, with the options of the last job reset
+    OperatorLease again = registry.acquire("counted");
+    OperatorLease other = registry.acquire("counted");
+    EXPECT_TRUE(again.get() == reused || other.get() == reused);
+    EXPECT_EQ(created, 3);
+    cv::Mat image = createSimpleTestImage();
+    EXPECT_EQ(cv::norm(again->detectEdges(image), OcvSobel().detectEdges(image), cv::NORM_INF), 0);
+    EXPECT_EQ(cv::norm(other->detectEdges(image), OcvSobel().detectEdges(image), cv::NORM_INF), 0);
+
+    EXPECT_EQ(registry.estimate("counted", cv::Size(10, 10)).peakBytes,
+              OcvSobel().estimateResources(cv::Size(10, 10)).peakBytes);
+    EXPECT_EQ(created, 4);
+    EXPECT_EQ(registry.estimate("counted", cv::Size(10, 10)).peakBytes,
+              OcvSobel().estimateResources(cv::Size(10, 10)).peakBytes);
+    EXPECT_EQ(created, 4);
+
+    EXPECT_THROW(registry.add({"counted", "", {}, {}, [](const ExecutionConfig&, const std::string&) {
+        return std::make_unique<OcvSobel>();
+    }}), std::runtime_error);
+}
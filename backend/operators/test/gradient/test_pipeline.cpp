@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "pipeline/pipeline.h"
+#include "gradient/pipeline_operator.h"
+#include "gradient/operator_registry.h"
+#include <opencv2/opencv.hpp>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the stage pipeline.
+ *
+ * Tests parsing of the comma-separated and JSON descriptions,
+ * how stages are grouped into passes, and that the fused tiled
+ * run matches the stage-by-stage run exactly, including at the
+ * image borders and for tiles smaller than the halo.
+ */
+class PipelineTest : public GradientOperatorTest {};
+
+/**
+ * Tests that both description formats give the same stages and
+ * that gray is prepended when it is missing.
+ */
+TEST_F(PipelineTest, ParsesDescriptions) {
+    Pipeline text = Pipeline::parse("blur=5,sobel,threshold=40");
+    EXPECT_EQ(text.toString(), "gray,blur=5,sobel,threshold=40");
+
+    Pipeline json = Pipeline::parse(
+        R"({"stages": [{"op": "gray"}, {"op": "blur", "size": 5}, {"op": "sobel"}, {"op": "threshold", "value": 40}]})");
+    EXPECT_EQ(json.toString(), text.toString());
+
+    EXPECT_THROW(Pipeline::parse(""), std::runtime_error);
+    EXPECT_THROW(Pipeline::parse("sobel,canny"), std::runtime_error);
+    EXPECT_THROW(Pipeline::parse("blur=4"), std::runtime_error);
+    EXPECT_THROW(Pipeline::parse("sobel,gray"), std::runtime_error);
+}
+
+/**
+ * Tests that fusable stages share a pass and whole-image stages
+ * split the pipeline.
+ */
+TEST_F(PipelineTest, GroupsPasses) {
+    EXPECT_EQ(Pipeline::parse("blur=5,sobel,threshold=40").countPasses(), 1);
+    EXPECT_EQ(Pipeline::parse("sobel,normalize").countPasses(), 2);
+    EXPECT_EQ(Pipeline::parse("sobel,normalize,threshold=128").countPasses(), 3);
+}
+
+/**
+ * Tests that the fused run equals the stage-by-stage run for
+ * several pipelines and tile sizes.
+ */
+TEST_F(PipelineTest, FusedMatchesUnfused) {
+    cv::Mat image = loadTestImage();
+    const std::vector<std::string> descriptions = {
+        "sobel",
+        "blur=5,sobel,threshold=40",
+        "blur=3,blur=7,prewitt",
+        "roberts,blur=3",
+        "blur,sobel,normalize,threshold=100",
+    };
+
+    for (const std::string& description : descriptions) {
+        Pipeline pipeline = Pipeline::parse(description);
+        cv::Mat expected = pipeline.runUnfused(image);
+
+        for (cv::Size tileSize : {cv::Size(64, 64), cv::Size(5, 3), cv::Size(1000, 1000)}) {
+            TileScheduler scheduler(tileSize);
+            cv::Mat fused = pipeline.run(image, scheduler);
+            ASSERT_EQ(fused.size(), expected.size());
+            EXPECT_EQ(cv::norm(fused, expected, cv::NORM_INF), 0)
+                << description << " with " << tileSize.width << "x" << tileSize.height << " tiles";
+        }
+    }
+}
+
+/**
+ * Tests the pipeline through the registry and getEdges.
+ */
+TEST_F(PipelineTest, RunsAsOperator) {
+    std::unique_ptr<GradientOperator> gradientOperator =
+        OperatorRegistry::builtin().create("pipeline%3Ablur%3D5%2Csobel%2Cthreshold%3D40");
+    EXPECT_EQ(gradientOperator->getOperatorName(), "Pipeline(gray,blur=5,sobel,threshold=40)");
+    EXPECT_THROW((void)OperatorRegistry::builtin().create("pipeline:sharpen"), std::runtime_error);
+
+    std::string outputPath = getUniqueOutputPath("pipeline");
+    cv::Mat edges = gradientOperator->getEdges(testImagePath, outputPath);
+    verifyOutputImage(outputPath);
+
+    // a binary result
+    cv::Mat notBinary;
+    cv::inRange(edges, 1, 254, notBinary);
+    EXPECT_EQ(cv::countNonZero(notBinary), 0);
+    EXPECT_GT(cv::countNonZero(edges), 0);
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/ocv_sobel.h"
+#include "utils/png_encoder.h"
+#include <opencv2/opencv.hpp>
+#include <omp.h>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the parallel PNG encoder.
+ *
+ * Tests that the stitched bands decode to the image in every channel
+ * layout and level, that the file does not depend on the number of
+ * threads, and that getEdges writes its PNGs with it.
+ */
+class PngEncoderTest : public GradientOperatorTest {
+protected:
+    static int countChunks(const std::vector<uint8_t>& png, const std::string& type) {
+        int count = 0;
+        for (size_t offset = 8; offset + 8 <= png.size();) {
+            size_t length = (static_cast<size_t>(png[offset]) << 24) | (png[offset + 1] << 16)
+                            | (png[offset + 2] << 8) | png[offset + 3];
+            count += std::string(png.begin() + offset + 4, png.begin() + offset + 8) == type;
+            offset += length + 12;
+        }
+        return count;
+    }
+};
+
+/**
+ * Tests that OpenCV decodes the output to the input for grayscale,
+ * BGR and BGRA images, in one band or many, at every level.
+ */
+TEST_F(PngEncoderTest, RoundTripsLayouts) {
+    cv::Mat color = loadTestImage();
+    cv::Mat gray;
+    cv::cvtColor(color, gray, cv::COLOR_BGR2GRAY);
+    cv::Mat alpha;
+    cv::cvtColor(color, alpha, cv::COLOR_BGR2BGRA);
+    cv::Mat tiny(7, 13, CV_8U);
+    cv::randu(tiny, 0, 256);
+
+    for (const cv::Mat& image : {gray, color, alpha, tiny}) {
+        for (int level : {0, 1, 6, 9}) {
+            std::vector<uint8_t> png = PngEncoder::encode(image, level, cv::IMWRITE_PNG_STRATEGY_DEFAULT);
+            cv::Mat decoded = cv::imdecode(png, cv::IMREAD_UNCHANGED);
+            ASSERT_EQ(decoded.size(), image.size()) << "level " << level;
+            ASSERT_EQ(decoded.channels(), image.channels());
+            EXPECT_EQ(cv::norm(decoded, image, cv::NORM_INF), 0) << image.channels() << " channels, level " << level;
+        }
+    }
+
+    // one IDAT chunk per band
+    size_t stride = static_cast<size_t>(color.cols) * 3 + 1;
+    int bandRows = static_cast<int>(PngEncoder::bandBytes / stride);
+    EXPECT_EQ(countChunks(PngEncoder::encode(color, 1, cv::IMWRITE_PNG_STRATEGY_RLE), "IDAT"),
+              (color.rows + bandRows - 1) / bandRows);
+    EXPECT_EQ(countChunks(PngEncoder::encode(tiny, 1, cv::IMWRITE_PNG_STRATEGY_RLE), "IDAT"), 1);
+
+    EXPECT_THROW(PngEncoder::encode(cv::Mat(4, 4, CV_32F), 1, 0), std::runtime_error);
+    EXPECT_THROW(PngEncoder::encode(gray, 10, 0), std::runtime_error);
+}
+
+/**
+ * Tests that the bands and their dictionaries do not depend on the
+ * threads, so the file is the same for any number of them.
+ */
+TEST_F(PngEncoderTest, OutputIgnoresThreads) {
+    cv::Mat edges = OcvSobel().detectEdges(loadTestImage());
+    int threads = omp_get_max_threads();
+
+    omp_set_num_threads(1);
+    std::vector<uint8_t> sequential = PngEncoder::encode(edges, 6, cv::IMWRITE_PNG_STRATEGY_FILTERED);
+    omp_set_num_threads(4);
+    std::vector<uint8_t> parallel = PngEncoder::encode(edges, 6, cv::IMWRITE_PNG_STRATEGY_FILTERED);
+    omp_set_num_threads(threads);
+
+    EXPECT_EQ(sequential, parallel);
+}
+
+/**
+ * Tests that getEdges writes PNGs that hold exactly the edges.
+ */
+TEST_F(PngEncoderTest, WritesEdgePng) {
+    OcvSobel sobel;
+    std::string outputPath = getUniqueOutputPath("parallel") + ".png";
+    cv::Mat edges = sobel.getEdges(testImagePath, outputPath);
+
+    cv::Mat written = cv::imread(outputPath, cv::IMREAD_UNCHANGED);
+    ASSERT_EQ(written.size(), edges.size());
+    EXPECT_EQ(cv::norm(written, edges, cv::NORM_INF), 0);
+}
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/alt_sobel.h"
+#include "gradient/ocv_sobel.h"
+#include "gradient/omp_sobel.h"
+#include "gradient/operator_registry.h"
+#include "utils/image_utils.h"
+#include <opencv2/opencv.hpp>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for processing a region of interest.
+ *
+ * Tests the --roi flag, that the edges of a region equal that part of
+ * the whole image's edges in every output format, and that uncompressed
+ * inputs are read only within the region.
+ */
+class RegionOfInterestTest : public GradientOperatorTest {
+protected:
+    static EdgeOptions withRegion(const cv::Rect& region, double sigma = 0) {
+        EdgeOptions options;
+        options.region = region;
+        options.sigma = sigma;
+        return options;
+    }
+
+    // Compares the region's edges with the crop of the whole image's edges.
+    void expectCrop(GradientOperator& gradientOperator, const cv::Mat& image, const cv::Rect& region,
+                    double tolerance = 0) {
+        cv::Mat whole = gradientOperator.detectEdges(image);
+        EdgeOptions options = withRegion(region);
+        gradientOperator.setEdgeOptions(options);
+        EdgeResult result = gradientOperator.computeEdges(image, ".png");
+        cv::Rect bounded = region & cv::Rect(0, 0, image.cols, image.rows);
+        ASSERT_EQ(result.edges.size(), bounded.size()) << gradientOperator.getOperatorName();
+        EXPECT_LE(cv::norm(result.edges, whole(bounded), cv::NORM_INF), tolerance)
+            << gradientOperator.getOperatorName() << " " << region;
+        gradientOperator.setEdgeOptions(EdgeOptions());
+    }
+};
+
+/**
+ * Tests parsing of the --roi flag.
+ */
+TEST_F(RegionOfInterestTest, ParsesFlag) {
+    EdgeOptions options;
+    EXPECT_FALSE(options.hasRegion());
+    EXPECT_TRUE(options.parseFlag("--roi=10,20,300,40"));
+    EXPECT_TRUE(options.hasRegion());
+    EXPECT_EQ(options.region, cv::Rect(10, 20, 300, 40));
+
+    EXPECT_THROW(options.parseFlag("--roi=10,20,300"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--roi=10,20,300,40,5"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--roi=-1,0,5,5"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--roi=0,0,0,5"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--roi=a,b,c,d"), std::runtime_error);
+}
+
+/**
+ * Tests that a region, inside the image or reaching past its corner,
+ * gets the edges of the whole image there.
+ */
+TEST_F(RegionOfInterestTest, MatchesCropOfWholeImage) {
+    cv::Mat image = loadTestImage();
+    cv::Rect inside(image.cols / 4, image.rows / 3, 97, 61);
+    cv::Rect corner(image.cols - 40, image.rows - 30, 100, 100);
+
+    OmpSobel ompSobel;
+    AltSobel altSobel;
+    std::unique_ptr<GradientOperator> pipeline = OperatorRegistry::builtin().create("pipeline:blur=5,sobel");
+    for (GradientOperator* gradientOperator : {static_cast<GradientOperator*>(&ompSobel),
+                                               static_cast<GradientOperator*>(&altSobel), pipeline.get()}) {
+        expectCrop(*gradientOperator, image, inside);
+        expectCrop(*gradientOperator, image, corner);
+        expectCrop(*gradientOperator, image, cv::Rect(0, 0, 50, 50));
+    }
+
+    // the separable filters may round one level differently on regions of another width
+    OmpSobel smoothed;
+    smoothed.setEdgeOptions(withRegion(cv::Rect(), 1.5));
+    cv::Mat whole = smoothed.detectEdges(image);
+    smoothed.setEdgeOptions(withRegion(inside, 1.5));
+    EXPECT_EQ(smoothed.inputRegion(image.size()), cv::Rect(inside.x - 6, inside.y - 6, 109, 73));
+    EXPECT_LE(cv::norm(smoothed.computeEdges(image, ".png").edges, whole(inside), cv::NORM_INF), 1);
+}
+
+/**
+ * Tests that gradient tensors and point lists are limited to the
+ * region, and that a region outside the image is rejected.
+ */
+TEST_F(RegionOfInterestTest, LimitsEveryFormat) {
+    cv::Mat image = loadTestImage();
+    cv::Rect region(30, 40, 64, 48);
+    OmpSobel ompSobel;
+    GradientPlanes planes;
+    cv::Mat whole = ompSobel.detectEdgesWithGradients(image, planes);
+
+    ompSobel.setEdgeOptions(withRegion(region));
+    EdgeResult tensor = ompSobel.computeEdges(image, ".npy");
+    EXPECT_EQ(tensor.planes.gradX.size(), region.size());
+    EXPECT_EQ(cv::norm(tensor.planes.gradX, planes.gradX(region), cv::NORM_INF), 0);
+    EXPECT_EQ(cv::norm(tensor.planes.gradY, planes.gradY(region), cv::NORM_INF), 0);
+    EXPECT_EQ(cv::norm(tensor.magnitude, whole(region), cv::NORM_INF), 0);
+
+    EdgeResult points = ompSobel.computeEdges(image, ".pts");
+    EXPECT_EQ(points.magnitude.size(), region.size());
+
+    ompSobel.setEdgeOptions(withRegion(cv::Rect(image.cols, 0, 10, 10)));
+    EXPECT_THROW(ompSobel.computeEdges(image, ".png"), std::runtime_error);
+
+    // operators that normalize have no halo and read the region alone
+    OcvSobel ocvSobel;
+    ocvSobel.setEdgeOptions(withRegion(region));
+    EXPECT_EQ(ocvSobel.inputRegion(image.size()), region);
+    EXPECT_EQ(ocvSobel.computeEdges(image, ".png").edges.size(), region.size());
+}
+
+/**
+ * Tests that uncompressed files are read within the region and give
+ * the pixels a whole decode would, and that other formats are cropped.
+ */
+TEST_F(RegionOfInterestTest, DecodesOnlyTheRegion) {
+    cv::Mat image = loadTestImage();
+    cv::Mat gray;
+    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    cv::Rect region(17, 9, 123, 45);
+
+    std::vector<std::string> names = {"/image.ppm", "/image.bmp", "/gray.pgm", "/image.png"};
+    for (const std::string& name : names) {
+        std::string path = testOutputDir + name;
+        ASSERT_TRUE(cv::imwrite(path, name == "/gray.pgm" ? gray : image));
+        EXPECT_EQ(ImageUtils::canDecodeRegion(path), name != "/image.png") << name;
+
+        cv::ImreadModes mode = name == "/gray.pgm" ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+        cv::Mat expected = cv::imread(path, mode)(region);
+        cv::Mat pixels = ImageUtils::getRegion(path, region, mode);
+        ASSERT_EQ(pixels.size(), region.size()) << name;
+        ASSERT_EQ(pixels.type(), expected.type()) << name;
+        EXPECT_EQ(cv::norm(pixels, expected, cv::NORM_INF), 0) << name;
+    }
+
+    std::string path = testOutputDir + "/image.ppm";
+    cv::Rect past(image.cols - 10, image.rows - 5, 50, 50);
+    EXPECT_EQ(ImageUtils::getRegion(path, past).size(), cv::Size(10, 5));
+    EXPECT_THROW(ImageUtils::getRegion(path, cv::Rect(image.cols, 0, 5, 5)), std::runtime_error);
+}
+
+/**
+ * Tests that getEdges writes the edges of the region, decoded with
+ * its halo only.
+ */
+TEST_F(RegionOfInterestTest, WritesRegionOfFile) {
+    cv::Mat image = loadTestImage();
+    std::string inputPath = testOutputDir + "/image.ppm";
+    ASSERT_TRUE(cv::imwrite(inputPath, image));
+    cv::Rect region(image.cols / 2, 3, 80, 70);
+
+    OmpSobel ompSobel;
+    cv::Mat whole = ompSobel.detectEdges(image);
+    ompSobel.setEdgeOptions(withRegion(region));
+    std::string outputPath = testOutputDir + "/region.png";
+    ompSobel.getEdges(inputPath, outputPath);
+
+    cv::Mat written = cv::imread(outputPath, cv::IMREAD_GRAYSCALE);
+    ASSERT_EQ(written.size(), region.size());
+    EXPECT_EQ(cv::norm(written, whole(region), cv::NORM_INF), 0);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "utils/resource_limits.h"
+#include "utils/image_utils.h"
+#include "gradient/ocv_sobel.h"
+#include "gradient/alt_sobel.h"
+#include "gradient/omp_sobel.h"
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the resource budget checked before decoding.
+ *
+ * Tests flag parsing, that estimates grow with the image, and
+ * that an oversize input is rejected or downscaled according to
+ * the policy before it is decoded at full size.
+ */
+class ResourceLimitsTest : public GradientOperatorTest {};
+
+/**
+ * Tests that the budget flags are parsed and unknown flags are left alone.
+ */
+TEST_F(ResourceLimitsTest, ParsesFlags) {
+    ResourceLimits limits;
+    EXPECT_FALSE(limits.isLimited());
+
+    EXPECT_TRUE(limits.parseFlag("--max-memory=256"));
+    EXPECT_TRUE(limits.parseFlag("--max-pixels=1000000"));
+    EXPECT_TRUE(limits.parseFlag("--oversize=downscale"));
+    EXPECT_FALSE(limits.parseFlag("--threads=2"));
+
+    EXPECT_EQ(limits.maxBytes, size_t(256) << 20);
+    EXPECT_EQ(limits.maxPixels, 1000000u);
+    EXPECT_EQ(limits.oversize, OversizePolicy::Downscale);
+    EXPECT_TRUE(limits.isLimited());
+
+    EXPECT_THROW(limits.parseFlag("--max-memory=0"), std::runtime_error);
+    EXPECT_THROW(limits.parseFlag("--max-pixels=-5"), std::runtime_error);
+    EXPECT_THROW(limits.parseFlag("--oversize=crop"), std::runtime_error);
+}
+
+/**
+ * Tests that estimates scale with the pixel count and reflect
+ * how much each operator allocates.
+ */
+TEST_F(ResourceLimitsTest, EstimatesScaleWithArea) {
+    OcvSobel ocvSobel;
+    AltSobel altSobel;
+    OmpSobel ompSobel(3, ExecutionConfig());
+
+    ResourceEstimate small = ocvSobel.estimateResources(cv::Size(100, 100));
+    ResourceEstimate large = ocvSobel.estimateResources(cv::Size(200, 200));
+    EXPECT_EQ(large.peakBytes, 4 * small.peakBytes);
+    EXPECT_GT(large.seconds, small.seconds);
+
+    cv::Size size(1000, 1000);
+    EXPECT_GT(altSobel.estimateResources(size).peakBytes, ocvSobel.estimateResources(size).peakBytes);
+    EXPECT_LT(ompSobel.estimateResources(size).peakBytes, ocvSobel.estimateResources(size).peakBytes);
+}
+
+/**
+ * Tests the reduction plan for a JPEG and a PNG header, including
+ * the full-size decode that PNG needs before it can be resized.
+ */
+TEST_F(ResourceLimitsTest, PlansReduction) {
+    OcvSobel ocvSobel;
+    ImageInfo info;
+    info.width = 4000;
+    info.height = 3000;
+    info.channels = 3;
+    info.bitDepth = 8;
+    info.format = "jpeg";
+
+    ResourceLimits limits;
+    limits.maxBytes = ocvSobel.estimateResources(cv::Size(1000, 750)).peakBytes;
+    ocvSobel.setResourceLimits(limits);
+    EXPECT_THROW((void)ocvSobel.planReduction(info, cv::IMREAD_GRAYSCALE), ImageTooLarge);
+
+    limits.oversize = OversizePolicy::Downscale;
+    ocvSobel.setResourceLimits(limits);
+    EXPECT_EQ(ocvSobel.planReduction(info, cv::IMREAD_GRAYSCALE), 4);
+
+    // 12 MB of full-size grayscale decode never fits a budget this small
+    info.format = "png";
+    EXPECT_THROW((void)ocvSobel.planReduction(info, cv::IMREAD_GRAYSCALE), ImageTooLarge);
+
+    limits = ResourceLimits();
+    limits.maxPixels = 4000u * 3000u;
+    ocvSobel.setResourceLimits(limits);
+    EXPECT_EQ(ocvSobel.planReduction(info, cv::IMREAD_GRAYSCALE), 1);
+}
+
+/**
+ * Tests that an oversize input is rejected before any output is written.
+ */
+TEST_F(ResourceLimitsTest, RejectsOversizeInput) {
+    ResourceLimits limits;
+    limits.maxPixels = 1000;
+    OcvSobel ocvSobel;
+    ocvSobel.setResourceLimits(limits);
+
+    std::string outputPath = getUniqueOutputPath("ocv_sobel_rejected");
+    EXPECT_THROW(ocvSobel.getEdges(testImagePath, outputPath), ImageTooLarge);
+    EXPECT_FALSE(std::filesystem::exists(outputPath));
+}
+
+/**
+ * Tests that the downscale policy decodes the input at the largest
+ * reduction that fits and still produces an output.
+ */
+TEST_F(ResourceLimitsTest, DownscalesOversizeInput) {
+    std::optional<ImageInfo> info = ImageUtils::probeImage(testImagePath);
+    ASSERT_TRUE(info.has_value());
+
+    ResourceLimits limits;
+    limits.maxPixels = static_cast<uint64_t>(info->width) * info->height / 4;
+    limits.oversize = OversizePolicy::Downscale;
+    OmpSobel ompSobel;
+    ompSobel.setResourceLimits(limits);
+
+    std::string outputPath = getUniqueOutputPath("omp_sobel_downscaled");
+    cv::Mat result = ompSobel.getEdges(testImagePath, outputPath);
+    EXPECT_EQ(result.cols, (info->width + 1) / 2);
+    EXPECT_EQ(result.rows, (info->height + 1) / 2);
+    verifyOutputImage(outputPath);
+}
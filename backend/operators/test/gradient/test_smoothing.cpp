@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/ocv_sobel.h"
+#include "gradient/omp_sobel.h"
+#include "gradient/operator_registry.h"
+#include "utils/smoothed_kernels.h"
+#include "utils/kernels_util.h"
+#include <opencv2/opencv.hpp>
+#include <cmath>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the Gaussian pre-smoothing of the gradient operators.
+ *
+ * Tests the --sigma flag, that the smoothed separable kernels equal
+ * blurring then differentiating, that the tiled operator gives the
+ * same result for any tiling, and that every operator accepts it.
+ */
+class SmoothingTest : public GradientOperatorTest {
+protected:
+    static EdgeOptions withSigma(double sigma) {
+        EdgeOptions options;
+        options.sigma = sigma;
+        return options;
+    }
+
+    static int kernelSize(double sigma) {
+        return 2 * static_cast<int>(std::ceil(3 * sigma)) + 1;
+    }
+};
+
+/**
+ * Tests parsing of the --sigma flag.
+ */
+TEST_F(SmoothingTest, ParsesSigmaFlag) {
+    EdgeOptions options;
+    EXPECT_FALSE(options.isSmoothing());
+    EXPECT_FALSE(options.parseFlag("--threads=2"));
+
+    EXPECT_TRUE(options.parseFlag("--sigma=1.5"));
+    EXPECT_DOUBLE_EQ(options.sigma, 1.5);
+    EXPECT_TRUE(options.isSmoothing());
+    EXPECT_TRUE(options.parseFlag("--sigma=0"));
+    EXPECT_FALSE(options.isSmoothing());
+
+    EXPECT_THROW(options.parseFlag("--sigma="), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--sigma=-1"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--sigma=21"), std::runtime_error);
+    EXPECT_THROW(options.parseFlag("--sigma=1px"), std::runtime_error);
+}
+
+/**
+ * Tests that one pass with the folded kernels equals a Gaussian blur
+ * followed by the Sobel filter, in both directions.
+ */
+TEST_F(SmoothingTest, FoldedKernelsMatchBlurThenSobel) {
+    cv::Mat gray;
+    cv::cvtColor(loadTestImage(), gray, cv::COLOR_BGR2GRAY);
+    gray.convertTo(gray, CV_32F);
+
+    for (double sigma : {0.8, 1.5, 3.0}) {
+        cv::Mat blurred;
+        cv::GaussianBlur(gray, blurred, cv::Size(kernelSize(sigma), kernelSize(sigma)), sigma);
+
+        for (bool horizontal : {true, false}) {
+            SeparableKernel kernel = SmoothedKernels::derivative(KernelUtil::derivativeDifference,
+                                                                 KernelUtil::sobelSmoothing, sigma, horizontal);
+            EXPECT_EQ(SmoothedKernels::radius(kernel), kernelSize(sigma) / 2 + 1);
+
+            cv::Mat folded;
+            cv::Mat expected;
+            cv::sepFilter2D(gray, folded, CV_32F, kernel.rowKernel, kernel.columnKernel);
+            cv::Sobel(blurred, expected, CV_32F, horizontal ? 1 : 0, horizontal ? 0 : 1);
+            EXPECT_LT(cv::norm(folded, expected, cv::NORM_INF), 0.01) << "sigma " << sigma;
+        }
+    }
+}
+
+/**
+ * Tests that smoothing changes the output and that sigma 0 leaves
+ * the operator exactly as it was.
+ */
+TEST_F(SmoothingTest, SigmaZeroIsUnchanged) {
+    cv::Mat image = loadTestImage();
+    OcvSobel plain;
+    cv::Mat expected = plain.detectEdges(image);
+
+    OcvSobel unsmoothed;
+    unsmoothed.setEdgeOptions(withSigma(0));
+    EXPECT_EQ(cv::norm(unsmoothed.detectEdges(image), expected, cv::NORM_INF), 0);
+
+    OcvSobel smoothed;
+    smoothed.setEdgeOptions(withSigma(2));
+    EXPECT_GT(cv::norm(smoothed.detectEdges(image), expected, cv::NORM_INF), 0);
+}
+
+/**
+ * Tests that the tiled operator, which smooths inside its tile loop,
+ * gives the same edges for tiles smaller and larger than its halo.
+ */
+TEST_F(SmoothingTest, TiledSmoothingIgnoresTiling) {
+    cv::Mat image = loadTestImage();
+    cv::Mat expected;
+
+    for (cv::Size tileSize : {cv::Size(1000, 1000), cv::Size(64, 64), cv::Size(7, 5)}) {
+        ExecutionConfig config;
+        config.tileSize = tileSize;
+        OmpSobel tiled(3, config);
+        tiled.setEdgeOptions(withSigma(2));
+        cv::Mat edges = tiled.detectEdges(image);
+
+        if (expected.empty()) {
+            expected = edges;
+            EXPECT_GT(cv::countNonZero(edges), 0);
+        } else {
+            EXPECT_LE(cv::norm(edges, expected, cv::NORM_INF), 1)
+                << tileSize.width << "x" << tileSize.height << " tiles";
+        }
+    }
+}
+
+/**
+ * Tests that every built-in operator runs with smoothing.
+ */
+TEST_F(SmoothingTest, EveryOperatorSmooths) {
+    cv::Mat image = createSimpleTestImage();
+    for (const OperatorDescriptor* descriptor : OperatorRegistry::builtin().list()) {
+        std::string name = descriptor->takesArgument ? descriptor->name + ":sobel" : descriptor->name;
+        std::unique_ptr<GradientOperator> gradientOperator = OperatorRegistry::builtin().create(name);
+        gradientOperator->setEdgeOptions(withSigma(1.5));
+        cv::Mat edges = gradientOperator->detectEdges(image);
+        EXPECT_EQ(edges.size(), image.size()) << descriptor->name;
+        EXPECT_GT(cv::countNonZero(edges), 0) << descriptor->name;
+    }
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/ocv_sobel.h"
+#include "gradient/omp_sobel.h"
+#include "utils/tile_pyramid.h"
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the deep-zoom tile pyramid output.
+ *
+ * Tests the Deep Zoom and XYZ layouts, that every level holds the
+ * max-downsampled map whatever bands the rows arrive in, and that
+ * operators stream their bands into the pyramid.
+ */
+class TilePyramidTest : public GradientOperatorTest {
+protected:
+    static cv::Mat makeMap(cv::Size size) {
+        cv::Mat map(size, CV_8UC1);
+        cv::randu(map, 0, 256);
+        return map;
+    }
+
+    // The next level as the pyramid builds it: the maximum of each 2x2 block.
+    static cv::Mat halve(const cv::Mat& map) {
+        cv::Mat half((map.rows + 1) / 2, (map.cols + 1) / 2, CV_8UC1);
+        for (int y = 0; y < half.rows; ++y) {
+            for (int x = 0; x < half.cols; ++x) {
+                uint8_t value = 0;
+                for (int dy = 0; dy < 2 && 2 * y + dy < map.rows; ++dy) {
+                    for (int dx = 0; dx < 2 && 2 * x + dx < map.cols; ++dx) {
+                        value = std::max(value, map.at<uint8_t>(2 * y + dy, 2 * x + dx));
+                    }
+                }
+                half.at<uint8_t>(y, x) = value;
+            }
+        }
+        return half;
+    }
+
+    // Reassembles one Deep Zoom level from its tiles, checking the size of each.
+    static cv::Mat readLevel(const TilePyramid& pyramid, int level, cv::Size size) {
+        cv::Mat map(size, CV_8UC1, cv::Scalar(0));
+        for (int row = 0; row * TilePyramid::tileSize < size.height; ++row) {
+            for (int column = 0; column * TilePyramid::tileSize < size.width; ++column) {
+                cv::Rect area(column * TilePyramid::tileSize, row * TilePyramid::tileSize,
+                              std::min(TilePyramid::tileSize, size.width - column * TilePyramid::tileSize),
+                              std::min(TilePyramid::tileSize, size.height - row * TilePyramid::tileSize));
+                cv::Mat tile = cv::imread(pyramid.tilePath(level, column, row), cv::IMREAD_GRAYSCALE);
+                EXPECT_EQ(tile.size(), area.size()) << pyramid.tilePath(level, column, row);
+                if (tile.size() == area.size()) {
+                    tile.copyTo(map(area));
+                }
+            }
+        }
+        return map;
+    }
+};
+
+/**
+ * Tests which output paths select a pyramid.
+ */
+TEST_F(TilePyramidTest, DetectsPaths) {
+    EXPECT_TRUE(TilePyramid::isPyramidPath("results/scan.dzi"));
+    EXPECT_TRUE(TilePyramid::isPyramidPath("results/SCAN.DZI"));
+    EXPECT_TRUE(TilePyramid::isPyramidPath("tiles/{z}/{x}/{y}.png"));
+    EXPECT_FALSE(TilePyramid::isPyramidPath("results/scan.png"));
+    EXPECT_FALSE(TilePyramid::isPyramidPath("tiles/{z}/{x}.png"));
+    EXPECT_THROW(TilePyramid("scan.png", cv::Size(10, 10), EncodeOptions()), std::runtime_error);
+}
+
+/**
+ * Tests that a Deep Zoom pyramid has every level down to one pixel,
+ * each the max-downsampled level above it, for rows added in bands
+ * that do not line up with the tiles.
+ */
+TEST_F(TilePyramidTest, WritesDeepZoomLevels) {
+    cv::Mat map = makeMap(cv::Size(600, 301));
+    std::string path = testOutputDir + "/map.dzi";
+    TilePyramid pyramid(path, map.size(), EncodeOptions(), 3);
+    EXPECT_EQ(pyramid.levelCount(), 11);
+    EXPECT_EQ(pyramid.tilePath(10, 2, 1), testOutputDir + "/map_files/10/2_1.png");
+
+    int y = 0;
+    for (int rows : {1, 100, 37, 163}) {
+        pyramid.addRows(map.rowRange(y, y + rows));
+        y += rows;
+    }
+    PyramidStats stats = pyramid.finish();
+    EXPECT_EQ(stats.levels, 11);
+
+    size_t tiles = 0;
+    cv::Mat expected = map;
+    for (int level = 10; level >= 0; --level) {
+        EXPECT_EQ(cv::norm(readLevel(pyramid, level, expected.size()), expected, cv::NORM_INF), 0) << "level " << level;
+        tiles += static_cast<size_t>((expected.cols + 255) / 256) * ((expected.rows + 255) / 256);
+        expected = halve(expected);
+    }
+    EXPECT_EQ(stats.tiles, tiles);
+
+    std::ifstream descriptor(path);
+    std::stringstream text;
+    text << descriptor.rdbuf();
+    EXPECT_NE(text.str().find("TileSize=\"256\""), std::string::npos);
+    EXPECT_NE(text.str().find("<Size Width=\"600\" Height=\"301\"/>"), std::string::npos);
+}
+
+/**
+ * Tests that XYZ tiles are padded to the tile size and that zoom 0 is
+ * the first level that fits into one tile.
+ */
+TEST_F(TilePyramidTest, WritesXyzTiles) {
+    cv::Mat map = makeMap(cv::Size(600, 300));
+    TilePyramid pyramid(testOutputDir + "/xyz/{z}/{x}/{y}.png", map.size(), EncodeOptions());
+    EXPECT_EQ(pyramid.levelCount(), 3);
+    pyramid.addRows(map);
+    PyramidStats stats = pyramid.finish();
+    EXPECT_EQ(stats.tiles, 6u + 2u + 1u);
+
+    cv::Mat top = cv::imread(testOutputDir + "/xyz/0/0/0.png", cv::IMREAD_GRAYSCALE);
+    ASSERT_EQ(top.size(), cv::Size(256, 256));
+    cv::Mat expected = halve(halve(map));
+    EXPECT_EQ(cv::norm(top(cv::Rect(0, 0, 150, 75)), expected, cv::NORM_INF), 0);
+    EXPECT_EQ(cv::countNonZero(top.colRange(150, 256)), 0);
+
+    cv::Mat corner = cv::imread(testOutputDir + "/xyz/2/2/1.png", cv::IMREAD_GRAYSCALE);
+    ASSERT_EQ(corner.size(), cv::Size(256, 256));
+    EXPECT_EQ(cv::norm(corner(cv::Rect(0, 0, 88, 44)), map(cv::Rect(512, 256, 88, 44)), cv::NORM_INF), 0);
+}
+
+/**
+ * Tests that rows beyond the map and a map left incomplete are rejected.
+ */
+TEST_F(TilePyramidTest, RejectsMismatchedRows) {
+    cv::Mat map = makeMap(cv::Size(64, 32));
+    TilePyramid pyramid(testOutputDir + "/small.dzi", map.size(), EncodeOptions(), 1);
+    EXPECT_THROW(pyramid.addRows(makeMap(cv::Size(63, 4))), std::runtime_error);
+    pyramid.addRows(map.rowRange(0, 16));
+    EXPECT_THROW(pyramid.finish(), std::runtime_error);
+    EXPECT_THROW(pyramid.addRows(map), std::runtime_error);
+}
+
+/**
+ * Tests that getEdges writes the full edge map as the last level,
+ * streamed in bands for a local operator and at once for one that
+ * normalizes.
+ */
+TEST_F(TilePyramidTest, WritesEdgesOfOperators) {
+    cv::Mat image;
+    cv::resize(loadTestImage(), image, cv::Size(700, 530));
+    std::string inputPath = testOutputDir + "/input.png";
+    ASSERT_TRUE(cv::imwrite(inputPath, image));
+
+    OmpSobel ompSobel;
+    OcvSobel ocvSobel;
+    for (GradientOperator* gradientOperator : {static_cast<GradientOperator*>(&ompSobel),
+                                               static_cast<GradientOperator*>(&ocvSobel)}) {
+        cv::Mat expected = gradientOperator->detectEdges(cv::imread(inputPath, gradientOperator->inputMode()));
+        std::string path = testOutputDir + "/" + gradientOperator->getOperatorName() + ".dzi";
+        gradientOperator->getEdges(inputPath, path);
+        ASSERT_TRUE(std::filesystem::exists(path));
+
+        TilePyramid layout(path, expected.size(), EncodeOptions(), 1);
+        int full = layout.levelCount() - 1;
+        EXPECT_EQ(cv::norm(readLevel(layout, full, expected.size()), expected, cv::NORM_INF), 0)
+            << gradientOperator->getOperatorName();
+    }
+}
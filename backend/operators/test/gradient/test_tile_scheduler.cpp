@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include "utils/tile_scheduler.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <stdexcept>
+
+/**
+ * Test suite for the work-stealing tile scheduler.
+ *
+ * Verifies that tiles partition the image exactly, that every tile
+ * is run exactly once regardless of stealing, and that failures in
+ * the per-tile work are reported to the caller.
+ */
+class TileSchedulerTest : public ::testing::Test {
+protected:
+    /**
+     * Counts how many tiles cover each pixel of the image.
+     *
+     * @param tiles The tiles to count
+     * @param imageSize The size of the image
+     * @return cv::Mat Coverage count per pixel
+     */
+    cv::Mat coverage(const std::vector<cv::Rect>& tiles, cv::Size imageSize) {
+        cv::Mat counts(imageSize, CV_32SC1, cv::Scalar(0));
+        for (const auto& tile : tiles) {
+            cv::Mat region = counts(tile);
+            region += cv::Scalar(1);
+        }
+        return counts;
+    }
+};
+
+/**
+ * Tests that tiles cover every pixel exactly once.
+ *
+ * Uses an image size that is not a multiple of the tile size
+ * so that the clipped right and bottom tiles are exercised.
+ */
+TEST_F(TileSchedulerTest, TilesPartitionImage) {
+    TileScheduler scheduler(cv::Size(64, 48));
+    cv::Size imageSize(250, 130);
+
+    std::vector<cv::Rect> tiles = scheduler.makeTiles(imageSize);
+    EXPECT_EQ(tiles.size(), 4u * 3u);
+
+    cv::Mat counts = coverage(tiles, imageSize);
+    double minCount, maxCount;
+    cv::minMaxLoc(counts, &minCount, &maxCount);
+    EXPECT_EQ(minCount, 1.0);
+    EXPECT_EQ(maxCount, 1.0);
+}
+
+/**
+ * Tests that an empty image produces no tiles and no work.
+ */
+TEST_F(TileSchedulerTest, EmptyImage) {
+    TileScheduler scheduler(cv::Size(32, 32));
+    EXPECT_TRUE(scheduler.makeTiles(cv::Size(0, 0)).empty());
+
+    std::atomic<int> calls(0);
+    scheduler.run(cv::Size(0, 0), [&](const cv::Rect&) { ++calls; });
+    EXPECT_EQ(calls.load(), 0);
+}
+
+/**
+ * Tests that the default tile size is derived from the L2 cache.
+ *
+ * The working set of one tile must fit in the cache and the
+ * tile must not degenerate for large per-pixel footprints.
+ */
+TEST_F(TileSchedulerTest, DefaultTileSizeFitsCache) {
+    const size_t bytesPerPixel = 13;
+    cv::Size tileSize = TileScheduler::defaultTileSize(bytesPerPixel);
+
+    EXPECT_GE(tileSize.width, 32);
+    EXPECT_EQ(tileSize.width, tileSize.height);
+    EXPECT_LE(static_cast<size_t>(tileSize.area()) * bytesPerPixel, TileScheduler::l2CacheSize());
+
+    TileScheduler scheduler(cv::Size(), bytesPerPixel);
+    EXPECT_EQ(scheduler.getTileSize(), tileSize);
+}
+
+/**
+ * Tests that every tile runs exactly once.
+ *
+ * Uses small tiles so that threads run out of their own band
+ * and steal from each other.
+ */
+TEST_F(TileSchedulerTest, RunsEveryTileOnce) {
+    TileScheduler scheduler(cv::Size(16, 16));
+    cv::Size imageSize(300, 200);
+    cv::Mat counts(imageSize, CV_32SC1, cv::Scalar(0));
+
+    scheduler.run(imageSize, [&](const cv::Rect& tile) {
+        cv::Mat region = counts(tile);
+        region += cv::Scalar(1);
+    });
+
+    double minCount, maxCount;
+    cv::minMaxLoc(counts, &minCount, &maxCount);
+    EXPECT_EQ(minCount, 1.0);
+    EXPECT_EQ(maxCount, 1.0);
+}
+
+/**
+ * Tests that the static and dynamic schedules run full-width
+ * row bands of the configured chunk size, each exactly once.
+ */
+TEST_F(TileSchedulerTest, BandSchedulesRunEveryBandOnce) {
+    for (ScheduleKind schedule : {ScheduleKind::Static, ScheduleKind::Dynamic}) {
+        ExecutionConfig config;
+        config.schedule = schedule;
+        config.chunkSize = 10;
+        config.numThreads = 4;
+        TileScheduler scheduler(config);
+        cv::Size imageSize(77, 95);
+
+        std::vector<cv::Rect> bands = scheduler.makeTiles(imageSize);
+        ASSERT_EQ(bands.size(), 10u);
+        EXPECT_EQ(bands.back(), cv::Rect(0, 90, 77, 5));
+
+        cv::Mat counts(imageSize, CV_32SC1, cv::Scalar(0));
+        scheduler.run(imageSize, [&](const cv::Rect& band) {
+            EXPECT_EQ(band.width, imageSize.width);
+            cv::Mat region = counts(band);
+            region += cv::Scalar(1);
+        });
+
+        double minCount, maxCount;
+        cv::minMaxLoc(counts, &minCount, &maxCount);
+        EXPECT_EQ(minCount, 1.0);
+        EXPECT_EQ(maxCount, 1.0);
+    }
+}
+
+/**
+ * Tests that pinned runs still visit every tile and that the
+ * configured thread count and tile size are kept.
+ */
+TEST_F(TileSchedulerTest, PinnedRun) {
+    ExecutionConfig config;
+    config.numThreads = 2;
+    config.tileSize = cv::Size(20, 20);
+    config.pinning = PinPolicy::Compact;
+    TileScheduler scheduler(config);
+
+    EXPECT_EQ(scheduler.getNumThreads(), 2);
+    EXPECT_EQ(scheduler.getTileSize(), cv::Size(20, 20));
+
+    std::atomic<int> calls(0);
+    scheduler.run(cv::Size(100, 100), [&](const cv::Rect&) { ++calls; });
+    EXPECT_EQ(calls.load(), 25);
+}
+
+/**
+ * Tests that an exception thrown by a tile reaches the caller.
+ *
+ * Exceptions cannot cross an OpenMP region, so the scheduler
+ * has to capture and rethrow them after the region ends.
+ */
+TEST_F(TileSchedulerTest, PropagatesExceptions) {
+    TileScheduler scheduler(cv::Size(16, 16));
+
+    EXPECT_THROW({
+        scheduler.run(cv::Size(128, 128), [](const cv::Rect& tile) {
+            if (tile.x == 64 && tile.y == 64) {
+                throw std::runtime_error("tile failed");
+            }
+        });
+    }, std::runtime_error);
+}
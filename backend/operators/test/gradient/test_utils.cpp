@@ -2,6 +2,7 @@
 #include "test_utils.h"
 #include "utils/image_utils.h"
 #include <opencv2/opencv.hpp>
+#include <fstream>
 
 using namespace TestUtils;
 
@@ -250,3 +251,61 @@ TEST_F(ImageUtilsTest, ErrorHandling) {
     bool saveResult = cv::imwrite("/invalid/path/image.jpg", testImage);
     EXPECT_FALSE(saveResult);
 }
+
+/**
+ * Tests that the header probe reports the same size and channels
+ * as a full decode, for every format it supports that OpenCV writes.
+ */
+TEST_F(ImageUtilsTest, ProbeMatchesDecode) {
+    cv::Mat colorImage = createTestImage(210, 130);
+    cv::Mat grayImage;
+    cv::cvtColor(colorImage, grayImage, cv::COLOR_BGR2GRAY);
+
+    struct Case { std::string name; cv::Mat image; std::string format; int channels; };
+    std::vector<Case> cases = {
+        {"probe.png", colorImage, "png", 3},
+        {"probe_gray.png", grayImage, "png", 1},
+        {"probe.jpg", colorImage, "jpeg", 3},
+        {"probe_gray.jpg", grayImage, "jpeg", 1},
+        {"probe.bmp", colorImage, "bmp", 3},
+        {"probe.pgm", grayImage, "pnm", 1},
+        {"probe.ppm", colorImage, "pnm", 3},
+    };
+
+    for (const auto& testCase : cases) {
+        std::string path = testOutputDir + "/" + testCase.name;
+        ASSERT_TRUE(cv::imwrite(path, testCase.image)) << path;
+
+        std::optional<ImageInfo> info = ImageUtils::probeImage(path);
+        ASSERT_TRUE(info.has_value()) << path;
+        EXPECT_EQ(info->format, testCase.format) << path;
+        EXPECT_EQ(info->size(), cv::Size(210, 130)) << path;
+        EXPECT_EQ(info->channels, testCase.channels) << path;
+        EXPECT_EQ(info->bitDepth, 8) << path;
+    }
+}
+
+/**
+ * Tests that files the probe cannot identify yield no information
+ * instead of an error.
+ */
+TEST_F(ImageUtilsTest, ProbeUnknownFormat) {
+    std::string path = testOutputDir + "/not_an_image.txt";
+    std::ofstream(path) << "plain text";
+
+    EXPECT_FALSE(ImageUtils::probeImage(path).has_value());
+    EXPECT_FALSE(ImageUtils::probeImage(testOutputDir + "/missing.png").has_value());
+}
+
+/**
+ * Tests that reduced decoding shrinks the image by the reduction factor.
+ */
+TEST_F(ImageUtilsTest, ReducedDecode) {
+    std::string path = testOutputDir + "/reduced.jpg";
+    cv::imwrite(path, createTestImage(200, 120));
+
+    cv::Mat image = ImageUtils::getImage(path, cv::IMREAD_GRAYSCALE, 4);
+    EXPECT_EQ(image.size(), cv::Size(50, 30));
+    EXPECT_EQ(image.channels(), 1);
+    EXPECT_THROW(ImageUtils::getImage(path, cv::IMREAD_COLOR, 3), std::runtime_error);
+}
@@ -0,0 +1,267 @@
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include "gradient/ocv_sobel.h"
+#include "gradient/omp_sobel.h"
+#include "video/video_pipeline.h"
+#include <opencv2/opencv.hpp>
+#include <cstdio>
+#include <fstream>
+
+using namespace TestUtils;
+
+/**
+ * Test suite for the video mode.
+ *
+ * Tests that Y4M streams round trip and convert to the same frames
+ * as OpenCV, that the overlapped stages write the edges of every
+ * frame in order to Y4M and to frame sequences, and that a video
+ * stops at its first failed frame.
+ */
+class VideoPipelineTest : public GradientOperatorTest {
+protected:
+    // Frames of the test image panning right, with even dimensions for 4:2:0.
+    std::vector<cv::Mat> makeFrames(int count) {
+        cv::Mat image;
+        cv::resize(loadTestImage(), image, cv::Size(360, 240));
+        std::vector<cv::Mat> frames;
+        for (int i = 0; i < count; ++i) {
+            frames.push_back(image(cv::Rect(4 * i, 0, 320, 240)).clone());
+        }
+        return frames;
+    }
+
+    // Writes BGR frames as a 4:2:0 Y4M file through OpenCV's I420 conversion.
+    std::string writeY4m(const std::vector<cv::Mat>& frames, const std::string& name) {
+        std::string path = testOutputDir + "/" + name + ".y4m";
+        std::ofstream file(path, std::ios::binary);
+        file << "YUV4MPEG2 W" << frames[0].cols << " H" << frames[0].rows << " F30:1 Ip A1:1 C420jpeg\n";
+        for (const cv::Mat& frame : frames) {
+            cv::Mat yuv;
+            cv::cvtColor(frame, yuv, cv::COLOR_BGR2YUV_I420);
+            file << "FRAME\n";
+            file.write(reinterpret_cast<const char*>(yuv.data), static_cast<std::streamsize>(yuv.total()));
+        }
+        return path;
+    }
+
+    static std::vector<cv::Mat> readAll(FrameSource& source) {
+        std::vector<cv::Mat> frames;
+        cv::Mat frame;
+        while (source.read(frame)) {
+            frames.push_back(frame.clone());
+        }
+        return frames;
+    }
+
+    // Fails on one frame and keeps the edges of the others.
+    class FailingSink : public FrameSink {
+    public:
+        explicit FailingSink(size_t failAt) : failAt(failAt) {}
+
+        void write(const EdgeResult& result) override {
+            if (++calls == failAt) {
+                throw std::runtime_error("disk full");
+            }
+            written.push_back(result.edges.clone());
+        }
+
+        size_t failAt;
+        size_t calls = 0;
+        std::vector<cv::Mat> written;
+    };
+};
+
+/**
+ * Tests the frame rates and frame sequence paths.
+ */
+TEST_F(VideoPipelineTest, ParsesRatesAndPatterns) {
+    EXPECT_EQ(FrameRate::fromFps(25).numerator, 25);
+    EXPECT_EQ(FrameRate::fromFps(25).denominator, 1);
+    EXPECT_EQ(FrameRate::fromFps(29.97).numerator, 30000);
+    EXPECT_EQ(FrameRate::fromFps(29.97).denominator, 1001);
+    EXPECT_EQ(FrameRate::fromFps(0).numerator, 25);
+    EXPECT_NEAR(FrameRate::fromFps(12.5).fps(), 12.5, 1e-9);
+
+    OcvSobel sobel;
+    EXPECT_EQ(FrameSequenceWriter("out/frame_%05d.png", sobel).pathOf(42), "out/frame_00042.png");
+    EXPECT_EQ(FrameSequenceWriter("%d.pgm", sobel).pathOf(1234), "1234.pgm");
+    EXPECT_EQ(FrameSequenceWriter("%d.pgm", sobel).extension(), ".pgm");
+    EXPECT_THROW(FrameSequenceWriter("frame_%s.png", sobel), std::runtime_error);
+    EXPECT_THROW(FrameSequenceWriter("frame_%d_%d.png", sobel), std::runtime_error);
+    EXPECT_THROW(FrameSequenceWriter("frame_%0123456789012345678901d.png", sobel), std::runtime_error);
+    EXPECT_THROW(FrameSink::open(testOutputDir + "/edges.gif", FrameRate(), sobel), std::runtime_error);
+}
+
+/**
+ * Tests that mono frames round trip through a Y4M file with their
+ * frame rate, and that malformed streams are rejected.
+ */
+TEST_F(VideoPipelineTest, Y4mRoundTrips) {
+    std::string path = testOutputDir + "/mono.y4m";
+    std::vector<cv::Mat> frames;
+    {
+        Y4mWriter writer(path, {30000, 1001});
+        for (int i = 0; i < 4; ++i) {
+            cv::Mat frame(37, 53, CV_8UC1);
+            cv::randu(frame, 0, 256);
+            writer.writeFrame(frame);
+            frames.push_back(frame);
+        }
+        EXPECT_THROW(writer.writeFrame(cv::Mat(36, 53, CV_8UC1)), std::runtime_error);
+        EXPECT_THROW(writer.writeFrame(cv::Mat(37, 53, CV_8UC3)), std::runtime_error);
+        writer.close();
+    }
+
+    Y4mReader reader(path, cv::IMREAD_GRAYSCALE);
+    EXPECT_EQ(reader.size(), cv::Size(53, 37));
+    EXPECT_EQ(reader.colorspace(), "mono");
+    EXPECT_EQ(reader.rate().numerator, 30000);
+    EXPECT_EQ(reader.rate().denominator, 1001);
+    std::vector<cv::Mat> read = readAll(reader);
+    ASSERT_EQ(read.size(), frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        EXPECT_EQ(cv::norm(read[i], frames[i], cv::NORM_INF), 0) << "frame " << i;
+    }
+
+    // mono frames are converted for color operators
+    Y4mReader colorReader(path, cv::IMREAD_COLOR);
+    cv::Mat color;
+    ASSERT_TRUE(colorReader.read(color));
+    EXPECT_EQ(color.type(), CV_8UC3);
+
+    std::string truncated = testOutputDir + "/truncated.y4m";
+    {
+        std::ofstream file(truncated, std::ios::binary);
+        file << "YUV4MPEG2 W8 H8 F25:1 Cmono\nFRAME\n" << std::string(63, 'x');
+    }
+    Y4mReader truncatedReader(truncated, cv::IMREAD_GRAYSCALE);
+    cv::Mat frame;
+    EXPECT_THROW(truncatedReader.read(frame), std::runtime_error);
+
+    std::string highDepth = testOutputDir + "/high_depth.y4m";
+    {
+        std::ofstream file(highDepth, std::ios::binary);
+        file << "YUV4MPEG2 W8 H8 F25:1 C420p10\n";
+    }
+    EXPECT_THROW(Y4mReader(highDepth, cv::IMREAD_GRAYSCALE), std::runtime_error);
+    EXPECT_THROW(Y4mReader(testImagePath, cv::IMREAD_GRAYSCALE), std::runtime_error);
+}
+
+/**
+ * Tests that 4:2:0 frames convert to BGR like OpenCV's I420 conversion,
+ * that gray frames are the luma plane, and that 4:4:4 chroma is
+ * resampled to the same frame.
+ */
+TEST_F(VideoPipelineTest, ConvertsChroma) {
+    std::vector<cv::Mat> frames = makeFrames(2);
+    std::string path = writeY4m(frames, "color");
+
+    cv::Mat yuv;
+    cv::Mat expected;
+    cv::cvtColor(frames[1], yuv, cv::COLOR_BGR2YUV_I420);
+    cv::cvtColor(yuv, expected, cv::COLOR_YUV2BGR_I420);
+
+    Y4mReader colorReader(path, cv::IMREAD_COLOR);
+    std::vector<cv::Mat> color = readAll(colorReader);
+    ASSERT_EQ(color.size(), 2u);
+    EXPECT_EQ(cv::norm(color[1], expected, cv::NORM_INF), 0);
+
+    Y4mReader grayReader(path, cv::IMREAD_GRAYSCALE);
+    std::vector<cv::Mat> gray = readAll(grayReader);
+    ASSERT_EQ(gray.size(), 2u);
+    EXPECT_EQ(cv::norm(gray[1], yuv.rowRange(0, 240), cv::NORM_INF), 0);
+
+    // 4:4:4 chroma made by doubling the 4:2:0 planes averages back to them exactly
+    std::string path444 = testOutputDir + "/color444.y4m";
+    {
+        std::ofstream file(path444, std::ios::binary);
+        file << "YUV4MPEG2 W320 H240 F30:1 C444\nFRAME\n";
+        file.write(reinterpret_cast<const char*>(yuv.data), 320 * 240);
+        for (int plane = 0; plane < 2; ++plane) {
+            cv::Mat quarter(120, 160, CV_8UC1, yuv.data + 320 * 240 + plane * 160 * 120);
+            cv::Mat full;
+            cv::resize(quarter, full, cv::Size(320, 240), 0, 0, cv::INTER_NEAREST);
+            file.write(reinterpret_cast<const char*>(full.data), static_cast<std::streamsize>(full.total()));
+        }
+    }
+    Y4mReader reader444(path444, cv::IMREAD_COLOR);
+    cv::Mat frame444;
+    ASSERT_TRUE(reader444.read(frame444));
+    EXPECT_EQ(cv::norm(frame444, expected, cv::NORM_INF), 0);
+    EXPECT_FALSE(reader444.read(frame444));
+}
+
+/**
+ * Tests that the overlapped stages write the edges of every frame in
+ * order, with more frames than slots, to a Y4M file for a grayscale
+ * operator and to a frame sequence for a color operator.
+ */
+TEST_F(VideoPipelineTest, WritesEveryFrameInOrder) {
+    std::vector<cv::Mat> frames = makeFrames(9);
+    std::string inputPath = writeY4m(frames, "input");
+
+    OcvSobel sobel;
+    std::string outputPath = testOutputDir + "/edges.y4m";
+    {
+        std::unique_ptr<FrameSource> source = FrameSource::open(inputPath, sobel.inputMode());
+        std::unique_ptr<FrameSink> sink = FrameSink::open(outputPath, source->rate(), sobel);
+        VideoStats stats = VideoPipeline(sobel, 3).run(*source, *sink);
+        EXPECT_EQ(stats.frames, frames.size());
+        EXPECT_GT(stats.computeSeconds, 0);
+    }
+    Y4mReader input(inputPath, cv::IMREAD_GRAYSCALE);
+    Y4mReader output(outputPath, cv::IMREAD_GRAYSCALE);
+    EXPECT_EQ(output.rate().numerator, 30);
+    std::vector<cv::Mat> luma = readAll(input);
+    std::vector<cv::Mat> edges = readAll(output);
+    ASSERT_EQ(edges.size(), frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        EXPECT_EQ(cv::norm(edges[i], sobel.detectEdges(luma[i]), cv::NORM_INF), 0) << "frame " << i;
+    }
+
+    OmpSobel ompSobel;
+    std::string pattern = testOutputDir + "/frame_%03d.png";
+    Y4mReader colorSource(inputPath, ompSobel.inputMode());
+    FrameSequenceWriter sequence(pattern, ompSobel);
+    EXPECT_EQ(VideoPipeline(ompSobel, 2).run(colorSource, sequence).frames, frames.size());
+
+    Y4mReader colorInput(inputPath, cv::IMREAD_COLOR);
+    std::vector<cv::Mat> color = readAll(colorInput);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        cv::Mat written = cv::imread(sequence.pathOf(i + 1), cv::IMREAD_GRAYSCALE);
+        ASSERT_FALSE(written.empty()) << sequence.pathOf(i + 1);
+        EXPECT_EQ(cv::norm(written, ompSobel.detectEdges(color[i]), cv::NORM_INF), 0) << "frame " << i;
+    }
+    EXPECT_THROW(VideoPipeline(sobel, 0), std::runtime_error);
+}
+
+/**
+ * Tests that a failed frame stops the video with its number, after
+ * the frames before it were written.
+ */
+TEST_F(VideoPipelineTest, StopsAtFailedFrame) {
+    std::string inputPath = writeY4m(makeFrames(8), "failing");
+    OcvSobel sobel;
+
+    Y4mReader source(inputPath, sobel.inputMode());
+    FailingSink sink(3);
+    try {
+        VideoPipeline(sobel, 2).run(source, sink);
+        FAIL() << "the failed frame was not reported";
+    } catch (const std::runtime_error& e) {
+        EXPECT_EQ(std::string(e.what()), "Frame 3: disk full");
+    }
+    EXPECT_EQ(sink.written.size(), 2u);
+
+    // a stream cut inside its last frame
+    std::string truncated = testOutputDir + "/cut.y4m";
+    {
+        std::ifstream file(inputPath, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::ofstream(truncated, std::ios::binary) << bytes.substr(0, bytes.size() - 1000);
+    }
+    Y4mReader cutSource(truncated, sobel.inputMode());
+    FailingSink noFailure(0);
+    EXPECT_THROW(VideoPipeline(sobel).run(cutSource, noFailure), std::runtime_error);
+    EXPECT_EQ(noFailure.written.size(), 7u);
+}
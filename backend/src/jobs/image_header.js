@@ -0,0 +1,130 @@
+const fs = require("fs");
+
+// Reads the pixel dimensions of an image from its header without decoding it.
+// Supports PNG, JPEG, GIF, BMP, WebP and binary PGM/PPM; returns null for anything else.
+// regionDecodable is set for the layouts the operators read a region of without decoding the
+// rest (ImageUtils::canDecodeRegion): 8-bit binary PGM/PPM and uncompressed 24-bit BMP.
+
+const HEADER_BYTES = 64;
+
+const readBytes = async (handle, position, length) => {
+  const buffer = Buffer.alloc(length);
+  const { bytesRead } = await handle.read(buffer, 0, length, position);
+  return buffer.subarray(0, bytesRead);
+};
+
+// JPEG stores the size in the first start-of-frame segment, which may follow
+// large EXIF or ICC segments, so walk the segment chain instead of a fixed prefix.
+const readJpegSize = async (handle) => {
+  let position = 2;
+  for (;;) {
+    const marker = await readBytes(handle, position, 4);
+    if (marker.length < 4 || marker[0] !== 0xff) {
+      return null;
+    }
+    const type = marker[1];
+    // fill bytes before a marker
+    if (type === 0xff) {
+      position += 1;
+      continue;
+    }
+    const length = marker.readUInt16BE(2);
+    const isStartOfFrame =
+      type >= 0xc0 && type <= 0xcf && type !== 0xc4 && type !== 0xc8 && type !== 0xcc;
+    if (isStartOfFrame) {
+      const frame = await readBytes(handle, position + 5, 4);
+      if (frame.length < 4) {
+        return null;
+      }
+      return { width: frame.readUInt16BE(2), height: frame.readUInt16BE(0) };
+    }
+    if (length < 2) {
+      return null;
+    }
+    position += 2 + length;
+  }
+};
+
+const readWebpSize = (header) => {
+  const chunk = header.toString("ascii", 12, 16);
+  if (chunk === "VP8 " && header.length >= 30) {
+    return {
+      width: header.readUInt16LE(26) & 0x3fff,
+      height: header.readUInt16LE(28) & 0x3fff,
+    };
+  }
+  if (chunk === "VP8L" && header.length >= 25) {
+    const bits = header.readUInt32LE(21);
+    return { width: (bits & 0x3fff) + 1, height: ((bits >> 14) & 0x3fff) + 1 };
+  }
+  if (chunk === "VP8X" && header.length >= 30) {
+    return {
+      width: header.readUIntLE(24, 3) + 1,
+      height: header.readUIntLE(27, 3) + 1,
+    };
+  }
+  return null;
+};
+
+// Binary PGM/PPM; the header is text, with comments allowed between the values
+const readPnmSize = (header) => {
+  const text = header.toString("latin1").replace(/#[^\n]*\n/g, "\n");
+  const match = /^P[56]\s+(\d+)\s+(\d+)\s+(\d+)\s/.exec(text);
+  if (!match) {
+    return null;
+  }
+  return {
+    width: Number(match[1]),
+    height: Number(match[2]),
+    regionDecodable: Number(match[3]) < 256,
+  };
+};
+
+const readImageSize = async (filePath) => {
+  let handle;
+  try {
+    handle = await fs.promises.open(filePath, "r");
+    const header = await readBytes(handle, 0, HEADER_BYTES);
+
+    if (header.length >= 24 && header.readUInt32BE(0) === 0x89504e47) {
+      return { width: header.readUInt32BE(16), height: header.readUInt32BE(20) };
+    }
+    if (header.length >= 4 && header[0] === 0xff && header[1] === 0xd8) {
+      return await readJpegSize(handle);
+    }
+    if (header.length >= 10 && header.toString("ascii", 0, 3) === "GIF") {
+      return { width: header.readUInt16LE(6), height: header.readUInt16LE(8) };
+    }
+    if (header.length >= 26 && header.toString("ascii", 0, 2) === "BM") {
+      return {
+        width: Math.abs(header.readInt32LE(18)),
+        height: Math.abs(header.readInt32LE(22)),
+        regionDecodable:
+          header.length >= 34 &&
+          header.readUInt32LE(14) >= 40 &&
+          header.readUInt16LE(28) === 24 &&
+          header.readUInt32LE(30) === 0,
+      };
+    }
+    if (header.length >= 3 && header[0] === 0x50 && (header[1] === 0x35 || header[1] === 0x36)) {
+      return readPnmSize(header);
+    }
+    if (
+      header.length >= 16 &&
+      header.toString("ascii", 0, 4) === "RIFF" &&
+      header.toString("ascii", 8, 12) === "WEBP"
+    ) {
+      return readWebpSize(header);
+    }
+    return null;
+  } catch (err) {
+    console.error("Failed to read image header:", err);
+    return null;
+  } finally {
+    if (handle) {
+      await handle.close();
+    }
+  }
+};
+
+module.exports = { readImageSize };
@@ -0,0 +1,81 @@
+const crypto = require("crypto");
+const fs = require("fs");
+
+// Shares one computation between concurrent requests for the same job. The first request
+// with a key starts the work; requests that arrive while it is in flight attach to it and
+// receive the same result. The work is aborted only when every attached request has gone.
+
+class JobCoalescer {
+  constructor() {
+    this.inflight = new Map();
+    this.stats = { started: 0, coalesced: 0 };
+  }
+
+  // Joins the job for `key`, calling `start(signal)` if none is in flight. Returns
+  // { promise, shared, release }; release() withdraws this caller and aborts the
+  // signal once no caller is left.
+  join(key, start) {
+    let entry = this.inflight.get(key);
+    const shared = Boolean(entry);
+    if (entry) {
+      this.stats.coalesced += 1;
+    } else {
+      this.stats.started += 1;
+      const abortController = new AbortController();
+      entry = { waiters: 0, abortController };
+      entry.promise = Promise.resolve()
+        .then(() => {
+          if (abortController.signal.aborted) {
+            throw new Error("Job abandoned before it started");
+          }
+          return start(abortController.signal);
+        })
+        .finally(() => {
+          if (this.inflight.get(key) === entry) {
+            this.inflight.delete(key);
+          }
+        });
+      this.inflight.set(key, entry);
+    }
+
+    entry.waiters += 1;
+    let released = false;
+    return {
+      promise: entry.promise,
+      shared,
+      release: () => {
+        if (released) {
+          return;
+        }
+        released = true;
+        entry.waiters -= 1;
+        if (entry.waiters === 0) {
+          // a later request must not attach to work that is being aborted
+          if (this.inflight.get(key) === entry) {
+            this.inflight.delete(key);
+          }
+          entry.abortController.abort();
+        }
+      },
+    };
+  }
+
+  snapshot() {
+    return { inflight: this.inflight.size, ...this.stats };
+  }
+}
+
+// Key of a job: the SHA-256 of the input bytes together with the operator and its parameters.
+const jobKey = (inputPath, operator, parameters) =>
+  new Promise((resolve, reject) => {
+    const hash = crypto.createHash("sha256");
+    fs.createReadStream(inputPath)
+      .on("error", reject)
+      .on("data", (chunk) => hash.update(chunk))
+      .on("end", () => {
+        hash.update(`\0${operator}\0${parameters.join(" ")}`);
+        resolve(hash.digest("hex"));
+      });
+  });
+
+module.exports = { JobCoalescer, jobKey };
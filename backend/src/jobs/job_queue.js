@@ -0,0 +1,250 @@
+const fs = require("fs");
+const os = require("os");
+
+// Admission-controlled queue in front of the operator processes. At most
+// `concurrency` jobs run at once and at most `maxQueued` wait. A job whose
+// predicted completion time would exceed the latency SLO is rejected up front,
+// so under overload the admitted jobs still finish in time instead of every
+// job sharing the CPU and missing its deadline.
+//
+// Waiting jobs start shortest-first by estimated cost, with aging so large jobs
+// are not starved. Jobs of at most `smallJobPixels` may also use `smallSlots`
+// extra slots that large jobs never take, so a phone photo does not wait behind
+// a huge scan that occupies every shared slot.
+
+class QueueRejectedError extends Error {
+  constructor(message, retryAfterMs) {
+    super(message);
+    this.name = "QueueRejectedError";
+    this.retryAfterMs = retryAfterMs;
+  }
+}
+
+class JobCancelledError extends Error {
+  constructor() {
+    super("Job cancelled while queued");
+    this.name = "JobCancelledError";
+  }
+}
+
+// CPUs granted by the cgroup quota (cpu.max or cpu.cfs_quota_us), falling back to the
+// host CPU count; os.cpus() alone reports the host even in a 0.5-CPU container.
+const availableCpus = () => {
+  const hostCpus = os.cpus().length || 1;
+  try {
+    const [quota, period] = fs
+      .readFileSync("/sys/fs/cgroup/cpu.max", "utf8")
+      .trim()
+      .split(/\s+/);
+    if (quota !== "max") {
+      return Math.min(hostCpus, Number(quota) / Number(period));
+    }
+  } catch (err) {
+    try {
+      const quota = Number(fs.readFileSync("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "utf8"));
+      const period = Number(fs.readFileSync("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "utf8"));
+      if (quota > 0 && period > 0) {
+        return Math.min(hostCpus, quota / period);
+      }
+    } catch (ignored) {
+      // no cgroup limit visible
+    }
+  }
+  return hostCpus;
+};
+
+class JobQueue {
+  constructor({
+    concurrency = Math.max(1, Math.floor(availableCpus())),
+    maxQueued = 16,
+    sloMs = 15000,
+    baseMs = 100,
+    msPerMegapixel = 400,
+    smallJobPixels = 16e6,
+    smallSlots = 1,
+    agingRate = 2,
+  } = {}) {
+    this.concurrency = concurrency;
+    this.maxQueued = maxQueued;
+    this.sloMs = sloMs;
+    this.baseMs = baseMs;
+    this.defaultMsPerMegapixel = msPerMegapixel;
+    this.msPerMegapixel = new Map(); // learned per operator
+    this.smallJobPixels = smallJobPixels;
+    this.smallSlots = smallSlots;
+    this.agingRate = agingRate; // ms of priority gained per ms waited
+    this.running = new Set();
+    this.queued = [];
+    this.stats = { admitted: 0, rejected: 0, completed: 0, failed: 0, cancelled: 0 };
+  }
+
+  // Predicted run time of a job from its pixel count, using the rate learned for its operator.
+  estimateMs(operator, pixels) {
+    const rate = this.msPerMegapixel.get(operator) || this.defaultMsPerMegapixel;
+    return this.baseMs + (rate * pixels) / 1e6;
+  }
+
+  // Folds an observed run time into the operator's rate so estimates follow the host.
+  observe(operator, pixels, elapsedMs) {
+    if (pixels <= 0) {
+      return;
+    }
+    const sample = (Math.max(0, elapsedMs - this.baseMs) * 1e6) / pixels;
+    const rate = this.msPerMegapixel.get(operator) || this.defaultMsPerMegapixel;
+    this.msPerMegapixel.set(operator, 0.8 * rate + 0.2 * sample);
+  }
+
+  isSmall(pixels) {
+    return pixels <= this.smallJobPixels;
+  }
+
+  runningIn(lane) {
+    let count = 0;
+    for (const job of this.running) {
+      if (job.lane === lane) {
+        count += 1;
+      }
+    }
+    return count;
+  }
+
+  // Work still ahead of a new job of the given cost: the remaining part of the running jobs
+  // plus the queued jobs that would start before it, spread over the slots it may use.
+  predictedWaitMs(costMs = Infinity, small = false) {
+    const slots = this.concurrency + (small ? this.smallSlots : 0);
+    const free =
+      this.concurrency - this.runningIn("shared") +
+      (small ? this.smallSlots - this.runningIn("small") : 0);
+    const ahead = this.queued.filter((job) => job.costMs <= costMs);
+    if (free > ahead.length) {
+      return 0;
+    }
+
+    const now = Date.now();
+    let work = 0;
+    for (const job of this.running) {
+      if (job.lane === "shared" || small) {
+        work += Math.max(0, job.costMs - (now - job.startedAt));
+      }
+    }
+    for (const job of ahead) {
+      work += job.costMs;
+    }
+    return work / slots;
+  }
+
+  // Admits a job or throws QueueRejectedError. `run` is called when a slot frees up and
+  // must return a promise. Returns { promise, cancel }; cancel() drops a job that has not
+  // started yet.
+  submit({ operator, pixels, run }) {
+    const costMs = this.estimateMs(operator, pixels);
+    const waitMs = this.predictedWaitMs(costMs, this.isSmall(pixels));
+
+    if (this.queued.length >= this.maxQueued) {
+      this.stats.rejected += 1;
+      throw new QueueRejectedError("Job queue is full", waitMs);
+    }
+    // an idle queue always admits, otherwise a job larger than the SLO could never run
+    if (waitMs > 0 && waitMs + costMs > this.sloMs) {
+      this.stats.rejected += 1;
+      throw new QueueRejectedError(
+        `Predicted completion in ${Math.round(waitMs + costMs)} ms exceeds ${this.sloMs} ms`,
+        waitMs
+      );
+    }
+
+    this.stats.admitted += 1;
+    const job = { operator, pixels, run, costMs, enqueuedAt: Date.now() };
+    job.promise = new Promise((resolve, reject) => {
+      job.resolve = resolve;
+      job.reject = reject;
+    });
+    this.queued.push(job);
+    this.dispatch();
+
+    return {
+      promise: job.promise,
+      cancel: () => {
+        const index = this.queued.indexOf(job);
+        if (index >= 0) {
+          this.queued.splice(index, 1);
+          this.stats.cancelled += 1;
+          job.reject(new JobCancelledError());
+        }
+      },
+    };
+  }
+
+  // Picks the queued job with the lowest aged cost among those the filter accepts.
+  next(accept) {
+    const now = Date.now();
+    let best = -1;
+    let bestPriority = Infinity;
+    this.queued.forEach((job, index) => {
+      const priority = job.costMs - this.agingRate * (now - job.enqueuedAt);
+      if (accept(job) && priority < bestPriority) {
+        best = index;
+        bestPriority = priority;
+      }
+    });
+    return best >= 0 ? this.queued.splice(best, 1)[0] : undefined;
+  }
+
+  dispatch() {
+    for (;;) {
+      let job;
+      if (this.runningIn("shared") < this.concurrency) {
+        job = this.next(() => true);
+        if (job) {
+          job.lane = "shared";
+        }
+      } else if (this.runningIn("small") < this.smallSlots) {
+        job = this.next((candidate) => this.isSmall(candidate.pixels));
+        if (job) {
+          job.lane = "small";
+        }
+      }
+      if (!job) {
+        return;
+      }
+      job.startedAt = Date.now();
+      this.running.add(job);
+
+      Promise.resolve()
+        .then(() => job.run())
+        .then(
+          (result) => {
+            this.stats.completed += 1;
+            this.observe(job.operator, job.pixels, Date.now() - job.startedAt);
+            job.resolve(result);
+          },
+          (err) => {
+            this.stats.failed += 1;
+            job.reject(err);
+          }
+        )
+        .finally(() => {
+          this.running.delete(job);
+          this.dispatch();
+        });
+    }
+  }
+
+  snapshot() {
+    return {
+      concurrency: this.concurrency,
+      smallSlots: this.smallSlots,
+      smallJobPixels: this.smallJobPixels,
+      running: this.running.size,
+      runningSmall: this.runningIn("small"),
+      queued: this.queued.length,
+      maxQueued: this.maxQueued,
+      sloMs: this.sloMs,
+      predictedWaitMs: Math.round(this.predictedWaitMs()),
+      msPerMegapixel: Object.fromEntries(this.msPerMegapixel),
+      ...this.stats,
+    };
+  }
+}
+
+module.exports = { JobQueue, QueueRejectedError, JobCancelledError, availableCpus };
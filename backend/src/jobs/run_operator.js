@@ -0,0 +1,144 @@
+const { spawn } = require("child_process");
+const fs = require("fs");
+const path = require("path");
+
+// In-process backend, used when OPERATOR_BACKEND=addon and the addon in native/edgeops has
+// been built; otherwise every job spawns the operator executable
+let edgeops = null;
+if (process.env.OPERATOR_BACKEND === "addon") {
+  try {
+    edgeops = require("../../native/edgeops");
+  } catch (err) {
+    console.error("edgeops addon unavailable, spawning the executable:", err.message);
+  }
+}
+
+// Pyramids are a descriptor plus a directory of tiles, which only the executable writes; the
+// addon returns a single encoded buffer
+const isPyramidPath = (outputPath) =>
+  path.extname(outputPath).toLowerCase() === ".dzi" ||
+  ["{z}", "{x}", "{y}"].every((token) => outputPath.includes(token));
+
+// Whether a job with this output runs in-process
+const usesAddon = (outputPath = "") =>
+  edgeops !== null && !isPyramidPath(outputPath);
+
+// Flags passed to every run, also part of the key under which identical jobs are coalesced
+const operatorFlags = () => {
+  // Extra execution flags, e.g. OPERATOR_FLAGS="--threads=2 --pin=compact" to bound each job
+  const flags = (process.env.OPERATOR_FLAGS || "")
+    .split(/\s+/)
+    .filter((flag) => flag.length > 0);
+
+  // Optional per-job deadline, e.g. OPERATOR_TIMEOUT_MS=30000; the operator stops itself at its
+  // next check, and is killed if it has not exited a grace period later
+  const timeoutMs = parseInt(process.env.OPERATOR_TIMEOUT_MS, 10);
+  if (timeoutMs > 0) {
+    flags.push(`--deadline-ms=${timeoutMs}`);
+  }
+  return flags;
+};
+
+// Runs the operator on the libuv thread pool through the addon. Resolves with the same shape
+// as spawnOperator, the addon's status standing in for the exit code.
+const runInProcess = async ({
+  operator,
+  inputPath,
+  outputPath,
+  signal,
+  flags = operatorFlags(),
+}) => {
+  const input = await fs.promises.readFile(inputPath);
+  let output;
+  try {
+    output = await edgeops.processImage(operator, input, {
+      extension: path.extname(outputPath) || ".png",
+      flags,
+      signal,
+    });
+  } catch (err) {
+    if (err.status === undefined) {
+      throw err;
+    }
+    console.error(`edgeops: ${err.message}`);
+    return { code: err.status, signal: null, stdoutOutput: "", stderrOutput: err.message };
+  }
+  await fs.promises.writeFile(outputPath, output);
+  return { code: 0, signal: null, stdoutOutput: "", stderrOutput: "" };
+};
+
+// Runs the operator executable once and resolves with its exit status and output.
+// The process runs in the executable's directory through spawn's cwd option rather than
+// process.chdir, which would change the directory of every concurrent job.
+const spawnOperator = ({
+  executablePath,
+  operatorProcess,
+  operator,
+  inputPath,
+  outputPath,
+  signal,
+  flags = operatorFlags(),
+}) =>
+  new Promise((resolve, reject) => {
+    const timeoutMs = parseInt(process.env.OPERATOR_TIMEOUT_MS, 10);
+
+    // Collect stderr output
+    let stderrOutput = "";
+    let stdoutOutput = "";
+
+    const cppProcess = spawn(
+      operatorProcess,
+      [operator, inputPath, outputPath, ...flags],
+      { cwd: executablePath }
+    );
+
+    let killTimer = null;
+    if (timeoutMs > 0) {
+      killTimer = setTimeout(() => cppProcess.kill("SIGKILL"), timeoutMs + 5000);
+    }
+
+    // Stop the operator if the client goes away before the result is sent
+    const onAbort = () => {
+      if (cppProcess.exitCode === null) {
+        cppProcess.kill("SIGTERM");
+      }
+    };
+    if (signal) {
+      signal.addEventListener("abort", onAbort, { once: true });
+    }
+
+    cppProcess.stdout.on("data", (data) => {
+      const output = data.toString();
+      stdoutOutput += output;
+      // console.log(`stdout: ${output}`);
+    });
+
+    cppProcess.stderr.on("data", (data) => {
+      const error = data.toString();
+      stderrOutput += error;
+      console.error(`stderr: ${error}`);
+    });
+
+    cppProcess.on("close", (code, exitSignal) => {
+      // console.log("C++ process closed with code:", code);
+      clearTimeout(killTimer);
+      if (signal) {
+        signal.removeEventListener("abort", onAbort);
+      }
+      resolve({ code, signal: exitSignal, stdoutOutput, stderrOutput });
+    });
+
+    cppProcess.on("error", (err) => {
+      console.error("C++ process error:", err);
+      clearTimeout(killTimer);
+      if (signal) {
+        signal.removeEventListener("abort", onAbort);
+      }
+      reject(err);
+    });
+  });
+
+const runOperator = (options) =>
+  usesAddon(options.outputPath) ? runInProcess(options) : spawnOperator(options);
+
+module.exports = { runOperator, operatorFlags, usesAddon };
@@ -2,8 +2,15 @@ const express = require("express");
 const multer = require("multer");
 const cors = require("cors");
 const path = require("path");
-const { spawn } = require("child_process");
 const fs = require("fs");
+const { readImageSize } = require("../jobs/image_header");
+const {
+  runOperator,
+  operatorFlags,
+  usesAddon,
+} = require("../jobs/run_operator");
+const { JobQueue, QueueRejectedError } = require("../jobs/job_queue");
+const { JobCoalescer, jobKey } = require("../jobs/job_coalescer");
 const router = express.Router();
 
 // Configure CORS with environment variables or defaults for local development
@@ -67,6 +74,38 @@ router.options("*", cors());
 const uploadFolder = path.join(__dirname, "../../uploads");
 const resultsFolder = path.join(__dirname, "../../results");
 
+// Extension of the output images, e.g. OPERATOR_OUTPUT_FORMAT=pgm; by default that of the upload
+const outputFormat = (process.env.OPERATOR_OUTPUT_FORMAT || "").replace(/^\./, "");
+
+// Files older than this are removed; newer ones may belong to jobs that are still queued,
+// running or about to be fetched by the client
+const fileTtlMs = parseInt(process.env.FILE_TTL_MS, 10) || 10 * 60 * 1000;
+
+const readPositiveInt = (value) => {
+  const number = parseInt(value, 10);
+  return number > 0 ? number : undefined;
+};
+
+const readNonNegativeInt = (value) => {
+  const number = parseInt(value, 10);
+  return number >= 0 ? number : undefined;
+};
+
+// Admission control and size-aware scheduling in front of the operator processes,
+// see src/jobs/job_queue.js
+const smallJobMegapixels = readPositiveInt(process.env.OPERATOR_SMALL_JOB_MEGAPIXELS);
+const jobQueue = new JobQueue({
+  concurrency: readPositiveInt(process.env.OPERATOR_CONCURRENCY),
+  maxQueued: readPositiveInt(process.env.OPERATOR_MAX_QUEUED),
+  sloMs: readPositiveInt(process.env.OPERATOR_QUEUE_SLO_MS),
+  msPerMegapixel: readPositiveInt(process.env.OPERATOR_MS_PER_MEGAPIXEL),
+  smallJobPixels: smallJobMegapixels && smallJobMegapixels * 1e6,
+  smallSlots: readNonNegativeInt(process.env.OPERATOR_SMALL_SLOTS),
+});
+
+// Concurrent requests for the same input, operator and flags share one run
+const jobCoalescer = new JobCoalescer();
+
 // Function to clean folders
 const cleanFolders = () => {
   try {
@@ -81,16 +120,16 @@ const cleanFolders = () => {
       // console.log("Created results folder");
     }
 
-    // Read and remove all files in uploads folder
-    const uploadFiles = fs.readdirSync(uploadFolder);
-    for (const file of uploadFiles) {
-      fs.unlinkSync(path.join(uploadFolder, file));
-    }
-
-    // Read and remove all files in results folder
-    const resultFiles = fs.readdirSync(resultsFolder);
-    for (const file of resultFiles) {
-      fs.unlinkSync(path.join(resultsFolder, file));
+    // Remove expired files from the uploads and results folders, and the tile folders of
+    // pyramid results
+    const now = Date.now();
+    for (const folder of [uploadFolder, resultsFolder]) {
+      for (const file of fs.readdirSync(folder)) {
+        const filePath = path.join(folder, file);
+        if (now - fs.statSync(filePath).mtimeMs > fileTtlMs) {
+          fs.rmSync(filePath, { recursive: true, force: true });
+        }
+      }
     }
 
     // console.log("Cleaned uploads and results folders");
@@ -99,11 +138,19 @@ const cleanFolders = () => {
   }
 };
 
+const removeFile = (filePath) => {
+  fs.unlink(filePath, (err) => {
+    if (err && err.code !== "ENOENT") {
+      console.error("Failed to remove file:", err);
+    }
+  });
+};
+
 // Upload multer with unique filename and folder creation if does not exist
 const upload = multer({
   storage: multer.diskStorage({
     destination: (req, file, cb) => {
-      // Clean folders before new upload
+      // Clean expired files before new upload
       cleanFolders();
       cb(null, uploadFolder);
     },
@@ -114,8 +161,14 @@ const upload = multer({
   }),
 });
 
+// GET /operators/queue route to report the job queue state
+router.get("/queue", (req, res) => {
+  res.setHeader("Cache-Control", "no-store");
+  res.json({ ...jobQueue.snapshot(), coalescing: jobCoalescer.snapshot() });
+});
+
 // POST /operators/:operator route to process the uploaded image with the operator and saving the output image
-router.post("/:operator", upload.single("file"), (req, res) => {
+router.post("/:operator", upload.single("file"), async (req, res) => {
   const operator = req.params.operator;
   // console.log("Operator:", operator);
   const encodedOperator = encodeURIComponent(operator);
@@ -129,7 +182,9 @@ router.post("/:operator", upload.single("file"), (req, res) => {
   }
 
   const inputFilename = req.file.filename;
-  const outputFilename = `output-${inputFilename}`;
+  const outputFilename = outputFormat
+    ? `output-${path.parse(inputFilename).name}.${outputFormat}`
+    : `output-${inputFilename}`;
 
   const inputPath = path.join(uploadFolder, inputFilename);
   const outputPath = path.join(resultsFolder, outputFilename);
@@ -163,8 +218,8 @@ router.post("/:operator", upload.single("file"), (req, res) => {
   // console.log("Executable path:", executablePath);
   // console.log("Operator process:", operatorProcess);
 
-  // Check if executable exists
-  if (!fs.existsSync(operatorProcess)) {
+  // Check if executable exists; the in-process addon does not need it
+  if (!usesAddon(outputPath) && !fs.existsSync(operatorProcess)) {
     console.error("Operator executable not found at:", operatorProcess);
     return res.status(500).json({ error: "Operator executable not found." });
   }
@@ -175,106 +230,149 @@ router.post("/:operator", upload.single("file"), (req, res) => {
     return res.status(400).json({ error: "Invalid image file: File is empty" });
   }
 
-  try {
-    // Change to executable directory
-    const currentDir = process.cwd();
-    // console.log("Current directory before change:", currentDir);
-    process.chdir(executablePath);
-    // console.log("Directory changed to:", process.cwd());
-  } catch (err) {
-    console.error(
-      "Failed to change directory:",
-      err,
-      "current directory:",
-      __dirname,
-      "executable path:",
-      executablePath
-    );
+  // Optional region of interest "x,y,width,height"; only that rectangle of the image is processed
+  // and returned, so the job costs about its area
+  const roi = req.body.roi || req.query.roi;
+  const roiMatch = roi && /^(\d+),(\d+),(\d+),(\d+)$/.exec(roi);
+  if (roi && (!roiMatch || Number(roiMatch[3]) === 0 || Number(roiMatch[4]) === 0)) {
+    removeFile(inputPath);
     return res
-      .status(500)
-      .json({ error: "Internal server error: directory change failed." });
+      .status(400)
+      .json({ error: "Invalid roi, expected x,y,width,height" });
+  }
+  const flags = roi ? [...operatorFlags(), `--roi=${roi}`] : operatorFlags();
+
+  // Estimate the cost from the header; unknown formats assume about 4 pixels per byte
+  const imageSize = await readImageSize(inputPath);
+  let pixels = imageSize
+    ? imageSize.width * imageSize.height
+    : req.file.size * 4;
+  if (roiMatch) {
+    // Only raw layouts are read within the region; other formats are decoded whole first, so
+    // the job costs the full decode plus the detection on the region
+    const roiPixels = Math.min(pixels, Number(roiMatch[3]) * Number(roiMatch[4]));
+    pixels = imageSize && imageSize.regionDecodable ? roiPixels : pixels + roiPixels;
   }
 
-  // Collect stderr output
-  let stderrOutput = "";
-  let stdoutOutput = "";
-
-  const cppProcess = spawn(operatorProcess, [
-    encodedOperator,
-    inputPath,
-    outputPath,
-  ]);
+  // Runs the job through the queue; shared by every request that joins the same key
+  const startJob = async (abortSignal) => {
+    const job = jobQueue.submit({
+      operator: encodedOperator,
+      pixels,
+      run: () =>
+        runOperator({
+          executablePath,
+          operatorProcess,
+          operator: encodedOperator,
+          inputPath,
+          outputPath,
+          signal: abortSignal,
+          flags,
+        }),
+    });
+    abortSignal.addEventListener("abort", () => job.cancel(), { once: true });
+    const jobResult = await job.promise;
+    return { ...jobResult, outputPath, outputFilename };
+  };
 
-  cppProcess.stdout.on("data", (data) => {
-    const output = data.toString();
-    stdoutOutput += output;
-    // console.log(`stdout: ${output}`);
-  });
+  let coalesced;
+  try {
+    const key = await jobKey(inputPath, encodedOperator, flags);
+    coalesced = jobCoalescer.join(key, startJob);
+  } catch (err) {
+    console.error("Failed to hash input:", err);
+    return res.status(500).json({ error: "Failed to read uploaded file" });
+  }
 
-  cppProcess.stderr.on("data", (data) => {
-    const error = data.toString();
-    stderrOutput += error;
-    console.error(`stderr: ${error}`);
+  // Withdraw from the job if the client goes away before the result is sent; the job itself
+  // stops only when no other request is waiting for it
+  res.on("close", () => {
+    if (!res.writableEnded) {
+      coalesced.release();
+    }
   });
 
-  cppProcess.on("close", (code) => {
-    // console.log("C++ process closed with code:", code);
-
-    // Change back to original directory
-    try {
-      process.chdir(__dirname);
-      // console.log("Directory changed back to:", process.cwd());
-    } catch (err) {
-      console.error("Failed to change back to original directory:", err);
+  let result;
+  try {
+    result = await coalesced.promise;
+  } catch (err) {
+    if (res.writableEnded || res.destroyed) {
+      return;
     }
-
-    if (code !== 0) {
-      console.error(`C++ process exited with code ${code}`);
-
-      // Check if output file exists despite error
-      if (fs.existsSync(outputPath)) {
-        // console.log("Output file exists despite error code. Proceeding...");
-      } else {
-        return res.status(500).json({
-          error: "Processing failed",
-          details: stderrOutput || "No error details available",
-          exitCode: code,
-        });
+    if (err instanceof QueueRejectedError) {
+      console.error("Job rejected:", err.message);
+      if (!coalesced.shared) {
+        removeFile(inputPath);
       }
-    }
-
-    // Check if output file exists
-    if (!fs.existsSync(outputPath)) {
-      console.error("Output file not created:", outputPath);
-      return res.status(500).json({
-        error: "Output file not created",
-        details: stderrOutput || "No error details available",
+      res.setHeader("Retry-After", Math.max(1, Math.ceil(err.retryAfterMs / 1000)));
+      return res.status(503).json({
+        error: "Server busy, please try again shortly",
+        details: err.message,
       });
     }
+    console.error("Failed to start subprocess:", err);
+    return res.status(500).json({
+      error: "Failed to start subprocess",
+      details: err.message,
+    });
+  }
+
+  // A coalesced request answers with the output of the run it attached to
+  const { code, signal, stderrOutput } = result;
+  const resultPath = result.outputPath;
+
+  // Nobody is waiting for the result any more
+  if (res.writableEnded || res.destroyed) {
+    return;
+  }
 
-    // console.log("Input filename:", inputFilename);
-    // console.log("Output filename:", outputFilename);
-    res.json({
-      inputImage: inputFilename,
-      outputImage: outputFilename,
+  // Exit code 2 means the operator stopped on its deadline or a signal
+  if (code === 2 || signal === "SIGKILL") {
+    console.error("C++ process cancelled:", stderrOutput);
+    return res.status(504).json({
+      error: "Processing timed out",
+      details: stderrOutput || "No error details available",
     });
-  });
+  }
+
+  // Exit code 3 means the input's header showed it would not fit the resource limits
+  if (code === 3) {
+    console.error("C++ process rejected the input:", stderrOutput);
+    return res.status(413).json({
+      error: "Image too large",
+      details: stderrOutput || "No error details available",
+    });
+  }
 
-  cppProcess.on("error", (err) => {
-    console.error("C++ process error:", err);
+  if (code !== 0) {
+    console.error(`C++ process exited with code ${code}`);
 
-    // Change back to original directory
-    try {
-      process.chdir(__dirname);
-    } catch (dirErr) {
-      console.error("Failed to change back to original directory:", dirErr);
+    // Check if output file exists despite error
+    if (fs.existsSync(resultPath)) {
+      // console.log("Output file exists despite error code. Proceeding...");
+    } else {
+      return res.status(500).json({
+        error: "Processing failed",
+        details: stderrOutput || "No error details available",
+        exitCode: code,
+      });
     }
+  }
 
-    console.error("Failed to start subprocess:", err);
+  // Check if output file exists
+  if (!fs.existsSync(resultPath)) {
+    console.error("Output file not created:", resultPath);
     return res.status(500).json({
-      error: "Failed to start subprocess",
-      details: err.message,
+      error: "Output file not created",
+      details: stderrOutput || "No error details available",
     });
+  }
+
+  // console.log("Input filename:", inputFilename);
+  // console.log("Output filename:", outputFilename);
+  res.json({
+    inputImage: inputFilename,
+    outputImage: result.outputFilename,
   });
 });
 